@@ -262,22 +262,37 @@ int RISCV_sscanf(const char *s, const char *fmt, ...);
 #define RISCV_printf0(fmt, ...) \
     RISCV_printf(getInterface(IFACE_SERVICE), 0, fmt, __VA_ARGS__)
 
+/**
+ * Level is checked before any formatting or locking. Inside of a service
+ * getLogLevel() resolves to IService::getLogLevel(), otherwise to the
+ * namespace function below and the check is done by RISCV_printf.
+ */
+#define RISCV_log_enabled(level) \
+    ((level) <= getLogLevel())
+
 /** Output with the maximal logging level */
 #define RISCV_error(fmt, ...) \
+    (RISCV_log_enabled(LOG_ERROR) ? \
     RISCV_printf(getInterface(IFACE_SERVICE), LOG_ERROR, "%s:%d " fmt, \
-                 __FILE__, __LINE__, __VA_ARGS__)
+                 __FILE__, __LINE__, __VA_ARGS__) : 0)
 
 /** Output with the information logging level */
 #define RISCV_important(fmt, ...) \
-    RISCV_printf(getInterface(IFACE_SERVICE), LOG_IMPORTANT, fmt, __VA_ARGS__)
+    (RISCV_log_enabled(LOG_IMPORTANT) ? \
+    RISCV_printf(getInterface(IFACE_SERVICE), LOG_IMPORTANT, fmt, \
+                 __VA_ARGS__) : 0)
 
 /** Output with the information logging level */
 #define RISCV_info(fmt, ...) \
-    RISCV_printf(getInterface(IFACE_SERVICE), LOG_INFO, fmt, __VA_ARGS__)
+    (RISCV_log_enabled(LOG_INFO) ? \
+    RISCV_printf(getInterface(IFACE_SERVICE), LOG_INFO, fmt, \
+                 __VA_ARGS__) : 0)
 
 /** Output with the lower logging level */
 #define RISCV_debug(fmt, ...) \
-    RISCV_printf(getInterface(IFACE_SERVICE), LOG_DEBUG, fmt, __VA_ARGS__)
+    (RISCV_log_enabled(LOG_DEBUG) ? \
+    RISCV_printf(getInterface(IFACE_SERVICE), LOG_DEBUG, fmt, \
+                 __VA_ARGS__) : 0)
 
 /** Suspend thread on certain number of milliseconds */
 void RISCV_sleep_ms(int ms);
@@ -291,6 +306,9 @@ int RISCV_get_pid();
 /** Memory barrier */
 void RISCV_memory_barrier();
 
+/** Atomically write 'val' into '*dst' if it equals 'cmp'. Return 1 if done */
+int RISCV_atomic_cas_ptr(void * volatile *dst, void *cmp, void *val);
+
 void RISCV_thread_create(void *data);
 uint64_t RISCV_thread_id();
 
@@ -350,6 +368,9 @@ void RISCV_file_close(file_def *f);
 }
 #endif
 
+/** Default logging level for the contexts without IService */
+static inline int getLogLevel() { return LOG_DEBUG; }
+
 }  // namespace debugger
 
 #endif  // __DEBUGGER_API_CORE_H__
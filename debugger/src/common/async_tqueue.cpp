@@ -73,65 +73,150 @@ void AsyncTQueueType::initProc() {
 
 /** Clock queue */
 ClockAsyncTQueueType::ClockAsyncTQueueType() {
-    size_ = 1;
+    size_ = 16;
     queue_ = new StepQueueItemType[size_];
+    prequeue_ = 0;
 
     RISCV_mutex_init(&mutex_);
     hardReset();
 }
 
 ClockAsyncTQueueType::~ClockAsyncTQueueType() {
+    freePreQueued();
     RISCV_mutex_destroy(&mutex_);
     delete [] queue_;
 }
 
 void ClockAsyncTQueueType::hardReset() {
+    RISCV_mutex_lock(&mutex_);
+    freePreQueued();
     item_total_ = 0;
-    precnt_ = 0;
-    item_cnt_ = 0;
+    next_time_ = ~0ull;
+    update_cnt_ = 0;
+    RISCV_mutex_unlock(&mutex_);
 }
 
+void ClockAsyncTQueueType::freePreQueued() {
+    PreQueueItemType *p;
+    do {
+        p = prequeue_;
+    } while (!RISCV_atomic_cas_ptr(
+                reinterpret_cast<void * volatile *>(&prequeue_), p, 0));
+    while (p) {
+        PreQueueItemType *next = p->next;
+        delete p;
+        p = next;
+    }
+}
 
 void ClockAsyncTQueueType::put(uint64_t time, IFace *cb) {
-    RISCV_mutex_lock(&mutex_);
-    if (precnt_ >= 1024) {
-        RISCV_mutex_unlock(&mutex_);
-        RISCV_printf(0, 0, "clock pre-queue overflow: %d", precnt_);
-        return;
-    }
-    prequeue_[precnt_].left = 0;
-    prequeue_[precnt_].right = 0;
-    prequeue_[precnt_].time = time;
-    prequeue_[precnt_++].iface = cb;
-    RISCV_mutex_unlock(&mutex_);
+    PreQueueItemType *p = new PreQueueItemType;
+    p->time = time;
+    p->iface = cb;
+    do {
+        p->next = prequeue_;
+    } while (!RISCV_atomic_cas_ptr(
+                reinterpret_cast<void * volatile *>(&prequeue_), p->next, p));
+    update_cnt_++;
 }
 
+/**
+ * @brief Re-schedule callback.
+ * @details Pre-queued items are only detached under the mutex, so that
+ *          the list can be walked here while other threads put new items.
+ */
 bool ClockAsyncTQueueType::move(IFace *cb, uint64_t time) {
     RISCV_mutex_lock(&mutex_);
-    for (int i = 0; i < precnt_; i++) {
-        if (prequeue_[i].iface == cb) {
-            prequeue_[i].time = time;
+    for (PreQueueItemType *p = prequeue_; p; p = p->next) {
+        if (p->iface == cb) {
+            p->time = time;
+            update_cnt_++;
             RISCV_mutex_unlock(&mutex_);
             return true;
         }
     }
     for (int i = 0; i < item_total_; i++) {
-        if (queue_[i].iface == cb) {
-            queue_[i].time = time;
-            RISCV_mutex_unlock(&mutex_);
-            return true;
+        if (queue_[i].iface != cb) {
+            continue;
+        }
+        uint64_t prev = queue_[i].time;
+        queue_[i].time = time;
+        if (time < prev) {
+            heapUp(i);
+        } else {
+            heapDown(i);
         }
+        next_time_ = queue_[0].time;
+        update_cnt_++;
+        RISCV_mutex_unlock(&mutex_);
+        return true;
     }
     RISCV_mutex_unlock(&mutex_);
     return false;
 }
 
-void ClockAsyncTQueueType::pushPreQueued() {
-    if (precnt_ == 0) {
-        return;
+void ClockAsyncTQueueType::getItems(AttributeType *list) {
+    pushPreQueued();
+    RISCV_mutex_lock(&mutex_);
+    StepQueueItemType *t = new StepQueueItemType[item_total_ + 1];
+    // Insertion sort, the queue is short
+    for (int i = 0; i < item_total_; i++) {
+        int n = i;
+        while (n > 0 && t[n - 1].time > queue_[i].time) {
+            t[n] = t[n - 1];
+            n--;
+        }
+        t[n] = queue_[i];
+    }
+    list->make_list(item_total_);
+    for (int i = 0; i < item_total_; i++) {
+        (*list)[i].make_list(2);
+        (*list)[i][0u].make_uint64(t[i].time);
+        (*list)[i][1].make_iface(t[i].iface);
     }
+    RISCV_mutex_unlock(&mutex_);
+    delete [] t;
+}
+
+void ClockAsyncTQueueType::pushPreQueuedLocked() {
+    PreQueueItemType *p;
+    PreQueueItemType *fifo = 0;
+    RISCV_mutex_lock(&mutex_);
+    do {
+        p = prequeue_;
+    } while (!RISCV_atomic_cas_ptr(
+                reinterpret_cast<void * volatile *>(&prequeue_), p, 0));
+    // Restore registration order
+    while (p) {
+        PreQueueItemType *next = p->next;
+        p->next = fifo;
+        fifo = p;
+        p = next;
+    }
+    while (fifo) {
+        p = fifo->next;
+        heapInsert(fifo->time, fifo->iface);
+        delete fifo;
+        fifo = p;
+    }
+    RISCV_mutex_unlock(&mutex_);
+}
+
+IFace *ClockAsyncTQueueType::popNext(uint64_t step_cnt) {
+    IFace *ret = 0;
     RISCV_mutex_lock(&mutex_);
-    while ((precnt_ + item_total_) > size_) {
+    if (item_total_ && queue_[0].time <= step_cnt) {
+        ret = queue_[0].iface;
+        queue_[0] = queue_[--item_total_];
+        heapDown(0);
+    }
+    next_time_ = item_total_ ? queue_[0].time : ~0ull;
+    RISCV_mutex_unlock(&mutex_);
+    return ret;
+}
+
+void ClockAsyncTQueueType::heapInsert(uint64_t time, IFace *cb) {
+    if (item_total_ == size_) {
         int t1 = 2*size_;
         StepQueueItemType *p1 = new StepQueueItemType[t1];
         memcpy(p1, queue_, item_total_*sizeof(StepQueueItemType));
@@ -139,36 +224,42 @@ void ClockAsyncTQueueType::pushPreQueued() {
         queue_ = p1;
         size_ = t1;
     }
-    memcpy(&queue_[item_total_], prequeue_, precnt_*sizeof(StepQueueItemType));
-    item_total_ += precnt_;
-    precnt_ = 0;
-    RISCV_mutex_unlock(&mutex_);
+    queue_[item_total_].time = time;
+    queue_[item_total_].iface = cb;
+    heapUp(item_total_++);
+    next_time_ = queue_[0].time;
 }
 
-
-IFace *ClockAsyncTQueueType::getNext(uint64_t step_cnt) {
-    IFace *ret = 0;
-    if (item_cnt_ >= item_total_) {
-        return ret;
-    }
-    for (; item_cnt_ < item_total_; item_cnt_++) {
-        if (step_cnt < queue_[item_cnt_].time) {
-            continue;
+void ClockAsyncTQueueType::heapUp(int idx) {
+    StepQueueItemType t = queue_[idx];
+    while (idx > 0) {
+        int parent = (idx - 1) >> 1;
+        if (queue_[parent].time <= t.time) {
+            break;
         }
-        ret = queue_[item_cnt_].iface;
+        queue_[idx] = queue_[parent];
+        idx = parent;
+    }
+    queue_[idx] = t;
+}
 
-        // remove item from list using swap function to avoid usage
-        // of allocation/deallocation calls.
-        if (item_cnt_ < (item_total_ - 1)) {
-            queue_[item_cnt_] = queue_[item_total_ - 1];
+void ClockAsyncTQueueType::heapDown(int idx) {
+    StepQueueItemType t = queue_[idx];
+    int child;
+    while ((child = 2*idx + 1) < item_total_) {
+        if (child + 1 < item_total_
+            && queue_[child + 1].time < queue_[child].time) {
+            child++;
+        }
+        if (t.time <= queue_[child].time) {
+            break;
         }
-        item_total_--;
-        break;
+        queue_[idx] = queue_[child];
+        idx = child;
     }
-    return ret;
+    queue_[idx] = t;
 }
 
-
 /** GUI queue */
 GuiAsyncTQueueType::GuiAsyncTQueueType() : AsyncTQueueType() {
     item_.make_list(Queue_Total);
@@ -51,6 +51,12 @@ class AsyncTQueueType {
 };
 
 
+/**
+ * Step callbacks queue. Registered callbacks are kept in the binary min-heap
+ * with the cached earliest time so that per-step check is one comparison.
+ * Registration from any thread is pushed into lock-free pre-queue (stack)
+ * without size limit and moved into the heap by the clock owner thread.
+ */
 class ClockAsyncTQueueType {
  public:
     ClockAsyncTQueueType();
@@ -59,14 +65,18 @@ class ClockAsyncTQueueType {
     /** Power ON/OFF cycle */
     void hardReset();
 
-    /** Thread safe method of the callbacks registration */
+    /** Thread safe lock-free method of the callbacks registration */
     void put(uint64_t time, IFace *cb);
 
     /** push registered to the main queue */
-    void pushPreQueued();
+    void pushPreQueued() {
+        if (prequeue_) {
+            pushPreQueuedLocked();
+        }
+    }
 
     /** Reset proccessed counter at the begining of each iteration */
-    void initProc() { item_cnt_ = 0; }
+    void initProc() {}
 
     /** move previously regsiterd callbacks: true: moved; false: not found */
     bool move(IFace *cb, uint64_t time);
@@ -74,22 +84,55 @@ class ClockAsyncTQueueType {
     /**
      * Get next registered interface with counter less or equal to 'step_cnt'
      */
-    IFace *getNext(uint64_t step_cnt);
+    IFace *getNext(uint64_t step_cnt) {
+        if (step_cnt < next_time_) {
+            return 0;
+        }
+        return popNext(step_cnt);
+    }
+
+    /**
+     * Earliest time of the registered callbacks. Returns 0 when there're
+     * not yet processed pre-queued items.
+     */
+    uint64_t getNextTime() {
+        if (prequeue_) {
+            return 0;
+        }
+        return next_time_;
+    }
+
+    /** Modification counter incremented on each put() or move() call */
+    unsigned getUpdateCnt() { return update_cnt_; }
+
+    /** Registered callbacks [[time, iface], ...] ordered by time */
+    void getItems(AttributeType *list);
+
+ private:
+    void pushPreQueuedLocked();
+    IFace *popNext(uint64_t step_cnt);
+    void heapInsert(uint64_t time, IFace *cb);
+    void heapUp(int idx);
+    void heapDown(int idx);
+    void freePreQueued();
 
  private:
     struct StepQueueItemType {
-        StepQueueItemType *left;
-        StepQueueItemType *right;
         uint64_t time;
         IFace *iface;
     };
-    StepQueueItemType *queue_;
+    struct PreQueueItemType {
+        PreQueueItemType *next;
+        uint64_t time;
+        IFace *iface;
+    };
+    StepQueueItemType *queue_;      // min-heap ordered by time
     int size_;
     int item_total_;
-    int item_cnt_;
+    volatile uint64_t next_time_;   // queue_[0].time or ~0ull if empty
 
-    int precnt_;
-    StepQueueItemType prequeue_[1024];
+    PreQueueItemType * volatile prequeue_;
+    volatile unsigned update_cnt_;
 
     mutex_def mutex_;
 };
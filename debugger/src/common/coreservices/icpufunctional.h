@@ -60,6 +60,8 @@ class ICpuFunctional : public IFace {
     ICpuFunctional() : IFace(IFACE_CPU_FUNCTIONAL) {}
 
     virtual void raiseSoftwareIrq() = 0;
+    /** Interrupt controller notifies about new request (wake-up from WFI) */
+    virtual void notifyInterrupt() = 0;
     virtual uint64_t *getpRegs() = 0;
     virtual uint64_t getPC() = 0;
     virtual void setPC(uint64_t v) = 0;
@@ -84,7 +86,11 @@ class ICpuFunctional : public IFace {
     virtual bool isMpuEnabled() = 0;
     virtual bool checkMpu(uint64_t addr, uint32_t sz, const char *rwx) = 0;
     virtual bool isMmuEnabled() = 0;
-    virtual uint64_t translateMmu(uint64_t addr) = 0;
+    /**
+     * Virtual to physical address translation for 'x', 'r' or 'w' access.
+     * @return false on page fault
+     */
+    virtual bool translateMmu(uint64_t va, const char *rwx, uint64_t *pa) = 0;
     virtual void flushMmu() = 0;
 
   protected:
@@ -40,6 +40,9 @@ class IElfReader : public IFace {
     virtual uint64_t sectionSize(unsigned idx) = 0;
 
     virtual uint8_t *sectionData(unsigned idx) = 0;
+
+    /** Not initialized data (.bss): zero-filled on loading */
+    virtual bool isSectionNoBits(unsigned idx) = 0;
 };
 
 }  // namespace debugger
@@ -49,6 +49,10 @@ class IIrqController : public IFace {
     // prioiry and enabled for context. Called by CPU.
     // @ret IRQ_REQUEST_NONE if no requests
     virtual int getPendingRequest(int ctxid) = 0;
+
+    // CPU (ICpuFunctional interface) to be notified on the new requests
+    // for the specified context.
+    virtual void registerListener(int ctxid, IFace *icpu) {}
 };
 
 }  // namespace debugger
@@ -42,6 +42,23 @@ class IJtagBitBang : public IFace {
     virtual void resetTAP(char trst, char srst) = 0;
     virtual void setPins(char tck, char tms, char tdi) = 0;
     virtual bool getTDO() = 0;
+
+    /**
+     * @brief Optional scan engine used to skip per-pin calls.
+     * @return true if TAP is in Shift-DR or Shift-IR state and the next
+     *         rising edge of TCK shifts the register.
+     */
+    virtual bool isShiftState() { return false; }
+
+    /**
+     * @brief Shift nbits (1..64) of the selected register at once.
+     * @param[in] tdi Bits shifted in, LSB first.
+     * @param[in] tms_last TMS value of the last bit, other bits use TMS=0.
+     * @return TDO bits sampled before every rising edge, LSB first.
+     */
+    virtual uint64_t shiftScan(uint64_t tdi, int nbits, char tms_last) {
+        return 0;
+    }
 };
 
 }  // namespace debugger
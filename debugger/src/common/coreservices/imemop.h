@@ -18,6 +18,7 @@
 #define __DEBUGGER_IMEMOP_PLUGIN_H__
 
 #include <inttypes.h>
+#include <string.h>
 #include <iface.h>
 #include <attribute.h>
 
@@ -27,6 +28,7 @@ class IService;
 static const char *const IFACE_MEMORY_OPERATION = "IMemoryOperation";
 static const char *const IFACE_AXI4_NB_RESPONSE = "IAxi4NbResponse";
 static const char *const IFACE_ADDRESS_TRANSLATOR = "IAddressTranslator";
+static const char *const IFACE_MEMORY_SNOOP = "IMemorySnoop";
 
 static const int PAYLOAD_MAX_BYTES = 8;
 
@@ -62,6 +64,39 @@ typedef struct Axi4TransactionType {
     int source_idx;             // Need for bus utilization statistic
 } Axi4TransactionType;
 
+/**
+ * Host buffer of the bulk transaction scatter list.
+ */
+typedef struct BulkBufferType {
+    uint8_t *ptr;
+    uint64_t size;              // [Bytes]
+} BulkBufferType;
+
+/**
+ * Bulk (burst) transaction: contiguous bus range starting from 'addr'
+ * transferred from/to the list of host buffers in a single call.
+ */
+typedef struct BulkTransactionType {
+    EAxi4Action action;
+    EAxi4Response response;
+    uint64_t addr;
+    int bufcnt;                 // scatter list size
+    BulkBufferType *buf;        // total length is the sum of buffer sizes
+    int source_idx;
+} BulkTransactionType;
+
+/**
+ * Direct memory interface (DMI) region: host pointer to the device storage
+ * that the initiator may access directly instead of b_transport() calls.
+ */
+typedef struct DmiRegionType {
+    uint64_t addr;              // bus address of the first byte
+    uint64_t size;              // [Bytes]
+    uint8_t *ptr;               // host pointer corresponding to 'addr'
+    bool rd;                    // read access allowed
+    bool wr;                    // write access allowed
+} DmiRegionType;
+
 /**
  * Non-blocking memory access response interface (Initiator/Master)
  */
@@ -72,6 +107,17 @@ class IAxi4NbResponse : public IFace {
     virtual void nb_response(Axi4TransactionType *trans) = 0;
 };
 
+/**
+ * Write notification for the initiators keeping decoded copy of memory
+ * content. Called in the context of the writer thread.
+ */
+class IMemorySnoop : public IFace {
+ public:
+    IMemorySnoop() : IFace(IFACE_MEMORY_SNOOP) {}
+
+    virtual void snoopWrite(uint64_t addr, uint64_t sz) = 0;
+};
+
 /**
  * Slave/Targer interface
  */
@@ -113,6 +159,64 @@ class IMemoryOperation : public IFace {
         return ret;
     }
 
+    /**
+     * Bulk transaction
+     *
+     * Plain memories and buses implement it natively. Default
+     * implementation splits the transfer into naturally aligned blocking
+     * transactions of up to PAYLOAD_MAX_BYTES.
+     */
+    virtual ETransStatus bulk_transport(BulkTransactionType *trans) {
+        Axi4TransactionType tr;
+        ETransStatus ret = TRANS_OK;
+        uint64_t addr = trans->addr;
+        tr.action = trans->action;
+        tr.source_idx = trans->source_idx;
+        trans->response = MemResp_Valid;
+        for (int i = 0; i < trans->bufcnt; i++) {
+            uint8_t *ptr = trans->buf[i].ptr;
+            uint64_t left = trans->buf[i].size;
+            while (left) {
+                uint32_t sz = PAYLOAD_MAX_BYTES;
+                while (sz > left || (addr & (sz - 1))) {
+                    sz >>= 1;
+                }
+                tr.addr = addr;
+                tr.xsize = sz;
+                tr.wstrb = 0;
+                tr.response = MemResp_Valid;
+                tr.rpayload.b64[0] = 0;
+                if (tr.action == MemAction_Write) {
+                    tr.wstrb = (1u << sz) - 1;
+                    memcpy(tr.wpayload.b8, ptr, sz);
+                }
+                if (b_transport(&tr) == TRANS_ERROR
+                    || tr.response == MemResp_Error) {
+                    trans->response = MemResp_Error;
+                    ret = TRANS_ERROR;
+                }
+                if (tr.action == MemAction_Read) {
+                    memcpy(ptr, tr.rpayload.b8, sz);
+                }
+                addr += sz;
+                ptr += sz;
+                left -= sz;
+            }
+        }
+        return ret;
+    }
+
+    /**
+     * Direct memory interface request
+     *
+     * Plain memory devices may return host pointer on storage containing
+     * address 'addr'. Default implementation doesn't allow direct access so
+     * that all transactions go via b_transport().
+     */
+    virtual bool get_direct_mem_ptr(uint64_t addr, DmiRegionType *dmi) {
+        return false;
+    }
+
     virtual uint64_t getBaseAddress() { return baseAddress_.to_uint64(); }
     virtual void setBaseAddress(uint64_t addr) {
         baseAddress_.make_uint64(addr);
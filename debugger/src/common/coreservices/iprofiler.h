@@ -0,0 +1,46 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <iface.h>
+
+namespace debugger {
+
+static const char *const IFACE_PROFILER = "IProfiler";
+
+/** Collector of the PC samples taken by CPU models */
+class IProfiler : public IFace {
+ public:
+    IProfiler() : IFace(IFACE_PROFILER) {}
+
+    /** Allocate samples storage of the CPU, @return CPU index or -1 */
+    virtual int registerCpu(const char *name) = 0;
+
+    /** Number of steps between samples */
+    virtual uint64_t getSamplePeriod() = 0;
+
+    /**
+     * @brief Store sample, called from the CPU thread.
+     * @param[in] stack  Stack trace buffer [[from, to], ...]
+     * @param[in] weight Number of periods represented by the sample
+     */
+    virtual void sample(int cpuidx, uint64_t pc, const uint64_t *stack,
+                        unsigned depth, uint64_t weight) = 0;
+};
+
+}  // namespace debugger
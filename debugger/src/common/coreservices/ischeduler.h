@@ -0,0 +1,53 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <iface.h>
+
+namespace debugger {
+
+static const char *const IFACE_QUANTUM_EXECUTOR = "IQuantumExecutor";
+
+/** Hart driven by the external scheduler instead of its own thread */
+class IQuantumExecutor : public IFace {
+ public:
+    IQuantumExecutor() : IFace(IFACE_QUANTUM_EXECUTOR) {}
+
+    /**
+     * @brief Execute instructions in the caller thread.
+     * @details Sleeping hart skips to the end of quantum, halted hart
+     *          returns after processing the pending debug requests.
+     * @return Number of steps advanced, 0 if the hart isn't running.
+     */
+    virtual uint64_t executeQuantum(uint64_t steps) = 0;
+
+    /** Steps skipped in the sleep state instead of execution */
+    virtual uint64_t getIdleSteps() = 0;
+};
+
+static const char *const IFACE_HART_SCHEDULER = "IHartScheduler";
+
+class IHartScheduler : public IFace {
+ public:
+    IHartScheduler() : IFace(IFACE_HART_SCHEDULER) {}
+
+    /** Harts are executed in the registration order */
+    virtual void registerHart(IQuantumExecutor *ihart) = 0;
+};
+
+}  // namespace debugger
@@ -0,0 +1,96 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <inttypes.h>
+#include <string.h>
+#include <iface.h>
+#include <attribute.h>
+
+namespace debugger {
+
+static const char *const IFACE_SNAPSHOT = "ISnapshot";
+
+/** Granularity of the memory images */
+static const int SNAPSHOT_PAGE_BITS = 12;
+static const int SNAPSHOT_PAGE_SIZE = 1 << SNAPSHOT_PAGE_BITS;
+
+/**
+ * @brief Checkpoint support of the simulated object.
+ * @details Registered as a service interface or as a port interface of
+ *          the registers. All methods are called with the CPUs halted,
+ *          ports are restored before the service state.
+ */
+class ISnapshot : public IFace {
+ public:
+    ISnapshot() : IFace(IFACE_SNAPSHOT) {}
+
+    /** Registers, counters, FIFOs and other internal state */
+    virtual void saveState(AttributeType *state) = 0;
+    virtual void restoreState(const AttributeType *state) = 0;
+
+    /** Memory image size in bytes, 0 if there's no storage */
+    virtual uint64_t getStorageSize() { return 0; }
+
+    /**
+     * @brief Host pointer to the storage page.
+     * @return 0 for the not allocated page of the sparse storage that
+     *         reads as zeros, unless 'alloc' is set.
+     */
+    virtual uint8_t *getStoragePage(uint64_t off, bool alloc) { return 0; }
+
+    /** Drop the whole content so that storage reads as zeros */
+    virtual void clearStorage() {}
+
+    /**
+     * @brief Use page-aligned file region as the storage content.
+     * @details Region is mapped privately, so the pages are shared with
+     *          the file and the other simulators until the first write.
+     * @return false if not supported, the caller copies data instead.
+     */
+    virtual bool mapStorage(uint64_t off, uint64_t size,
+                            int fd, uint64_t fileoff) {
+        return false;
+    }
+
+    /**
+     * @brief In-process copy-on-write snapshot of the storage.
+     * @details takeStorage() keeps the current content, pages are copied
+     *          only when modified. rollbackStorage() brings the kept
+     *          content back and can be called several times.
+     * @return false if not supported, the caller copies pages instead.
+     */
+    virtual bool takeStorage() { return false; }
+    virtual bool rollbackStorage() { return false; }
+
+ protected:
+    /** Copy saved binary block if it exists and has the expected size */
+    bool restoreData(const AttributeType *state, const char *key,
+                     void *p, unsigned sz) {
+        if (!state->has_key(key)) {
+            return false;
+        }
+        const AttributeType &t = (*state)[key];
+        if (!t.is_data() || t.size() != sz) {
+            return false;
+        }
+        memcpy(p, t.data(), sz);
+        return true;
+    }
+};
+
+}  // namespace debugger
@@ -87,6 +87,15 @@ class ISourceCode : public IFace {
 
     virtual void addressToSymbol(uint64_t addr, AttributeType *info) = 0;
 
+    /**
+     * Lookup without memory allocation for the frequently called paths.
+     * Returned pointer is valid until the symbols are changed.
+     *
+     * @param[out] offset Offset from the beginning of the symbol
+     * @return Symbol name or 0 if address doesn't belong to any symbol
+     */
+    virtual const char *addressToName(uint64_t addr, uint64_t *offset) = 0;
+
     virtual int symbol2Address(const char *name, uint64_t *addr) = 0;
 
     /** Disasm input data buffer.
@@ -16,6 +16,7 @@
 
 #include <api_core.h>
 #include "bus_generic.h"
+#include <algorithm>
 
 namespace debugger {
 
@@ -23,24 +24,22 @@ BusGeneric::BusGeneric(const char *name) : IService(name),
     IHap(HAP_ConfigDone) {
     registerInterface(static_cast<IMemoryOperation *>(this));
     registerAttribute("AddrWidth", &addrWidth_);
-    RISCV_mutex_init(&mutexBAccess_);
-    RISCV_mutex_init(&mutexNBAccess_);
+    RISCV_mutex_init(&mutexMap_);
     RISCV_register_hap(static_cast<IHap *>(this));
-    imaphash_ = 0;
-
-    memset(imemtbl_, 0, sizeof(imemtbl_));
-    for (int i = 0; i < HASH_TBL_SIZE; i++) {
-        imemtbl_[i].devlist.make_list(0);
-    }
+    decode_ = 0;
+    snoopcnt_ = 0;
     addrWidth_.make_int64(39);      // 39-bits address width for FU740
 }
 
 BusGeneric::~BusGeneric() {
-    RISCV_mutex_destroy(&mutexBAccess_);
-    RISCV_mutex_destroy(&mutexNBAccess_);
-    if (imaphash_) {
-        delete [] imaphash_;
+    DecodeTableType *tbl = decode_;
+    while (tbl) {
+        DecodeTableType *retired = tbl->retired;
+        delete [] tbl->items;
+        delete tbl;
+        tbl = retired;
     }
+    RISCV_mutex_destroy(&mutexMap_);
 }
 
 void BusGeneric::postinitService() {
@@ -48,7 +47,6 @@ void BusGeneric::postinitService() {
     HASH_MASK_ = (1ull << HASH_ADDR_WIDTH) - 1;
 
     HASH_LVL1_OFFSET_ = addrWidth_.to_int() - HASH_ADDR_WIDTH;
-    HASH_LVL2_OFFSET_ = addrWidth_.to_int() - 2*HASH_ADDR_WIDTH;
 
     IMemoryOperation *imem;
     for (unsigned i = 0; i < listMap_.size(); i++) {
@@ -83,11 +81,30 @@ void BusGeneric::postinitService() {
 void BusGeneric::hapTriggered(EHapType type,
                               uint64_t param,
                               const char *descr) {
-    RISCV_mutex_lock(&mutexNBAccess_);
-    RISCV_mutex_lock(&mutexBAccess_);
+    AttributeType lstSnoop;
+    RISCV_get_services_with_iface(IFACE_MEMORY_SNOOP, &lstSnoop);
+
+    RISCV_mutex_lock(&mutexMap_);
     maphash();
-    RISCV_mutex_unlock(&mutexBAccess_);
-    RISCV_mutex_unlock(&mutexNBAccess_);
+    int cnt = 0;
+    for (unsigned i = 0; i < lstSnoop.size() && cnt < SNOOP_MAX; i++) {
+        IService *iserv = static_cast<IService *>(lstSnoop[i].to_iface());
+        snoop_[cnt++] = static_cast<IMemorySnoop *>(
+                        iserv->getInterface(IFACE_MEMORY_SNOOP));
+    }
+    RISCV_memory_barrier();
+    snoopcnt_ = cnt;
+    RISCV_mutex_unlock(&mutexMap_);
+}
+
+/** Device mapped after configuration requires new decode table */
+void BusGeneric::map(IMemoryOperation *imemop) {
+    RISCV_mutex_lock(&mutexMap_);
+    IMemoryOperation::map(imemop);
+    if (decode_) {
+        maphash();
+    }
+    RISCV_mutex_unlock(&mutexMap_);
 }
 
 ETransStatus BusGeneric::b_transport(Axi4TransactionType *trans) {
@@ -95,8 +112,6 @@ ETransStatus BusGeneric::b_transport(Axi4TransactionType *trans) {
     uint32_t sz;
     IMemoryOperation *memdev = 0;
 
-    RISCV_mutex_lock(&mutexBAccess_);
-
     getMapedDevice(trans, &memdev, &sz);
 
     if (memdev == 0) {
@@ -106,11 +121,13 @@ ETransStatus BusGeneric::b_transport(Axi4TransactionType *trans) {
         ret = TRANS_ERROR;
     } else {
         memdev->b_transport(trans);
+        if (trans->action == MemAction_Write) {
+            snoopWrite(trans->addr, trans->xsize);
+        }
         RISCV_debug("[%08" RV_PRI64 "x] => [%08x %08x]",
             trans->addr,
             trans->rpayload.b32[1], trans->rpayload.b32[0]);
     }
-    RISCV_mutex_unlock(&mutexBAccess_);
     return ret;
 }
 
@@ -120,8 +137,6 @@ ETransStatus BusGeneric::nb_transport(Axi4TransactionType *trans,
     IMemoryOperation *memdev = 0;
     uint32_t sz;
 
-    RISCV_mutex_lock(&mutexNBAccess_);
-
     getMapedDevice(trans, &memdev, &sz);
 
     if (memdev == 0) {
@@ -133,62 +148,227 @@ ETransStatus BusGeneric::nb_transport(Axi4TransactionType *trans,
         ret = TRANS_ERROR;
     } else {
         memdev->nb_transport(trans, cb);
+        if (trans->action == MemAction_Write) {
+            snoopWrite(trans->addr, trans->xsize);
+        }
         RISCV_debug("Non-blocking request to [%08" RV_PRI64 "x]",
                     trans->addr);
     }
-    RISCV_mutex_unlock(&mutexNBAccess_);
     return ret;
 }
 
+/**
+ * Forward one sub-transaction per buffer and device crossing.
+ */
+ETransStatus BusGeneric::bulk_transport(BulkTransactionType *trans) {
+    ETransStatus ret = TRANS_OK;
+    IMemoryOperation *memdev;
+    Axi4TransactionType tr;
+    BulkTransactionType sub;
+    BulkBufferType buf;
+    uint32_t sz;
+
+    sub.action = trans->action;
+    sub.source_idx = trans->source_idx;
+    sub.bufcnt = 1;
+    sub.buf = &buf;
+    trans->response = MemResp_Valid;
+    tr.addr = trans->addr;
+    for (int i = 0; i < trans->bufcnt; i++) {
+        buf.ptr = trans->buf[i].ptr;
+        uint64_t left = trans->buf[i].size;
+        while (left) {
+            getMapedDevice(&tr, &memdev, &sz);
+            buf.size = left < sz ? left : sz;
+            if (memdev == 0) {
+                RISCV_error("Bulk request to unmapped address "
+                            "%08" RV_PRI64 "x", tr.addr);
+                if (trans->action == MemAction_Read) {
+                    memset(buf.ptr, 0xFF, static_cast<size_t>(left));
+                }
+                trans->response = MemResp_Error;
+                return TRANS_ERROR;
+            }
+            sub.addr = tr.addr;
+            if (memdev->bulk_transport(&sub) == TRANS_ERROR
+                || sub.response == MemResp_Error) {
+                trans->response = MemResp_Error;
+                ret = TRANS_ERROR;
+            }
+            if (trans->action == MemAction_Write) {
+                snoopWrite(tr.addr, buf.size);
+            }
+            RISCV_debug("Bulk [%08" RV_PRI64 "x] %" RV_PRI64 "d bytes",
+                        tr.addr, buf.size);
+            tr.addr += buf.size;
+            buf.ptr += buf.size;
+            left -= buf.size;
+        }
+    }
+    return ret;
+}
+
+/**
+ * Forward DMI request to the slave device. Granted region is limited by the
+ * decoded range so that it never includes addresses of other devices.
+ */
+bool BusGeneric::get_direct_mem_ptr(uint64_t addr, DmiRegionType *dmi) {
+    IMemoryOperation *memdev = 0;
+    Axi4TransactionType tr;
+    uint32_t sz;
+    uint64_t start;
+
+    tr.addr = addr;
+    getMapedDevice(&tr, &memdev, &sz, &start);
+    if (memdev == 0 || (addr & ~ADDR_MASK_)
+        || !memdev->get_direct_mem_ptr(addr, dmi)) {
+        return false;
+    }
+
+    // Clip to the decoded interval [start, addr + sz), so that the region
+    // doesn't cover overlays of the higher priority devices
+    uint64_t lo = dmi->addr;
+    uint64_t hi = dmi->addr + dmi->size;
+    if (lo < start) {
+        dmi->ptr += start - lo;
+        lo = start;
+    }
+    if (hi > addr + sz) {
+        hi = addr + sz;
+    }
+    if (lo > addr || hi <= addr) {
+        return false;
+    }
+    dmi->addr = lo;
+    dmi->size = hi - lo;
+    return true;
+}
+
+/**
+ * Lock-free lookup: binary search in the sorted ranges limited by
+ * the first level hash item.
+ */
 void BusGeneric::getMapedDevice(Axi4TransactionType *trans,
-                         IMemoryOperation **pdev, uint32_t *sz) {
-    IMemoryOperation *imem;
-    uint64_t bar, barsz;
+                         IMemoryOperation **pdev, uint32_t *sz,
+                         uint64_t *start) {
+    DecodeTableType *tbl = decode_;
     *pdev = 0;
     *sz = 0;
+    if (tbl == 0) {
+        return;
+    }
 
-    uint64_t hashidx = (trans->addr & ADDR_MASK_) >> HASH_LVL1_OFFSET_;
-    HashTableItemType &item = imemtbl_[hashidx];
-    if (item.idev) {
+    uint64_t addr = trans->addr & ADDR_MASK_;
+    uint64_t hashidx = addr >> HASH_LVL1_OFFSET_;
+    int lo = tbl->first[hashidx];
+    int hi = tbl->last[hashidx];
+    int mid;
+    while (lo < hi) {
+        mid = (lo + hi) >> 1;
+        if (tbl->items[mid].end <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < tbl->last[hashidx] && tbl->items[lo].start <= addr) {
+        DecodeItemType &item = tbl->items[lo];
         *pdev = item.idev;
-    } else if (item.nxtlvlena) {
-        for (unsigned i = 0; i < item.devlist.size(); i++) {
-            imem = static_cast<IMemoryOperation *>(item.devlist[i].to_iface());
-            bar = imem->getBaseAddress();
-            barsz = imem->getLength();
-            if (bar <= trans->addr && trans->addr < (bar + barsz)) {
-                if (!(*pdev) || imem->getPriority() > (*pdev)->getPriority()) {
-                    *pdev = imem;
-                }
-            }
+        if (start) {
+            *start = item.start;
+        }
+        if ((item.end - addr) > 0xFFFFFFFFull) {
+            *sz = 0xFFFFFFFFul;
+        } else {
+            *sz = static_cast<uint32_t>(item.end - addr);
         }
     }
 }
 
+/**
+ * Build new decode table: split address space on ranges owned by the
+ * device with the highest priority (the first mapped on equal priority),
+ * then publish it.
+ */
 void BusGeneric::maphash() {
-    IMemoryOperation *imem;
-    uint64_t first, last;
-    uint64_t bar;
-    for (unsigned i = 0; i < imap_.size(); i++) {
+    IMemoryOperation *imem, *idev;
+    uint64_t bar, barend;
+    uint64_t addrmax = ADDR_MASK_ + 1;
+    unsigned devtotal = imap_.size();
+    DecodeTableType *tbl = new DecodeTableType;
+    uint64_t *bnd = new uint64_t[2*devtotal + 1];
+    int bndcnt = 0;
+
+    for (unsigned i = 0; i < devtotal; i++) {
         imem = static_cast<IMemoryOperation *>(imap_[i].to_iface());
-        bar = imem->getBaseAddress();
-        first = (bar >> HASH_LVL1_OFFSET_) & HASH_MASK_;
-        last = ((bar + imem->getLength()) >> HASH_LVL1_OFFSET_) & HASH_MASK_;
-
-        for (uint64_t n = first; n <= last; n++) {
-            HashTableItemType &item = imemtbl_[n];
-            if (!item.nxtlvlena && !item.idev) {
-                item.idev = imem;
-            } else if (item.idev) {
-                item.nxtlvlena = true;
-                item.devlist.new_list_item().make_iface(item.idev);
-                item.devlist.new_list_item().make_iface(imem);
-                item.idev = 0;
-            } else {
-                item.devlist.new_list_item().make_iface(imem);
+        if (imem->getLength() == 0) {
+            continue;
+        }
+        bar = imem->getBaseAddress() & ADDR_MASK_;
+        barend = bar + imem->getLength();
+        if (barend > addrmax) {
+            barend = addrmax;
+        }
+        bnd[bndcnt++] = bar;
+        bnd[bndcnt++] = barend;
+    }
+    std::sort(bnd, bnd + bndcnt);
+    bndcnt = static_cast<int>(std::unique(bnd, bnd + bndcnt) - bnd);
+
+    tbl->total = 0;
+    tbl->items = new DecodeItemType[bndcnt + 1];
+    for (int k = 0; k < bndcnt - 1; k++) {
+        idev = 0;
+        for (unsigned i = 0; i < devtotal; i++) {
+            imem = static_cast<IMemoryOperation *>(imap_[i].to_iface());
+            bar = imem->getBaseAddress() & ADDR_MASK_;
+            if (bnd[k] < bar || bnd[k] >= (bar + imem->getLength())) {
+                continue;
+            }
+            if (!idev || imem->getPriority() > idev->getPriority()) {
+                idev = imem;
             }
         }
+        if (idev == 0) {
+            continue;
+        }
+        DecodeItemType *prv = 0;
+        if (tbl->total) {
+            prv = &tbl->items[tbl->total - 1];
+        }
+        if (prv && prv->idev == idev && prv->end == bnd[k]) {
+            prv->end = bnd[k + 1];
+        } else {
+            prv = &tbl->items[tbl->total++];
+            prv->start = bnd[k];
+            prv->end = bnd[k + 1];
+            prv->idev = idev;
+        }
     }
+    delete [] bnd;
+
+    int first = 0;
+    int last = 0;
+    for (uint64_t n = 0; n < HASH_TBL_SIZE; n++) {
+        uint64_t hstart = n << HASH_LVL1_OFFSET_;
+        uint64_t hend = (n + 1) << HASH_LVL1_OFFSET_;
+        while (first < tbl->total && tbl->items[first].end <= hstart) {
+            first++;
+        }
+        if (last < first) {
+            last = first;
+        }
+        while (last < tbl->total && tbl->items[last].start < hend) {
+            last++;
+        }
+        tbl->first[n] = first;
+        tbl->last[n] = last;
+    }
+
+    // Publish: readers may still use the previous table
+    tbl->retired = decode_;
+    RISCV_memory_barrier();
+    decode_ = tbl;
 }
 
 }  // namespace debugger
@@ -36,9 +36,12 @@ class BusGeneric : public IService,
     virtual void postinitService();
 
     /** IMemoryOperation interface */
+    virtual void map(IMemoryOperation *imemop);
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
     virtual ETransStatus nb_transport(Axi4TransactionType *trans,
                                       IAxi4NbResponse *cb);
+    virtual ETransStatus bulk_transport(BulkTransactionType *trans);
+    virtual bool get_direct_mem_ptr(uint64_t addr, DmiRegionType *dmi);
 
     /** IHap */
     virtual void hapTriggered(EHapType type, uint64_t param,
@@ -48,30 +51,48 @@ class BusGeneric : public IService,
     /** Speed-optimized mapping */
     virtual void maphash();
     void getMapedDevice(Axi4TransactionType *trans,
-                        IMemoryOperation **pdev, uint32_t *sz);
+                        IMemoryOperation **pdev, uint32_t *sz,
+                        uint64_t *start = 0);
+    void snoopWrite(uint64_t addr, uint64_t sz) {
+        for (int i = 0; i < snoopcnt_; i++) {
+            snoop_[i]->snoopWrite(addr, sz);
+        }
+    }
 
  protected:
     static const int HASH_ADDR_WIDTH = 14;
     static const int HASH_TBL_SIZE = 1 << HASH_ADDR_WIDTH;
     AttributeType addrWidth_;       // address bits (39 bits for FU740). [63:39] must be equal to [38]
-    mutex_def mutexBAccess_;
-    mutex_def mutexNBAccess_;
-    Axi4TransactionType b_tr_;
-    Axi4TransactionType nb_tr_;
+    mutex_def mutexMap_;            // serialize decode table rebuilding only
 
-    IMemoryOperation **imaphash_;
-
-    struct HashTableItemType {
-        bool nxtlvlena;
+    // Address range [start, end) owned by the device with highest priority
+    struct DecodeItemType {
+        uint64_t start;
+        uint64_t end;
         IMemoryOperation *idev;
-        HashTableItemType *tbl;
-        AttributeType devlist;
-    } imemtbl_[HASH_TBL_SIZE];
+    };
+
+    // Immutable decode table. New table is published on each map change
+    // so that transactions don't take any lock. Previous tables are kept
+    // until destruction because they may still be used by other threads.
+    // Devices serialize their own accesses.
+    struct DecodeTableType {
+        DecodeTableType *retired;
+        int total;
+        DecodeItemType *items;              // sorted non-overlapping ranges
+        int first[HASH_TBL_SIZE];           // items index range per hash
+        int last[HASH_TBL_SIZE];
+    };
+    DecodeTableType * volatile decode_;
+
+    // Initiators notified about writes via the bus
+    static const int SNOOP_MAX = 32;
+    IMemorySnoop *snoop_[SNOOP_MAX];
+    int snoopcnt_;
 
     uint64_t ADDR_MASK_;
     uint64_t HASH_MASK_;
     uint64_t HASH_LVL1_OFFSET_;
-    uint64_t HASH_LVL2_OFFSET_;
 };
 
 DECLARE_CLASS(BusGeneric)
@@ -19,6 +19,30 @@
 
 namespace debugger {
 
+int CpuICacheCmdType::isValid(AttributeType *args) {
+    if (!(*args)[0u].is_equal("icache")) {
+        return CMD_INVALID;
+    }
+    for (unsigned i = 1; i < args->size(); i++) {
+        if (!(*args)[i].is_string()) {
+            return CMD_WRONG_ARGS;
+        }
+        if (!(*args)[i].is_equal("clear")
+            && !(*args)[i].is_equal(cmdParent_->getObjName())) {
+            return CMD_INVALID;
+        }
+    }
+    return CMD_VALID;
+}
+
+void CpuICacheCmdType::exec(AttributeType *args, AttributeType *res) {
+    CpuGeneric *p = static_cast<CpuGeneric *>(cmdParent_);
+    p->getICacheStat(res);
+    if ((*args)[args->size() - 1].is_equal("clear")) {
+        p->clearICacheStat();
+    }
+}
+
 CpuGeneric::CpuGeneric(const char *name)  
     : IService(name), IHap(HAP_ConfigDone),
     portCSR_(this,  "csr",  0,     1<<12),
@@ -31,6 +55,9 @@ CpuGeneric::CpuGeneric(const char *name)
     registerInterface(static_cast<IDPort *>(this));
     registerInterface(static_cast<IPower *>(this));
     registerInterface(static_cast<IResetListener *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
+    registerInterface(static_cast<IQuantumExecutor *>(this));
+    registerInterface(static_cast<IMemorySnoop *>(this));
     registerInterface(static_cast<IHap *>(this));
     registerAttribute("Enable", &isEnable_);
     registerAttribute("SysBus", &sysBus_);
@@ -41,6 +68,9 @@ CpuGeneric::CpuGeneric(const char *name)
     registerAttribute("StackTraceSize", &stackTraceSize_);
     registerAttribute("FreqHz", &freqHz_);
     registerAttribute("GenerateTraceFile", &generateTraceFile_);
+    registerAttribute("TraceFormat", &traceFormat_);
+    registerAttribute("TraceWindow", &traceWindow_);
+    registerAttribute("TraceEnable", &traceEnable_);
     registerAttribute("ResetVector", &resetVector_);
     registerAttribute("SysBusMasterID", &sysBusMasterID_);
     registerAttribute("CacheBaseAddress", &cacheBaseAddr_);
@@ -49,12 +79,18 @@ CpuGeneric::CpuGeneric(const char *name)
     registerAttribute("TriggersTotal", &triggersTotal_);
     registerAttribute("McontrolMaskmax", &mcontrolMaskmax_);
     registerAttribute("ResetState", &resetState_);
+    registerAttribute("TranslationBlocks", &translationBlocks_);
+    registerAttribute("DirectMemAccess", &directMemAccess_);
+    registerAttribute("Scheduler", &scheduler_);
+    registerAttribute("Profiler", &profiler_);
 
     char tstr[256];
     RISCV_sprintf(tstr, sizeof(tstr), "eventConfigDone_%s", name);
     RISCV_event_create(&eventConfigDone_, tstr);
     RISCV_sprintf(tstr, sizeof(tstr), "eventDbgRequest_%s", name);
     RISCV_event_create(&eventDbgRequest_, tstr);
+    RISCV_sprintf(tstr, sizeof(tstr), "eventWakeup_%s", name);
+    RISCV_event_create(&eventWakeup_, tstr);
     RISCV_mutex_init(&mutex_csr_);
     RISCV_register_hap(static_cast<IHap *>(this));
 
@@ -65,6 +101,14 @@ CpuGeneric::CpuGeneric(const char *name)
     exceptions_ = 0;
     interrupt_pending_[0] = 0;
     interrupt_pending_[1] = 0;
+    sleep_ = false;
+    irq_possible_ = true;
+    trigger_data_hit_ = false;
+    idle_steps_ = 0;
+    quantumEnd_ = ~0ull;
+    profNext_ = ~0ull;
+    profidx_ = -1;
+    iprofiler_ = 0;
     do_not_cache_ = false;
     haltreq_ = false;
     procbufexecreq_ = false;
@@ -72,7 +116,15 @@ CpuGeneric::CpuGeneric(const char *name)
     resumeack_ = false;
 
     ptriggers_ = 0;
+    memset(&trigplan_, 0, sizeof(trigplan_));
     trace_file_ = 0;
+    tracewr_ = 0;
+    trace_enabled_ = false;
+    trace_trig_on_ = true;
+    trace_pending_ = false;
+    traceFormat_.make_string("text");
+    traceWindow_.make_list(0);
+    traceEnable_.make_boolean(true);
     trace_data_.step_cnt = 0;
     trace_data_.pc = 0;
     trace_data_.instrbuf.make_data(8);
@@ -82,12 +134,27 @@ CpuGeneric::CpuGeneric(const char *name)
 
     icache_ = 0;
     memcache_sz_ = 0;
+    icache_hits_ = 0;
+    icache_misses_ = 0;
+    pcmd_icache_ = 0;
     fetch_addr_ = 0;
     cache_offset_ = 0;
     cachable_pc_ = false;
     CACHE_BASE_ADDR_ = 0;
     CACHE_MASK_ = 0;
     oplen_ = 0;
+    tbcache_ = 0;
+    tbmask_ = 0;
+    tbcodemap_ = 0;
+    tbphysmap_ = 0;
+    tbflushreq_ = false;
+    tbrec_.size = 0;
+    fetch_paddr_ = 0;
+    decodeMode_ = 0;
+    memset(dmitlb_, 0, sizeof(dmitlb_));
+    dmitlb_idx_ = 0;
+    snoopcnt_ = 0;
+    directMemAccess_.make_boolean(true);
     RISCV_set_default_clock(static_cast<IClock *>(this));
 
     R = portRegs_.getpR64();
@@ -101,17 +168,30 @@ CpuGeneric::~CpuGeneric() {
     RISCV_set_default_clock(0);
     RISCV_event_close(&eventConfigDone_);
     RISCV_event_close(&eventDbgRequest_);
+    RISCV_event_close(&eventWakeup_);
     RISCV_mutex_destroy(&mutex_csr_);
     if (icache_) {
         delete [] icache_;
     }
     if (ptriggers_) {
         delete [] ptriggers_;
+        delete [] trigplan_.exec;
+        delete [] trigplan_.data;
+        delete [] trigplan_.icount;
+    }
+    if (tbcache_) {
+        delete [] tbcache_;
+        delete [] tbcodemap_;
+        delete [] tbphysmap_;
     }
     if (trace_file_) {
         trace_file_->close();
         delete trace_file_;
     }
+    if (tracewr_) {
+        tracewr_->close();
+        delete tracewr_;
+    }
 }
 
 void CpuGeneric::postinitService() {
@@ -148,6 +228,19 @@ void CpuGeneric::postinitService() {
         }
     }
 
+    iprofiler_ = 0;
+    if (profiler_.size()) {
+        iprofiler_ = static_cast<IProfiler *>(
+            RISCV_get_service_iface(profiler_.to_string(), IFACE_PROFILER));
+        if (!iprofiler_) {
+            RISCV_error("IProfiler interface '%s' not found",
+                        profiler_.to_string());
+        } else {
+            profidx_ = iprofiler_->registerCpu(getObjName());
+            profNext_ = iprofiler_->getSamplePeriod();
+        }
+    }
+
     icmdexec_ = static_cast<ICmdExecutor *>(
        RISCV_get_service_iface(cmdexec_.to_string(), IFACE_CMD_EXECUTOR));
     if (!icmdexec_) {
@@ -160,6 +253,10 @@ void CpuGeneric::postinitService() {
 
     ptriggers_ = new TriggerStorageType[triggersTotal_.to_int()];
     memset(ptriggers_, 0, triggersTotal_.to_int()*sizeof(TriggerStorageType));
+    trigplan_.exec = new TriggerMatchType[triggersTotal_.to_int()];
+    trigplan_.data = new TriggerMatchType[triggersTotal_.to_int()];
+    trigplan_.icount = new int[triggersTotal_.to_int()];
+    compileTriggers();
 
     CACHE_BASE_ADDR_ = cacheBaseAddr_.to_uint64();
     CACHE_MASK_ = ~cacheAddrMask_.to_uint64();
@@ -167,17 +264,56 @@ void CpuGeneric::postinitService() {
         memcache_sz_ = cacheAddrMask_.to_int() + 1;
         icache_ = new ICacheType[memcache_sz_];
         memset(icache_, 0, memcache_sz_*sizeof(ICacheType));
+
+        pcmd_icache_ = new CpuICacheCmdType(static_cast<IService *>(this));
+        icmdexec_->registerCommand(static_cast<ICommand *>(pcmd_icache_));
+    }
+
+    if (translationBlocks_.to_int() > 0) {
+        int tbtotal = 1;
+        while (tbtotal < translationBlocks_.to_int()) {
+            tbtotal <<= 1;
+        }
+        tbmask_ = tbtotal - 1;
+        tbcache_ = new TranslationBlockType[tbtotal];
+        tbcodemap_ = new uint8_t[(TB_CODEMAP_MASK + 1) / 8];
+        tbphysmap_ = new uint8_t[(TB_CODEMAP_MASK + 1) / 8];
+        flush(~0ull);
     }
 
     // Get global settings:
     const AttributeType *glb = RISCV_get_global_settings();
     if ((*glb)["SimEnable"].to_bool() && isEnable_.to_bool()) {
-        if (!run()) {
+        if (scheduler_.is_string() && scheduler_.size()) {
+            // Executed by the scheduler thread instead of own busyLoop
+            IHartScheduler *isched = static_cast<IHartScheduler *>(
+                RISCV_get_service_iface(scheduler_.to_string(),
+                                        IFACE_HART_SCHEDULER));
+            if (!isched) {
+                RISCV_error("IHartScheduler interface '%s' not found",
+                            scheduler_.to_string());
+                return;
+            }
+            isched->registerHart(static_cast<IQuantumExecutor *>(this));
+        } else if (!run()) {
             RISCV_error("Can't create thread.", NULL);
             return;
         }
         if (generateTraceFile_.is_string() && generateTraceFile_.size()) {
-            trace_file_ = new std::ofstream(generateTraceFile_.to_string());
+            if (traceFormat_.is_equal("binary")) {
+                tracewr_ = new TraceWriter(generateTraceFile_.to_string(),
+                                           sysBusMasterID_.to_uint32());
+                if (!tracewr_->isOpened()) {
+                    RISCV_error("Can't open trace file %s",
+                                generateTraceFile_.to_string());
+                    delete tracewr_;
+                    tracewr_ = 0;
+                }
+            } else {
+                trace_file_ = new std::ofstream(
+                                    generateTraceFile_.to_string());
+            }
+            trace_trig_on_ = traceEnable_.to_bool();
         }
     }
 
@@ -185,10 +321,29 @@ void CpuGeneric::postinitService() {
     setNPC(getResetAddress());
 }
 
+void CpuGeneric::predeleteService() {
+    if (pcmd_icache_) {
+        icmdexec_->unregisterCommand(static_cast<ICommand *>(pcmd_icache_));
+        delete pcmd_icache_;
+        pcmd_icache_ = 0;
+    }
+}
+
 void CpuGeneric::hapTriggered(EHapType type,
                               uint64_t param,
                               const char *descr) {
 	RISCV_unregister_hap(static_cast<IHap *>(this));
+    // Writes via DMI bypass the bus, other harts are notified directly
+    AttributeType lstSnoop;
+    RISCV_get_services_with_iface(IFACE_MEMORY_SNOOP, &lstSnoop);
+    for (unsigned i = 0; i < lstSnoop.size() && snoopcnt_ < SNOOP_MAX; i++) {
+        IService *iserv = static_cast<IService *>(lstSnoop[i].to_iface());
+        IMemorySnoop *isnoop = static_cast<IMemorySnoop *>(
+                        iserv->getInterface(IFACE_MEMORY_SNOOP));
+        if (isnoop != static_cast<IMemorySnoop *>(this)) {
+            snoop_[snoopcnt_++] = isnoop;
+        }
+    }
     RISCV_event_set(&eventConfigDone_);
 }
 
@@ -200,7 +355,34 @@ void CpuGeneric::busyLoop() {
     }
 }
 
+/**
+ * Run scheduled hart in the caller thread. Halted hart returns as soon as
+ * there's no pending debug request so that the other harts can continue.
+ */
+uint64_t CpuGeneric::executeQuantum(uint64_t steps) {
+    uint64_t start = step_cnt_;
+    uint64_t prev;
+    quantumEnd_ = step_cnt_ + steps;
+    while (step_cnt_ < quantumEnd_) {
+        prev = step_cnt_;
+        updatePipeline();
+        if (step_cnt_ == prev
+            && (estate_ == CORE_Halted || estate_ == CORE_OFF)) {
+            break;
+        }
+    }
+    return step_cnt_ - start;
+}
+
 void CpuGeneric::updatePipeline() {
+    if (sleep_ && updateSleep()) {
+        return;
+    }
+
+    if (tbcache_ && executeTranslationBlock()) {
+        return;
+    }
+
     if (!updateState()) {
         return;
     }
@@ -211,7 +393,9 @@ void CpuGeneric::updatePipeline() {
 
     if (!isTriggerInstruction()) {
         fetchILine();
-        instr_ = decodeInstruction(cacheline_);
+        if (!instr_) {
+            instr_ = decodeInstruction(cacheline_);
+        }
 
         trackContextStart();
         if (instr_) {
@@ -219,6 +403,9 @@ void CpuGeneric::updatePipeline() {
         } else {
             generateIllegalOpcode();
         }
+        if (tbcache_) {
+            recordTranslation();
+        }
         trackContextEnd();
 
         pc_z_ = getPC();
@@ -232,9 +419,194 @@ void CpuGeneric::updatePipeline() {
 
     handleTrap();
 
-    if (trace_file_) {
-        traceOutput();
+    if (trace_enabled_) {
+        if (tracewr_) {
+            traceOutputBinary();
+        } else {
+            traceOutput();
+        }
+        trace_enabled_ = false;
+    }
+}
+
+/**
+ * Execute previously recorded block of instructions starting from NPC.
+ * Block is interrupted on branch, exception, halt request or when the
+ * clock queue requires processing. Interrupts are sampled on the block
+ * boundary.
+ */
+bool CpuGeneric::executeTranslationBlock() {
+    if (tbflushreq_) {
+        invalidateTranslationAll();
+    }
+    uint64_t npc = getNPC();
+    TranslationBlockType *tb = &tbcache_[(npc >> 1) & tbmask_];
+    if (tb->size == 0 || tb->pc != npc || tb->prv != cur_prv_level
+        || tb->mode != decodeMode_
+        || estate_ != CORE_Normal || haltreq_ || trigger_data_hit_
+        || trace_file_ || tracewr_ || isStepEnabled()
+        || isTriggerArmed(tb->pc, tb->endpc - tb->pc)) {
+        return false;
+    }
+
+    uint64_t deadline = queue_.getNextTime();
+    if (quantumEnd_ < deadline) {
+        deadline = quantumEnd_;
+    }
+    if (profNext_ < deadline) {
+        deadline = profNext_;
+    }
+    unsigned qupdcnt = queue_.getUpdateCnt();
+    tbrec_.size = 0;
+    for (int i = 0; i < tb->size; i++) {
+        TranslatedInstrType *op = &tb->op[i];
+        step_cnt_++;
+        setPC(getNPC());
+        branch_ = false;
+        cacheline_[0].val = op->payload.val;
+        instr_ = op->instr;
+        oplen_ = instr_->exec(cacheline_);
+        if (icovtracker_) {
+            icovtracker_->markAddress(getPC(),
+                                      static_cast<uint8_t>(oplen_));
+        }
+        pc_z_ = getPC();
+        if (!branch_) {
+            setNPC(getPC() + oplen_);
+        }
+        checkStackProtection();
+        if (branch_ || exceptions_ || haltreq_ || trigger_data_hit_
+            || sleep_ || tb->size == 0
+            || step_cnt_ >= deadline || qupdcnt != queue_.getUpdateCnt()) {
+            // tb->size is cleared by self-modified code, watchpoint halts
+            // on the load/store instruction
+            break;
+        }
+    }
+
+    updateQueue();
+    handleTrap();
+    return true;
+}
+
+void CpuGeneric::recordTranslation() {
+    if (estate_ != CORE_Normal || instr_ == 0 || do_not_cache_) {
+        tbrec_.size = 0;
+        return;
+    }
+    uint64_t pc = getPC();
+    if (tbrec_.size == 0 || tbrec_.endpc != pc
+        || tbrec_.prv != cur_prv_level || tbrec_.mode != decodeMode_) {
+        tbrec_.pc = pc;
+        tbrec_.ppc = fetch_paddr_;
+        tbrec_.prv = cur_prv_level;
+        tbrec_.mode = decodeMode_;
+        tbrec_.size = 0;
+    }
+    TranslatedInstrType *op = &tbrec_.op[tbrec_.size++];
+    op->instr = instr_;
+    op->payload.val = cacheline_[0].val;
+    tbrec_.endpc = pc + oplen_;
+
+    // Block doesn't cross virtual page boundary, so that remapping of one
+    // page doesn't require to re-check neighbours
+    if (!branch_ && !exceptions_ && tbrec_.size < TB_INSTR_MAX
+        && ((tbrec_.pc ^ tbrec_.endpc) >> TB_PAGE_LOG2) == 0) {
+        return;
+    }
+
+    TranslationBlockType *tb = &tbcache_[(tbrec_.pc >> 1) & tbmask_];
+    memcpy(tb, &tbrec_, sizeof(TranslationBlockType)
+            - (TB_INSTR_MAX - tbrec_.size) * sizeof(TranslatedInstrType));
+    for (uint64_t line = tb->pc >> TB_CODEMAP_LINE_LOG2;
+        line <= ((tb->endpc - 1) >> TB_CODEMAP_LINE_LOG2); line++) {
+        uint64_t bit = line & TB_CODEMAP_MASK;
+        tbcodemap_[bit >> 3] |= static_cast<uint8_t>(1u << (bit & 0x7));
+    }
+    // Block doesn't cross page, so that physical range is contiguous
+    uint64_t pend = tb->ppc + (tb->endpc - tb->pc);
+    for (uint64_t line = tb->ppc >> TB_CODEMAP_LINE_LOG2;
+        line <= ((pend - 1) >> TB_CODEMAP_LINE_LOG2); line++) {
+        uint64_t bit = line & TB_CODEMAP_MASK;
+        tbphysmap_[bit >> 3] |= static_cast<uint8_t>(1u << (bit & 0x7));
+    }
+    tbrec_.size = 0;
+}
+
+bool CpuGeneric::isTranslatedLine(const uint8_t *map, uint64_t addr,
+                                  uint64_t sz) {
+    uint64_t line0 = addr >> TB_CODEMAP_LINE_LOG2;
+    uint64_t line1 = (addr + sz - 1) >> TB_CODEMAP_LINE_LOG2;
+    uint64_t bit;
+    for (uint64_t line = line0; line <= line1; line++) {
+        bit = line & TB_CODEMAP_MASK;
+        if (map[bit >> 3] & (1u << (bit & 0x7))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Write of the other initiator: system bus master or another hart writing
+ * via DMI. Blocks are dropped by the owner thread before the next block.
+ * Marks of the physical lines are kept till the full flush.
+ */
+void CpuGeneric::snoopWrite(uint64_t addr, uint64_t sz) {
+    if (tbcache_ && sz && isTranslatedLine(tbphysmap_, addr, sz)) {
+        tbflushreq_ = true;
+    }
+}
+
+void CpuGeneric::invalidateTranslation(uint64_t addr, uint64_t sz) {
+    uint64_t line0 = addr >> TB_CODEMAP_LINE_LOG2;
+    uint64_t line1 = (addr + sz - 1) >> TB_CODEMAP_LINE_LOG2;
+    bool hit = isTranslatedLine(tbcodemap_, addr, sz);
+    uint64_t bit;
+    if (tbrec_.size && tbrec_.pc < (addr + sz) && tbrec_.endpc > addr) {
+        tbrec_.size = 0;
+    }
+    if (!hit) {
+        return;
+    }
+
+    for (uint64_t line = line0; line <= line1; line++) {
+        bit = line & TB_CODEMAP_MASK;
+        tbcodemap_[bit >> 3] &= ~static_cast<uint8_t>(1u << (bit & 0x7));
+    }
+    // Remove modified blocks and restore marks of the remaining blocks
+    TranslationBlockType *tb;
+    for (uint64_t i = 0; i <= tbmask_; i++) {
+        tb = &tbcache_[i];
+        if (tb->size == 0) {
+            continue;
+        }
+        if (tb->pc < (addr + sz) && tb->endpc > addr) {
+            tb->size = 0;
+            continue;
+        }
+        for (uint64_t line = tb->pc >> TB_CODEMAP_LINE_LOG2;
+            line <= ((tb->endpc - 1) >> TB_CODEMAP_LINE_LOG2); line++) {
+            if (line >= line0 && line <= line1) {
+                bit = line & TB_CODEMAP_MASK;
+                tbcodemap_[bit >> 3] |=
+                    static_cast<uint8_t>(1u << (bit & 0x7));
+            }
+        }
+    }
+}
+
+void CpuGeneric::invalidateTranslationAll() {
+    if (tbcache_ == 0) {
+        return;
+    }
+    tbflushreq_ = false;
+    for (uint64_t i = 0; i <= tbmask_; i++) {
+        tbcache_[i].size = 0;
     }
+    memset(tbcodemap_, 0, (TB_CODEMAP_MASK + 1) / 8);
+    memset(tbphysmap_, 0, (TB_CODEMAP_MASK + 1) / 8);
+    tbrec_.size = 0;
 }
 
 bool CpuGeneric::updateState() {
@@ -260,6 +632,10 @@ bool CpuGeneric::updateState() {
             haltreq_ = false;
             upd = false;
             halt(HALT_CAUSE_HALTREQ, "External Halt request");
+        } else if (trigger_data_hit_) {
+            trigger_data_hit_ = false;
+            upd = false;
+            halt(HALT_CAUSE_TRIGGER, "Trigger load/store (watchpoint)");
         } else if (isTriggerICount()) {
             upd = false;
             halt(HALT_CAUSE_TRIGGER, "Trigger icount hit");
@@ -278,6 +654,48 @@ bool CpuGeneric::updateState() {
     return upd;
 }
 
+/**
+ * Hart is in WFI state: instead of executing steps one by one jump step
+ * counter directly to the next clock event (timers, mtimecmp etc). Without
+ * registered events wait for notifyInterrupt() from interrupt controller.
+ * @return true if hart is still sleeping.
+ */
+bool CpuGeneric::updateSleep() {
+    if (estate_ != CORE_Normal || haltreq_ || isStepEnabled()) {
+        sleep_ = false;
+        return false;
+    }
+    RISCV_event_clear(&eventWakeup_);
+    if (isWakeupPending()) {
+        sleep_ = false;
+        handleInterrupts();
+        return false;
+    }
+
+    uint64_t t = queue_.getNextTime();
+    if (quantumEnd_ < t) {
+        // Scheduled hart: interrupt can come on the quantum boundary
+        t = quantumEnd_;
+    }
+    if (t == ~0ull) {
+        RISCV_event_wait_ms(&eventWakeup_, 10);
+        return true;
+    }
+    if (t > step_cnt_) {
+        idle_steps_ += t - step_cnt_;
+        step_cnt_ = t;
+    }
+    updateQueue();
+    return true;
+}
+
+void CpuGeneric::notifyInterrupt() {
+    irq_possible_ = true;
+    if (sleep_) {
+        RISCV_event_set(&eventWakeup_);
+    }
+}
+
 void CpuGeneric::updateQueue() {
     IFace *cb;
     queue_.initProc();
@@ -286,10 +704,35 @@ void CpuGeneric::updateQueue() {
     while ((cb = queue_.getNext(step_cnt_)) != 0) {
         static_cast<IClockListener *>(cb)->stepCallback(step_cnt_);
     }
+    if (step_cnt_ >= profNext_) {
+        sampleProfiler();
+    }
 }
 
+/**
+ * Steps skipped in the sleep state are accounted to the sampled WFI
+ * instruction with the weight equal to the number of missed periods.
+ */
+void CpuGeneric::sampleProfiler() {
+    uint64_t period = iprofiler_->getSamplePeriod();
+    uint64_t weight = (step_cnt_ - profNext_) / period + 1;
+    profNext_ += weight * period;
+    if (estate_ != CORE_Normal) {
+        return;
+    }
+    iprofiler_->sample(profidx_, getPC(), stackTraceBuf_.getpR64(),
+                       static_cast<unsigned>(stackTraceCnt_.getValue().val),
+                       weight);
+}
+
+/**
+ * Fetch instruction or get the already decoded one from the cache. Cache
+ * is indexed by physical address, so that a hit requires neither bus
+ * transaction nor decoding.
+ */
 void CpuGeneric::fetchILine() {
     bool generate_trap = false;
+    uint64_t paddr;
     fetch_addr_ = fetchingAddress();
     cachable_pc_ = false;
     instr_ = 0;
@@ -301,11 +744,26 @@ void CpuGeneric::fetchILine() {
         return;
     }
 
-    if ((fetch_addr_ & CACHE_MASK_) == CACHE_BASE_ADDR_) {
-        cachable_pc_ = true;
-        cache_offset_ = fetch_addr_ - CACHE_BASE_ADDR_;
-        instr_ = icache_[cache_offset_].instr;
-        cacheline_[0].buf32[0] = icache_[cache_offset_].buf;  // for tracer
+    if (icache_) {
+        paddr = fetch_addr_;
+        if (isMmuEnabled() && !translateMmu(fetch_addr_, "x", &paddr)) {
+            // Page fault is raised by the bus access below
+            paddr = ~0ull;
+        }
+        if ((paddr & CACHE_MASK_) == CACHE_BASE_ADDR_) {
+            cachable_pc_ = true;
+            cache_offset_ = paddr - CACHE_BASE_ADDR_;
+            if (icache_[cache_offset_].instr
+                && icache_[cache_offset_].mode == decodeMode_
+                && (!isMpuEnabled() || checkMpu(paddr, 4, "x"))) {
+                fetch_paddr_ = paddr;
+                instr_ = icache_[cache_offset_].instr;
+                cacheline_[0].val = icache_[cache_offset_].payload;
+                icache_hits_++;
+                return;
+            }
+            icache_misses_++;
+        }
     }
 
     trans_.action = MemAction_Read;
@@ -316,6 +774,7 @@ void CpuGeneric::fetchILine() {
         generate_trap = true;
     } else {
         cacheline_[0].val = trans_.rpayload.b64[0];
+        fetch_paddr_ = trans_.addr;
     }
 
     if (generate_trap) {
@@ -343,6 +802,13 @@ void CpuGeneric::handleTrap() {
 }
 
 void CpuGeneric::flush(uint64_t addr) {
+    if (tbcache_) {
+        if (addr == ~0ull) {
+            invalidateTranslationAll();
+        } else {
+            invalidateTranslation(addr, 4);
+        }
+    }
     if (icache_ == 0) {
         return;
     }
@@ -356,8 +822,33 @@ void CpuGeneric::flush(uint64_t addr) {
     }
 }
 
+void CpuGeneric::getICacheStat(AttributeType *res) {
+    uint64_t total = icache_hits_ + icache_misses_;
+    res->make_dict();
+    (*res)["hits"].make_uint64(icache_hits_);
+    (*res)["misses"].make_uint64(icache_misses_);
+    if (total) {
+        (*res)["hitrate"].make_floating(
+            static_cast<double>(icache_hits_) / static_cast<double>(total));
+    } else {
+        (*res)["hitrate"].make_floating(0);
+    }
+}
+
+void CpuGeneric::clearICacheStat() {
+    icache_hits_ = 0;
+    icache_misses_ = 0;
+}
+
 void CpuGeneric::trackContextStart() {
-    if (!trace_file_) {
+    trace_enabled_ = (trace_file_ || tracewr_) && trace_trig_on_
+                   && isTraceWindow();
+    if (!trace_enabled_) {
+        if (trace_pending_) {
+            // Capture is finished: write the rest without waiting for halt
+            tracewr_->flush();
+            trace_pending_ = false;
+        }
         return;
     }
     trace_data_.action_cnt = 0;
@@ -378,12 +869,38 @@ void CpuGeneric::trackContextEnd() {
         }
         if (cachable_pc_) {
             icache_[cache_offset_].instr = instr_;
-            icache_[cache_offset_].buf = cacheline_[0].buf32[0];
+            icache_[cache_offset_].payload = cacheline_[0].val;
+            icache_[cache_offset_].mode = decodeMode_;
         }
     }
     do_not_cache_ = false;
 }
 
+/** Optional [from, to) range of step counter values to trace */
+bool CpuGeneric::isTraceWindow() {
+    if (traceWindow_.size() != 2) {
+        return true;
+    }
+    return step_cnt_ >= traceWindow_[0u].to_uint64()
+        && step_cnt_ < traceWindow_[1].to_uint64();
+}
+
+void CpuGeneric::traceOutputBinary() {
+    uint32_t instr;
+    memcpy(&instr, trace_data_.instrbuf.data(), sizeof(instr));
+    tracewr_->putInstr(trace_data_.step_cnt, trace_data_.pc, instr, oplen_);
+    trace_pending_ = true;
+    for (int i = 0; i < trace_data_.action_cnt; i++) {
+        trace_action_type *pa = &trace_data_.action[i];
+        if (!pa->memop) {
+            tracewr_->putReg(pa->waddr, pa->wdata);
+        } else {
+            tracewr_->putMemop(pa->memop_addr, pa->memop_write != 0,
+                               pa->memop_data.val, pa->memop_size);
+        }
+    }
+}
+
 void CpuGeneric::traceRegister(int idx, uint64_t v) {
     if (trace_data_.action_cnt >= 64) {
         return;
@@ -425,7 +942,7 @@ bool CpuGeneric::moveStepCallback(IClockListener *cb, uint64_t t) {
 
 void CpuGeneric::setReg(int idx, uint64_t val) {
     R[idx] = val;
-    if (trace_file_) {
+    if (trace_enabled_) {
         traceRegister(idx, val);
     }
 }
@@ -454,9 +971,22 @@ void CpuGeneric::popStackTrace() {
 
 ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr, int flags) {
     ETransStatus ret = TRANS_OK;
+    uint64_t vaddr = tr->addr;
     tr->source_idx = sysBusMasterID_.to_int();
+    if (trigplan_.dataCnt && !(flags & 0x1) && estate_ == CORE_Normal
+        && isTriggerPage(trigplan_.dataMap, vaddr, tr->xsize)) {
+        isTriggerData(vaddr, tr->xsize, tr->action == MemAction_Write);
+    }
     if (isMmuEnabled()) {
-        tr->addr = translateMmu(tr->addr);
+        const char *rwx = "r";
+        if (flags & 0x1) {
+            rwx = "x";
+        } else if (tr->action == MemAction_Write) {
+            rwx = "w";
+        }
+        if (!translateMmu(vaddr, rwx, &tr->addr)) {
+            return TRANS_ERROR;
+        }
     }
     if (isMpuEnabled()) {
         if (flags & 0x1) {
@@ -473,7 +1003,30 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr, int flags) {
             }
         }
     }
-    if (tr->xsize <= sysBusWidthBytes_.to_uint32()) {
+    if (tr->action == MemAction_Write) {
+        if (tbcache_) {
+            // Blocks are recorded with virtual addresses
+            invalidateTranslation(tr->addr, tr->xsize);
+            if (vaddr != tr->addr) {
+                invalidateTranslation(vaddr, tr->xsize);
+            }
+        }
+        if (icache_ && (tr->addr & CACHE_MASK_) == CACHE_BASE_ADDR_) {
+            // Drop decoded instructions overlapping modified bytes
+            uint64_t off = tr->addr - CACHE_BASE_ADDR_;
+            uint64_t offend = off + tr->xsize;
+            off = off < 3 ? 0 : off - 3;
+            if (offend > static_cast<uint64_t>(memcache_sz_)) {
+                offend = memcache_sz_;
+            }
+            for (; off < offend; off++) {
+                icache_[off].instr = 0;
+            }
+        }
+    }
+    if (dmiAccess(tr)) {
+        // Plain memory accessed via host pointer
+    } else if (tr->xsize <= sysBusWidthBytes_.to_uint32()) {
         ret = isysbus_->b_transport(tr);
     } else {
         // 1-byte access for HC08
@@ -493,7 +1046,7 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr, int flags) {
         }
     }
 
-    if (trace_file_) {
+    if (trace_enabled_) {
         int we = tr->action == MemAction_Write ? 1 : 0;
         Reg64Type memop_data;
         memop_data.val = 0;
@@ -507,6 +1060,64 @@ ETransStatus CpuGeneric::dma_memop(Axi4TransactionType *tr, int flags) {
     return ret;
 }
 
+/**
+ * Direct access to plain memory without system bus transaction. Memory
+ * mapped registers and DPI routed memories fall back to bus.
+ */
+bool CpuGeneric::dmiAccess(Axi4TransactionType *tr) {
+    DmiRegionType *pdmi = 0;
+    if (!directMemAccess_.to_bool()) {
+        return false;
+    }
+    for (int i = 0; i < DMI_TLB_SIZE; i++) {
+        if ((tr->addr - dmitlb_[i].addr) < dmitlb_[i].size) {
+            pdmi = &dmitlb_[i];
+            break;
+        }
+    }
+    if (pdmi == 0) {
+        pdmi = &dmitlb_[dmitlb_idx_];
+        if (!isysbus_->get_direct_mem_ptr(tr->addr, pdmi)) {
+            pdmi->size = 0;
+            return false;
+        }
+        dmitlb_idx_ = (dmitlb_idx_ + 1) % DMI_TLB_SIZE;
+    }
+
+    uint64_t off = tr->addr - pdmi->addr;
+    if ((off + tr->xsize) > pdmi->size) {
+        return false;
+    }
+    if (tr->action == MemAction_Write) {
+        if (!pdmi->wr) {
+            // Request again after the bus write, copy-on-write page
+            // becomes writable
+            pdmi->size = 0;
+            return false;
+        }
+        if (((1ul << tr->xsize) - 1) == tr->wstrb) {
+            memcpy(&pdmi->ptr[off], tr->wpayload.b8, tr->xsize);
+        } else {
+            for (uint32_t i = 0; i < tr->xsize; i++) {
+                if ((tr->wstrb >> i) & 0x1) {
+                    pdmi->ptr[off + i] = tr->wpayload.b8[i];
+                }
+            }
+        }
+        for (int i = 0; i < snoopcnt_; i++) {
+            snoop_[i]->snoopWrite(tr->addr, tr->xsize);
+        }
+    } else {
+        if (!pdmi->rd) {
+            return false;
+        }
+        tr->rpayload.b64[0] = 0;
+        memcpy(tr->rpayload.b8, &pdmi->ptr[off], tr->xsize);
+    }
+    tr->response = MemResp_Valid;
+    return true;
+}
+
 void CpuGeneric::resume() {
     if (estate_ == CORE_OFF) {
         RISCV_error("CPU is turned-off", 0);
@@ -547,25 +1158,28 @@ void CpuGeneric::halt(uint32_t cause, const char *descr) {
         RISCV_info("pc:%04" RV_PRI64 "x: %s\t %s",
                        getPC(), strop, descr);
     }
+    if (tracewr_) {
+        // Make trace consistent while the simulation is paused
+        tracewr_->flush();
+        trace_pending_ = false;
+    }
     estate_ = CORE_Halted;
 }
 
 bool CpuGeneric::isTriggerICount() {
     bool ret = false;
     TriggerStorageType *pt;
-    for (unsigned i = 0; i < triggersTotal_.to_uint32(); i++) {
-        pt = &ptriggers_[i];
-        if (pt->data1.bitsdef.type == TriggerType_InstrCountMatch) {
-            if (pt->data1.icount_bits.count - 1 == 0) {
-                ret = true;
-            }
-            if ((pt->data1.icount_bits.count > 1) &&
-                (pt->data1.icount_bits.m || pt->data1.icount_bits.s
-                || pt->data1.icount_bits.u)) {
-                pt->data1.icount_bits.count--;
-            }
-            pt->data1.icount_bits.hit = 1;
+    for (int i = 0; i < trigplan_.icountCnt; i++) {
+        pt = &ptriggers_[trigplan_.icount[i]];
+        if (pt->data1.icount_bits.count - 1 == 0) {
+            ret = true;
         }
+        if ((pt->data1.icount_bits.count > 1) &&
+            (pt->data1.icount_bits.m || pt->data1.icount_bits.s
+            || pt->data1.icount_bits.u)) {
+            pt->data1.icount_bits.count--;
+        }
+        pt->data1.icount_bits.hit = 1;
     }
     return ret;
 }
@@ -597,10 +1211,15 @@ void CpuGeneric::reset(IFace *isource) {
         memset(ptriggers_,
                0,
                triggersTotal_.to_int()*sizeof(TriggerStorageType));
+        compileTriggers();
     }
     stackTraceCnt_.reset(isource);
+    memset(dmitlb_, 0, sizeof(dmitlb_));
     interrupt_pending_[0] = 0;
     interrupt_pending_[1] = 0;
+    sleep_ = false;
+    irq_possible_ = true;
+    trigger_data_hit_ = false;
     do_not_cache_ = false;
 
     if (resetState_.is_equal("Halted")) {
@@ -610,76 +1229,277 @@ void CpuGeneric::reset(IFace *isource) {
     }
 }
 
-bool CpuGeneric::isTriggerInstruction() {
-    uint64_t pc = getPC();
+/**
+ * @brief Save context that isn't stored in the register banks.
+ * @details Banks are saved via their ports. Queued clock callbacks are
+ *          saved with the names of the owning services.
+ */
+void CpuGeneric::saveState(AttributeType *state) {
+    AttributeType items;
+    AttributeType lstn;
+    AttributeType t1;
+    IService *iserv;
+
+    state->make_dict();
+    (*state)["ctxregs"].make_data(sizeof(ctxregs_), ctxregs_);
+    if (ptriggers_) {
+        (*state)["triggers"].make_data(
+            triggersTotal_.to_int()*sizeof(TriggerStorageType), ptriggers_);
+    }
+    (*state)["interrupt_pending"].make_data(sizeof(interrupt_pending_),
+                                            interrupt_pending_);
+    (*state)["step_cnt"].make_uint64(step_cnt_);
+    (*state)["idle_steps"].make_uint64(idle_steps_);
+    (*state)["prv"].make_uint64(cur_prv_level);
+    (*state)["exceptions"].make_uint64(exceptions_);
+    (*state)["pc_z"].make_uint64(pc_z_);
+    (*state)["sleep"].make_boolean(sleep_);
+    // Pages can become shared with the snapshot, request them again
+    memset(dmitlb_, 0, sizeof(dmitlb_));
+
+    queue_.getItems(&items);
+    RISCV_get_services_with_iface(IFACE_CLOCK_LISTENER, &lstn);
+    AttributeType &queue = (*state)["queue"];
+    queue.make_list(0);
+    t1.make_list(2);
+    for (unsigned i = 0; i < items.size(); i++) {
+        for (unsigned n = 0; n < lstn.size(); n++) {
+            iserv = static_cast<IService *>(lstn[n].to_iface());
+            if (iserv->getInterface(IFACE_CLOCK_LISTENER)
+                != items[i][1].to_iface()) {
+                continue;
+            }
+            t1[0u] = items[i][0u];
+            t1[1].make_string(iserv->getObjName());
+            queue.add_to_list(&t1);
+            break;
+        }
+    }
+    if (queue.size() != items.size()) {
+        RISCV_error("%d clock callbacks of unknown objects aren't saved",
+                    items.size() - queue.size());
+    }
+}
+
+void CpuGeneric::restoreState(const AttributeType *state) {
+    IFace *icb;
+
+    restoreData(state, "ctxregs", ctxregs_, sizeof(ctxregs_));
+    if (ptriggers_) {
+        restoreData(state, "triggers", ptriggers_,
+                    triggersTotal_.to_int()*sizeof(TriggerStorageType));
+        compileTriggers();
+    }
+    restoreData(state, "interrupt_pending", interrupt_pending_,
+                sizeof(interrupt_pending_));
+    step_cnt_ = (*state)["step_cnt"].to_uint64();
+    idle_steps_ = (*state)["idle_steps"].to_uint64();
+    cur_prv_level = (*state)["prv"].to_uint64();
+    exceptions_ = (*state)["exceptions"].to_uint64();
+    pc_z_ = (*state)["pc_z"].to_uint64();
+    sleep_ = (*state)["sleep"].to_bool();
+    irq_possible_ = true;
+    if (iprofiler_) {
+        profNext_ = step_cnt_ + iprofiler_->getSamplePeriod();
+    }
+    trigger_data_hit_ = false;
+
+    queue_.hardReset();
+    const AttributeType &queue = (*state)["queue"];
+    for (unsigned i = 0; i < queue.size(); i++) {
+        icb = RISCV_get_service_iface(queue[i][1].to_string(),
+                                      IFACE_CLOCK_LISTENER);
+        if (icb) {
+            queue_.put(queue[i][0u].to_uint64(), icb);
+        }
+    }
 
+    // Memory content was replaced: drop decoded code and DMI pointers
+    flush(~0ull);
+    memset(dmitlb_, 0, sizeof(dmitlb_));
+}
+
+/**
+ * Convert address matches of the enabled triggers into the inclusive
+ * ranges or masked compares. Instruction trigger with the 'hit' bit set
+ * fires on any address until the bit is cleared by debugger.
+ */
+void CpuGeneric::compileTriggers() {
+    static const uint64_t SIZE_BYTES[8] = {1, 1, 2, 4, 6, 8, 10, 12};
     TriggerData1Type::bits_type2 *pt;
-    bool fire = false;
-    uint64_t action = 0;
+    TriggerMatchType m;
+    uint64_t data2;
     uint64_t mask;
     int tcnt;
+
+    trigplan_.execCnt = 0;
+    trigplan_.dataCnt = 0;
+    trigplan_.icountCnt = 0;
+    memset(trigplan_.execMap, 0, sizeof(trigplan_.execMap));
+    memset(trigplan_.dataMap, 0, sizeof(trigplan_.dataMap));
     for (int i = 0; i < triggersTotal_.to_int(); i++) {
         pt = &ptriggers_[i].data1.mcontrol_bits;
-        if (pt->type != TriggerType_AddrDataMatch) {
-            continue;
-        }
-        if (!(pt->m | pt->s | pt->u)) {
-            // Trigger is disabled
+        if (pt->type == TriggerType_InstrCountMatch) {
+            trigplan_.icount[trigplan_.icountCnt++] = i;
             continue;
         }
-        if (!pt->execute) {
+        if (pt->type != TriggerType_AddrDataMatch
+            || !(pt->m | pt->s | pt->u)) {
             continue;
         }
 
+        data2 = ptriggers_[i].data2;
+        m.idx = i;
+        m.masked = 0;
+        m.lo = data2;
+        m.hi = data2;
         switch (pt->match) {
         case 0:
-            if (pc == ptriggers_[i].data2) {
-                pt->hit = 1;
-            }
             break;
         case 1:
             mask = 1;
             tcnt = 0;
-            while ((tcnt < mcontrolMaskmax_.to_int())
-                && !(ptriggers_[i].data2 & mask)) {
+            while ((tcnt < mcontrolMaskmax_.to_int()) && !(data2 & mask)) {
                 mask <<= 1;
                 tcnt++;
             }
-            mask = ~(mask - 1);
-            if ((pc & mask) == (ptriggers_[i].data2 & mask)) {
-                pt->hit = 1;
-            }
+            m.lo = data2 & ~(mask - 1);
+            m.hi = data2 | (mask - 1);
             break;
         case 2:
-            if (pc >= ptriggers_[i].data2) {
-                pt->hit = 1;
-            }
+            m.hi = ~0ull;
             break;
         case 3:
-            if (pc < ptriggers_[i].data2) {
-                pt->hit = 1;
+            if (data2 == 0) {
+                continue;
             }
+            m.lo = 0;
+            m.hi = data2 - 1;
             break;
         case 4:
-            mask = (pc & 0xFFFFFFFFull) & (ptriggers_[i].data2 >> 32);
-            if (mask == (ptriggers_[i].data2 & 0xFFFFFFFFull)) {
-                pt->hit = 1;
-            }
-            break;
         case 5:
-            mask = (pc >> 32) & (ptriggers_[i].data2 >> 32);
-            if (mask == (ptriggers_[i].data2 & 0xFFFFFFFFull)) {
-                pt->hit = 1;
-            }
+            m.masked = pt->match - 3;
+            m.lo = data2 & 0xFFFFFFFFull;
+            m.hi = data2 >> 32;
             break;
-        default:;
+        default:
+            continue;
+        }
+
+        if (pt->load | pt->store) {
+            TriggerMatchType *pm = &trigplan_.data[trigplan_.dataCnt++];
+            *pm = m;
+            if (pt->match == 0) {
+                pm->hi += SIZE_BYTES[((pt->sizehi << 2) | pt->sizelo) & 7];
+                pm->hi -= 1;
+            }
+            markTriggerPages(trigplan_.dataMap, pm);
         }
+        if (pt->execute) {
+            if (pt->hit && pt->action != 2 && pt->action != 3) {
+                m.masked = 0;
+                m.lo = 0;
+                m.hi = ~0ull;
+            }
+            trigplan_.exec[trigplan_.execCnt] = m;
+            markTriggerPages(trigplan_.execMap,
+                             &trigplan_.exec[trigplan_.execCnt++]);
+        }
+    }
+}
 
+void CpuGeneric::markTriggerPages(uint64_t *map, const TriggerMatchType *m) {
+    uint64_t pn0 = m->lo >> TRIGGER_PAGE_LOG2;
+    uint64_t pn1 = m->hi >> TRIGGER_PAGE_LOG2;
+    uint64_t bit;
+    if (m->masked || (pn1 - pn0) >= TRIGGER_MAP_BITS - 1) {
+        memset(map, 0xFF, (TRIGGER_MAP_BITS / 64) * sizeof(uint64_t));
+        return;
+    }
+    for (uint64_t pn = pn0; pn <= pn1; pn++) {
+        bit = pn & (TRIGGER_MAP_BITS - 1);
+        map[bit >> 6] |= 1ull << (bit & 63);
+    }
+}
+
+/** Check whether instructions of the block require trigger processing */
+bool CpuGeneric::isTriggerArmed(uint64_t addr, uint64_t sz) {
+    if (trigplan_.icountCnt) {
+        return true;
+    }
+    return trigplan_.execCnt && isTriggerPage(trigplan_.execMap, addr, sz);
+}
+
+/**
+ * Match load/store against compiled triggers, match=0 watches sizelo/sizehi
+ * bytes (0 means 1 byte), so that any access overlapping watched bytes
+ * fires the trigger.
+ */
+bool CpuGeneric::isTriggerData(uint64_t addr, uint32_t sz, bool wr) {
+    TriggerData1Type::bits_type2 *pt;
+    bool fire = false;
+    uint64_t action = 0;
+    for (int i = 0; i < trigplan_.dataCnt; i++) {
+        pt = &ptriggers_[trigplan_.data[i].idx].data1.mcontrol_bits;
+        if (!(wr ? pt->store : pt->load)
+            || !isTriggerMatch(&trigplan_.data[i], addr, sz)) {
+            continue;
+        }
+        if (pt->action == 2 || pt->action == 3) {
+            trace_trig_on_ = pt->action == 2;
+            continue;
+        }
+        pt->hit = 1;
+        fire = true;
+        action = pt->action;
+    }
+
+    if (fire) {
+        if (action == 0) {
+            raiseSoftwareIrq();
+        } else if (action == 1) {
+            trigger_data_hit_ = true;
+        } else {
+            RISCV_error("unsupported trigger action: %d",
+                        static_cast<int>(action));
+        }
+    }
+    return fire;
+}
+
+bool CpuGeneric::isTriggerInstruction() {
+    if (trigplan_.execCnt == 0) {
+        return false;
+    }
+    uint64_t pc = getPC();
+    if (!isTriggerPage(trigplan_.execMap, pc, 1)) {
+        return false;
+    }
+
+    TriggerData1Type::bits_type2 *pt;
+    bool fire = false;
+    bool recompile = false;
+    uint64_t action = 0;
+    for (int i = 0; i < trigplan_.execCnt; i++) {
+        if (!isTriggerMatch(&trigplan_.exec[i], pc, 1)) {
+            continue;
+        }
+        pt = &ptriggers_[trigplan_.exec[i].idx].data1.mcontrol_bits;
+        if (pt->action == 2 || pt->action == 3) {
+            // Trace on/off actions don't interrupt execution
+            trace_trig_on_ = pt->action == 2;
+            continue;
+        }
         // TODO bit 'chain'
-        if (pt->hit == 1) {
-            fire = true;
-            action = pt->action;
+        if (!pt->hit) {
+            pt->hit = 1;
+            recompile = true;
         }
+        fire = true;
+        action = pt->action;
+    }
+    if (recompile) {
+        compileTriggers();
     }
 
     if (fire) {
@@ -30,12 +30,37 @@
 #include "coreservices/isrccode.h"
 #include "coreservices/icmdexec.h"
 #include "coreservices/icoveragetracker.h"
+#include "coreservices/iprofiler.h"
+#include "coreservices/isnapshot.h"
+#include "coreservices/ischeduler.h"
 #include "generic/mapreg.h"
+#include "generic/tracewriter.h"
 #include <riscv-isa.h>
 #include <fstream>
 
 namespace debugger {
 
+class CpuICacheCmdType : public ICommand {
+ public:
+    explicit CpuICacheCmdType(IService *parent) : ICommand(parent, "icache") {
+        briefDescr_.make_string("Get decoded instructions cache statistic.");
+        detailedDescr_.make_string(
+            "Description:\n"
+            "    This command returns hit/miss counters of the decoded\n"
+            "    instructions cache of the functional CPU model. CPU name\n"
+            "    should be specified in multi-core system.\n"
+            "Usage:\n"
+            "    icache [cpu_name] [clear]\n"
+            "Example:\n"
+            "    icache\n"
+            "    icache core0 clear");
+    }
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+};
+
 class CpuGeneric : public IService,
                    public IThread,
                    public ICpuFunctional,
@@ -43,6 +68,9 @@ class CpuGeneric : public IService,
                    public IClock,
                    public IPower,
                    public IResetListener,
+                   public ISnapshot,
+                   public IQuantumExecutor,
+                   public IMemorySnoop,
                    public IHap {
  public:
     explicit CpuGeneric(const char *name);
@@ -50,6 +78,7 @@ class CpuGeneric : public IService,
 
     /** IService interface */
     virtual void postinitService();
+    virtual void predeleteService();
 
     /** ICpuFunctional */
     virtual uint64_t *getpRegs() { return R; }
@@ -75,8 +104,12 @@ class CpuGeneric : public IService,
     virtual bool isMpuEnabled() { return false; }
     virtual bool checkMpu(uint64_t addr, uint32_t sz, const char *rwx) { return true; }
     virtual bool isMmuEnabled() { return false; }
-    virtual uint64_t translateMmu(uint64_t addr) { return addr; }
+    virtual bool translateMmu(uint64_t va, const char *rwx, uint64_t *pa) {
+        *pa = va;
+        return true;
+    }
     virtual void flushMmu() {}
+    virtual void notifyInterrupt();
 
     /** IDPort interface */
     virtual int resumereq();
@@ -97,6 +130,9 @@ class CpuGeneric : public IService,
     virtual bool isExecutingProgbuf() { return estate_ == CORE_ProgbufExec; }
     virtual void setResetPin(bool val) {}
 
+    /** Common commands access methods */
+    virtual void getICacheStat(AttributeType *res);
+    virtual void clearICacheStat();
 
  protected:
     virtual uint64_t getResetAddress() { return resetVector_.to_uint64(); }
@@ -112,9 +148,17 @@ class CpuGeneric : public IService,
     virtual void traceRegister(int idx, uint64_t v);
     virtual void traceMemop(uint64_t addr, int we, uint64_t v, uint32_t sz);
     virtual void traceOutput() {}
+    virtual void traceOutputBinary();
+    virtual bool isTraceWindow();
     virtual bool isStepEnabled() { return false; }
+    virtual bool isWakeupPending() { return true; }
     virtual bool isTriggerICount();
     virtual bool isTriggerInstruction();
+    virtual bool isTriggerArmed(uint64_t addr, uint64_t sz);
+    virtual bool isTriggerDataArmed() { return trigplan_.dataCnt != 0; }
+    virtual bool isTriggerData(uint64_t addr, uint32_t sz, bool wr);
+    virtual void compileTriggers();
+    virtual bool dmiAccess(Axi4TransactionType *tr);
 
  public:
     /** IClock */
@@ -135,6 +179,17 @@ class CpuGeneric : public IService,
     /** IResetListener interface */
     virtual void reset(IFace *isource);
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
+    /** IQuantumExecutor */
+    virtual uint64_t executeQuantum(uint64_t steps);
+    virtual uint64_t getIdleSteps() { return idle_steps_; }
+
+    /** IMemorySnoop */
+    virtual void snoopWrite(uint64_t addr, uint64_t sz);
+
     /** IHap */
     virtual void hapTriggered(EHapType type, uint64_t param,
                               const char *descr);
@@ -144,13 +199,24 @@ class CpuGeneric : public IService,
     virtual void busyLoop();
 
     virtual void updatePipeline();
+    virtual bool executeTranslationBlock();
+    virtual void recordTranslation();
+    virtual void invalidateTranslation(uint64_t addr, uint64_t sz);
+    virtual void invalidateTranslationAll();
+    bool isTranslatedLine(const uint8_t *map, uint64_t addr, uint64_t sz);
     virtual bool updateState();
+    virtual bool updateSleep();
     virtual uint64_t fetchingAddress() { return getPC(); }
     virtual void fetchILine();
     virtual void updateQueue();
+    virtual void sampleProfiler();
     virtual void enterProgbufExec();
     virtual void exitProgbufExec();
 
+ public:
+    /** Enter sleep state till the next interrupt (WFI instruction) */
+    void waitForInterrupt() { sleep_ = true; }
+
  protected:
     AttributeType isEnable_;
     AttributeType freqHz_;
@@ -161,6 +227,9 @@ class CpuGeneric : public IService,
     AttributeType sourceCode_;
     AttributeType stackTraceSize_;
     AttributeType generateTraceFile_;
+    AttributeType traceFormat_;
+    AttributeType traceWindow_;
+    AttributeType traceEnable_;
     AttributeType resetVector_;
     AttributeType sysBusMasterID_;
     AttributeType cacheBaseAddr_;
@@ -169,9 +238,14 @@ class CpuGeneric : public IService,
     AttributeType resetState_;
     AttributeType triggersTotal_;
     AttributeType mcontrolMaskmax_;
+    AttributeType translationBlocks_;
+    AttributeType directMemAccess_;
+    AttributeType scheduler_;
+    AttributeType profiler_;
 
     ISourceCode *isrc_;
     ICoverageTracker *icovtracker_;
+    IProfiler *iprofiler_;
     ICmdExecutor *icmdexec_;
     IMemoryOperation *isysbus_;
     GenericInstruction *instr_;
@@ -210,6 +284,48 @@ class CpuGeneric : public IService,
         uint64_t extra;
     } *ptriggers_;
 
+    // Match plan rebuilt by compileTriggers() on tdata1/tdata2 change.
+    // Pages of the matched ranges are marked in the bitmaps indexed by
+    // the page number modulo bitmap size, unmarked page needs no check.
+    static const int TRIGGER_PAGE_LOG2 = 12;
+    static const int TRIGGER_MAP_BITS = 4096;
+
+    struct TriggerMatchType {
+        uint64_t lo;            // first address or value of masked match
+        uint64_t hi;            // last address or mask of masked match
+        int idx;                // index in ptriggers_
+        int masked;             // 0=range; 1=low 32 bits; 2=high 32 bits
+    };
+
+    struct TriggerPlanType {
+        int execCnt;
+        int dataCnt;
+        int icountCnt;
+        TriggerMatchType *exec;
+        TriggerMatchType *data;
+        int *icount;
+        uint64_t execMap[TRIGGER_MAP_BITS / 64];
+        uint64_t dataMap[TRIGGER_MAP_BITS / 64];
+    } trigplan_;
+
+    void markTriggerPages(uint64_t *map, const TriggerMatchType *m);
+    bool isTriggerPage(const uint64_t *map, uint64_t addr, uint64_t sz) {
+        uint64_t pn0 = (addr >> TRIGGER_PAGE_LOG2) & (TRIGGER_MAP_BITS - 1);
+        uint64_t pn1 = ((addr + sz - 1) >> TRIGGER_PAGE_LOG2)
+                        & (TRIGGER_MAP_BITS - 1);
+        return ((map[pn0 >> 6] >> (pn0 & 63)) & 1)
+            || ((map[pn1 >> 6] >> (pn1 & 63)) & 1);
+    }
+    bool isTriggerMatch(const TriggerMatchType *m,
+                        uint64_t addr, uint64_t sz) {
+        if (m->masked == 1) {
+            return ((addr & m->hi) & 0xFFFFFFFFull) == m->lo;
+        } else if (m->masked == 2) {
+            return ((addr >> 32) & m->hi) == m->lo;
+        }
+        return addr <= m->hi && m->lo <= addr + sz - 1;
+    }
+
     uint64_t step_cnt_;
     volatile bool resumereq_;
     volatile bool resumeack_;
@@ -235,7 +351,15 @@ class CpuGeneric : public IService,
     mutex_def mutex_csr_;
     event_def eventConfigDone_;
     event_def eventDbgRequest_;
+    event_def eventWakeup_;
     ClockAsyncTQueueType queue_;
+    volatile bool sleep_;           // WFI state
+    volatile bool irq_possible_;    // interrupt possibly pending
+    bool trigger_data_hit_;         // watchpoint hit, halt after instruction
+    uint64_t idle_steps_;           // steps skipped in sleep state
+    uint64_t quantumEnd_;           // scheduled hart stops on this step
+    uint64_t profNext_;             // step of the next profiler sample
+    int profidx_;                   // CPU index in profiler
 
     enum ECoreState {
         CORE_OFF,
@@ -250,18 +374,62 @@ class CpuGeneric : public IService,
     // Simple memory cache to avoid access to sysbus and speed-up simulation
     struct ICacheType {
         GenericInstruction *instr;
-        uint32_t buf;
+        uint64_t payload;           // predecoded instruction
+        uint32_t mode;              // decoding mode, see decodeMode_
     } *icache_;            // parsed instructions storage
     int memcache_sz_;               // allocated size
+    uint64_t icache_hits_;
+    uint64_t icache_misses_;
+    CpuICacheCmdType *pcmd_icache_;
     uint64_t CACHE_BASE_ADDR_;
     uint64_t CACHE_MASK_;
     uint64_t fetch_addr_;
+    uint64_t fetch_paddr_;          // physical address of the last fetch
+    uint32_t decodeMode_;           // instruction set (ARM/Thumb), else 0
     uint64_t cache_offset_;         // instruction pointer - CACHE_BASE_ADDR
     bool cachable_pc_;              // fetched_pc hit into cachable region
 
     uint64_t cur_prv_level;
 
+    // Per-core cache of the DMI regions granted by system bus
+    static const int DMI_TLB_SIZE = 4;
+    DmiRegionType dmitlb_[DMI_TLB_SIZE];
+    int dmitlb_idx_;
+
+    // Other initiators notified about writes via DMI
+    static const int SNOOP_MAX = 32;
+    IMemorySnoop *snoop_[SNOOP_MAX];
+    int snoopcnt_;
+
+    // Translation blocks: straight-line sequences of already decoded
+    // instructions executed without fetching and decoding.
+    static const int TB_INSTR_MAX = 64;
+    static const int TB_CODEMAP_LINE_LOG2 = 8;      // 256 bytes per bit
+    static const int TB_PAGE_LOG2 = 12;
+    static const uint64_t TB_CODEMAP_MASK = (1ull << 20) - 1;
+
+    struct TranslatedInstrType {
+        GenericInstruction *instr;
+        Reg64Type payload;
+    };
+
+    struct TranslationBlockType {
+        uint64_t pc;            // address of the first instruction
+        uint64_t endpc;         // address next after the last instruction
+        uint64_t prv;           // privilege level used on translation
+        uint64_t ppc;           // physical address of the first instruction
+        uint32_t mode;          // decodeMode_ used on translation
+        int size;               // number of instructions, 0 = invalid
+        TranslatedInstrType op[TB_INSTR_MAX];
+    } *tbcache_;
+    TranslationBlockType tbrec_;    // block under recording
+    uint64_t tbmask_;
+    uint8_t *tbcodemap_;            // marked lines contain translated code
+    uint8_t *tbphysmap_;            // the same lines by physical address
+    volatile bool tbflushreq_;      // translated code modified by others
+
     struct trace_action_type {
+
         bool memop;             // 0=register; 1=memop
         int waddr;              // register addr
         uint64_t wdata;         // register data
@@ -281,6 +449,10 @@ class CpuGeneric : public IService,
         int action_cnt;
     } trace_data_;
     std::ofstream *trace_file_;
+    TraceWriter *tracewr_;
+    bool trace_enabled_;            // current instruction is traced
+    bool trace_trig_on_;            // switched by trace on/off triggers
+    bool trace_pending_;            // binary records weren't flushed
 };
 
 }  // namespace debugger
@@ -19,6 +19,27 @@
 
 namespace debugger {
 
+/** Register banks are saved without the trailing zero bytes */
+static void save_bank(const void *regs, int len, AttributeType *state) {
+    const uint8_t *p = static_cast<const uint8_t *>(regs);
+    while (len > 0 && p[len - 1] == 0) {
+        len--;
+    }
+    state->make_data(static_cast<unsigned>(len), p);
+}
+
+static void restore_bank(void *regs, int len, const AttributeType *state) {
+    if (!state->is_data()) {
+        return;
+    }
+    unsigned sz = state->size();
+    if (sz > static_cast<unsigned>(len)) {
+        sz = static_cast<unsigned>(len);
+    }
+    memset(regs, 0, len);
+    memcpy(regs, state->data(), sz);
+}
+
 MappedReg64Type::MappedReg64Type(IService *parent, const char *name,
                   uint64_t addr, int priority) {
     if (parent == NULL) {
@@ -27,6 +48,8 @@ MappedReg64Type::MappedReg64Type(IService *parent, const char *name,
                 static_cast<IMemoryOperation *>(this));
         parent->registerPortInterface(name,
                 static_cast<IResetListener *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
     }
     parent_ = parent;
     portListeners_.make_list(0);
@@ -64,6 +87,14 @@ ETransStatus MappedReg64Type::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+void MappedReg64Type::saveState(AttributeType *state) {
+    state->make_uint64(value_.val);
+}
+
+void MappedReg64Type::restoreState(const AttributeType *state) {
+    value_.val = state->to_uint64();
+}
+
 /** 32-bits register */
 MappedReg32Type::MappedReg32Type(IService *parent, const char *name,
                   uint64_t addr, int priority) {
@@ -73,6 +104,8 @@ MappedReg32Type::MappedReg32Type(IService *parent, const char *name,
                 static_cast<IMemoryOperation *>(this));
         parent->registerPortInterface(name,
                 static_cast<IResetListener *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
     }
     parent_ = parent;
     portListeners_.make_list(0);
@@ -114,6 +147,14 @@ ETransStatus MappedReg32Type::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+void MappedReg32Type::saveState(AttributeType *state) {
+    state->make_uint64(value_.val);
+}
+
+void MappedReg32Type::restoreState(const AttributeType *state) {
+    value_.val = state->to_uint32();
+}
+
 
 /** 16-bits register */
 MappedReg16Type::MappedReg16Type(IService *parent, const char *name,
@@ -124,6 +165,8 @@ MappedReg16Type::MappedReg16Type(IService *parent, const char *name,
                 static_cast<IMemoryOperation *>(this));
         parent->registerPortInterface(name,
                 static_cast<IResetListener *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
     }
     parent_ = parent;
     portListeners_.make_list(0);
@@ -171,6 +214,14 @@ ETransStatus MappedReg16Type::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+void MappedReg16Type::saveState(AttributeType *state) {
+    state->make_uint64(value_.word);
+}
+
+void MappedReg16Type::restoreState(const AttributeType *state) {
+    value_.word = static_cast<uint16_t>(state->to_uint32());
+}
+
 /** 8-bits register */
 MappedReg8Type::MappedReg8Type(IService *parent, const char *name,
                   uint64_t addr, int len, int priority) {
@@ -180,6 +231,8 @@ MappedReg8Type::MappedReg8Type(IService *parent, const char *name,
                 static_cast<IMemoryOperation *>(this));
         parent->registerPortInterface(name,
                 static_cast<IResetListener *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
     }
     parent_ = parent;
     portListeners_.make_list(0);
@@ -211,6 +264,14 @@ ETransStatus MappedReg8Type::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+void MappedReg8Type::saveState(AttributeType *state) {
+    state->make_uint64(value_.byte);
+}
+
+void MappedReg8Type::restoreState(const AttributeType *state) {
+    value_.byte = static_cast<uint8_t>(state->to_uint32());
+}
+
 ETransStatus GenericReg64Bank::b_transport(Axi4TransactionType *trans) {
     int idx = static_cast<int>((trans->addr - getBaseAddress()) >> 3);
     if (trans->action == MemAction_Read) {
@@ -225,6 +286,14 @@ void GenericReg64Bank::reset() {
     memset(regs_, 0, length_.to_int());
 }
 
+void GenericReg64Bank::saveState(AttributeType *state) {
+    save_bank(regs_, length_.to_int(), state);
+}
+
+void GenericReg64Bank::restoreState(const AttributeType *state) {
+    restore_bank(regs_, length_.to_int(), state);
+}
+
 void GenericReg64Bank::setRegTotal(int len) {
     if (len * static_cast<int>(sizeof(Reg64Type)) == length_.to_int()) {
         return;
@@ -252,6 +321,14 @@ void GenericReg32Bank::reset() {
     memset(regs_, 0, length_.to_int());
 }
 
+void GenericReg32Bank::saveState(AttributeType *state) {
+    save_bank(regs_, length_.to_int(), state);
+}
+
+void GenericReg32Bank::restoreState(const AttributeType *state) {
+    restore_bank(regs_, length_.to_int(), state);
+}
+
 void GenericReg32Bank::setRegTotal(int len) {
     if (len * static_cast<int>(sizeof(Reg32Type)) == length_.to_int()) {
         return;
@@ -296,6 +373,14 @@ void GenericReg16Bank::reset() {
     memset(regs_, 0, length_.to_int());
 }
 
+void GenericReg16Bank::saveState(AttributeType *state) {
+    save_bank(regs_, length_.to_int(), state);
+}
+
+void GenericReg16Bank::restoreState(const AttributeType *state) {
+    restore_bank(regs_, length_.to_int(), state);
+}
+
 void GenericReg16Bank::setRegTotal(int len) {
     if (len * static_cast<int>(sizeof(Reg16Type)) == length_.to_int()) {
         return;
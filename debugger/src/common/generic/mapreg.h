@@ -21,11 +21,13 @@
 #include <iservice.h>
 #include "coreservices/imemop.h"
 #include "coreservices/ireset.h"
+#include "coreservices/isnapshot.h"
 
 namespace debugger {
 
 class MappedReg64Type : public IMemoryOperation,
-                        public IResetListener {
+                        public IResetListener,
+                        public ISnapshot {
  public:
     MappedReg64Type(IService *parent, const char *name,
                     uint64_t addr, int priority = 1);
@@ -36,6 +38,10 @@ class MappedReg64Type : public IMemoryOperation,
     /** IResetListener interface */
     virtual void reset(IFace *isource) { value_.val = hard_reset_value_; }
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
     /** General access methods: */
     const char *regName() { return regname_.to_string(); }
     Reg64Type getValue() { return value_; }
@@ -67,7 +73,8 @@ class MappedReg64Type : public IMemoryOperation,
 };
 
 class MappedReg32Type : public IMemoryOperation,
-                        public IResetListener {
+                        public IResetListener,
+                        public ISnapshot {
  public:
     MappedReg32Type(IService *parent, const char *name,
                     uint64_t addr, int priority = 1);
@@ -78,6 +85,10 @@ class MappedReg32Type : public IMemoryOperation,
     /** IResetListener interface */
     virtual void reset(IFace *isource) { value_.val = hard_reset_value_; }
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
     /** General access methods: */
     const char *regName() { return regname_.to_string(); }
     Reg32Type getValue() { return value_; }
@@ -109,7 +120,8 @@ class MappedReg32Type : public IMemoryOperation,
 };
 
 class MappedReg16Type : public IMemoryOperation,
-                        public IResetListener {
+                        public IResetListener,
+                        public ISnapshot {
  public:
     MappedReg16Type(IService *parent, const char *name,
                     uint64_t addr, int len = 2, int priority = 1);
@@ -120,6 +132,10 @@ class MappedReg16Type : public IMemoryOperation,
     /** IResetListener interface */
     virtual void reset(IFace *isource) { value_.word = hard_reset_value_; }
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
     /** General access methods: */
     const char *regName() { return regname_.to_string(); }
     Reg16Type getValue() { return value_; }
@@ -151,7 +167,8 @@ class MappedReg16Type : public IMemoryOperation,
 };
 
 class MappedReg8Type : public IMemoryOperation,
-                       public IResetListener {
+                       public IResetListener,
+                       public ISnapshot {
  public:
     MappedReg8Type(IService *parent, const char *name,
                     uint64_t addr, int len = 1, int priority = 1);
@@ -162,6 +179,10 @@ class MappedReg8Type : public IMemoryOperation,
     /** IResetListener interface */
     virtual void reset(IFace *isource) { value_.byte = hard_reset_value_; }
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
     /** General access methods: */
     const char *regName() { return regname_.to_string(); }
     Reg8Type getValue() { return value_; }
@@ -192,13 +213,16 @@ class MappedReg8Type : public IMemoryOperation,
     uint8_t hard_reset_value_;
 };
 
-class GenericReg64Bank : public IMemoryOperation {
+class GenericReg64Bank : public IMemoryOperation,
+                         public ISnapshot {
  public:
     GenericReg64Bank(IService *parent, const char *name,
                     uint64_t addr, int len) {
         parent_ = parent;
         parent->registerPortInterface(name,
                     static_cast<IMemoryOperation *>(this));
+        parent->registerPortInterface(name,
+                    static_cast<ISnapshot *>(this));
         regs_ = 0;
         bankName_.make_string(name);
         baseAddress_.make_uint64(addr);
@@ -216,6 +240,10 @@ class GenericReg64Bank : public IMemoryOperation {
     /** IResetListener interface */
     virtual void reset();
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
     /** General access methods: */
     void setRegTotal(int len);
     virtual Reg64Type read(int idx) { return regs_[idx]; }
@@ -230,13 +258,16 @@ class GenericReg64Bank : public IMemoryOperation {
     Reg64Type *regs_;
 };
 
-class GenericReg32Bank : public IMemoryOperation {
+class GenericReg32Bank : public IMemoryOperation,
+                         public ISnapshot {
  public:
     GenericReg32Bank(IService *parent, const char *name,
                     uint64_t addr, int len) {
         parent_ = parent;
         parent->registerPortInterface(name,
                     static_cast<IMemoryOperation *>(this));
+        parent->registerPortInterface(name,
+                    static_cast<ISnapshot *>(this));
         regs_ = 0;
         bankName_.make_string(name);
         baseAddress_.make_uint64(addr);
@@ -254,6 +285,10 @@ class GenericReg32Bank : public IMemoryOperation {
     /** IResetListener interface */
     virtual void reset();
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
     /** General access methods: */
     void setRegTotal(int len);
     virtual uint32_t read(int idx) { return regs_[idx].val; }
@@ -267,13 +302,16 @@ class GenericReg32Bank : public IMemoryOperation {
     Reg32Type *regs_;
 };
 
-class GenericReg16Bank : public IMemoryOperation {
+class GenericReg16Bank : public IMemoryOperation,
+                         public ISnapshot {
  public:
     GenericReg16Bank(IService *parent, const char *name,
                     uint64_t addr, int len) {
         parent_ = parent;
         parent->registerPortInterface(name,
                 static_cast<IMemoryOperation *>(this));
+        parent->registerPortInterface(name,
+                static_cast<ISnapshot *>(this));
         regs_ = 0;
         bankName_.make_string(name);
         baseAddress_.make_uint64(addr);
@@ -291,6 +329,10 @@ class GenericReg16Bank : public IMemoryOperation {
     /** IResetListener interface */
     virtual void reset();
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
     /** General access methods: */
     void setRegTotal(int len);
     virtual Reg16Type read(int idx) { return regs_[idx]; }
@@ -21,6 +21,7 @@ namespace debugger {
 
 MemoryGeneric::MemoryGeneric(const char *name)  : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("ReadOnly", &readOnly_);
     registerAttribute("DpiClient", &dpiClient_);
     registerAttribute("DpiRoutes", &dpiRoutes_);
@@ -99,4 +100,68 @@ ETransStatus MemoryGeneric::b_transport(Axi4TransactionType *trans) {
     return TRANS_OK;
 }
 
+ETransStatus MemoryGeneric::bulk_transport(BulkTransactionType *trans) {
+    if (idpi_) {
+        // Each word is compared with SystemVerilog model
+        return IMemoryOperation::bulk_transport(trans);
+    }
+    uint64_t off = trans->addr - getBaseAddress();
+    uint64_t total = 0;
+    for (int i = 0; i < trans->bufcnt; i++) {
+        total += trans->buf[i].size;
+    }
+    if (off + total > length_.to_uint64()) {
+        RISCV_error("Bulk access out of range [%08" RV_PRI64 "x], "
+                    "%" RV_PRI64 "d bytes", trans->addr, total);
+        trans->response = MemResp_Error;
+        return TRANS_ERROR;
+    }
+    trans->response = MemResp_Valid;
+    if (trans->action == MemAction_Write && readOnly_.to_bool()) {
+        RISCV_error("Write to READ ONLY memory", NULL);
+        trans->response = MemResp_Error;
+        return TRANS_OK;
+    }
+    for (int i = 0; i < trans->bufcnt; i++) {
+        if (trans->action == MemAction_Write) {
+            memcpy(&mem_[off], trans->buf[i].ptr, trans->buf[i].size);
+        } else {
+            memcpy(trans->buf[i].ptr, &mem_[off], trans->buf[i].size);
+        }
+        off += trans->buf[i].size;
+    }
+
+    const char *rw_str[2] = {"=>", "<="};
+    RISCV_debug("[%08" RV_PRI64 "x] %s %" RV_PRI64 "d bytes",
+        trans->addr, rw_str[trans->action], total);
+    return TRANS_OK;
+}
+
+bool MemoryGeneric::get_direct_mem_ptr(uint64_t addr, DmiRegionType *dmi) {
+    if (mem_ == 0 || idpi_) {
+        // Each access should be forwarded to SystemVerilog
+        return false;
+    }
+    dmi->addr = getBaseAddress();
+    dmi->size = length_.to_uint64();
+    dmi->ptr = mem_;
+    dmi->rd = true;
+    dmi->wr = !readOnly_.to_bool();
+    return true;
+}
+
+/** Content of the DPI memory belongs to the remote side */
+uint64_t MemoryGeneric::getStorageSize() {
+    if (mem_ == 0 || idpi_) {
+        return 0;
+    }
+    return length_.to_uint64();
+}
+
+void MemoryGeneric::clearStorage() {
+    if (mem_) {
+        memset(mem_, 0, static_cast<size_t>(length_.to_uint64()));
+    }
+}
+
 }  // namespace debugger
@@ -21,11 +21,13 @@
 #include "iservice.h"
 #include "coreservices/imemop.h"
 #include <coreservices/idpi.h>
+#include "coreservices/isnapshot.h"
 
 namespace debugger {
 
 class MemoryGeneric : public IService, 
-                      public IMemoryOperation {
+                      public IMemoryOperation,
+                      public ISnapshot {
  public:
     MemoryGeneric(const char *name);
     ~MemoryGeneric();
@@ -35,6 +37,17 @@ class MemoryGeneric : public IService,
 
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
+    virtual ETransStatus bulk_transport(BulkTransactionType *trans);
+    virtual bool get_direct_mem_ptr(uint64_t addr, DmiRegionType *dmi);
+
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state) { state->make_nil(); }
+    virtual void restoreState(const AttributeType *state) {}
+    virtual uint64_t getStorageSize();
+    virtual uint8_t *getStoragePage(uint64_t off, bool alloc) {
+        return &mem_[off];
+    }
+    virtual void clearStorage();
 
  protected:
     AttributeType readOnly_;
@@ -24,6 +24,7 @@ RegMemBankGeneric::RegMemBankGeneric(const char *name)
     registerInterface(static_cast<IMemoryOperation *>(this));
     stubmem = 0;
     imaphash_ = 0;
+    RISCV_mutex_init(&mutexAccess_);
 
     RISCV_register_hap(static_cast<IHap *>(this));
 }
@@ -35,6 +36,7 @@ RegMemBankGeneric::~RegMemBankGeneric() {
     if (imaphash_) {
         delete [] imaphash_;
     }
+    RISCV_mutex_destroy(&mutexAccess_);
 }
 
 void RegMemBankGeneric::postinitService() {
@@ -93,6 +95,7 @@ ETransStatus RegMemBankGeneric::b_transport(Axi4TransactionType *trans) {
     uint64_t off0 = off;
     uint32_t tsz = trans->xsize;
     tr = *trans;
+    RISCV_mutex_lock(&mutexAccess_);
     while (tsz > 0) {
         imem = imaphash_[off];
         if (imem != 0) {
@@ -127,6 +130,7 @@ ETransStatus RegMemBankGeneric::b_transport(Axi4TransactionType *trans) {
             off += 1;
         }
     }
+    RISCV_mutex_unlock(&mutexAccess_);
     trans->addr = t_addr;           // restore address;
     return TRANS_OK;
 }
@@ -139,7 +143,9 @@ ETransStatus RegMemBankGeneric::nb_transport(Axi4TransactionType *trans,
     trans->addr -= getBaseAddress();    // offset relative registers bank
     imem = imaphash_[trans->addr];
     if (imem != 0) {
+        RISCV_mutex_lock(&mutexAccess_);
         ETransStatus ret = imem->nb_transport(trans, cb);
+        RISCV_mutex_unlock(&mutexAccess_);
         trans->addr = t_addr;           // restore address;
         return ret;
     }
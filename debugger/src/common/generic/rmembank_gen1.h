@@ -51,6 +51,7 @@ class RegMemBankGeneric : public IService,
  protected:
     IMemoryOperation **imaphash_;
     uint8_t *stubmem;
+    mutex_def mutexAccess_;     // registers and their side effects
 };
 
 }  // namespace debugger
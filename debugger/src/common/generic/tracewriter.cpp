@@ -0,0 +1,150 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "tracewriter.h"
+
+namespace debugger {
+
+TraceWriter::TraceWriter(const char *filename, uint32_t cpuid) {
+    AttributeType t1;
+    RISCV_generate_name(&t1);
+    RISCV_event_create(&eventReady_, t1.to_string());
+    RISCV_generate_name(&t1);
+    RISCV_event_create(&eventDone_, t1.to_string());
+
+    buf_[0] = new uint8_t[BUF_SIZE];
+    buf_[1] = new uint8_t[BUF_SIZE];
+    active_ = 0;
+    cnt_ = 0;
+    wrcnt_ = 0;
+    wridx_ = 0;
+    step_ = 0;
+    npc_ = 0;
+    memaddr_ = 0;
+    memset(regs_, 0, sizeof(regs_));
+
+    fp_ = fopen(filename, "wb");
+    if (!fp_) {
+        return;
+    }
+    TraceFileHeaderType hdr;
+    memcpy(hdr.magic, TRACE_BIN_MAGIC, sizeof(hdr.magic));
+    hdr.version = TRACE_BIN_VERSION;
+    hdr.cpuid = cpuid;
+    fwrite(&hdr, 1, sizeof(hdr), fp_);
+    run();
+}
+
+TraceWriter::~TraceWriter() {
+    close();
+    RISCV_event_close(&eventReady_);
+    RISCV_event_close(&eventDone_);
+    delete [] buf_[0];
+    delete [] buf_[1];
+}
+
+void TraceWriter::close() {
+    if (!fp_) {
+        return;
+    }
+    flush();
+    stop();
+    RISCV_event_set(&eventReady_);
+    join(5000);
+    fclose(fp_);
+    fp_ = 0;
+}
+
+/** Wait until the previous buffer is written and pass the current one */
+void TraceWriter::swapBuffers() {
+    while (wrcnt_) {
+        RISCV_event_wait_ms(&eventDone_, 10);
+        RISCV_event_clear(&eventDone_);
+    }
+    wridx_ = active_;
+    wrcnt_ = cnt_;
+    RISCV_event_set(&eventReady_);
+    active_ ^= 1;
+    cnt_ = 0;
+}
+
+void TraceWriter::busyLoop() {
+    while (true) {
+        RISCV_event_wait_ms(&eventReady_, 100);
+        RISCV_event_clear(&eventReady_);
+        if (wrcnt_) {
+            fwrite(buf_[wridx_], 1, wrcnt_, fp_);
+            fflush(fp_);
+            wrcnt_ = 0;
+            RISCV_event_set(&eventDone_);
+        } else if (!isEnabled()) {
+            break;
+        }
+    }
+}
+
+void TraceWriter::putInstr(uint64_t step, uint64_t pc, uint32_t instr,
+                           int oplen) {
+    uint8_t *tag = &buf_[active_][cnt_++];
+    *tag = TraceRecord_Instr;
+    if (pc != npc_) {
+        *tag |= TRACE_TAG_PC_JUMP;
+        putSigned(static_cast<int64_t>(pc - npc_));
+    }
+    if (step != step_ + 1) {
+        *tag |= TRACE_TAG_STEP_JUMP;
+        putVarint(step - step_);
+    }
+    if (oplen == 2) {
+        *tag |= TRACE_TAG_RVC;
+    } else {
+        oplen = 4;
+    }
+    memcpy(&buf_[active_][cnt_], &instr, oplen);
+    cnt_ += oplen;
+    step_ = step;
+    npc_ = pc + oplen;
+    checkFull();
+}
+
+void TraceWriter::putReg(int idx, uint64_t val) {
+    idx &= (TRACE_REGS_MAX - 1);
+    buf_[active_][cnt_++] = TraceRecord_Reg;
+    buf_[active_][cnt_++] = static_cast<uint8_t>(idx);
+    putVarint(val ^ regs_[idx]);
+    regs_[idx] = val;
+    checkFull();
+}
+
+void TraceWriter::putMemop(uint64_t addr, bool wr, uint64_t val,
+                           uint32_t sz) {
+    uint8_t tag = TraceRecord_Memop;
+    int szlog = 0;
+    while ((1u << szlog) < sz && szlog < 3) {
+        szlog++;
+    }
+    tag |= static_cast<uint8_t>(szlog << TRACE_TAG_SIZE_SHIFT);
+    if (wr) {
+        tag |= TRACE_TAG_WRITE;
+    }
+    buf_[active_][cnt_++] = tag;
+    putSigned(static_cast<int64_t>(addr - memaddr_));
+    putVarint(val);
+    memaddr_ = addr;
+    checkFull();
+}
+
+}  // namespace debugger
@@ -0,0 +1,131 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <api_core.h>
+#include "coreservices/ithread.h"
+#include <stdio.h>
+
+namespace debugger {
+
+/**
+ * Binary trace file: TraceFileHeaderType followed by records. Every record
+ * starts with the tag byte, multi-byte fields are LEB128 varints:
+ *
+ *   Instruction  tag[2:0]=0
+ *                tag[3]=1  pc isn't previous pc + previous length:
+ *                          zigzag varint of the pc delta follows
+ *                tag[4]=1  step delta isn't 1: varint of the delta follows
+ *                tag[5]=1  2-bytes instruction, otherwise 4 bytes
+ *                instruction bytes
+ *   Register     tag[2:0]=1, byte index, varint (value ^ previous value)
+ *   Memory       tag[2:0]=2, tag[3] write, tag[6:4] log2(size),
+ *                zigzag varint of the address delta, varint data
+ *
+ * Register and memory records belong to the preceding instruction.
+ */
+static const char TRACE_BIN_MAGIC[8] = {'R', 'V', 'T', 'R', 'A', 'C', 'E', 0};
+static const uint32_t TRACE_BIN_VERSION = 1;
+
+enum ETraceRecord {
+    TraceRecord_Instr,
+    TraceRecord_Reg,
+    TraceRecord_Memop,
+};
+
+static const uint8_t TRACE_TAG_TYPE_MASK = 0x07;
+static const uint8_t TRACE_TAG_PC_JUMP = 0x08;
+static const uint8_t TRACE_TAG_STEP_JUMP = 0x10;
+static const uint8_t TRACE_TAG_RVC = 0x20;
+static const uint8_t TRACE_TAG_WRITE = 0x08;
+static const int TRACE_TAG_SIZE_SHIFT = 4;
+static const int TRACE_REGS_MAX = 256;
+
+struct TraceFileHeaderType {
+    char magic[8];
+    uint32_t version;
+    uint32_t cpuid;             // SysBusMasterID of the traced CPU
+};
+
+/**
+ * @brief Double-buffered writer of the binary trace.
+ * @details Records are encoded by the CPU thread into the active buffer.
+ *          Full buffer is passed to the background thread and the CPU
+ *          continues with the second one.
+ */
+class TraceWriter : public IThread {
+ public:
+    TraceWriter(const char *filename, uint32_t cpuid);
+    virtual ~TraceWriter();
+
+    bool isOpened() { return fp_ != 0; }
+    /** Pass accumulated records to the writer thread */
+    void flush() {
+        if (cnt_) {
+            swapBuffers();
+        }
+    }
+    /** Write the rest of data and stop thread */
+    void close();
+
+    void putInstr(uint64_t step, uint64_t pc, uint32_t instr, int oplen);
+    void putReg(int idx, uint64_t val);
+    void putMemop(uint64_t addr, bool wr, uint64_t val, uint32_t sz);
+
+ protected:
+    /** IThread */
+    virtual void busyLoop() override;
+
+ private:
+    void putVarint(uint64_t v) {
+        while (v >= 0x80) {
+            buf_[active_][cnt_++] = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        buf_[active_][cnt_++] = static_cast<uint8_t>(v);
+    }
+    void putSigned(int64_t v) {
+        putVarint((static_cast<uint64_t>(v) << 1)
+                  ^ static_cast<uint64_t>(v >> 63));
+    }
+    void checkFull() {
+        if (cnt_ > BUF_SIZE - RECORD_MAX) {
+            swapBuffers();
+        }
+    }
+    void swapBuffers();
+
+ private:
+    static const int BUF_SIZE = 1 << 20;
+    static const int RECORD_MAX = 32;
+
+    FILE *fp_;
+    uint8_t *buf_[2];
+    int active_;                // buffer filled by CPU
+    int cnt_;
+    volatile int wrcnt_;        // bytes passed to thread, 0 = idle
+    int wridx_;
+    event_def eventReady_;
+    event_def eventDone_;
+
+    uint64_t step_;
+    uint64_t npc_;
+    uint64_t memaddr_;
+    uint64_t regs_[TRACE_REGS_MAX];
+};
+
+}  // namespace debugger
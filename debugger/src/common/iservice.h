@@ -171,6 +171,9 @@ class IService : public IFace {
 
     virtual const char *getObjName() { return obj_name_.to_string(); }
 
+    /** Non-virtual to be checked inline by the RISCV_* logging macros */
+    int getLogLevel() { return static_cast<int>(logLevel_.to_int64()); }
+
     virtual AttributeType getConfiguration() {
         AttributeType ret(Attr_Dict);
         ret["Name"] = AttributeType(getObjName());
@@ -442,11 +442,23 @@ union csr_satp_type {
     uint64_t u64;
     struct bits_type {
         uint64_t ppn : 44;  // [43:0] WARL
-        uint64_t asid : 9;  // [59:44] WARL
+        uint64_t asid : 16; // [59:44] WARL
         uint64_t mode : 4;  // [63:60] WARL
     } bits;
 };
 
+/** Page table entry bits (Sv39/Sv48) */
+static const uint64_t PTE_V = 1ull << 0;   // Valid
+static const uint64_t PTE_R = 1ull << 1;   // Readable
+static const uint64_t PTE_W = 1ull << 2;   // Writable
+static const uint64_t PTE_X = 1ull << 3;   // Executable
+static const uint64_t PTE_U = 1ull << 4;   // Accessible in U-mode
+static const uint64_t PTE_G = 1ull << 5;   // Global mapping
+static const uint64_t PTE_A = 1ull << 6;   // Accessed
+static const uint64_t PTE_D = 1ull << 7;   // Dirty
+static const int PTE_PPN_SHIFT = 10;       // [53:10] physical page number
+static const uint64_t PTE_PPN_MASK = (1ull << 44) - 1;
+
 
 static const char *const RISCV_IREGS_NAMES[] = {
     "zero",     // [0] zero
@@ -22,6 +22,8 @@ namespace debugger {
 EIsaArmV7 decoder_arm(uint32_t ti, char *errmsg, size_t errsz);
 EIsaArmV7 decoder_thumb(uint32_t ti, uint32_t *tio,
                         char *errmsg, size_t errsz);
+void decoder_thumb_init();
+EIsaArmV7 decoder_thumb_table(uint32_t ti);
 
 
 CpuCortex_Functional::CpuCortex_Functional(const char *name) :
@@ -44,6 +46,7 @@ void CpuCortex_Functional::postinitService() {
     }
     addArm7tmdiIsa();
     addThumb2Isa();
+    decoder_thumb_init();
 
     CpuGeneric::postinitService();
 
@@ -326,7 +329,11 @@ GenericInstruction *CpuCortex_Functional::decodeInstruction(Reg64Type *cache) {
     EIsaArmV7 etype;
     if (getInstrMode() == THUMB_mode) {
         uint32_t tio;
-        etype = decoder_thumb(ti, &tio, errmsg_, sizeof(errmsg_));
+        etype = decoder_thumb_table(ti);
+        if (etype == ARMV7_Total) {
+            // Branch tree is used only to describe the error
+            decoder_thumb(ti, &tio, errmsg_, sizeof(errmsg_));
+        }
         //cacheline_[0].buf32[0] = tio;
     } else {
         etype = decoder_arm(ti, errmsg_, sizeof(errmsg_));
@@ -54,6 +54,7 @@ class CpuCortex_Functional : public CpuGeneric,
     virtual void setInstrMode(EArmInstructionModes mode) {
         const uint32_t MODE[ArmInstrModes_Total] = {0u, 1u};
         p_psr_->u.T = MODE[mode];
+        decodeMode_ = MODE[mode];   // entries of the other mode miss
     }
     virtual EArmInstructionModes getInstrMode() {
         const EArmInstructionModes MODE[2] = {ARM_mode, THUMB_mode};
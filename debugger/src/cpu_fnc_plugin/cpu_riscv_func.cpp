@@ -20,6 +20,63 @@
 
 namespace debugger {
 
+int CpuTlbCmdType::isValid(AttributeType *args) {
+    if (!(*args)[0u].is_equal("tlb")) {
+        return CMD_INVALID;
+    }
+    for (unsigned i = 1; i < args->size(); i++) {
+        if (!(*args)[i].is_string()) {
+            return CMD_WRONG_ARGS;
+        }
+        if (!(*args)[i].is_equal("clear")
+            && !(*args)[i].is_equal(cmdParent_->getObjName())) {
+            return CMD_INVALID;
+        }
+    }
+    return CMD_VALID;
+}
+
+void CpuTlbCmdType::exec(AttributeType *args, AttributeType *res) {
+    CpuRiver_Functional *p = static_cast<CpuRiver_Functional *>(cmdParent_);
+    p->getTlbStat(res);
+    if ((*args)[args->size() - 1].is_equal("clear")) {
+        p->clearTlbStat();
+    }
+}
+
+int CpuDecodeBenchCmdType::isValid(AttributeType *args) {
+    if (!(*args)[0u].is_equal("decbench")) {
+        return CMD_INVALID;
+    }
+    unsigned n = 1;
+    if (args->size() > 1 && (*args)[1].is_string()) {
+        if (!(*args)[1].is_equal(cmdParent_->getObjName())) {
+            return CMD_INVALID;
+        }
+        n = 2;
+    }
+    if (args->size() < n + 2 || args->size() > n + 3) {
+        return CMD_WRONG_ARGS;
+    }
+    for (unsigned i = n; i < args->size(); i++) {
+        if (!(*args)[i].is_integer()) {
+            return CMD_WRONG_ARGS;
+        }
+    }
+    return CMD_VALID;
+}
+
+void CpuDecodeBenchCmdType::exec(AttributeType *args, AttributeType *res) {
+    CpuRiver_Functional *p = static_cast<CpuRiver_Functional *>(cmdParent_);
+    unsigned n = (*args)[1].is_string() ? 2 : 1;
+    unsigned loops = 1;
+    if (args->size() > n + 2) {
+        loops = (*args)[n + 2].to_uint32();
+    }
+    p->decodeBench((*args)[n].to_uint64(), (*args)[n + 1].to_uint64(),
+                   loops, res);
+}
+
 CpuRiver_Functional::CpuRiver_Functional(const char *name) :
     CpuGeneric(name) {
     registerInterface(static_cast<ICpuRiscV *>(this));
@@ -31,13 +88,38 @@ CpuRiver_Functional::CpuRiver_Functional(const char *name) :
     registerAttribute("CLINT", &clint_);
     registerAttribute("PLIC", &plic_);
     registerAttribute("PmpTotal", &pmpTotal_);
+    registerAttribute("ExpandRVC", &expandRVC_);
 
+    expandRVC_.make_boolean(true);
     mmuReservatedAddr_ = 0;
     mmuReservedAddrWatchdog_ = 0;
     memset(&pmpTable_, 0, sizeof(pmpTable_));
+    csrTable_ = getCsrTable();
+    csr_ = portCSR_.getpR64();
+    csrSeq_ = 0;
+    mmuActive_ = false;
+    mpuActive_ = false;
+    stepEnabled_ = false;
+    stackCheck_ = false;
+    mmuFault_ = 0;
+    mmuFaultAddr_ = 0;
+    pcmd_tlb_ = 0;
+    pcmd_decbench_ = 0;
+    memset(decodeL1_, 0, sizeof(decodeL1_));
+    memset(decodeRvc_, 0, sizeof(decodeRvc_));
+    decodeL2_ = 0;
+    decodeL2Cnt_ = 0;
+    decodePool_ = 0;
+    decodePoolCnt_ = 0;
+    decodePoolSize_ = 0;
+    decodeLast_ = 0;
+    flushTlb(~0ull, ~0ull);
+    clearTlbStat();
 }
 
 CpuRiver_Functional::~CpuRiver_Functional() {
+    delete [] decodeL2_;
+    delete [] decodePool_;
 }
 
 void CpuRiver_Functional::postinitService() {
@@ -60,6 +142,7 @@ void CpuRiver_Functional::postinitService() {
             addIsaExtensionM();
         }
     }
+    buildDecodeTables();
 
     // Power-on
     reset(0);
@@ -79,9 +162,39 @@ void CpuRiver_Functional::postinitService() {
         RISCV_error("Interface IIrqController in %s not found",
                     clint_.to_string());
     }
+
+    if (icmdexec_) {
+        pcmd_tlb_ = new CpuTlbCmdType(static_cast<IService *>(this));
+        icmdexec_->registerCommand(static_cast<ICommand *>(pcmd_tlb_));
+        pcmd_decbench_ =
+            new CpuDecodeBenchCmdType(static_cast<IService *>(this));
+        icmdexec_->registerCommand(static_cast<ICommand *>(pcmd_decbench_));
+    }
+
+    // Wake-up notification from the interrupt controllers
+    IFace *icpu = static_cast<ICpuFunctional *>(this);
+    if (iirqloc_) {
+        iirqloc_->registerListener(2*hartid_.to_int(), icpu);
+        iirqloc_->registerListener(2*hartid_.to_int() + 1, icpu);
+    }
+    if (iirqext_) {
+        for (unsigned i = 0; i < contextid_.size(); i++) {
+            iirqext_->registerListener(contextid_[i].to_int(), icpu);
+        }
+    }
 }
 
 void CpuRiver_Functional::predeleteService() {
+    if (pcmd_tlb_) {
+        icmdexec_->unregisterCommand(static_cast<ICommand *>(pcmd_tlb_));
+        delete pcmd_tlb_;
+        pcmd_tlb_ = 0;
+    }
+    if (pcmd_decbench_) {
+        icmdexec_->unregisterCommand(static_cast<ICommand *>(pcmd_decbench_));
+        delete pcmd_decbench_;
+        pcmd_decbench_ = 0;
+    }
     CpuGeneric::predeleteService();
 }
 
@@ -92,10 +205,112 @@ unsigned CpuRiver_Functional::addSupportedInstruction(
     return 0;
 }
 
+/**
+ * Instruction is a candidate for all table keys that equal to its fixed
+ * bits in the key fields, the remaining bits are checked by parse().
+ * Candidates keep the registration order.
+ */
+unsigned CpuRiver_Functional::addDecodeList(uint32_t key, uint32_t keymask) {
+    unsigned start = decodePoolCnt_;
+    for (int h = 0; h < INSTR_HASH_TABLE_SIZE; h++) {
+        for (unsigned i = 0; i < listInstr_[h].size(); i++) {
+            RiscvInstruction *instr = static_cast<RiscvInstruction *>(
+                            listInstr_[h][i].to_iface());
+            if (((key ^ instr->opcode()) & instr->mask() & keymask) != 0) {
+                continue;
+            }
+            if (decodePoolCnt_ + 1 >= decodePoolSize_) {
+                RiscvInstruction **t =
+                    new RiscvInstruction *[2 * decodePoolSize_];
+                memcpy(t, decodePool_, decodePoolCnt_ * sizeof(*t));
+                delete [] decodePool_;
+                decodePool_ = t;
+                decodePoolSize_ *= 2;
+            }
+            decodePool_[decodePoolCnt_++] = instr;
+        }
+    }
+    if (start == decodePoolCnt_) {
+        return 0;
+    }
+    decodePool_[decodePoolCnt_++] = 0;
+
+    // Neighbouring keys usually differ only in the operand bits
+    unsigned len = decodePoolCnt_ - start;
+    if (decodeLast_ && decodeLast_ + len == start
+        && memcmp(&decodePool_[decodeLast_], &decodePool_[start],
+                  len * sizeof(*decodePool_)) == 0) {
+        decodePoolCnt_ = start;
+        return decodeLast_;
+    }
+    decodeLast_ = start;
+    return start;
+}
+
+void CpuRiver_Functional::buildDecodeTables() {
+    delete [] decodeL2_;
+    delete [] decodePool_;
+    decodePoolSize_ = 1024;
+    decodePool_ = new RiscvInstruction *[decodePoolSize_];
+    decodePool_[0] = 0;         // empty list of illegal opcodes
+    decodePoolCnt_ = 1;
+    decodeLast_ = 0;
+
+    // 32-bit opcodes: the second level is used by the groups with the
+    // several candidates that differ in funct7, funct5 or rs2.
+    bool needL2[DECODE_L1_SIZE];
+    decodeL2Cnt_ = 0;
+    for (uint32_t i = 0; i < DECODE_L1_SIZE; i++) {
+        uint32_t key = 0x3 | ((i & 0x1F) << 2) | ((i & 0xE0) << 7);
+        unsigned off = addDecodeList(key, DECODE_L1_MASK);
+        decodeL1_[i] = off;
+        needL2[i] = false;
+        if (off == 0 || decodePool_[off + 1] == 0) {
+            continue;
+        }
+        for (RiscvInstruction **p = &decodePool_[off]; *p; p++) {
+            if ((*p)->mask() & ~DECODE_L1_MASK) {
+                needL2[i] = true;
+                decodeL2Cnt_++;
+                break;
+            }
+        }
+    }
+
+    decodeL2_ = new uint32_t[decodeL2Cnt_ * DECODE_L2_SIZE];
+    uint32_t *l2 = decodeL2_;
+    for (uint32_t i = 0; i < DECODE_L1_SIZE; i++) {
+        if (!needL2[i]) {
+            continue;
+        }
+        uint32_t key = 0x3 | ((i & 0x1F) << 2) | ((i & 0xE0) << 7);
+        for (uint32_t n = 0; n < DECODE_L2_SIZE; n++) {
+            l2[n] = addDecodeList(key | (n << 20), DECODE_L2_MASK);
+        }
+        decodeL1_[i] = DECODE_L2_FLAG
+                     | static_cast<uint32_t>(l2 - decodeL2_);
+        l2 += DECODE_L2_SIZE;
+    }
+
+    // Compressed opcodes, quadrant 3 is never used
+    for (uint32_t i = 0; i < DECODE_RVC_SIZE; i++) {
+        uint32_t key = (i & 0x3) | ((i & 0xC) << 3) | ((i & 0x3F0) << 6);
+        decodeRvc_[i] = 0;
+        if ((i & 0x3) != 0x3) {
+            decodeRvc_[i] = addDecodeList(key, DECODE_RVC_MASK);
+        }
+    }
+    RISCV_debug("Decoder: %d L2 tables, %d candidate entries",
+                decodeL2Cnt_, decodePoolCnt_);
+}
+
 /** Check stack protection exceptions: */
 void CpuRiver_Functional::checkStackProtection() {
-    uint64_t mstackovr = readCSR(CSR_mstackovr);
-    uint64_t mstackund = readCSR(CSR_mstackund);
+    if (!stackCheck_) {
+        return;
+    }
+    uint64_t mstackovr = csr_[CSR_mstackovr];
+    uint64_t mstackund = csr_[CSR_mstackund];
     uint64_t sp = portRegs_.read(Reg_sp).val;
     if (mstackovr != 0 && sp < mstackovr) {
         generateException(EXCEPTION_StackOverflow, getPC());
@@ -127,13 +342,28 @@ void CpuRiver_Functional::handleException(int e) {
         return;
     }
 
+    if (e == EXCEPTION_InstrPageFault || e == EXCEPTION_LoadPageFault
+        || e == EXCEPTION_StorePageFault) {
+        // Restart faulted instruction after the page is mapped
+        setNPC(getPC());
+    }
     switchContext(PRV_M);
 
     uint64_t mtvec = readCSR(CSR_mtvec) & ~0x3ull;
     setNPC(mtvec);
 }
 
+/**
+ * Requests are evaluated only when interrupt controller notified about
+ * a new request or mstatus/mie were modified. Flag is cleared before
+ * evaluation, so that a notification arriving meanwhile isn't lost.
+ */
 void CpuRiver_Functional::handleInterrupts() {
+    if (!irq_possible_) {
+        return;
+    }
+    irq_possible_ = false;
+
     int ctx = 0;
     csr_mcause_type mcause;
     csr_mstatus_type mstatus;
@@ -189,6 +419,11 @@ void CpuRiver_Functional::handleInterrupts() {
     }
 }
 
+/** WFI resumes on any locally enabled request ignoring mstatus.MIE */
+bool CpuRiver_Functional::isWakeupPending() {
+    return (readCSR(CSR_mip) & readCSR(CSR_mie)) != 0;
+}
+
 void CpuRiver_Functional::switchContext(uint32_t prvnxt) {
     // All traps handle via machine mode while CSR mdelegate
     // doesn't setup other.
@@ -199,7 +434,7 @@ void CpuRiver_Functional::switchContext(uint32_t prvnxt) {
     mstatus.bits.MPIE = (mstatus.value >> cur_prv_level) & 0x1;
     mstatus.bits.MIE = 0;
     cur_prv_level = prvnxt;
-    writeCSR(CSR_mstatus, mstatus.value);
+    writeCSR(CSR_mstatus, mstatus.value);   // updates MMU/PMP state
 
     int xepc = static_cast<int>((cur_prv_level << 8) + 0x41);
     writeCSR(xepc, getNPC());
@@ -219,36 +454,165 @@ void CpuRiver_Functional::reset(IFace *isource) {
     writeCSR(CSR_dpc, getResetAddress());
 
     cur_prv_level = PRV_M;           // Current privilege level
+    updateCsrState();
     mmuReservedAddrWatchdog_ = 0;
+    mmuFault_ = 0;
+    flushTlb(~0ull, ~0ull);
+}
+
+/** PMP regions derived from the CSR bank */
+void CpuRiver_Functional::saveState(AttributeType *state) {
+    CpuGeneric::saveState(state);
+    (*state)["reserved_addr"].make_uint64(mmuReservatedAddr_);
+    (*state)["reserved_watchdog"].make_uint64(mmuReservedAddrWatchdog_);
+    (*state)["pmp"].make_data(sizeof(pmpTable_), &pmpTable_);
 }
 
+void CpuRiver_Functional::restoreState(const AttributeType *state) {
+    CpuGeneric::restoreState(state);
+    updateCsrState();       // CSR bank is restored before the CPU state
+    mmuReservatedAddr_ = (*state)["reserved_addr"].to_uint64();
+    mmuReservedAddrWatchdog_ = (*state)["reserved_watchdog"].to_uint64();
+    restoreData(state, "pmp", &pmpTable_, sizeof(pmpTable_));
+    mmuFault_ = 0;
+    flushTlb(~0ull, ~0ull);
+}
+
+/**
+ * Access fault reported by the memory operation is replaced with the page
+ * fault if it was caused by the address translation.
+ */
+void CpuRiver_Functional::generateException(int e, uint64_t arg) {
+    if (mmuFault_ && (e == EXCEPTION_InstrFault
+                    || e == EXCEPTION_LoadFault
+                    || e == EXCEPTION_StoreFault)) {
+        e = mmuFault_;
+        arg = mmuFaultAddr_;
+    }
+    mmuFault_ = 0;
+    writeCSR(CSR_mtval, arg);
+    CpuGeneric::generateException(e, arg);
+}
+
+/**
+ * Predecoded payload is the 32-bit instruction word and its length, so
+ * that caches, translation blocks, tracer and coverage see the compressed
+ * instructions as their 32-bit equivalents.
+ */
 GenericInstruction *CpuRiver_Functional::decodeInstruction(Reg64Type *cache) {
+    RiscvInstruction *instr;
+    uint32_t val = cache[0].buf32[0];
+    cache[0].buf32[1] = val;
+    if ((val & 0x3) == 0x3) {
+        return decodeTable(cache[0].buf32);
+    }
+    if (expandRVC_.to_bool()) {
+        uint32_t op = expandCompressed(static_cast<uint16_t>(val));
+        if (op && (instr = decodeTable(&op)) != 0) {
+            cache[0].buf32[1] = op;
+            return instr;
+        }
+        // Reserved encoding or 32-bit extension is not supported
+    }
+    return decodeTable(cache[0].buf32);
+}
+
+RiscvInstruction *CpuRiver_Functional::decodeTable(uint32_t *payload) {
+    uint32_t val = payload[0];
+    uint32_t off;
+    if ((val & 0x3) == 0x3) {
+        off = decodeL1_[decodeL1Index(val)];
+        if (off & DECODE_L2_FLAG) {
+            off = decodeL2_[(off & ~DECODE_L2_FLAG) + (val >> 20)];
+        }
+    } else {
+        off = decodeRvc_[decodeRvcIndex(val)];
+    }
+    for (RiscvInstruction **p = &decodePool_[off]; *p; p++) {
+        if ((*p)->parse(payload)) {
+            return *p;
+        }
+    }
+    return 0;
+}
+
+/** Reference decoder used to check the tables */
+RiscvInstruction *CpuRiver_Functional::decodeLinear(uint32_t *payload) {
     RiscvInstruction *instr = NULL;
-    int hash_idx = hash32(cacheline_[0].buf32[0]);
+    int hash_idx = hash32(payload[0]);
     for (unsigned i = 0; i < listInstr_[hash_idx].size(); i++) {
         instr = static_cast<RiscvInstruction *>(
                         listInstr_[hash_idx][i].to_iface());
-        if (instr->parse(cacheline_[0].buf32)) {
-            break;
+        if (instr->parse(payload)) {
+            return instr;
         }
-        instr = NULL;
     }
     // Check compressed instructions:
-    if (instr == NULL) {
-        hash_idx = hash16(cacheline_[0].buf16[0]);
-        for (unsigned i = 0; i < listInstr_[hash_idx].size(); i++) {
-            instr = static_cast<RiscvInstruction *>(
-                            listInstr_[hash_idx][i].to_iface());
-            if (instr->parse(cacheline_[0].buf32)) {
-                break;
-            }
-            instr = NULL;
+    hash_idx = hash16(static_cast<uint16_t>(payload[0]));
+    for (unsigned i = 0; i < listInstr_[hash_idx].size(); i++) {
+        instr = static_cast<RiscvInstruction *>(
+                        listInstr_[hash_idx][i].to_iface());
+        if (instr->parse(payload)) {
+            return instr;
         }
     }
-    if (mmuReservedAddrWatchdog_) {
-        mmuReservedAddrWatchdog_--;
+    return NULL;
+}
+
+void CpuRiver_Functional::decodeBench(uint64_t addr, uint64_t bytes,
+                                      unsigned loops, AttributeType *res) {
+    // Corpus is the instruction stream of the memory region
+    unsigned total = static_cast<unsigned>(bytes / 2);
+    uint64_t *mem = new uint64_t[total / 4 + 2];
+    uint32_t *words = new uint32_t[total + 1];
+    unsigned cnt = 0;
+    memset(mem, 0, (total / 4 + 2) * sizeof(uint64_t));
+    for (unsigned i = 0; i < total / 4 + 2; i++) {
+        if (!readPhys64((addr & ~0x7ull) + 8 * i, &mem[i])) {
+            break;
+        }
     }
-    return instr;
+    uint8_t *pbuf = reinterpret_cast<uint8_t *>(mem) + (addr & 0x7);
+    for (unsigned off = 0; off + 2 <= bytes; ) {
+        memcpy(&words[cnt], &pbuf[off], 4);
+        off += (words[cnt++] & 0x3) == 0x3 ? 4 : 2;
+    }
+
+    unsigned illegal = 0;
+    unsigned mismatch = 0;
+    for (unsigned i = 0; i < cnt; i++) {
+        RiscvInstruction *instr = decodeTable(&words[i]);
+        if (instr != decodeLinear(&words[i])) {
+            mismatch++;
+        }
+        if (!instr) {
+            illegal++;
+        }
+    }
+
+    volatile uintptr_t sum = 0;
+    uint64_t t1 = RISCV_get_time_ms();
+    for (unsigned n = 0; n < loops; n++) {
+        for (unsigned i = 0; i < cnt; i++) {
+            sum += reinterpret_cast<uintptr_t>(decodeTable(&words[i]));
+        }
+    }
+    uint64_t t2 = RISCV_get_time_ms();
+    for (unsigned n = 0; n < loops; n++) {
+        for (unsigned i = 0; i < cnt; i++) {
+            sum += reinterpret_cast<uintptr_t>(decodeLinear(&words[i]));
+        }
+    }
+    uint64_t t3 = RISCV_get_time_ms();
+    delete [] mem;
+    delete [] words;
+
+    res->make_dict();
+    (*res)["instr"].make_uint64(cnt);
+    (*res)["illegal"].make_uint64(illegal);
+    (*res)["mismatch"].make_uint64(mismatch);
+    (*res)["table_ms"].make_uint64(t2 - t1);
+    (*res)["linear_ms"].make_uint64(t3 - t2);
 }
 
 void CpuRiver_Functional::generateIllegalOpcode() {
@@ -265,17 +629,25 @@ void CpuRiver_Functional::trackContextStart() {
 
 void CpuRiver_Functional::traceOutput() {
     char tstr[1024];
+    const char *mnemonic = "";
 
     isrc_->disasm(0,
                   trace_data_.pc,
                   &trace_data_.instrbuf,
                   &trace_data_.asmlist);
+    for (unsigned i = 0; i < trace_data_.asmlist.size(); i++) {
+        const AttributeType &item = trace_data_.asmlist[i];
+        if (item[ASM_list_type].to_int() == AsmList_disasm) {
+            mnemonic = item[ASM_mnemonic].to_string();
+            break;
+        }
+    }
 
     RISCV_sprintf(tstr, sizeof(tstr),
         "%9" RV_PRI64 "d: %08" RV_PRI64 "x: %s \r\n",
             trace_data_.step_cnt,
             trace_data_.pc,
-            trace_data_.asmlist[0u].to_string());
+            mnemonic);
     (*trace_file_) << tstr;
 
 
@@ -306,12 +678,6 @@ void CpuRiver_Functional::traceOutput() {
     trace_file_->flush();
 }
 
-bool CpuRiver_Functional::isStepEnabled() {
-    csr_dcsr_type dcsr;
-    dcsr.u64 = static_cast<uint32_t>(readCSR(CSR_dcsr));
-    return dcsr.bits.step;
-}
-
 void CpuRiver_Functional::enterDebugMode(uint64_t v, uint32_t cause) {
     csr_dcsr_type dcsr;
     dcsr.u64 = static_cast<uint32_t>(readCSR(CSR_dcsr));
@@ -325,7 +691,7 @@ int CpuRiver_Functional::dportReadReg(uint32_t regno, uint64_t *val) {
     *val = 0;
     uint32_t region = regno >> 12;
     if (region == 0) {
-        *val = readCSR(regno);
+        *val = readCSRSeq(regno);
     } else if (region == 1) {
         *val = readGPR(regno & 0x3F);
     } else if (region == 0xc) {
@@ -361,6 +727,7 @@ int CpuRiver_Functional::dportReadMem(uint64_t addr, uint32_t virt,
     //}
     tr.xsize = sz;
     if (dma_memop(&tr) != TRANS_OK) {
+        mmuFault_ = 0;
         return -1;
     }
     memcpy(payload, tr.rpayload.b8, sz);
@@ -380,179 +747,300 @@ int CpuRiver_Functional::dportWriteMem(uint64_t addr, uint32_t virt,
     tr.wstrb = (1 << sz) - 1;
     tr.wpayload.b64[0] = payload;
     if (dma_memop(&tr) != TRANS_OK) {
+        mmuFault_ = 0;
         return -1;
     }
     return 0;
 }
 
 
+/** Descriptors shared by all harts are filled once on the first call */
+const CpuRiver_Functional::CsrDescriptorType *
+    CpuRiver_Functional::getCsrTable() {
+    struct CsrTableType {
+        CsrDescriptorType item[CSR_TOTAL];
+        CsrTableType() { initCsrTable(item); }
+    };
+    static const CsrTableType tbl;
+    return tbl.item;
+}
+
+/**
+ * Registers without read/write handler are kept in the plain storage of
+ * the CSR bank. Write handler returns false when the value mustn't be
+ * stored.
+ */
+void CpuRiver_Functional::initCsrTable(CsrDescriptorType *tbl) {
+    static const uint16_t RO_LIST[] = {
+        CSR_misa, CSR_mvendorid, CSR_marchid, CSR_mimplementationid,
+        CSR_mhartid, CSR_mcycle, CSR_minsret, CSR_cycle, CSR_time,
+        CSR_insret
+    };
+    static const uint16_t COUNTERS_LIST[] = {
+        CSR_mcycle, CSR_minsret, CSR_cycle, CSR_time, CSR_insret
+    };
+    memset(tbl, 0, CSR_TOTAL*sizeof(CsrDescriptorType));
+    for (unsigned i = 0; i < sizeof(RO_LIST) / sizeof(RO_LIST[0]); i++) {
+        tbl[RO_LIST[i]].flags |= CSR_FLAG_RO;
+    }
+    for (unsigned i = 0;
+        i < sizeof(COUNTERS_LIST) / sizeof(COUNTERS_LIST[0]); i++) {
+        tbl[COUNTERS_LIST[i]].rd = &CpuRiver_Functional::readCsrCounter;
+    }
+    tbl[CSR_dpc].rd = &CpuRiver_Functional::readCsrDpc;
+    tbl[CSR_tdata1].rd = &CpuRiver_Functional::readCsrTrigger;
+    tbl[CSR_tdata2].rd = &CpuRiver_Functional::readCsrTrigger;
+    tbl[CSR_textra].rd = &CpuRiver_Functional::readCsrTrigger;
+    tbl[CSR_tinfo].rd = &CpuRiver_Functional::readCsrTinfo;
+    tbl[CSR_mip].rd = &CpuRiver_Functional::readCsrMip;
+
+    tbl[CSR_tselect].wr = &CpuRiver_Functional::writeCsrTselect;
+    tbl[CSR_tdata1].wr = &CpuRiver_Functional::writeCsrTrigger;
+    tbl[CSR_tdata2].wr = &CpuRiver_Functional::writeCsrTrigger;
+    tbl[CSR_textra].wr = &CpuRiver_Functional::writeCsrTrigger;
+    tbl[CSR_flushi].wr = &CpuRiver_Functional::writeCsrFlushi;
+    for (uint16_t i = CSR_pmpcfg0; i <= CSR_pmpcfg15; i++) {
+        tbl[i].wr = &CpuRiver_Functional::writeCsrPmpcfg;
+    }
+    tbl[CSR_satp].wr = &CpuRiver_Functional::writeCsrSatp;
+    tbl[CSR_satp].flags |= CSR_FLAG_STATE;
+    tbl[CSR_mstatus].wr = &CpuRiver_Functional::writeCsrMstatus;
+    tbl[CSR_mstatus].flags |= CSR_FLAG_STATE | CSR_FLAG_IRQ;
+    tbl[CSR_mie].flags |= CSR_FLAG_IRQ;
+    tbl[CSR_dcsr].flags |= CSR_FLAG_STATE;
+    tbl[CSR_mstackovr].flags |= CSR_FLAG_STATE;
+    tbl[CSR_mstackund].flags |= CSR_FLAG_STATE;
+}
+
+/** Recompute flags checked on each instruction or memory access */
+void CpuRiver_Functional::updateCsrState() {
+    csr_dcsr_type dcsr;
+    csr_satp_type satp;
+    csr_mstatus_type mstatus;
+    dcsr.u64 = static_cast<uint32_t>(csr_[CSR_dcsr]);
+    satp.u64 = csr_[CSR_satp];
+    mstatus.value = csr_[CSR_mstatus];
+
+    // PMP is active for S,U modes or in M-mode with MSTATUS.MPRV=1
+    mpuActive_ = cur_prv_level != PRV_M
+        || (mstatus.bits.MPRV && (mstatus.bits.MPP != PRV_M));
+    mmuActive_ = satp.bits.mode != SATP_MODE_OFF && mpuActive_;
+    stepEnabled_ = dcsr.bits.step != 0;
+    stackCheck_ = (csr_[CSR_mstackovr] | csr_[CSR_mstackund]) != 0;
+}
+
 uint64_t CpuRiver_Functional::readCSR(uint32_t regno) {
-    uint64_t ret = 0;
-    uint64_t trigidx;
-    if (regno == CSR_mcycle) {
-        ret = step_cnt_;
-    } else if (regno == CSR_minsret) {
-        ret = step_cnt_;
-    } else if (regno == CSR_cycle) {
-        ret = step_cnt_;
-    } else if (regno == CSR_time) {
-        ret = step_cnt_;
-    } else if (regno == CSR_insret) {
-        ret = step_cnt_;
-    } else if (regno == CSR_dpc) {
-        if (!isHalted()) {
-            ret = getNPC();
-        } else {
-            ret = portCSR_.read(regno).val;
-        }
-    } else if (regno == CSR_tdata1) {
-        trigidx = readCSR(CSR_tselect);
-        ret = ptriggers_[trigidx].data1.val;
-    } else if (regno == CSR_tdata2) {
-        trigidx = readCSR(CSR_tselect);
-        ret = ptriggers_[trigidx].data2;
-    } else if (regno == CSR_textra) {
-        trigidx = readCSR(CSR_tselect);
-        ret = ptriggers_[trigidx].extra;
-    } else if (regno == CSR_tinfo) {
-        // RO: list of supported triggers
-        ret = (1ull << TriggerType_AddrDataMatch)
-            | (1ull << TriggerType_InstrCountMatch)
-            | (1ull << TriggerType_Inetrrupt)
-            | (1ull << TriggerType_Exception);
-    } else if (regno == CSR_mip) {
-        int hartid = hartid_.to_int();
-        csr_mip_type mip;
-        mip.value = 0;
-        mip.bits.MSIP = iirqloc_->getPendingRequest(2*hartid);
-        mip.bits.MTIP = iirqloc_->getPendingRequest(2*hartid + 1);
-        mip.bits.MEIP = iirqext_->getPendingRequest(hartid) != IRQ_REQUEST_NONE;
-        ret = mip.value;
-    } else {
-        RISCV_mutex_lock(&mutex_csr_);
-        ret = portCSR_.read(regno).val;
-        RISCV_mutex_unlock(&mutex_csr_);
+    regno &= CSR_TOTAL - 1;
+    CsrReadType rd = csrTable_[regno].rd;
+    if (rd) {
+        return (this->*rd)(regno);
     }
+    return csr_[regno];
+}
+
+/**
+ * Debugger thread reads registers without lock: the value is re-read if
+ * any CSR was modified meanwhile.
+ */
+uint64_t CpuRiver_Functional::readCSRSeq(uint32_t regno) {
+    uint32_t seq;
+    uint64_t ret;
+    do {
+        seq = csrSeq_;
+        RISCV_memory_barrier();
+        ret = readCSR(regno);
+        RISCV_memory_barrier();
+    } while ((seq & 0x1) || seq != csrSeq_);
     return ret;
 }
 
 void CpuRiver_Functional::writeCSR(uint32_t regno, uint64_t val) {
-    bool wr_access = true;
-    uint64_t trigidx;
-    // Read-Only registers
-    if (regno == CSR_misa) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_mvendorid) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_marchid) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_mimplementationid) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_mhartid) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_mcycle) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_minsret) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_cycle) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_time) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_insret) {
-        wr_access = false;  // RO
-    } else if (regno == CSR_tselect) {
-        if (val > triggersTotal_.to_uint64()) {
-            val = triggersTotal_.to_uint64();
-            RISCV_debug("Select trigger %d", static_cast<int>(val));
-        }
-    } else if (regno == CSR_tdata1) {
-        trigidx = readCSR(CSR_tselect);
+    regno &= CSR_TOTAL - 1;
+    const CsrDescriptorType *d = &csrTable_[regno];
+    if (d->flags & CSR_FLAG_RO) {
+        return;
+    }
+    // CPU and debugger threads both write CSRs, the lock keeps the only
+    // writer of the sequence counter
+    RISCV_mutex_lock(&mutex_csr_);
+    csrSeq_ = csrSeq_ + 1;
+    RISCV_memory_barrier();
+    if (!d->wr || (this->*d->wr)(regno, &val)) {
+        csr_[regno] = val;
+    }
+    RISCV_memory_barrier();
+    csrSeq_ = csrSeq_ + 1;
+    if (d->flags & CSR_FLAG_STATE) {
+        updateCsrState();
+    }
+    RISCV_mutex_unlock(&mutex_csr_);
+    if (d->flags & CSR_FLAG_IRQ) {
+        // Enable bits could unmask already pending request
+        irq_possible_ = true;
+    }
+}
+
+uint64_t CpuRiver_Functional::readCsrCounter(uint32_t regno) {
+    return step_cnt_;
+}
+
+uint64_t CpuRiver_Functional::readCsrDpc(uint32_t regno) {
+    if (!isHalted()) {
+        return getNPC();
+    }
+    return csr_[regno];
+}
+
+uint64_t CpuRiver_Functional::readCsrTrigger(uint32_t regno) {
+    uint64_t trigidx = csr_[CSR_tselect];
+    if (trigidx >= triggersTotal_.to_uint64()) {
+        return 0;
+    }
+    if (regno == CSR_tdata1) {
+        return ptriggers_[trigidx].data1.val;
+    } else if (regno == CSR_tdata2) {
+        return ptriggers_[trigidx].data2;
+    }
+    return ptriggers_[trigidx].extra;
+}
+
+uint64_t CpuRiver_Functional::readCsrTinfo(uint32_t regno) {
+    // RO: list of supported triggers
+    return (1ull << TriggerType_AddrDataMatch)
+        | (1ull << TriggerType_InstrCountMatch)
+        | (1ull << TriggerType_Inetrrupt)
+        | (1ull << TriggerType_Exception);
+}
+
+uint64_t CpuRiver_Functional::readCsrMip(uint32_t regno) {
+    int hartid = hartid_.to_int();
+    csr_mip_type mip;
+    mip.value = 0;
+    mip.bits.MSIP = iirqloc_->getPendingRequest(2*hartid);
+    mip.bits.MTIP = iirqloc_->getPendingRequest(2*hartid + 1);
+    mip.bits.MEIP = iirqext_->getPendingRequest(hartid) != IRQ_REQUEST_NONE;
+    return mip.value;
+}
+
+bool CpuRiver_Functional::writeCsrTselect(uint32_t regno, uint64_t *val) {
+    if (*val > triggersTotal_.to_uint64()) {
+        *val = triggersTotal_.to_uint64();
+        RISCV_debug("Select trigger %d", static_cast<int>(*val));
+    }
+    return true;
+}
+
+bool CpuRiver_Functional::writeCsrTrigger(uint32_t regno, uint64_t *val) {
+    uint64_t trigidx = csr_[CSR_tselect];
+    if (trigidx >= triggersTotal_.to_uint64()) {
+        return true;
+    }
+    if (regno == CSR_tdata1) {
         TriggerData1Type tdata1;
-        tdata1.val = val;
+        tdata1.val = *val;
         if (tdata1.bitsdef.type == TriggerType_AddrDataMatch) {
             // Preset value
             tdata1.mcontrol_bits.maskmax = mcontrolMaskmax_.to_uint64();
         }
-        ptriggers_[trigidx].data1.val = val;
+        ptriggers_[trigidx].data1.val = *val;
+        compileTriggers();
         RISCV_info("[tdata1] <= %016" RV_PRI64 "x, type=%d",
-            val, static_cast<uint32_t>(tdata1.bitsdef.type));
-        val = tdata1.val;
+            *val, static_cast<uint32_t>(tdata1.bitsdef.type));
+        *val = tdata1.val;
     } else if (regno == CSR_tdata2) {
-        trigidx = readCSR(CSR_tselect);
-        ptriggers_[trigidx].data2 = val;
-        RISCV_info("[tdata2] <= %016" RV_PRI64 "x", val);
-    } else if (regno == CSR_textra) {
-        trigidx = readCSR(CSR_tselect);
-        ptriggers_[trigidx].extra = val;
-        RISCV_info("[textra] <= %016" RV_PRI64 "x", val);
-    } else if (regno == CSR_flushi) {
-        flush(val);
-    } else if (regno >= CSR_pmpcfg0 && regno <= CSR_pmpcfg15) {
-        // Physical memory protection configuration:
-        uint64_t mask54 = (1ull << 54) - 1;
-        unsigned pmpidx = 8 * (regno - (CSR_pmpcfg0 & ~0x1));
-        unsigned pmptot = 8;
-        unsigned pmpcfg;
-        unsigned A, RWX, L;
-        if (CSR_pmpcfg0 & 0x1) {
-            pmptot = 4;
-            pmpidx += 4;
-        }
-        for (unsigned i = 0; i < pmptot; i++) {
-            pmpcfg = static_cast<unsigned>((val >> (8 * i)) & 0xFF);
-            RWX = pmpcfg & 0x7;
-            A = (pmpcfg >> 3) & 0x3;
-            L = (pmpcfg >> 7) & 0x1;
-            uint64_t startaddr = 0;
-            uint64_t endaddr = (mask54 << 2) | 0x3;
-            if (A == 0x0) {
-                disablePmp(pmpidx + i);
-            } else if (A == 1) {
-                // TOR: Top of region
-                endaddr = (portCSR_.read(CSR_pmpaddr0 + pmpidx + i).val & mask54) - 1;
-                if (pmpidx) {
-                    startaddr = portCSR_.read(CSR_pmpaddr0 + pmpidx + i - 1).val & mask54;
-                }
-                enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
-            } else if (A == 2) {
-                startaddr = (portCSR_.read(CSR_pmpaddr0 + pmpidx + i).val & mask54) << 2;
-                endaddr = startaddr + 3;
-                enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
-            } else if (A == 3) {
-                startaddr = portCSR_.read(CSR_pmpaddr0 + pmpidx + i).val & mask54;
-                if (startaddr == mask54) {
-                    // Full memory region
-                    startaddr = 0;
-                    endaddr = ~0ull;
-                } else {
-                    uint64_t bitidx = 0x1ull;
-                    while ((startaddr & bitidx) && bitidx) {
-                        startaddr &= ~bitidx;
-                        bitidx <<= 1;
-                    }
-                    startaddr <<= 2;
-                    endaddr = startaddr + 8 * bitidx - 1;
+        ptriggers_[trigidx].data2 = *val;
+        compileTriggers();
+        RISCV_info("[tdata2] <= %016" RV_PRI64 "x", *val);
+    } else {
+        ptriggers_[trigidx].extra = *val;
+        RISCV_info("[textra] <= %016" RV_PRI64 "x", *val);
+    }
+    return true;
+}
+
+bool CpuRiver_Functional::writeCsrFlushi(uint32_t regno, uint64_t *val) {
+    flush(*val);
+    return true;
+}
+
+bool CpuRiver_Functional::writeCsrPmpcfg(uint32_t regno, uint64_t *val) {
+    // Physical memory protection configuration:
+    uint64_t mask54 = (1ull << 54) - 1;
+    unsigned pmpidx = 8 * (regno - (CSR_pmpcfg0 & ~0x1));
+    unsigned pmptot = 8;
+    unsigned pmpcfg;
+    unsigned A, RWX, L;
+    if (CSR_pmpcfg0 & 0x1) {
+        pmptot = 4;
+        pmpidx += 4;
+    }
+    for (unsigned i = 0; i < pmptot; i++) {
+        pmpcfg = static_cast<unsigned>((*val >> (8 * i)) & 0xFF);
+        RWX = pmpcfg & 0x7;
+        A = (pmpcfg >> 3) & 0x3;
+        L = (pmpcfg >> 7) & 0x1;
+        uint64_t startaddr = 0;
+        uint64_t endaddr = (mask54 << 2) | 0x3;
+        if (A == 0x0) {
+            disablePmp(pmpidx + i);
+        } else if (A == 1) {
+            // TOR: Top of region
+            endaddr = (csr_[CSR_pmpaddr0 + pmpidx + i] & mask54) - 1;
+            if (pmpidx) {
+                startaddr = csr_[CSR_pmpaddr0 + pmpidx + i - 1] & mask54;
+            }
+            enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
+        } else if (A == 2) {
+            startaddr = (csr_[CSR_pmpaddr0 + pmpidx + i] & mask54) << 2;
+            endaddr = startaddr + 3;
+            enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
+        } else if (A == 3) {
+            startaddr = csr_[CSR_pmpaddr0 + pmpidx + i] & mask54;
+            if (startaddr == mask54) {
+                // Full memory region
+                startaddr = 0;
+                endaddr = ~0ull;
+            } else {
+                uint64_t bitidx = 0x1ull;
+                while ((startaddr & bitidx) && bitidx) {
+                    startaddr &= ~bitidx;
+                    bitidx <<= 1;
                 }
-                enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
+                startaddr <<= 2;
+                endaddr = startaddr + 8 * bitidx - 1;
             }
+            enablePmp(pmpidx + i, startaddr, endaddr, RWX, L);
         }
-    } else if (regno == CSR_satp) {
-        csr_satp_type satp;
-        satp.u64 = val;
-        if (satp.bits.mode != SATP_MODE_OFF
-            && satp.bits.mode != SATP_MODE_SV39
-            && satp.bits.mode != SATP_MODE_SV48) {
-            RISCV_error(
-                "[satp] <= %016" RV_PRI64 "x. Paging mode %x not supported",
-                val, satp.bits.mode);
-        }
     }
+    // Translated code was checked with the previous 'x' permissions
+    flush(~0ull);
+    return true;
+}
+
+bool CpuRiver_Functional::writeCsrSatp(uint32_t regno, uint64_t *val) {
+    csr_satp_type satp;
+    satp.u64 = *val;
+    if (satp.bits.mode != SATP_MODE_OFF
+        && satp.bits.mode != SATP_MODE_SV39
+        && satp.bits.mode != SATP_MODE_SV48) {
+        RISCV_error(
+            "[satp] <= %016" RV_PRI64 "x. Paging mode %x not supported",
+            *val, satp.bits.mode);
+        return false;   // WARL: write has no effect
+    }
+    // Blocks were translated with the previous address space
+    invalidateTranslationAll();
+    return true;
+}
 
-    if (wr_access) {
-        RISCV_mutex_lock(&mutex_csr_);
-        portCSR_.write(regno, val);
-        RISCV_mutex_unlock(&mutex_csr_);
+bool CpuRiver_Functional::writeCsrMstatus(uint32_t regno, uint64_t *val) {
+    csr_mstatus_type mstatus;
+    mstatus.value = csr_[CSR_mstatus] ^ *val;
+    if (mstatus.bits.SUM || mstatus.bits.MXR) {
+        // Permissions are checked on TLB fill
+        flushTlb(~0ull, ~0ull);
     }
+    return true;
 }
 
 void CpuRiver_Functional::disablePmp(uint32_t pmpidx) {
@@ -589,20 +1077,6 @@ void CpuRiver_Functional::enablePmp(uint32_t pmpidx,
     }
 }
 
-// PMP is active for S,U modes or in M-mode when L-bit is set (or MSTATUS.MPRV=1):
-bool CpuRiver_Functional::isMpuEnabled() {
-    uint64_t prv = getPrvLevel();
-    if (prv != PRV_M) {
-        return true;
-    }
-    csr_mstatus_type mstatus;
-    mstatus.value = readCSR(CSR_mstatus);
-    if (mstatus.bits.MPRV && (mstatus.bits.MPP != PRV_M)) {
-        return true;
-    }
-    return false;
-}
-
 bool CpuRiver_Functional::checkMpu(uint64_t adr, uint32_t size, const char *rwx) {
     bool allow = false;
 
@@ -627,32 +1101,221 @@ bool CpuRiver_Functional::checkMpu(uint64_t adr, uint32_t size, const char *rwx)
     return allow;
 }
 
-bool CpuRiver_Functional::isMmuEnabled() {
+bool CpuRiver_Functional::translateMmu(uint64_t va, const char *rwx,
+                                       uint64_t *pa) {
     csr_satp_type satp;
-    uint64_t prv = getPrvLevel();
-    satp.u64 = readCSR(CSR_satp);
-    if (prv != PRV_M && satp.bits.mode) {
+    csr_mstatus_type mstatus;
+    uint64_t prv = cur_prv_level;
+    int type = TLB_Load;
+    satp.u64 = csr_[CSR_satp];
+    mstatus.value = csr_[CSR_mstatus];
+    if (rwx[0] == 'x') {
+        type = TLB_Instr;
+    } else {
+        if (rwx[0] == 'w') {
+            type = TLB_Store;
+        }
+        if (mstatus.bits.MPRV) {
+            prv = mstatus.bits.MPP;
+        }
+    }
+    if (prv == PRV_M || satp.bits.mode == SATP_MODE_OFF) {
+        *pa = va;
         return true;
     }
-    csr_mstatus_type mstatus;
-    mstatus.value = readCSR(CSR_mstatus);
-    if (mstatus.bits.MPRV && (mstatus.bits.MPP != PRV_M) && satp.bits.mode) {
+
+    uint64_t vpn = va >> PAGE_BITS;
+    TlbEntryType *e = &tlb_[type][vpn & (TLB_SIZE - 1)];
+    if (e->vpn == vpn && e->prv == prv
+        && (e->global || e->asid == satp.bits.asid)) {
+        tlbStat_[type].hits++;
+        *pa = e->pabase | (va & ((1ull << PAGE_BITS) - 1));
         return true;
     }
-    return false;
+    tlbStat_[type].misses++;
+
+    uint64_t pabase;
+    bool global;
+    if (!walkPageTable(va, type, prv, &pabase, &global)) {
+        static const int FAULT[TLB_Total] = {
+            EXCEPTION_InstrPageFault,
+            EXCEPTION_LoadPageFault,
+            EXCEPTION_StorePageFault
+        };
+        mmuFault_ = FAULT[type];
+        mmuFaultAddr_ = va;
+        pageFaults_++;
+        return false;
+    }
+    e->vpn = vpn;
+    e->pabase = pabase;
+    e->asid = static_cast<uint16_t>(satp.bits.asid);
+    e->prv = static_cast<uint8_t>(prv);
+    e->global = global;
+    *pa = pabase | (va & ((1ull << PAGE_BITS) - 1));
+    return true;
+}
+
+/**
+ * Sv39/Sv48 table walk. Accessed and Dirty bits are updated by hardware.
+ * @return false on page fault
+ */
+bool CpuRiver_Functional::walkPageTable(uint64_t va, int type, uint64_t prv,
+                                        uint64_t *pabase, bool *global) {
+    csr_satp_type satp;
+    csr_mstatus_type mstatus;
+    satp.u64 = csr_[CSR_satp];
+    mstatus.value = csr_[CSR_mstatus];
+    int levels = satp.bits.mode == SATP_MODE_SV48 ? 4 : 3;
+    int vabits = PAGE_BITS + 9 * levels;
+
+    // Upper bits must be equal to the most significant bit of VA
+    int64_t vahi = static_cast<int64_t>(va) >> (vabits - 1);
+    if (vahi != 0 && vahi != -1) {
+        return false;
+    }
+
+    uint64_t a = static_cast<uint64_t>(satp.bits.ppn) << PAGE_BITS;
+    uint64_t pteaddr = 0;
+    uint64_t pte = 0;
+    int i;
+    *global = false;
+    for (i = levels - 1; i >= 0; i--) {
+        pteaddr = a + 8 * ((va >> (PAGE_BITS + 9 * i)) & 0x1FF);
+        if (!readPhys64(pteaddr, &pte)) {
+            return false;
+        }
+        if (!(pte & PTE_V) || (!(pte & PTE_R) && (pte & PTE_W))) {
+            return false;
+        }
+        *global = *global || (pte & PTE_G) != 0;
+        if (pte & (PTE_R | PTE_X)) {
+            break;      // leaf
+        }
+        a = ((pte >> PTE_PPN_SHIFT) & PTE_PPN_MASK) << PAGE_BITS;
+    }
+    if (i < 0) {
+        return false;
+    }
+
+    if (prv == PRV_U) {
+        if (!(pte & PTE_U)) {
+            return false;
+        }
+    } else if (pte & PTE_U) {
+        if (type == TLB_Instr || !mstatus.bits.SUM) {
+            return false;
+        }
+    }
+    if (type == TLB_Instr && !(pte & PTE_X)) {
+        return false;
+    }
+    if (type == TLB_Load && !(pte & PTE_R)
+        && !(mstatus.bits.MXR && (pte & PTE_X))) {
+        return false;
+    }
+    if (type == TLB_Store && !(pte & PTE_W)) {
+        return false;
+    }
+
+    uint64_t ppn = (pte >> PTE_PPN_SHIFT) & PTE_PPN_MASK;
+    uint64_t spmask = (1ull << (9 * i)) - 1;
+    if (ppn & spmask) {
+        return false;   // misaligned superpage
+    }
+
+    uint64_t upd = pte | PTE_A;
+    if (type == TLB_Store) {
+        upd |= PTE_D;
+    }
+    if (upd != pte && !writePhys64(pteaddr, upd)) {
+        return false;
+    }
+    ppn |= (va >> PAGE_BITS) & spmask;
+    *pabase = ppn << PAGE_BITS;
+    return true;
 }
 
-uint64_t CpuRiver_Functional::translateMmu(uint64_t va) {
-    uint64_t pa = va;
-    if ((va >> 48) != 0xFFFF) {
-        // Non-virtual address
-        return pa;
+bool CpuRiver_Functional::readPhys64(uint64_t addr, uint64_t *val) {
+    Axi4TransactionType tr;
+    tr.action = MemAction_Read;
+    tr.source_idx = sysBusMasterID_.to_int();
+    tr.addr = addr;
+    tr.xsize = 8;
+    tr.wstrb = 0;
+    if (!dmiAccess(&tr) && isysbus_->b_transport(&tr) != TRANS_OK) {
+        return false;
     }
-    return pa;
+    *val = tr.rpayload.b64[0];
+    return true;
+}
+
+bool CpuRiver_Functional::writePhys64(uint64_t addr, uint64_t val) {
+    Axi4TransactionType tr;
+    tr.action = MemAction_Write;
+    tr.source_idx = sysBusMasterID_.to_int();
+    tr.addr = addr;
+    tr.xsize = 8;
+    tr.wstrb = 0xFF;
+    tr.wpayload.b64[0] = val;
+    if (!dmiAccess(&tr) && isysbus_->b_transport(&tr) != TRANS_OK) {
+        return false;
+    }
+    return true;
 }
 
 void CpuRiver_Functional::flushMmu() {
+    flushTlb(~0ull, ~0ull);
 }
 
-}  // namespace debugger
+/**
+ * Invalidate TLB entries of the specified virtual address and/or ASID
+ * (~0 means all) together with the translation blocks.
+ */
+void CpuRiver_Functional::flushTlb(uint64_t va, uint64_t asid) {
+    uint64_t vpn = va >> PAGE_BITS;
+    for (int n = 0; n < TLB_Total; n++) {
+        for (int i = 0; i < TLB_SIZE; i++) {
+            TlbEntryType *e = &tlb_[n][i];
+            if (va != ~0ull && e->vpn != vpn) {
+                continue;
+            }
+            if (asid != ~0ull && (e->global || e->asid != asid)) {
+                continue;
+            }
+            e->vpn = ~0ull;
+        }
+    }
+    if (va == ~0ull) {
+        invalidateTranslationAll();
+    } else if (tbcache_) {
+        invalidateTranslation(va & ~((1ull << PAGE_BITS) - 1),
+                              1ull << PAGE_BITS);
+    }
+}
 
+void CpuRiver_Functional::getTlbStat(AttributeType *res) {
+    static const char *TLB_NAMES[TLB_Total] = {"itlb", "dtlb_load", "dtlb_store"};
+    res->make_dict();
+    for (int n = 0; n < TLB_Total; n++) {
+        AttributeType &t = (*res)[TLB_NAMES[n]];
+        uint64_t total = tlbStat_[n].hits + tlbStat_[n].misses;
+        t.make_dict();
+        t["hits"].make_uint64(tlbStat_[n].hits);
+        t["misses"].make_uint64(tlbStat_[n].misses);
+        if (total) {
+            t["hitrate"].make_floating(static_cast<double>(tlbStat_[n].hits)
+                                       / static_cast<double>(total));
+        } else {
+            t["hitrate"].make_floating(0);
+        }
+    }
+    (*res)["pagefaults"].make_uint64(pageFaults_);
+}
+
+void CpuRiver_Functional::clearTlbStat() {
+    memset(tlbStat_, 0, sizeof(tlbStat_));
+    pageFaults_ = 0;
+}
+
+}  // namespace debugger
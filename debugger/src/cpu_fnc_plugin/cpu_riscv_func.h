@@ -25,6 +25,53 @@
 
 namespace debugger {
 
+class CpuTlbCmdType : public ICommand {
+ public:
+    explicit CpuTlbCmdType(IService *parent) : ICommand(parent, "tlb") {
+        briefDescr_.make_string("Get MMU translation buffers statistic.");
+        detailedDescr_.make_string(
+            "Description:\n"
+            "    This command returns hit/miss counters of the instruction,\n"
+            "    load and store TLBs and number of page faults. CPU name\n"
+            "    should be specified in multi-core system.\n"
+            "Usage:\n"
+            "    tlb [cpu_name] [clear]\n"
+            "Example:\n"
+            "    tlb\n"
+            "    tlb core0 clear");
+    }
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+};
+
+class CpuDecodeBenchCmdType : public ICommand {
+ public:
+    explicit CpuDecodeBenchCmdType(IService *parent)
+        : ICommand(parent, "decbench") {
+        briefDescr_.make_string("Measure instruction decoder speed.");
+        detailedDescr_.make_string(
+            "Description:\n"
+            "    Instruction words are read from the physical memory and\n"
+            "    decoded 'loops' times by the table decoder and by the\n"
+            "    linear search over all registered instructions. Number of\n"
+            "    the different results is returned as 'mismatch'.\n"
+            "Response:\n"
+            "    {'instr':n,'illegal':n,'mismatch':n,'table_ms':n,\n"
+            "     'linear_ms':n}\n"
+            "Usage:\n"
+            "    decbench [cpu_name] <addr> <bytes> [loops]\n"
+            "Example:\n"
+            "    decbench 0x10000000 0x4000\n"
+            "    decbench core0 0x10000000 0x4000 100");
+    }
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+};
+
 class CpuRiver_Functional : public CpuGeneric,
                             public ICpuRiscV {
  public:
@@ -38,26 +85,32 @@ class CpuRiver_Functional : public CpuGeneric,
     /** IResetListener interface */
     virtual void reset(IFace *isource);
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state) override;
+    virtual void restoreState(const AttributeType *state) override;
+
     /** ICpuFunctional interface */
     virtual void enterDebugMode(uint64_t v, uint32_t cause) override;
     virtual void raiseSoftwareIrq() {}
     virtual void setReg(int idx, uint64_t val) override {
-        if (idx) {
+        // Faulted load must keep 'rd' to be restarted
+        if (idx && !(exceptions_ & PAGE_FAULT_MASK)) {
             CpuGeneric::setReg(idx, val);
         }
     }
     virtual uint64_t getIrqAddress(int idx) { return readCSR(CSR_mtvec); }
-    virtual void generateException(int e, uint64_t arg) override {
-        writeCSR(CSR_mtval, arg);
-        CpuGeneric::generateException(e, arg);
-    }
+    virtual void generateException(int e, uint64_t arg) override;
     virtual void generateExceptionLoadInstruction(uint64_t addr) override {
         generateException(EXCEPTION_InstrFault, addr);
     }
-    virtual bool isMpuEnabled() override;
+    virtual void setPrvLevel(uint64_t lvl) override {
+        cur_prv_level = lvl;
+        updateCsrState();
+    }
+    virtual bool isMpuEnabled() override { return mpuActive_; }
     virtual bool checkMpu(uint64_t addr, uint32_t sz, const char *rwx) override;
-    virtual bool isMmuEnabled() override;
-    virtual uint64_t translateMmu(uint64_t addr) override;
+    virtual bool isMmuEnabled() override { return mmuActive_; }
+    virtual bool translateMmu(uint64_t va, const char *rwx, uint64_t *pa) override;
     virtual void flushMmu() override;
 
 
@@ -76,17 +129,25 @@ class CpuRiver_Functional : public CpuGeneric,
     virtual void writeNonStandardReg(uint32_t regno, uint64_t val) {}
     virtual void mmuAddrReserve(uint64_t addr) override {
         mmuReservatedAddr_ = addr;
-        mmuReservedAddrWatchdog_ = 64;
+        mmuReservedAddrWatchdog_ = step_cnt_ + 64;
     }
     virtual bool mmuAddrRelease(uint64_t addr) override {
         bool success = 0;
-        if (mmuReservedAddrWatchdog_ && mmuReservatedAddr_ == addr) {
+        if (step_cnt_ < mmuReservedAddrWatchdog_
+            && mmuReservatedAddr_ == addr) {
             success = true;
             mmuReservedAddrWatchdog_ = 0;
         }
         return success;
     }
 
+    /** Common methods */
+    void flushTlb(uint64_t va, uint64_t asid);
+    void getTlbStat(AttributeType *res);
+    void clearTlbStat();
+    void decodeBench(uint64_t addr, uint64_t bytes, unsigned loops,
+                     AttributeType *res);
+
  protected:
     /** CpuGeneric common methods */
     virtual EEndianessType endianess() { return LittleEndian; }
@@ -98,18 +159,30 @@ class CpuRiver_Functional : public CpuGeneric,
     virtual void trackContextStart();
     /** // Stop tracking and write trace file */
     virtual void traceOutput() override;
-    virtual bool isStepEnabled() override;
+    virtual bool isStepEnabled() override { return stepEnabled_; }
+    virtual bool isWakeupPending() override;
     virtual void checkStackProtection() override;
 
     void addIsaUserRV64I();
     void addIsaPrivilegedRV64I();
     void addIsaExtensionA();
     void addIsaExtensionC();
+    uint32_t expandCompressed(uint16_t c);
     void addIsaExtensionD();
     void addIsaExtensionF();
     void addIsaExtensionM();
     unsigned addSupportedInstruction(RiscvInstruction *instr);
+    void buildDecodeTables();
+    unsigned addDecodeList(uint32_t key, uint32_t keymask);
+    RiscvInstruction *decodeTable(uint32_t *payload);
+    RiscvInstruction *decodeLinear(uint32_t *payload);
     uint32_t hash32(uint32_t val) { return (val >> 2) & 0x1f; }
+    uint32_t decodeL1Index(uint32_t val) {
+        return ((val >> 2) & 0x1F) | ((val >> 7) & 0xE0);
+    }
+    uint32_t decodeRvcIndex(uint32_t val) {
+        return (val & 0x3) | ((val >> 3) & 0xC) | ((val >> 6) & 0x3F0);
+    }
     /** Compressed instruction */
     uint32_t hash16(uint16_t val) {
         uint32_t t1 = val & 0x3;
@@ -117,6 +190,26 @@ class CpuRiver_Functional : public CpuGeneric,
     }
 
  private:
+    typedef uint64_t (CpuRiver_Functional::*CsrReadType)(uint32_t regno);
+    typedef bool (CpuRiver_Functional::*CsrWriteType)(uint32_t regno,
+                                                      uint64_t *val);
+    struct CsrDescriptorType;
+    static const CsrDescriptorType *getCsrTable();
+    static void initCsrTable(CsrDescriptorType *tbl);
+    void updateCsrState();
+    uint64_t readCSRSeq(uint32_t regno);
+    uint64_t readCsrCounter(uint32_t regno);
+    uint64_t readCsrDpc(uint32_t regno);
+    uint64_t readCsrTrigger(uint32_t regno);
+    uint64_t readCsrTinfo(uint32_t regno);
+    uint64_t readCsrMip(uint32_t regno);
+    bool writeCsrTselect(uint32_t regno, uint64_t *val);
+    bool writeCsrTrigger(uint32_t regno, uint64_t *val);
+    bool writeCsrFlushi(uint32_t regno, uint64_t *val);
+    bool writeCsrPmpcfg(uint32_t regno, uint64_t *val);
+    bool writeCsrSatp(uint32_t regno, uint64_t *val);
+    bool writeCsrMstatus(uint32_t regno, uint64_t *val);
+
     void switchContext(uint32_t prvnxt);
     void disablePmp(uint32_t pmpidx);
     void enablePmp(uint32_t pmpidx,
@@ -124,6 +217,10 @@ class CpuRiver_Functional : public CpuGeneric,
                     uint64_t endadr,
                     uint32_t rwx,
                     uint32_t lock);
+    bool walkPageTable(uint64_t va, int type, uint64_t prv,
+                       uint64_t *pabase, bool *global);
+    bool readPhys64(uint64_t addr, uint64_t *val);
+    bool writePhys64(uint64_t addr, uint64_t val);
 
  private:
     AttributeType vendorid_;
@@ -134,15 +231,90 @@ class CpuRiver_Functional : public CpuGeneric,
     AttributeType clint_;       // Core-local interruptor
     AttributeType plic_;        // External interrupt controller
     AttributeType pmpTotal_;    // Total number of enabled PMP regions < 64
+    AttributeType expandRVC_;   // Execute compressed instructions as 32-bit
 
     static const int INSTR_HASH_TABLE_SIZE = 1 << 6;
     AttributeType listInstr_[INSTR_HASH_TABLE_SIZE];
 
+    // Decoder tables built from the fixed bits of the registered
+    // instructions. Leaf value is the offset of the null-terminated list
+    // of candidates in decodePool_, usually with one entry.
+    static const int DECODE_L1_SIZE = 1 << 8;       // opcode[6:2], funct3
+    static const int DECODE_L2_SIZE = 1 << 12;      // funct7/funct5, rs2
+    static const int DECODE_RVC_SIZE = 1 << 10;
+    static const uint32_t DECODE_L1_MASK = 0x0000707F;
+    static const uint32_t DECODE_L2_MASK = 0xFFF0707F;
+    static const uint32_t DECODE_RVC_MASK = 0x0000FC63;
+    static const uint32_t DECODE_L2_FLAG = 0x80000000;
+    uint32_t decodeL1_[DECODE_L1_SIZE];     // leaf or L2 offset with flag
+    uint32_t decodeRvc_[DECODE_RVC_SIZE];   // funct3, [12:10], [6:5], op
+    uint32_t *decodeL2_;
+    unsigned decodeL2Cnt_;
+    RiscvInstruction **decodePool_;
+    unsigned decodePoolCnt_;
+    unsigned decodePoolSize_;
+    unsigned decodeLast_;                   // last added list
+    CpuDecodeBenchCmdType *pcmd_decbench_;
+
     IIrqController *iirqloc_;
     IIrqController *iirqext_;
 
     uint64_t mmuReservatedAddr_;
-    int mmuReservedAddrWatchdog_;   // not exceed 64 instructions between LR/SC
+    uint64_t mmuReservedAddrWatchdog_;  // step limit: 64 instructions between LR/SC
+
+    // CSR descriptors shared by all harts
+    static const int CSR_TOTAL = 1 << 12;
+    enum ECsrFlags {
+        CSR_FLAG_RO = 0x1,      // write has no effect
+        CSR_FLAG_STATE = 0x2,   // updateCsrState() after write
+        CSR_FLAG_IRQ = 0x4,     // write could unmask pending interrupt
+    };
+    struct CsrDescriptorType {
+        CsrReadType rd;         // 0 = read plain storage
+        CsrWriteType wr;        // 0 = write plain storage
+        uint32_t flags;
+    };
+    const CsrDescriptorType *csrTable_;
+
+    uint64_t *csr_;             // storage of the CSR bank
+    volatile uint32_t csrSeq_;  // odd while CSR is being modified,
+                                // writers are serialized by mutex_csr_
+
+    // State derived from CSRs and privilege level
+    bool mmuActive_;
+    bool mpuActive_;
+    bool stepEnabled_;
+    bool stackCheck_;
+
+    // Software TLB: direct mapped, 4 KB entries (superpages are split),
+    // tagged with ASID and effective privilege level.
+    enum ETlbType {
+        TLB_Instr,
+        TLB_Load,
+        TLB_Store,
+        TLB_Total
+    };
+    static const uint64_t PAGE_FAULT_MASK =
+        (1ull << EXCEPTION_InstrPageFault)
+        | (1ull << EXCEPTION_LoadPageFault)
+        | (1ull << EXCEPTION_StorePageFault);
+    static const int TLB_SIZE = 256;
+    static const int PAGE_BITS = 12;
+    struct TlbEntryType {
+        uint64_t vpn;       // virtual page number, ~0 = invalid
+        uint64_t pabase;    // physical page address
+        uint16_t asid;
+        uint8_t prv;
+        bool global;
+    } tlb_[TLB_Total][TLB_SIZE];
+    struct TlbStatType {
+        uint64_t hits;
+        uint64_t misses;
+    } tlbStat_[TLB_Total];
+    uint64_t pageFaults_;
+    int mmuFault_;              // page fault exception of the last access
+    uint64_t mmuFaultAddr_;
+    CpuTlbCmdType *pcmd_tlb_;
 
     static const int PMP_ENTRIES_MAX = 64;  // limited by RISC-V specification
     struct PmpEntryType {
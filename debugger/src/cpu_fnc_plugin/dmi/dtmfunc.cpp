@@ -161,5 +161,37 @@ bool DtmFunctional::getTDO() {
     return dr_ & 0x1 ? true : false;
 }
 
+bool DtmFunctional::isShiftState() {
+    return estate_ == SHIFT_DR || estate_ == SHIFT_IR;
+}
+
+/**
+ * @brief Whole register shift equal to nbits of setPins() cycles.
+ * @details Complete scan (nbits equals to register length) is the
+ *          common case: TDO returns the captured value and the register
+ *          takes TDI value.
+ */
+uint64_t DtmFunctional::shiftScan(uint64_t tdi, int nbits, char tms_last) {
+    int len = estate_ == SHIFT_IR ? irlen_.to_int() : dr_length_;
+    uint64_t tdo = 0;
+    if (nbits <= len && len < 64) {
+        uint64_t mask = (1ull << nbits) - 1;
+        tdo = dr_ & mask;
+        dr_ = (dr_ >> nbits) | ((tdi & mask) << (len - nbits));
+    } else {
+        for (int i = 0; i < nbits; i++) {
+            tdo |= (dr_ & 0x1) << i;
+            dr_ >>= 1;
+            dr_ |= ((tdi >> i) & 0x1) << (len - 1);
+        }
+    }
+    estate_ = next[estate_][static_cast<int>(tms_last)];
+
+    tck_ = 1;
+    tms_ = tms_last;
+    tdi_ = static_cast<char>((tdi >> (nbits - 1)) & 0x1);
+    return tdo;
+}
+
 }  // namespace debugger
 
@@ -39,6 +39,8 @@ class DtmFunctional : public IService,
     virtual void resetTAP(char trst, char srst);
     virtual void setPins(char tck, char tms, char tdi);
     virtual bool getTDO();
+    virtual bool isShiftState();
+    virtual uint64_t shiftScan(uint64_t tdi, int nbits, char tms_last);
 
  private:
     AttributeType version_;
@@ -222,21 +222,24 @@ void ICacheFunctional::getCachedValue(uint64_t addr,
 }
 
 void ICacheFunctional::readLine(uint64_t adr, WayMemType *way) {
-    Axi4TransactionType tr;
+    BulkTransactionType tr;
+    BulkBufferType buf;
+    uint64_t line[ICACHE_LINE_BYTES / sizeof(uint64_t)];
     uint32_t index = getAdrIndex(adr);
     uint64_t tag = getAdrTag(adr);
-    int burst_steps = ICACHE_LINE_BYTES / PAYLOAD_MAX_BYTES;
+    int burst_steps = ICACHE_LINE_BYTES / sizeof(uint64_t);
     int wstrb = 0x1;
+    buf.ptr = reinterpret_cast<uint8_t *>(line);
+    buf.size = ICACHE_LINE_BYTES;
     tr.action = MemAction_Read;
-    tr.xsize = PAYLOAD_MAX_BYTES;
     tr.addr = adr & ~(ICACHE_LINE_BYTES - 1);
-    tr.wstrb = 0;
+    tr.bufcnt = 1;
+    tr.buf = &buf;
+    tr.source_idx = 0;
+    isysbus_->bulk_transport(&tr);      // whole line in one request
     for (int burst = 0; burst < burst_steps; burst ++) {
-        isysbus_->b_transport(&tr);
-        way->writeLine(index, tag, wstrb, tr.rpayload.b64[0]);
-
+        way->writeLine(index, tag, wstrb, line[burst]);
         wstrb <<= 1;
-        tr.addr += PAYLOAD_MAX_BYTES;
     }
 }
 
@@ -45,6 +45,21 @@ public:
         return 0x20 | ((static_cast<uint16_t>(opcode_) >> 13) << 2) | t1;
     }
 
+    /**
+     * Decoded payload keeps the fetched bytes in buf32[0] for the tracer,
+     * disassembler and mtval. buf32[1] is the opcode to execute: the
+     * 32-bit instruction itself or 32-bit equivalent of the expanded
+     * compressed instruction, so that the length comes from the fetched
+     * bytes.
+     */
+    static int oplen(Reg64Type *payload) {
+        return (payload->buf32[0] & 0x3) == 0x3 ? 4 : 2;
+    }
+
+    /** Fixed bits of the encoding used to build decoder tables */
+    uint32_t mask() { return mask_; }
+    uint32_t opcode() { return opcode_; }
+
 protected:
     AttributeType name_;
     CpuRiver_Functional *icpu_;
@@ -44,7 +44,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         trans.action = MemAction_Read;
         trans.addr = R[u.bits.rs1];
         trans.xsize = rvbytes_;
@@ -75,7 +75,7 @@ public:
                 icpu_->setReg(u.bits.rd, t);
             }
         }
-        return 4;
+        return oplen(payload);
     }
  protected:
     virtual uint64_t amo_op(uint64_t a, uint64_t b) = 0;
@@ -310,7 +310,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         trans.action = MemAction_Read;
         trans.addr = R[u.bits.rs1];
         trans.xsize = 4;
@@ -330,7 +330,7 @@ public:
                 icpu_->setReg(u.bits.rd, t);
             }
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -342,7 +342,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         trans.action = MemAction_Read;
         trans.addr = R[u.bits.rs1];
         trans.xsize = 8;
@@ -357,7 +357,7 @@ public:
                 icpu_->setReg(u.bits.rd, trans.rpayload.b32[0]);
             }
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -369,7 +369,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         bool error = 1;
         if (icpu_->mmuAddrRelease(R[u.bits.rs1])) {
             trans.action = MemAction_Write;
@@ -388,7 +388,7 @@ public:
             }
         }
         icpu_->setReg(u.bits.rd, error);    // success
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -400,7 +400,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         bool error = 1;
         if (icpu_->mmuAddrRelease(R[u.bits.rs1])) {
             trans.action = MemAction_Write;
@@ -419,7 +419,7 @@ public:
             }
         }
         icpu_->setReg(u.bits.rd, error);    // success
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1026,6 +1026,203 @@ public:
 };
 
 
+/**
+ * Encoders of the 32-bit instructions used by the compressed instructions
+ * expansion. Immediate values are already scaled and sign-extended.
+ */
+static const uint32_t OPC_LOAD = 0x03;
+static const uint32_t OPC_LOAD_FP = 0x07;
+static const uint32_t OPC_OP_IMM = 0x13;
+static const uint32_t OPC_OP_IMM_32 = 0x1B;
+static const uint32_t OPC_STORE = 0x23;
+static const uint32_t OPC_STORE_FP = 0x27;
+static const uint32_t OPC_OP = 0x33;
+static const uint32_t OPC_LUI = 0x37;
+static const uint32_t OPC_OP_32 = 0x3B;
+static const uint32_t OPC_BRANCH = 0x63;
+static const uint32_t OPC_JALR = 0x67;
+static const uint32_t OPC_JAL = 0x6F;
+static const uint32_t INSTR_EBREAK = 0x00100073;
+
+static int32_t sext(uint32_t val, int bits) {
+    return static_cast<int32_t>(val << (32 - bits)) >> (32 - bits);
+}
+
+static uint32_t opR(uint32_t opc, uint32_t rd, uint32_t funct3, uint32_t rs1,
+                    uint32_t rs2, uint32_t funct7) {
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12)
+         | (rd << 7) | opc;
+}
+
+static uint32_t opI(uint32_t opc, uint32_t rd, uint32_t funct3, uint32_t rs1,
+                    int32_t imm) {
+    return (static_cast<uint32_t>(imm) << 20) | (rs1 << 15) | (funct3 << 12)
+         | (rd << 7) | opc;
+}
+
+static uint32_t opS(uint32_t opc, uint32_t funct3, uint32_t rs1, uint32_t rs2,
+                    int32_t imm) {
+    uint32_t u = static_cast<uint32_t>(imm);
+    return (((u >> 5) & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15)
+         | (funct3 << 12) | ((u & 0x1F) << 7) | opc;
+}
+
+static uint32_t opB(uint32_t funct3, uint32_t rs1, uint32_t rs2, int32_t imm) {
+    uint32_t u = static_cast<uint32_t>(imm);
+    return (((u >> 12) & 0x1) << 31) | (((u >> 5) & 0x3F) << 25)
+         | (rs2 << 20) | (rs1 << 15) | (funct3 << 12)
+         | (((u >> 1) & 0xF) << 8) | (((u >> 11) & 0x1) << 7) | OPC_BRANCH;
+}
+
+static uint32_t opU(uint32_t opc, uint32_t rd, int32_t imm) {
+    return (static_cast<uint32_t>(imm) << 12) | (rd << 7) | opc;
+}
+
+static uint32_t opJ(uint32_t rd, int32_t imm) {
+    uint32_t u = static_cast<uint32_t>(imm);
+    return (((u >> 20) & 0x1) << 31) | (((u >> 1) & 0x3FF) << 21)
+         | (((u >> 11) & 0x1) << 20) | (((u >> 12) & 0xFF) << 12)
+         | (rd << 7) | OPC_JAL;
+}
+
+/**
+ * @brief Expand RV64C instruction into the 32-bit equivalent.
+ *
+ * Expansions are given by the 'C' extension specification. HINT encodings
+ * are expanded into instructions without effect.
+ *
+ * @return 0 for the reserved encodings
+ */
+uint32_t CpuRiver_Functional::expandCompressed(uint16_t c) {
+    uint32_t rd = (c >> 7) & 0x1F;          // rd/rs1
+    uint32_t rs2 = (c >> 2) & 0x1F;
+    uint32_t rs1p = 8 + ((c >> 7) & 0x7);   // rs1'/rd'
+    uint32_t rs2p = 8 + ((c >> 2) & 0x7);   // rs2'/rd'
+    uint32_t uimm6 = ((c >> 7) & 0x20) | ((c >> 2) & 0x1F);
+    int32_t imm6 = sext(uimm6, 6);
+    uint32_t uimm;
+    int32_t imm;
+
+    switch (((c & 0x3) << 3) | (c >> 13)) {
+    // Quadrant 0
+    case 0x00:  // C.ADDI4SPN
+        uimm = ((c >> 7) & 0x30) | ((c >> 1) & 0x3C0)
+             | ((c >> 4) & 0x4) | ((c >> 2) & 0x8);
+        return uimm ? opI(OPC_OP_IMM, rs2p, 0, 2, uimm) : 0;
+    case 0x01:  // C.FLD
+        uimm = ((c >> 7) & 0x38) | ((c << 1) & 0xC0);
+        return opI(OPC_LOAD_FP, rs2p, 3, rs1p, uimm);
+    case 0x02:  // C.LW
+        uimm = ((c >> 7) & 0x38) | ((c >> 4) & 0x4) | ((c << 1) & 0x40);
+        return opI(OPC_LOAD, rs2p, 2, rs1p, uimm);
+    case 0x03:  // C.LD
+        uimm = ((c >> 7) & 0x38) | ((c << 1) & 0xC0);
+        return opI(OPC_LOAD, rs2p, 3, rs1p, uimm);
+    case 0x05:  // C.FSD
+        uimm = ((c >> 7) & 0x38) | ((c << 1) & 0xC0);
+        return opS(OPC_STORE_FP, 3, rs1p, rs2p, uimm);
+    case 0x06:  // C.SW
+        uimm = ((c >> 7) & 0x38) | ((c >> 4) & 0x4) | ((c << 1) & 0x40);
+        return opS(OPC_STORE, 2, rs1p, rs2p, uimm);
+    case 0x07:  // C.SD
+        uimm = ((c >> 7) & 0x38) | ((c << 1) & 0xC0);
+        return opS(OPC_STORE, 3, rs1p, rs2p, uimm);
+
+    // Quadrant 1
+    case 0x08:  // C.NOP, C.ADDI
+        return opI(OPC_OP_IMM, rd, 0, rd, imm6);
+    case 0x09:  // C.ADDIW
+        return rd ? opI(OPC_OP_IMM_32, rd, 0, rd, imm6) : 0;
+    case 0x0A:  // C.LI
+        return opI(OPC_OP_IMM, rd, 0, 0, imm6);
+    case 0x0B:
+        if (rd == 2) {
+            // C.ADDI16SP
+            imm = sext(((c >> 3) & 0x200) | ((c >> 2) & 0x10)
+                     | ((c << 1) & 0x40) | ((c << 4) & 0x180)
+                     | ((c << 3) & 0x20), 10);
+            return imm ? opI(OPC_OP_IMM, 2, 0, 2, imm) : 0;
+        }
+        // C.LUI
+        return imm6 ? opU(OPC_LUI, rd, imm6) : 0;
+    case 0x0C:
+        switch ((c >> 10) & 0x3) {
+        case 0:     // C.SRLI
+            return opI(OPC_OP_IMM, rs1p, 5, rs1p, uimm6);
+        case 1:     // C.SRAI
+            return opI(OPC_OP_IMM, rs1p, 5, rs1p, 0x400 | uimm6);
+        case 2:     // C.ANDI
+            return opI(OPC_OP_IMM, rs1p, 7, rs1p, imm6);
+        default:;
+        }
+        switch (((c >> 10) & 0x4) | ((c >> 5) & 0x3)) {
+        case 0:     // C.SUB
+            return opR(OPC_OP, rs1p, 0, rs1p, rs2p, 0x20);
+        case 1:     // C.XOR
+            return opR(OPC_OP, rs1p, 4, rs1p, rs2p, 0);
+        case 2:     // C.OR
+            return opR(OPC_OP, rs1p, 6, rs1p, rs2p, 0);
+        case 3:     // C.AND
+            return opR(OPC_OP, rs1p, 7, rs1p, rs2p, 0);
+        case 4:     // C.SUBW
+            return opR(OPC_OP_32, rs1p, 0, rs1p, rs2p, 0x20);
+        case 5:     // C.ADDW
+            return opR(OPC_OP_32, rs1p, 0, rs1p, rs2p, 0);
+        default:
+            return 0;
+        }
+    case 0x0D:  // C.J
+        imm = sext(((c >> 1) & 0x800) | ((c >> 7) & 0x10) | ((c >> 1) & 0x300)
+                 | ((c << 2) & 0x400) | ((c >> 1) & 0x40) | ((c << 1) & 0x80)
+                 | ((c >> 2) & 0xE) | ((c << 3) & 0x20), 12);
+        return opJ(0, imm);
+    case 0x0E:  // C.BEQZ
+    case 0x0F:  // C.BNEZ
+        imm = sext(((c >> 4) & 0x100) | ((c >> 7) & 0x18) | ((c << 1) & 0xC0)
+                 | ((c >> 2) & 0x6) | ((c << 3) & 0x20), 9);
+        return opB((c >> 13) & 0x1, rs1p, 0, imm);
+
+    // Quadrant 2
+    case 0x10:  // C.SLLI
+        return opI(OPC_OP_IMM, rd, 1, rd, uimm6);
+    case 0x11:  // C.FLDSP
+        uimm = ((c >> 7) & 0x20) | ((c >> 2) & 0x18) | ((c << 4) & 0x1C0);
+        return opI(OPC_LOAD_FP, rd, 3, 2, uimm);
+    case 0x12:  // C.LWSP
+        uimm = ((c >> 7) & 0x20) | ((c >> 2) & 0x1C) | ((c << 4) & 0xC0);
+        return rd ? opI(OPC_LOAD, rd, 2, 2, uimm) : 0;
+    case 0x13:  // C.LDSP
+        uimm = ((c >> 7) & 0x20) | ((c >> 2) & 0x18) | ((c << 4) & 0x1C0);
+        return rd ? opI(OPC_LOAD, rd, 3, 2, uimm) : 0;
+    case 0x14:
+        if ((c & 0x1000) == 0) {
+            if (rs2 == 0) {
+                // C.JR
+                return rd ? opI(OPC_JALR, 0, 0, rd, 0) : 0;
+            }
+            // C.MV
+            return opR(OPC_OP, rd, 0, 0, rs2, 0);
+        }
+        if (rs2 == 0) {
+            // C.EBREAK, C.JALR
+            return rd ? opI(OPC_JALR, 1, 0, rd, 0) : INSTR_EBREAK;
+        }
+        // C.ADD
+        return opR(OPC_OP, rd, 0, rd, rs2, 0);
+    case 0x15:  // C.FSDSP
+        uimm = ((c >> 7) & 0x38) | ((c >> 1) & 0x1C0);
+        return opS(OPC_STORE_FP, 3, 2, rs2, uimm);
+    case 0x16:  // C.SWSP
+        uimm = ((c >> 7) & 0x3C) | ((c >> 1) & 0xC0);
+        return opS(OPC_STORE, 2, 2, rs2, uimm);
+    case 0x17:  // C.SDSP
+        uimm = ((c >> 7) & 0x38) | ((c >> 1) & 0x1C0);
+        return opS(OPC_STORE, 3, 2, rs2, uimm);
+    default:
+        return 0;
+    }
+}
+
 void CpuRiver_Functional::addIsaExtensionC() {
     addSupportedInstruction(new C_ADD(this));
     addSupportedInstruction(new C_ADDI(this));
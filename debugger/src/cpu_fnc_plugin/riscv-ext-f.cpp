@@ -919,7 +919,7 @@ class FADD_D : public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1, src2;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         src2.val = RF[u.bits.rs2];
         int except = 0;
@@ -927,7 +927,7 @@ class FADD_D : public FpuInstruction {
                        src1, src2, &dest, except);
         //dest.f64 = src1.f64 + src2.f64;
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -942,12 +942,12 @@ class FCVT_D_L: public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = R[u.bits.rs1];
         Int2Double(1, 0, src1, &dest);
         //dest.f64 = static_cast<double>(src1.ival);
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -962,12 +962,12 @@ class FCVT_D_LU: public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = R[u.bits.rs1];
         Int2Double(0, 0, src1, &dest);
         //dest.f64 = static_cast<double>(src1.val);
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -982,12 +982,12 @@ class FCVT_D_W: public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = R[u.bits.rs1];
         Int2Double(1, 1, src1, &dest);
         //dest.f64 = static_cast<double>(static_cast<int>(src1.buf32[0]));
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1002,12 +1002,12 @@ class FCVT_D_WU: public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = R[u.bits.rs1];
         Int2Double(0, 1, src1, &dest);
         //dest.f64 = static_cast<double>(src1.buf32[0]);
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1022,13 +1022,13 @@ class FCVT_L_D: public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         int ovr, und;
         Double2Int(1, 0, src1, &dest, ovr, und);
         //dest.ival = static_cast<int64_t>(src1.f64);
         icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1043,13 +1043,13 @@ class FCVT_LU_D : public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         int ovr, und;
         Double2Int(0, 0, src1, &dest, ovr, und);
         //dest.val = static_cast<uint64_t>(src1.f64);
         icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1064,13 +1064,13 @@ class FCVT_W_D : public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         int ovr, und;
         Double2Int(1, 1, src1, &dest, ovr, und);
         //dest.ival = static_cast<int32_t>(src1.f64);
         icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1085,13 +1085,13 @@ class FCVT_WU_D : public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         int ovr, und;
         Double2Int(0, 1, src1, &dest, ovr, und);
         //dest.val = static_cast<uint32_t>(src1.f64);
         icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1106,7 +1106,7 @@ class FDIV_D : public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, A, B;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         A.val = RF[u.bits.rs1];
         B.val = RF[u.bits.rs2];
 
@@ -1244,7 +1244,7 @@ class FDIV_D : public FpuInstruction {
             icpu_->writeCSR(ICpuRiscV::CSR_fcsr, fcsr.value);
         }
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1261,7 +1261,7 @@ class FEQ_D : public FpuInstruction {
         Reg64Type src1, src2, dest;
         //uint64_t eq = 0;
         int except = 0;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         src2.val = RF[u.bits.rs2];
         AddSubCompare(0, 0, 1, 1, 0, 0, src1, src2, &dest, except);
@@ -1276,7 +1276,7 @@ class FEQ_D : public FpuInstruction {
         //    eq = src1.val == src2.val ? 1ull: 0;
         //}
         icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1292,7 +1292,7 @@ public:
         Axi4TransactionType trans;
         Reg64Type dst;
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -1310,7 +1310,7 @@ public:
         }
         dst.val = trans.rpayload.b64[0];
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dst.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1327,7 +1327,7 @@ class FLE_D : public FpuInstruction {
         Reg64Type src1, src2, dest;
         //uint64_t le = 0;
         int except = 0;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         src2.val = RF[u.bits.rs2];
         AddSubCompare(0, 0, 1, 1, 0, 1, src1, src2, &dest, except);
@@ -1342,7 +1342,7 @@ class FLE_D : public FpuInstruction {
         //    le = src1.f64 <= src2.f64 ? 1ull: 0;
         //}
         icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1359,7 +1359,7 @@ class FLT_D : public FpuInstruction {
         Reg64Type src1, src2, dest;
         int except = 0;
         //uint64_t le = 0;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         src2.val = RF[u.bits.rs2];
         AddSubCompare(0, 0, 1, 0, 0, 1, src1, src2, &dest, except);
@@ -1374,7 +1374,7 @@ class FLT_D : public FpuInstruction {
         //    le = src1.f64 < src2.f64 ? 1ull: 0;
         //}
         icpu_->setReg(u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1390,13 +1390,13 @@ class FMAX_D : public FpuInstruction {
         ISA_R_type u;
         Reg64Type dest, src1, src2;
         int except = 0;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         src2.val = RF[u.bits.rs2];
         AddSubCompare(0, 0, 0, 0, 1, 0, src1, src2, &dest, except);
         //dest.f64 = src1.f64 > src2.f64 ? src1.f64: src2.f64;
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1412,13 +1412,13 @@ class FMIN_D : public FpuInstruction {
         ISA_R_type u;
         Reg64Type dest, src1, src2;
         int except = 0;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         src2.val = RF[u.bits.rs2];
         AddSubCompare(0, 0, 0, 0, 0, 1, src1, src2, &dest, except);
         //dest.f64 = src1.f64 < src2.f64 ? src1.f64: src2.f64;
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1433,10 +1433,10 @@ class FMOV_D_X : public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = R[u.bits.rs1];
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, src1.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1451,10 +1451,10 @@ class FMOV_X_D : public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type src1;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         icpu_->setReg(u.bits.rd, src1.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1469,7 +1469,7 @@ class FMUL_D : public FpuInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         Reg64Type dest, A, B;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         A.val = RF[u.bits.rs1];
         B.val = RF[u.bits.rs2];
 
@@ -1595,7 +1595,7 @@ class FMUL_D : public FpuInstruction {
         //except = nanA | nanB | overflow;
         //dest.f64 = src1.f64 * src2.f64;
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1610,7 +1610,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_S_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = (u.bits.imm11_5 << 5) | u.bits.imm4_0;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -1627,7 +1627,7 @@ public:
                 icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
             }
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1643,13 +1643,13 @@ class FSUB_D : public FpuInstruction {
         ISA_R_type u;
         Reg64Type dest, src1, src2;
         int except = 0;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         src1.val = RF[u.bits.rs1];
         src2.val = RF[u.bits.rs2];
         AddSubCompare(0, 1, 0, 0, 0, 0, src1, src2, &dest, except);
         //dest.f64 = src1.f64 - src2.f64;
         icpu_->setReg(ICpuRiscV::RegFpu_Offset + u.bits.rd, dest.val);
-        return 4;
+        return oplen(payload);
     }
 };
 
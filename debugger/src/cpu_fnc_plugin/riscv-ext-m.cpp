@@ -33,7 +33,7 @@ class DIV : public RiscvInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         int64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         int64_t rs1 = static_cast<int64_t>(R[u.bits.rs1]);
         int64_t rs2 = static_cast<int64_t>(R[u.bits.rs2]);
         if (rs2) {
@@ -48,7 +48,7 @@ class DIV : public RiscvInstruction {
             res = -1;
         }
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -63,7 +63,7 @@ class DIVU : public RiscvInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         if (R[u.bits.rs2]) {
             res = R[u.bits.rs1] / R[u.bits.rs2];
         } else {
@@ -71,7 +71,7 @@ class DIVU : public RiscvInstruction {
             res = ~0ull;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -85,7 +85,7 @@ class DIVUW : public RiscvInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint32_t a1 = static_cast<uint32_t>(R[u.bits.rs1]);
         uint32_t a2 = static_cast<uint32_t>(R[u.bits.rs2]);
         int32_t res;
@@ -97,7 +97,7 @@ class DIVUW : public RiscvInstruction {
             res = -1;
         }
         icpu_->setReg(u.bits.rd, static_cast<int64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -111,7 +111,7 @@ class DIVW : public RiscvInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         int32_t divident = static_cast<int32_t>(R[u.bits.rs1]);
         int32_t divisor = static_cast<int32_t>(R[u.bits.rs2]);
         int64_t rs1 = static_cast<int64_t>(divident);
@@ -131,7 +131,7 @@ class DIVW : public RiscvInstruction {
         res <<= 32;
         res >>= 32;
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -149,11 +149,11 @@ class MUL : public RiscvInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         int64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         res = static_cast<int64_t>(R[u.bits.rs1])
                 * static_cast<int64_t>(R[u.bits.rs2]);
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -172,7 +172,7 @@ class MULH : public RiscvInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         int64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t a1 = R[u.bits.rs1];
         uint64_t a2 = R[u.bits.rs2];
         uint64_t a1s = a1;
@@ -286,7 +286,7 @@ class MULH : public RiscvInstruction {
             res = lvl5.val[1];
         }
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -298,7 +298,7 @@ class MULHSU : public RiscvInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         int64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t a1 = R[u.bits.rs1];
         uint64_t a2 = R[u.bits.rs2];
         uint64_t a1s = a1;
@@ -404,7 +404,7 @@ class MULHSU : public RiscvInstruction {
             res = lvl5.val[1];
         }
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -416,7 +416,7 @@ class MULHU : public RiscvInstruction {
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         int64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t a1 = R[u.bits.rs1];
         uint64_t a2 = R[u.bits.rs2];
 
@@ -508,7 +508,7 @@ class MULHU : public RiscvInstruction {
 
         res = lvl5.val[1];
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -528,7 +528,7 @@ class MULW : public RiscvInstruction {
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         int32_t m1 = static_cast<int32_t>(R[u.bits.rs1]);
         int32_t m2 = static_cast<int32_t>(R[u.bits.rs2]);
         int32_t resw;
@@ -537,7 +537,7 @@ class MULW : public RiscvInstruction {
         resw = m1 * m2;
         res = static_cast<int64_t>(resw);
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -552,7 +552,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         int64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         int64_t rs1 = static_cast<int64_t>(R[u.bits.rs1]);
         int64_t rs2 = static_cast<int64_t>(R[u.bits.rs2]);
         if (R[u.bits.rs2]) {
@@ -567,7 +567,7 @@ public:
             res = static_cast<int64_t>(R[u.bits.rs1]);
         }
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -582,14 +582,14 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         if (R[u.bits.rs2]) {
             res = R[u.bits.rs1] % R[u.bits.rs2];
         } else {
             res = R[u.bits.rs1];
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -609,7 +609,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         int64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         int32_t a1 = static_cast<int32_t>(R[u.bits.rs1]);
         int32_t a2 = static_cast<int32_t>(R[u.bits.rs2]);
         int64_t rs1 = static_cast<int64_t>(a1);
@@ -625,7 +625,7 @@ public:
             res = a1;
         }
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -636,12 +636,12 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint32_t a1 = static_cast<uint32_t>(R[u.bits.rs1]);
         uint32_t a2 = static_cast<uint32_t>(R[u.bits.rs2]);
         int32_t resw;
         int64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         if (a2) {
             resw = static_cast<int32_t>(a1 % a2);
         } else {
@@ -649,7 +649,7 @@ public:
         }
         res = static_cast<int64_t>(resw);
         icpu_->setReg(u.bits.rd, static_cast<uint64_t>(res));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -38,7 +38,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
 
         uint64_t clr_mask = ~R[u.bits.rs1];
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -46,7 +46,7 @@ public:
             icpu_->setReg(u.bits.rd, csr);
         }
         icpu_->writeCSR(u.bits.imm, (csr & clr_mask));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -64,7 +64,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
 
         uint64_t clr_mask = ~static_cast<uint64_t>((u.bits.rs1));
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -72,7 +72,7 @@ public:
             icpu_->setReg(u.bits.rd, csr);
         }
         icpu_->writeCSR(u.bits.imm, (csr & clr_mask));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -94,7 +94,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
 
         uint64_t set_mask = R[u.bits.rs1];
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -102,7 +102,7 @@ public:
             icpu_->setReg(u.bits.rd, csr);
         }
         icpu_->writeCSR(u.bits.imm, (csr | set_mask));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -120,7 +120,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
 
         uint64_t set_mask = u.bits.rs1;
         uint64_t csr = icpu_->readCSR(u.bits.imm);
@@ -128,7 +128,7 @@ public:
             icpu_->setReg(u.bits.rd, csr);
         }
         icpu_->writeCSR(u.bits.imm, (csr | set_mask));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -148,14 +148,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
 
         uint64_t wr_value = R[u.bits.rs1];
         if (u.bits.rd) {
             icpu_->setReg(u.bits.rd, icpu_->readCSR(u.bits.imm));
         }
         icpu_->writeCSR(u.bits.imm, wr_value);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -173,14 +173,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
 
         uint64_t wr_value = u.bits.rs1;
         if (u.bits.rd) {
             icpu_->setReg(u.bits.rd, icpu_->readCSR(u.bits.imm));
         }
         icpu_->writeCSR(u.bits.imm, wr_value);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -206,7 +206,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         if (icpu_->getPrvLevel() != ICpuRiscV::PRV_U) {
             icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
-            return 4;
+            return oplen(payload);
         }
         csr_mstatus_type mstatus;
         mstatus.value = icpu_->readCSR(ICpuRiscV::CSR_mstatus);
@@ -216,7 +216,7 @@ public:
 
         icpu_->setPrvLevel(ICpuRiscV::PRV_U);
         icpu_->writeCSR(ICpuRiscV::CSR_mstatus, mstatus.value);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -231,7 +231,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         if (icpu_->getPrvLevel() != ICpuRiscV::PRV_S) {
             icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
-            return 4;
+            return oplen(payload);
         }
         csr_mstatus_type mstatus;
         mstatus.value = icpu_->readCSR(ICpuRiscV::CSR_mstatus);
@@ -245,7 +245,7 @@ public:
         mstatus.bits.SPP = ICpuRiscV::PRV_U;
             
         icpu_->writeCSR(ICpuRiscV::CSR_mstatus, mstatus.value);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -259,7 +259,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -274,7 +274,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         if (icpu_->getPrvLevel() != ICpuRiscV::PRV_M) {
             icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
-            return 4;
+            return oplen(payload);
         }
         csr_mstatus_type mstatus;
         mstatus.value = icpu_->readCSR(ICpuRiscV::CSR_mstatus);
@@ -288,7 +288,7 @@ public:
         mstatus.bits.MPP = ICpuRiscV::PRV_U;    // least-privileged supported mode
 
         icpu_->writeCSR(ICpuRiscV::CSR_mstatus, mstatus.value);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -304,14 +304,15 @@ public:
         RiscvInstruction(icpu, "FENCE", "?????????????????000?????0001111") {}
 
     virtual int exec(Reg64Type *payload) {
-        return 4;
+        return oplen(payload);
     }
 };
 
 /** 
  * @brief FENCE_I (memory barrier)
  *
- * Not used in functional model so that cache is not modeling.
+ * Cache isn't modeled in functional model but decoded instructions and
+ * translation blocks have to be dropped.
  */
 class FENCE_I : public RiscvInstruction {
 public:
@@ -319,7 +320,8 @@ public:
         RiscvInstruction(icpu, "FENCE_I", "?????????????????001?????0001111") {}
 
     virtual int exec(Reg64Type *payload) {
-        return 4;
+        icpu_->flush(~0ull);
+        return oplen(payload);
     }
 };
 
@@ -333,8 +335,33 @@ public:
         RiscvInstruction(icpu, "SFENCE_VMA", "0001001??????????000000001110011") {}
 
     virtual int exec(Reg64Type *payload) {
-        icpu_->flushMmu();
-        return 4;
+        ISA_R_type u;
+        u.value = payload->buf32[1];
+        if (u.bits.rs1 == 0 && u.bits.rs2 == 0) {
+            icpu_->flushMmu();
+        } else {
+            // rs1 selects virtual address, rs2 selects address space
+            icpu_->flushTlb(u.bits.rs1 ? R[u.bits.rs1] : ~0ull,
+                            u.bits.rs2 ? R[u.bits.rs2] & 0xFFFF : ~0ull);
+        }
+        return oplen(payload);
+    }
+};
+
+/**
+ * @brief WFI (wait for interrupt)
+ *
+ * Hart enters sleep state and skips simulation steps till the next
+ * clock event or an enabled interrupt becomes pending.
+ */
+class WFI : public RiscvInstruction {
+public:
+    WFI(CpuRiver_Functional *icpu) :
+        RiscvInstruction(icpu, "WFI", "00010000010100000000000001110011") {}
+
+    virtual int exec(Reg64Type *payload) {
+        icpu_->waitForInterrupt();
+        return oplen(payload);
     }
 };
 
@@ -352,7 +379,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         icpu_->generateException(ICpuRiscV::EXCEPTION_Breakpoint, icpu_->getPC());
         icpu_->doNotCache(icpu_->getPC());
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -374,12 +401,15 @@ public:
         case ICpuRiscV::PRV_M:
             icpu_->generateException(ICpuRiscV::EXCEPTION_CallFromMmode, icpu_->getPC());
             break;
+        case ICpuRiscV::PRV_S:
+            icpu_->generateException(ICpuRiscV::EXCEPTION_CallFromSmode, icpu_->getPC());
+            break;
         case ICpuRiscV::PRV_U:
             icpu_->generateException(ICpuRiscV::EXCEPTION_CallFromUmode, icpu_->getPC());
             break;
         default:;
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -398,13 +428,13 @@ void CpuRiver_Functional::addIsaPrivilegedRV64I() {
     addSupportedInstruction(new FENCE(this));
     addSupportedInstruction(new FENCE_I(this));
     addSupportedInstruction(new SFENCE_VMA(this));
+    addSupportedInstruction(new WFI(this));
     addSupportedInstruction(new ECALL(this));
     addSupportedInstruction(new EBREAK(this));
 
     // TODO:
     /*
   def DRET               = BitPat("b01111011001000000000000001110011")
-  def WFI                = BitPat("b00010000010100000000000001110011")  // wait for interrupt
 
     def RDCYCLE            = BitPat("b11000000000000000010?????1110011")
     def RDTIME             = BitPat("b11000000000100000010?????1110011")
@@ -32,9 +32,9 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] + R[u.bits.rs2]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -53,14 +53,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         uint64_t imm = u.bits.imm;
         if (imm & 0x800) {
             imm |= EXT_SIGN_12;
         }
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] + imm);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -81,7 +81,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         uint64_t imm = u.bits.imm;
         if (imm & 0x800) {
@@ -92,7 +92,7 @@ public:
             res |= EXT_SIGN_32;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -111,14 +111,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         uint64_t res = (R[u.bits.rs1] + R[u.bits.rs2]) & 0xFFFFFFFFLL;
         if (res & (1LL << 31)) {
             res |= EXT_SIGN_32;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -132,9 +132,9 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] & R[u.bits.rs2]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -152,14 +152,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t imm = u.bits.imm;
         if (imm & 0x800) {
             imm |= EXT_SIGN_12;
         }
 
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] & imm);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -178,14 +178,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_U_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
 
         uint64_t off = u.bits.imm31_12 << 12;
         if (off & (1LL << 31)) {
             off |= EXT_SIGN_32;
         }
         icpu_->setReg(u.bits.rd, icpu_->getPC() + off);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -199,7 +199,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_SB_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         if (R[u.bits.rs1] == R[u.bits.rs2]) {
             uint64_t imm = (u.bits.imm12 << 12) | (u.bits.imm11 << 11)
@@ -209,7 +209,7 @@ public:
             }
             icpu_->setBranch(icpu_->getPC() + imm);
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -228,7 +228,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_SB_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         if (static_cast<int64_t>(R[u.bits.rs1]) >= 
             static_cast<int64_t>(R[u.bits.rs2])) {
@@ -239,7 +239,7 @@ public:
             }
             icpu_->setBranch(icpu_->getPC() + imm);
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -254,7 +254,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_SB_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         if (R[u.bits.rs1] >= R[u.bits.rs2]) {
             uint64_t imm = (u.bits.imm12 << 12) | (u.bits.imm11 << 11)
@@ -264,7 +264,7 @@ public:
             }
             icpu_->setBranch(icpu_->getPC() + imm);
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -278,7 +278,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_SB_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         if (static_cast<int64_t>(R[u.bits.rs1]) < 
             static_cast<int64_t>(R[u.bits.rs2])) {
@@ -289,7 +289,7 @@ public:
             }
             icpu_->setBranch(icpu_->getPC() + imm);
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -303,7 +303,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_SB_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         if (R[u.bits.rs1] < R[u.bits.rs2]) {
             uint64_t imm = (u.bits.imm12 << 12) | (u.bits.imm11 << 11)
@@ -313,7 +313,7 @@ public:
             }
             icpu_->setBranch(icpu_->getPC() + imm);
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -327,7 +327,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_SB_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         if (R[u.bits.rs1] != R[u.bits.rs2]) {
             uint64_t imm = (u.bits.imm12 << 12) | (u.bits.imm11 << 11)
@@ -337,7 +337,7 @@ public:
             }
             icpu_->setBranch(icpu_->getPC() + imm);
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -359,7 +359,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_UJ_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = 0;
         if (u.bits.imm20) {
             off = 0xfffffffffff00000LL;
@@ -368,13 +368,13 @@ public:
         off |= (u.bits.imm11 << 11);
         off |= (u.bits.imm10_1 << 1);
         if (u.bits.rd != 0) {
-            icpu_->setReg(u.bits.rd, icpu_->getPC() + 4);
+            icpu_->setReg(u.bits.rd, icpu_->getPC() + oplen(payload));
         }
         icpu_->setBranch(icpu_->getPC() + off);
         if (u.bits.rd == ICpuRiscV::Reg_ra) {
             icpu_->pushStackTrace();
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -394,7 +394,7 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (u.bits.imm & 0x800) {
             off |= 0xfffffffffffff000LL;
@@ -402,7 +402,7 @@ public:
         off += R[u.bits.rs1];
         off &= ~0x1LL;
         if (u.bits.rd != 0) {
-            icpu_->setReg(u.bits.rd, icpu_->getPC() + 4);
+            icpu_->setReg(u.bits.rd, icpu_->getPC() + oplen(payload));
         }
         icpu_->setBranch(off);
 
@@ -412,7 +412,7 @@ public:
         } else if (u.bits.imm == 0 && u.bits.rs1 == ICpuRiscV::Reg_ra) {
             icpu_->popStackTrace();
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -434,7 +434,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -451,7 +451,7 @@ public:
             }
         }
         icpu_->setReg(u.bits.rd, trans.rpayload.b64[0]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -467,7 +467,7 @@ public:
         Axi4TransactionType trans;
         trans.rpayload.b64[0] = 0;
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -488,7 +488,7 @@ public:
             res |= EXT_SIGN_32;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -504,7 +504,7 @@ public:
         Axi4TransactionType trans;
         trans.rpayload.b64[0] = 0;
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -521,7 +521,7 @@ public:
             }
         }
         icpu_->setReg(u.bits.rd, trans.rpayload.b64[0]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -537,7 +537,7 @@ public:
         Axi4TransactionType trans;
         trans.rpayload.b64[0] = 0;
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -558,7 +558,7 @@ public:
             res |= EXT_SIGN_16;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -574,7 +574,7 @@ public:
         Axi4TransactionType trans;
         trans.rpayload.b64[0] = 0;
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -591,7 +591,7 @@ public:
             }
         }
         icpu_->setReg(u.bits.rd, trans.rpayload.b16[0]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -607,7 +607,7 @@ public:
         Axi4TransactionType trans;
         trans.rpayload.b64[0] = 0;
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -623,7 +623,7 @@ public:
             res |= EXT_SIGN_8;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -639,7 +639,7 @@ public:
         Axi4TransactionType trans;
         trans.rpayload.b64[0] = 0;
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = u.bits.imm;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -651,7 +651,7 @@ public:
             icpu_->generateException(ICpuRiscV::EXCEPTION_LoadFault, trans.addr);
         }
         icpu_->setReg(u.bits.rd, trans.rpayload.b8[0]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -669,13 +669,13 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_U_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t tmp = u.bits.imm31_12 << 12;
         if (tmp & 0x80000000) {
             tmp |= EXT_SIGN_32;
         }
         icpu_->setReg(u.bits.rd, tmp);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -689,9 +689,9 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] | R[u.bits.rs2]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -705,14 +705,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         uint64_t imm = u.bits.imm;
         if (imm & 0x800) {
             imm |= EXT_SIGN_12;
         }
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] | imm);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -726,10 +726,10 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint32_t shamt = u.bits.imm & 0x3f;
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] << shamt);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -746,7 +746,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         if (static_cast<int64_t>(R[u.bits.rs1]) <
                 static_cast<int64_t>(R[u.bits.rs2])) {
             res = 1;
@@ -754,7 +754,7 @@ public:
             res = 0;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -773,7 +773,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         uint64_t imm = u.bits.imm;
         if (imm & 0x800) {
@@ -786,7 +786,7 @@ public:
             res = 0;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -805,14 +805,14 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         if (R[u.bits.rs1] < R[u.bits.rs2]) {
             res = 1;
         } else {
             res = 0;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -832,7 +832,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         uint64_t imm = u.bits.imm;
         if (imm & 0x800) {
@@ -844,7 +844,7 @@ public:
             res = 0;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -858,9 +858,9 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] << (R[u.bits.rs2] & 0x3F));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -875,14 +875,14 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         res = R[u.bits.rs1] << (R[u.bits.rs2] & 0x1F);
         res &= 0xFFFFFFFFLL;
         if (res & (1LL << 31)) {
             res |= EXT_SIGN_32;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -901,7 +901,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint32_t shamt = u.bits.imm & 0x1f;
         res = R[u.bits.rs1] << shamt;
         res &= 0xFFFFFFFFLL;
@@ -912,7 +912,7 @@ public:
         if ((u.bits.imm >> 5) & 0x1) {
             icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -926,10 +926,10 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         icpu_->setReg(u.bits.rd,
                 static_cast<int64_t>(R[u.bits.rs1]) >> (R[u.bits.rs2] & 0x3F));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -943,11 +943,11 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         int32_t t1 = static_cast<int32_t>(R[u.bits.rs1]);
         icpu_->setReg(u.bits.rd,
                     static_cast<int64_t>(t1 >> (R[u.bits.rs2] & 0x1F)));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -964,10 +964,10 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint32_t shamt = u.bits.imm & 0x3f;
         icpu_->setReg(u.bits.rd, static_cast<int64_t>(R[u.bits.rs1]) >> shamt);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -981,14 +981,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         int32_t t1 = static_cast<int32_t>(R[u.bits.rs1]);
         uint32_t shamt = u.bits.imm & 0x1f;
         icpu_->setReg(u.bits.rd, static_cast<int64_t>(t1 >> shamt));
         if ((u.bits.imm >> 5) & 0x1) {
             icpu_->generateException(ICpuRiscV::EXCEPTION_InstrIllegal, icpu_->getPC());
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1003,9 +1003,9 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] >> (R[u.bits.rs2] & 0x3F));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1019,10 +1019,10 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint32_t shamt = u.bits.imm & 0x3f;
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] >> shamt);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1036,12 +1036,12 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint32_t shamt = u.bits.imm & 0x1f;
         uint32_t res = static_cast<uint32_t>(R[u.bits.rs1]);
         res >>= shamt;
         icpu_->setReg(u.bits.rd, static_cast<int64_t>(static_cast<int32_t>(res)));
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1056,14 +1056,14 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         res = static_cast<uint32_t>(R[u.bits.rs1]) >> (R[u.bits.rs2] & 0x1f);
         res &= 0xFFFFFFFFLL;
         if (res & (1LL << 31)) {
             res |= EXT_SIGN_32;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1084,7 +1084,7 @@ public:
     virtual int exec(Reg64Type *payload) {
         Axi4TransactionType trans;
         ISA_S_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = (u.bits.imm11_5 << 5) | u.bits.imm4_0;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -1101,7 +1101,7 @@ public:
                 icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
             }
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1117,7 +1117,7 @@ public:
         Axi4TransactionType trans;
         trans.wpayload.b64[0] = 0;
         ISA_S_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = (u.bits.imm11_5 << 5) | u.bits.imm4_0;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -1134,7 +1134,7 @@ public:
                 icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
             }
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1150,7 +1150,7 @@ public:
         Axi4TransactionType trans;
         trans.wpayload.b64[0] = 0;
         ISA_S_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = (u.bits.imm11_5 << 5) | u.bits.imm4_0;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -1167,7 +1167,7 @@ public:
                 icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
             }
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1183,7 +1183,7 @@ public:
         Axi4TransactionType trans;
         trans.wpayload.b64[0] = 0;
         ISA_S_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         uint64_t off = (u.bits.imm11_5 << 5) | u.bits.imm4_0;
         if (off & 0x800) {
             off |= EXT_SIGN_12;
@@ -1196,7 +1196,7 @@ public:
         if (icpu_->dma_memop(&trans) == TRANS_ERROR) {
             icpu_->generateException(ICpuRiscV::EXCEPTION_StoreFault, trans.addr);
         }
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1210,9 +1210,9 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] - R[u.bits.rs2]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1232,14 +1232,14 @@ public:
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
         uint64_t res;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         
         res = (R[u.bits.rs1] - R[u.bits.rs2]) & 0xFFFFFFFFLL;
         if (res & (1LL << 31)) {
             res |= EXT_SIGN_32;
         }
         icpu_->setReg(u.bits.rd, res);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1253,9 +1253,9 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_R_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] ^ R[u.bits.rs2]);
-        return 4;
+        return oplen(payload);
     }
 };
 
@@ -1272,14 +1272,14 @@ public:
 
     virtual int exec(Reg64Type *payload) {
         ISA_I_type u;
-        u.value = payload->buf32[0];
+        u.value = payload->buf32[1];
     
         uint64_t imm = u.bits.imm;
         if (imm & 0x800) {
             imm |= EXT_SIGN_12;
         }
         icpu_->setReg(u.bits.rd, R[u.bits.rs1] ^ imm);
-        return 4;
+        return oplen(payload);
     }
 };
 
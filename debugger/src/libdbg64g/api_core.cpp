@@ -18,17 +18,21 @@
 #include "coreservices/ithread.h"
 #include "coreservices/iclock.h"
 #include "generic/bus_generic.h"
+#include "services/debug/checkpoint.h"
 #include "services/debug/cpumonitor.h"
 #include "services/debug/codecov_generic.h"
 #include "services/debug/openocdwrap.h"
+#include "services/debug/profiler.h"
 #include "services/elfloader/elfreader.h"
 #include "services/exec/cmdexec.h"
 #include "services/mem/memlut.h"
 #include "services/mem/memsim.h"
 #include "services/mem/rmemsim.h"
 #include "services/remote/dpiclient.h"
+#include "services/remote/tcpsrv_gdb.h"
 #include "services/remote/tcpsrv_jtagbb.h"
 #include "services/remote/tcpsrv_rpc.h"
+#include "services/sched/hartsched.h"
 #include "services/comport/comport.h"
 #include "services/console/autocompleter.h"
 #include "services/console/console.h"
@@ -81,6 +85,10 @@ extern "C" int RISCV_init() {
     REGISTER_CLASS_IDX(TcpServerJtagBitBang, 13);
     REGISTER_CLASS_IDX(OpenOcdWrapper, 14);
     REGISTER_CLASS_IDX(DpiClient, 15);
+    REGISTER_CLASS_IDX(TcpServerGdb, 16);
+    REGISTER_CLASS_IDX(CheckpointService, 17);
+    REGISTER_CLASS_IDX(HartScheduler, 18);
+    REGISTER_CLASS_IDX(SamplingProfiler, 19);
 
     pcore_->load_plugins();
     return 0;
@@ -351,22 +359,22 @@ extern "C" int RISCV_printf(void *iface, int level,
     int ret = 0;
     va_list arg;
     IFace *iout = reinterpret_cast<IFace *>(iface);
-    uint64_t cur_t = pcore_->getTimestamp();
+    IService *iserv = 0;
+    if (iout && strcmp(iout->getFaceName(), IFACE_SERVICE) == 0) {
+        iserv = static_cast<IService *>(iout);
+        if (level > iserv->getLogLevel()) {
+            return 0;
+        }
+    }
 
+    uint64_t cur_t = pcore_->getTimestamp();
     char *buf = pcore_->getpBufLog();
     size_t buf_sz = pcore_->sizeBufLog();
     pcore_->lockPrintf();
     if (iout == NULL) {
         ret = RISCV_sprintf(buf, buf_sz,
                     "[%" RV_PRI64 "d, \"%s\", \"", cur_t, "unknown");
-    } else if (strcmp(iout->getFaceName(), IFACE_SERVICE) == 0) {
-        IService *iserv = static_cast<IService *>(iout);
-        AttributeType *local_level = 
-                static_cast<AttributeType *>(iserv->getAttribute("LogLevel"));
-        if (level > static_cast<int>(local_level->to_int64())) {
-            pcore_->unlockPrintf();
-            return 0;
-        }
+    } else if (iserv) {
         ret = RISCV_sprintf(buf, buf_sz,
                 "[%" RV_PRI64 "d, \"%s\", \"", cur_t, iserv->getObjName());
     } else if (strcmp(iout->getFaceName(), IFACE_CLASS) == 0) {
@@ -457,6 +465,15 @@ extern "C" void RISCV_memory_barrier() {
 #endif
 }
 
+extern "C" int RISCV_atomic_cas_ptr(void * volatile *dst,
+                                    void *cmp, void *val) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return InterlockedCompareExchangePointer(dst, val, cmp) == cmp ? 1 : 0;
+#else
+    return __sync_bool_compare_and_swap(dst, cmp, val) ? 1 : 0;
+#endif
+}
+
 extern "C" void RISCV_thread_create(void *data) {
     LibThreadType *p = (LibThreadType *)data;
 #if defined(_WIN32) || defined(__CYGWIN__)
@@ -908,8 +925,8 @@ int json_file_readall(const char *filename, char **pout) {
     fsz = ftell(f);
     fseek(f, 0, SEEK_SET);
 
-    (*pout) = new char[fsz];
-    memset((*pout), 0, fsz);
+    (*pout) = new char[fsz + 1];    // readline terminates the last line
+    memset((*pout), 0, fsz + 1);
 
     textcnt = 0;
     char *psub1;
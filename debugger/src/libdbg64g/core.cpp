@@ -40,20 +40,25 @@ CoreService::CoreService(const char *name) : IService("CoreService") {
 
     RISCV_mutex_init(&mutexPrintf_);
     RISCV_mutex_init(&mutexDefaultConsoles_);
-    RISCV_mutex_init(&mutexLogFile_);
     //logLevel_.make_int64(LOG_DEBUG);  // default = LOG_ERROR
     iclk_ = 0;
     uniqueIdx_ = 0;
     logFile_ = 0;
+    logWriterEna_ = false;
+    logWrCnt_ = 0;
+    logRdCnt_ = 0;
+    logRing_ = 0;
 }
 
 CoreService::~CoreService() {
     closeLog();
+    if (logRing_) {
+        delete [] logRing_;
+    }
     RISCV_mutex_lock(&mutexPrintf_);
     RISCV_mutex_destroy(&mutexPrintf_);
     RISCV_mutex_lock(&mutexDefaultConsoles_);
     RISCV_mutex_destroy(&mutexDefaultConsoles_);
-    RISCV_mutex_destroy(&mutexLogFile_);
     RISCV_event_close(&eventExiting_);
 }
 
@@ -460,32 +465,113 @@ void CoreService::unlockPrintf() {
 }
 
 int CoreService::openLog(const char *filename) {
-    if (logFile_) {
-        fclose(logFile_);
-        logFile_ = NULL;
-    }
+    RISCV_mutex_lock(&mutexPrintf_);
+    closeLog();
     logFile_ = fopen(filename, "wb");
     if (!logFile_) {
+        RISCV_mutex_unlock(&mutexPrintf_);
         return 1;
     }
+    if (!logRing_) {
+        logRing_ = new char[LOG_RING_SIZE];
+    }
+    logWrCnt_ = 0;
+    logRdCnt_ = 0;
+    RISCV_event_create(&eventLogWrite_, "eventLogWrite_");
+    logWriterEna_ = true;
+    logWriter_.func = reinterpret_cast<lib_thread_func>(runLogWriter);
+    logWriter_.args = this;
+    RISCV_thread_create(&logWriter_);
+    RISCV_mutex_unlock(&mutexPrintf_);
     return 0;
 }
 
 void CoreService::closeLog() {
-    if (logFile_) {
-        fclose(logFile_);
+    RISCV_mutex_lock(&mutexPrintf_);
+    if (!logFile_) {
+        RISCV_mutex_unlock(&mutexPrintf_);
+        return;
     }
+    logWriterEna_ = false;
+    RISCV_event_set(&eventLogWrite_);
+    RISCV_thread_join(logWriter_.Handle, 5000);
+    RISCV_event_close(&eventLogWrite_);
+    drainLog();
+    fclose(logFile_);
     logFile_ = 0;
+    RISCV_mutex_unlock(&mutexPrintf_);
+}
+
+thread_return_t CoreService::runLogWriter(void *arg) {
+    CoreService *p = reinterpret_cast<CoreService *>(arg);
+    while (p->logWriterEna_) {
+        RISCV_event_wait_ms(&p->eventLogWrite_, 100);
+        RISCV_event_clear(&p->eventLogWrite_);
+        p->drainLog();
+    }
+    return 0;
+}
+
+/**
+ * @brief Write all pending records to the file.
+ * @details Called by the writer thread only, or after it was joined.
+ */
+void CoreService::drainLog() {
+    unsigned wrcnt = logWrCnt_;
+    unsigned rdcnt = logRdCnt_;
+    unsigned off, sz;
+    if (wrcnt == rdcnt) {
+        return;
+    }
+    RISCV_memory_barrier();
+    while (rdcnt != wrcnt) {
+        off = rdcnt & (LOG_RING_SIZE - 1);
+        sz = wrcnt - rdcnt;
+        if (sz > LOG_RING_SIZE - off) {
+            sz = LOG_RING_SIZE - off;
+        }
+        fwrite(&logRing_[off], sz, 1, logFile_);
+        rdcnt += sz;
+    }
+    RISCV_memory_barrier();
+    logRdCnt_ = rdcnt;
+    fflush(logFile_);
 }
 
+/**
+ * @brief Queue log record for the writer thread.
+ * @details Caller holds mutexPrintf_ so there's only one producer. Wait
+ *          only when the ring is full.
+ */
 void CoreService::outputLog(const char *buf, int sz) {
+    unsigned wrcnt, off, part;
     if (!logFile_) {
         return;
     }
-    RISCV_mutex_lock(&mutexLogFile_);
-    fwrite(buf, sz, 1, logFile_);
-    fflush(logFile_);
-    RISCV_mutex_unlock(&mutexLogFile_);
+    while (sz > 0) {
+        wrcnt = logWrCnt_;
+        part = LOG_RING_SIZE - (wrcnt - logRdCnt_);
+        if (part == 0) {
+            RISCV_event_set(&eventLogWrite_);
+            RISCV_sleep_ms(1);
+            continue;
+        }
+        if (part > static_cast<unsigned>(sz)) {
+            part = static_cast<unsigned>(sz);
+        }
+        off = wrcnt & (LOG_RING_SIZE - 1);
+        if (part > LOG_RING_SIZE - off) {
+            part = LOG_RING_SIZE - off;
+        }
+        memcpy(&logRing_[off], buf, part);
+        RISCV_memory_barrier();
+        logWrCnt_ = wrcnt + part;
+        buf += part;
+        sz -= static_cast<int>(part);
+    }
+    if ((logWrCnt_ - logRdCnt_) > LOG_RING_SIZE / 2) {
+        RISCV_event_set(&eventLogWrite_);
+    }
 }
 
 void CoreService::outputConsole(const char *buf, int sz) {
@@ -36,6 +36,9 @@ struct CoreTimerType {
     int single_shot;
 };
 
+/** Log records ring size (must be power of 2) */
+static const unsigned LOG_RING_SIZE = 1 << 20;
+
 class CoreService : public IService {
  public:
     explicit CoreService(const char *name);
@@ -86,6 +89,9 @@ class CoreService : public IService {
     void generateUniqueName(const char *prefix, char *out, size_t outsz);
 
  private:
+    static thread_return_t runLogWriter(void *arg);
+    void drainLog();
+
     AttributeType Config_;
     AttributeType listPlugins_;
     AttributeType listClasses_;
@@ -95,13 +101,24 @@ class CoreService : public IService {
 
     int active_;
     event_def eventExiting_;
-    mutex_def mutexLogFile_;
     mutex_def mutexPrintf_;
     mutex_def mutexDefaultConsoles_;
 
     IFace *iclk_;
     FILE *logFile_;
 
+    /**
+     * Asynchronous log back-end: records are copied into the ring under
+     * mutexPrintf_ (single producer) and written to the file by
+     * the writer thread (single consumer) without fflush per record.
+     */
+    LibThreadType logWriter_;
+    event_def eventLogWrite_;
+    volatile bool logWriterEna_;
+    volatile unsigned logWrCnt_;
+    volatile unsigned logRdCnt_;
+    char *logRing_;
+
     /** Temporary buffer for the log messages. */
     char bufLog_[1024*1024];
     int uniqueIdx_;
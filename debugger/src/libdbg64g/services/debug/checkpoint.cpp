@@ -0,0 +1,641 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "checkpoint.h"
+#include "coreservices/idport.h"
+#include <stdio.h>
+
+namespace debugger {
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+#define chkpt_seek _fseeki64
+#define chkpt_fileno _fileno
+#else
+#define chkpt_seek fseeko
+#define chkpt_fileno fileno
+#endif
+
+/** FNV-1a over 64-bits words */
+static uint64_t page_hash(const uint8_t *page) {
+    const uint64_t *w = reinterpret_cast<const uint64_t *>(page);
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned i = 0; i < SNAPSHOT_PAGE_SIZE / sizeof(uint64_t); i++) {
+        h ^= w[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/** Check that page is filled with one 64-bits value */
+static bool page_filled(const uint8_t *page, uint64_t *value) {
+    const uint64_t *w = reinterpret_cast<const uint64_t *>(page);
+    for (unsigned i = 1; i < SNAPSHOT_PAGE_SIZE / sizeof(uint64_t); i++) {
+        if (w[i] != w[0]) {
+            return false;
+        }
+    }
+    *value = w[0];
+    return true;
+}
+
+/** Bytes of the page at 'off', the last page of storage can be partial */
+static uint64_t page_length(uint64_t sz, uint64_t off) {
+    return sz - off < SNAPSHOT_PAGE_SIZE ? sz - off : SNAPSHOT_PAGE_SIZE;
+}
+
+int CheckpointCmdType::isValid(AttributeType *args) {
+    if (!(*args)[0u].is_equal("checkpoint")) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 3 && (*args)[1].is_string() && (*args)[2].is_string()
+        && ((*args)[1].is_equal("save") || (*args)[1].is_equal("load"))) {
+        return CMD_VALID;
+    }
+    if (args->size() == 2 && ((*args)[1].is_equal("take")
+                           || (*args)[1].is_equal("rollback"))) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void CheckpointCmdType::exec(AttributeType *args, AttributeType *res) {
+    CheckpointService *p = static_cast<CheckpointService *>(cmdParent_);
+    const char *err;
+    uint64_t t1 = RISCV_get_time_ms();
+    res->make_dict();
+    if ((*args)[1].is_equal("save")) {
+        err = p->save((*args)[2].to_string(), res);
+    } else if ((*args)[1].is_equal("load")) {
+        err = p->load((*args)[2].to_string(), res);
+    } else if ((*args)[1].is_equal("take")) {
+        err = p->take(res);
+    } else {
+        err = p->rollback(res);
+    }
+    if (err) {
+        generateError(res, err);
+        return;
+    }
+    (*res)["ms"].make_uint64(RISCV_get_time_ms() - t1);
+}
+
+
+CheckpointService::CheckpointService(const char *name) : IService(name) {
+    registerAttribute("CmdExecutor", &cmdexec_);
+    icmdexec_ = 0;
+    pcmd_ = 0;
+    chunkHash_ = 0;
+    chunkHashSize_ = 0;
+    chunkCnt_ = 0;
+    map_ = 0;
+    mapCnt_ = 0;
+    mapSize_ = 0;
+    taken_ = 0;
+    takenCnt_ = 0;
+    takenSize_ = 0;
+}
+
+CheckpointService::~CheckpointService() {
+    freeTaken();
+    if (taken_) {
+        delete [] taken_;
+    }
+    if (chunkHash_) {
+        delete [] chunkHash_;
+    }
+    if (map_) {
+        delete [] map_;
+    }
+}
+
+void CheckpointService::postinitService() {
+    icmdexec_ = static_cast<ICmdExecutor *>(
+       RISCV_get_service_iface(cmdexec_.to_string(), IFACE_CMD_EXECUTOR));
+    if (!icmdexec_) {
+        RISCV_error("ICmdExecutor interface '%s' not found",
+                    cmdexec_.to_string());
+        return;
+    }
+    pcmd_ = new CheckpointCmdType(static_cast<IService *>(this));
+    icmdexec_->registerCommand(pcmd_);
+}
+
+void CheckpointService::predeleteService() {
+    if (icmdexec_) {
+        icmdexec_->unregisterCommand(pcmd_);
+        delete pcmd_;
+    }
+}
+
+bool CheckpointService::isHalted() {
+    AttributeType list;
+    RISCV_get_services_with_iface(IFACE_DPORT, &list);
+    for (unsigned i = 0; i < list.size(); i++) {
+        IService *iserv = static_cast<IService *>(list[i].to_iface());
+        IDPort *idport =
+            static_cast<IDPort *>(iserv->getInterface(IFACE_DPORT));
+        if (!idport->isHalted()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ISnapshot *CheckpointService::getSnapshot(const char *name) {
+    IService *iserv = static_cast<IService *>(RISCV_get_service(name));
+    if (!iserv) {
+        return 0;
+    }
+    return static_cast<ISnapshot *>(iserv->getInterface(IFACE_SNAPSHOT));
+}
+
+/** Services with the memory image: [[name, size], ...] */
+void CheckpointService::getStorages(AttributeType *list) {
+    AttributeType servlist;
+    list->make_list(0);
+    RISCV_get_services_with_iface(IFACE_SNAPSHOT, &servlist);
+    for (unsigned i = 0; i < servlist.size(); i++) {
+        IService *iserv = static_cast<IService *>(servlist[i].to_iface());
+        ISnapshot *isnap =
+            static_cast<ISnapshot *>(iserv->getInterface(IFACE_SNAPSHOT));
+        uint64_t sz = isnap->getStorageSize();
+        if (sz == 0) {
+            continue;
+        }
+        AttributeType item;
+        item.make_list(2);
+        item[0u].make_string(iserv->getObjName());
+        item[1].make_uint64(sz);
+        list->add_to_list(&item);
+    }
+}
+
+/**
+ * State of all services:
+ *     {'name': {'state': ..., 'ports': [[portname, state], ...]}, ...}
+ * Ports are stored in the registration order, names can repeat.
+ */
+void CheckpointService::saveStates(AttributeType *state) {
+    AttributeType servlist;
+    state->make_dict();
+    RISCV_get_services_with_iface(IFACE_SERVICE, &servlist);
+    for (unsigned i = 0; i < servlist.size(); i++) {
+        IService *iserv = static_cast<IService *>(servlist[i].to_iface());
+        ISnapshot *isnap =
+            static_cast<ISnapshot *>(iserv->getInterface(IFACE_SNAPSHOT));
+        const AttributeType *ports = iserv->getPortList();
+        AttributeType item;
+        AttributeType portstates;
+
+        portstates.make_list(0);
+        for (unsigned n = 0; n < ports->size(); n++) {
+            const AttributeType &port = (*ports)[n];
+            IFace *iface = port[1].to_iface();
+            if (strcmp(iface->getFaceName(), IFACE_SNAPSHOT) != 0) {
+                continue;
+            }
+            AttributeType t1;
+            t1.make_list(2);
+            t1[0u].make_string(port[0u].to_string());
+            static_cast<ISnapshot *>(iface)->saveState(&t1[1]);
+            portstates.add_to_list(&t1);
+        }
+        if (!isnap && portstates.size() == 0) {
+            continue;
+        }
+        item.make_dict();
+        if (isnap) {
+            isnap->saveState(&item["state"]);
+        }
+        item["ports"] = portstates;
+        (*state)[iserv->getObjName()] = item;
+    }
+}
+
+void CheckpointService::restoreStates(AttributeType *state) {
+    for (unsigned i = 0; i < state->size(); i++) {
+        const char *name = state->dict_key(i)->to_string();
+        AttributeType *item = state->dict_value(i);
+        IService *iserv = static_cast<IService *>(RISCV_get_service(name));
+        if (!iserv) {
+            RISCV_error("Service '%s' not found", name);
+            continue;
+        }
+        const AttributeType *ports = iserv->getPortList();
+        AttributeType &portstates = (*item)["ports"];
+        unsigned idx = 0;
+        for (unsigned n = 0; n < ports->size(); n++) {
+            const AttributeType &port = (*ports)[n];
+            IFace *iface = port[1].to_iface();
+            if (strcmp(iface->getFaceName(), IFACE_SNAPSHOT) != 0) {
+                continue;
+            }
+            if (idx >= portstates.size()
+                || !portstates[idx][0u].is_equal(port[0u].to_string())) {
+                RISCV_error("%s: port '%s' not saved",
+                            name, port[0u].to_string());
+                break;
+            }
+            static_cast<ISnapshot *>(iface)->restoreState(
+                &portstates[idx][1]);
+            idx++;
+        }
+
+        ISnapshot *isnap =
+            static_cast<ISnapshot *>(iserv->getInterface(IFACE_SNAPSHOT));
+        if (isnap && item->has_key("state")) {
+            isnap->restoreState(&(*item)["state"]);
+        }
+    }
+}
+
+int64_t CheckpointService::findChunk(uint64_t hash, const uint8_t *page) {
+    if (!chunkHashSize_) {
+        return -1;
+    }
+    uint64_t mask = chunkHashSize_ - 1;
+    for (uint64_t i = hash & mask; chunkHash_[i].page; i = (i + 1) & mask) {
+        if (chunkHash_[i].hash == hash
+            && memcmp(chunkHash_[i].page, page, SNAPSHOT_PAGE_SIZE) == 0) {
+            return static_cast<int64_t>(chunkHash_[i].idx);
+        }
+    }
+    return -1;
+}
+
+void CheckpointService::addChunk(uint64_t hash, const uint8_t *page,
+                                 uint64_t idx) {
+    if (2*(chunkCnt_ + 1) > chunkHashSize_) {
+        // Keep load factor below 0.5
+        ChunkHashType *prev = chunkHash_;
+        uint64_t prevsz = chunkHashSize_;
+        chunkHashSize_ = prevsz ? 2*prevsz : 4096;
+        chunkHash_ = new ChunkHashType[chunkHashSize_];
+        memset(chunkHash_, 0, chunkHashSize_*sizeof(ChunkHashType));
+        chunkCnt_ = 0;
+        for (uint64_t i = 0; i < prevsz; i++) {
+            if (prev[i].page) {
+                addChunk(prev[i].hash, prev[i].page, prev[i].idx);
+            }
+        }
+        if (prev) {
+            delete [] prev;
+        }
+    }
+    uint64_t mask = chunkHashSize_ - 1;
+    uint64_t i = hash & mask;
+    while (chunkHash_[i].page) {
+        i = (i + 1) & mask;
+    }
+    chunkHash_[i].hash = hash;
+    chunkHash_[i].page = page;
+    chunkHash_[i].idx = idx;
+    chunkCnt_++;
+}
+
+void CheckpointService::addPage(uint32_t storage, uint32_t kind,
+                                uint64_t off, uint64_t value) {
+    if (mapCnt_ == mapSize_) {
+        uint64_t sz = mapSize_ ? 2*mapSize_ : 4096;
+        CheckpointPageType *t = new CheckpointPageType[sz];
+        if (map_) {
+            memcpy(t, map_, mapCnt_*sizeof(CheckpointPageType));
+            delete [] map_;
+        }
+        map_ = t;
+        mapSize_ = sz;
+    }
+    map_[mapCnt_].storage = storage;
+    map_[mapCnt_].kind = kind;
+    map_[mapCnt_].off = off;
+    map_[mapCnt_].value = value;
+    mapCnt_++;
+}
+
+const char *CheckpointService::save(const char *filename,
+                                    AttributeType *res) {
+    if (!isHalted()) {
+        return "CPU isn't halted";
+    }
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        return "cannot open file";
+    }
+    CheckpointHeaderType hdr;
+    AttributeType state;
+    AttributeType storages;
+    uint8_t tail[SNAPSHOT_PAGE_SIZE];
+    uint64_t pages = 0;
+    uint64_t chunks = 0;
+    uint64_t fillval;
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CHECKPOINT_MAGIC, sizeof(hdr.magic));
+    hdr.version = CHECKPOINT_VERSION;
+    hdr.page_size = static_cast<uint32_t>(SNAPSHOT_PAGE_SIZE);
+    hdr.chunk_off = SNAPSHOT_PAGE_SIZE;
+    fwrite(&hdr, 1, sizeof(hdr), fp);
+    chkpt_seek(fp, hdr.chunk_off, SEEK_SET);
+
+    mapCnt_ = 0;
+    chunkCnt_ = 0;
+    if (chunkHash_) {
+        memset(chunkHash_, 0, chunkHashSize_*sizeof(ChunkHashType));
+    }
+
+    getStorages(&storages);
+    for (unsigned i = 0; i < storages.size(); i++) {
+        ISnapshot *isnap = getSnapshot(storages[i][0u].to_string());
+        uint64_t sz = storages[i][1].to_uint64();
+        for (uint64_t off = 0; off < sz; off += SNAPSHOT_PAGE_SIZE) {
+            const uint8_t *p = isnap->getStoragePage(off, false);
+            if (!p) {
+                continue;
+            }
+            bool is_tail = (sz - off) < SNAPSHOT_PAGE_SIZE;
+            if (is_tail) {
+                memset(tail, 0, sizeof(tail));
+                memcpy(tail, p, sz - off);
+                p = tail;
+            }
+            pages++;
+            if (page_filled(p, &fillval)) {
+                if (fillval) {
+                    addPage(i, CheckpointPage_Fill, off, fillval);
+                }
+                continue;
+            }
+            uint64_t hash = page_hash(p);
+            int64_t idx = findChunk(hash, p);
+            if (idx < 0) {
+                idx = static_cast<int64_t>(chunks++);
+                fwrite(p, 1, SNAPSHOT_PAGE_SIZE, fp);
+                if (!is_tail) {
+                    addChunk(hash, p, idx);
+                }
+            }
+            addPage(i, CheckpointPage_Chunk, off, idx);
+        }
+    }
+    hdr.chunk_total = chunks;
+
+    hdr.map_off = hdr.chunk_off + chunks*SNAPSHOT_PAGE_SIZE;
+    hdr.map_total = mapCnt_;
+    fwrite(map_, sizeof(CheckpointPageType), mapCnt_, fp);
+
+    state.make_dict();
+    saveStates(&state["services"]);
+    state["storages"] = storages;
+    (*res)["services"].make_uint64(state["services"].size());
+    state.to_config();
+    hdr.state_off = hdr.map_off + mapCnt_*sizeof(CheckpointPageType);
+    hdr.state_size = strlen(state.to_string());
+    fwrite(state.to_string(), 1, hdr.state_size, fp);
+
+    chkpt_seek(fp, 0, SEEK_SET);
+    fwrite(&hdr, 1, sizeof(hdr), fp);
+    bool err = ferror(fp) != 0;
+    fclose(fp);
+    if (err) {
+        return "write error";
+    }
+
+    (*res)["pages"].make_uint64(pages);
+    (*res)["chunks"].make_uint64(chunks);
+    (*res)["bytes"].make_uint64(hdr.state_off + hdr.state_size);
+    return 0;
+}
+
+const char *CheckpointService::load(const char *filename,
+                                    AttributeType *res) {
+    if (!isHalted()) {
+        return "CPU isn't halted";
+    }
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return "cannot open file";
+    }
+    CheckpointHeaderType hdr;
+    AttributeType state;
+    uint64_t mapped = 0;
+
+    if (fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr)
+        || memcmp(hdr.magic, CHECKPOINT_MAGIC, sizeof(hdr.magic)) != 0
+        || hdr.version != CHECKPOINT_VERSION
+        || hdr.page_size != SNAPSHOT_PAGE_SIZE) {
+        fclose(fp);
+        return "wrong file format";
+    }
+
+    char *cfg = new char[hdr.state_size + 1];
+    chkpt_seek(fp, hdr.state_off, SEEK_SET);
+    if (fread(cfg, 1, hdr.state_size, fp) != hdr.state_size) {
+        delete [] cfg;
+        fclose(fp);
+        return "wrong file format";
+    }
+    cfg[hdr.state_size] = '\0';
+    state.from_config(cfg);
+    delete [] cfg;
+
+    if (hdr.map_total > mapSize_) {
+        if (map_) {
+            delete [] map_;
+        }
+        mapSize_ = hdr.map_total;
+        map_ = new CheckpointPageType[mapSize_];
+    }
+    mapCnt_ = hdr.map_total;
+    chkpt_seek(fp, hdr.map_off, SEEK_SET);
+    if (fread(map_, sizeof(CheckpointPageType), mapCnt_, fp) != mapCnt_
+        || !state["storages"].is_list() || !state["services"].is_dict()) {
+        fclose(fp);
+        return "wrong file format";
+    }
+
+    AttributeType &storages = state["storages"];
+    ISnapshot **isnaps = new ISnapshot *[storages.size() + 1];
+    for (unsigned i = 0; i < storages.size(); i++) {
+        isnaps[i] = getSnapshot(storages[i][0u].to_string());
+        if (!isnaps[i]
+            || isnaps[i]->getStorageSize() != storages[i][1].to_uint64()) {
+            delete [] isnaps;
+            fclose(fp);
+            return "memory configuration changed";
+        }
+    }
+
+    // Corrupted or stale file must not index out of the storages, it's
+    // checked before the current content is dropped
+    for (uint64_t n = 0; n < mapCnt_; n++) {
+        if (map_[n].storage >= storages.size()
+            || map_[n].off >= storages[map_[n].storage][1].to_uint64()) {
+            delete [] isnaps;
+            fclose(fp);
+            return "wrong file format";
+        }
+    }
+
+    freeTaken();
+    for (unsigned i = 0; i < storages.size(); i++) {
+        isnaps[i]->clearStorage();
+    }
+
+    uint64_t i = 0;
+    while (i < mapCnt_) {
+        CheckpointPageType &pg = map_[i];
+        ISnapshot *isnap = isnaps[pg.storage];
+        uint64_t sz = storages[pg.storage][1].to_uint64();
+        uint64_t len = page_length(sz, pg.off);
+
+        if (pg.kind == CheckpointPage_Fill) {
+            uint64_t *w = reinterpret_cast<uint64_t *>(
+                            isnap->getStoragePage(pg.off, true));
+            for (uint64_t n = 0; n < len / sizeof(uint64_t); n++) {
+                w[n] = pg.value;
+            }
+            i++;
+            continue;
+        }
+
+        // Run of consecutive chunks mapped at once
+        uint64_t cnt = 1;
+        while ((i + cnt) < mapCnt_
+            && map_[i + cnt].kind == CheckpointPage_Chunk
+            && map_[i + cnt].storage == pg.storage
+            && map_[i + cnt].off == pg.off + cnt*SNAPSHOT_PAGE_SIZE
+            && map_[i + cnt].value == pg.value + cnt
+            && map_[i + cnt].off + SNAPSHOT_PAGE_SIZE <= sz) {
+            cnt++;
+        }
+        if (len == SNAPSHOT_PAGE_SIZE
+            && isnap->mapStorage(pg.off, cnt*SNAPSHOT_PAGE_SIZE,
+                        chkpt_fileno(fp),
+                        hdr.chunk_off + pg.value*SNAPSHOT_PAGE_SIZE)) {
+            mapped += cnt;
+            i += cnt;
+            continue;
+        }
+        for (uint64_t n = 0; n < cnt; n++) {
+            CheckpointPageType &t = map_[i + n];
+            len = page_length(sz, t.off);
+            chkpt_seek(fp, hdr.chunk_off + t.value*SNAPSHOT_PAGE_SIZE,
+                       SEEK_SET);
+            if (fread(isnap->getStoragePage(t.off, true), 1, len, fp) != len) {
+                RISCV_error("Chunk %" RV_PRI64 "d not read", t.value);
+            }
+        }
+        i += cnt;
+    }
+    delete [] isnaps;
+    fclose(fp);
+
+    restoreStates(&state["services"]);
+
+    (*res)["services"].make_uint64(state["services"].size());
+    (*res)["pages"].make_uint64(mapCnt_);
+    (*res)["chunks"].make_uint64(hdr.chunk_total);
+    (*res)["mapped"].make_uint64(mapped);
+    return 0;
+}
+
+void CheckpointService::freeTaken() {
+    for (uint64_t i = 0; i < takenCnt_; i++) {
+        delete [] taken_[i].data;
+    }
+    takenCnt_ = 0;
+    takenState_.attr_free();
+    takenStorages_.attr_free();
+}
+
+/** Pages of the storages without copy-on-write are copied immediately */
+const char *CheckpointService::take(AttributeType *res) {
+    if (!isHalted()) {
+        return "CPU isn't halted";
+    }
+    freeTaken();
+    getStorages(&takenStorages_);
+    for (unsigned i = 0; i < takenStorages_.size(); i++) {
+        AttributeType &item = takenStorages_[i];
+        ISnapshot *isnap = getSnapshot(item[0u].to_string());
+        uint64_t sz = item[1].to_uint64();
+        AttributeType cow;
+        cow.make_boolean(isnap->takeStorage());
+        item.add_to_list(&cow);
+        if (cow.to_bool()) {
+            continue;
+        }
+        for (uint64_t off = 0; off < sz; off += SNAPSHOT_PAGE_SIZE) {
+            uint8_t *p = isnap->getStoragePage(off, false);
+            if (!p) {
+                continue;
+            }
+            if (takenCnt_ == takenSize_) {
+                uint64_t tsz = takenSize_ ? 2*takenSize_ : 1024;
+                TakenPageType *t = new TakenPageType[tsz];
+                if (taken_) {
+                    memcpy(t, taken_, takenCnt_*sizeof(TakenPageType));
+                    delete [] taken_;
+                }
+                taken_ = t;
+                takenSize_ = tsz;
+            }
+            uint64_t len = page_length(sz, off);
+            taken_[takenCnt_].isnap = isnap;
+            taken_[takenCnt_].off = off;
+            taken_[takenCnt_].data = new uint8_t[SNAPSHOT_PAGE_SIZE];
+            memcpy(taken_[takenCnt_].data, p, len);
+            takenCnt_++;
+        }
+    }
+    saveStates(&takenState_);
+
+    (*res)["services"].make_uint64(takenState_.size());
+    (*res)["pages"].make_uint64(takenCnt_);
+    return 0;
+}
+
+const char *CheckpointService::rollback(AttributeType *res) {
+    if (!isHalted()) {
+        return "CPU isn't halted";
+    }
+    if (!takenState_.is_dict()) {
+        return "snapshot wasn't taken";
+    }
+    for (unsigned i = 0; i < takenStorages_.size(); i++) {
+        AttributeType &item = takenStorages_[i];
+        ISnapshot *isnap = getSnapshot(item[0u].to_string());
+        if (item[2].to_bool()) {
+            isnap->rollbackStorage();
+        } else {
+            isnap->clearStorage();
+        }
+    }
+    for (uint64_t i = 0; i < takenCnt_; i++) {
+        TakenPageType &pg = taken_[i];
+        uint64_t sz = pg.isnap->getStorageSize();
+        uint64_t len = page_length(sz, pg.off);
+        memcpy(pg.isnap->getStoragePage(pg.off, true), pg.data, len);
+    }
+    restoreStates(&takenState_);
+
+    (*res)["services"].make_uint64(takenState_.size());
+    (*res)["pages"].make_uint64(takenCnt_);
+    return 0;
+}
+
+}  // namespace debugger
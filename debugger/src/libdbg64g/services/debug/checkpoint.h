@@ -0,0 +1,152 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/icmdexec.h"
+#include "coreservices/isnapshot.h"
+
+namespace debugger {
+
+class CheckpointCmdType : public ICommand {
+ public:
+    explicit CheckpointCmdType(IService *parent)
+        : ICommand(parent, "checkpoint") {
+        briefDescr_.make_string("Save and restore the whole system state.");
+        detailedDescr_.make_string(
+            "Description:\n"
+            "    Save or load CPUs, devices and memory state. CPUs should\n"
+            "    be halted. 'take' keeps the state in memory and memory\n"
+            "    pages are copied only when modified, 'rollback' returns\n"
+            "    to the taken state and can be repeated.\n"
+            "Response:\n"
+            "    {'services':n,'pages':n,'chunks':n,'bytes':n,'mapped':n,\n"
+            "     'ms':n}   'bytes' is the file size on saving, 'mapped' is\n"
+            "               the number of pages mapped from the file\n"
+            "Usage:\n"
+            "    checkpoint save <file>\n"
+            "    checkpoint load <file>\n"
+            "    checkpoint take\n"
+            "    checkpoint rollback\n"
+            "Example:\n"
+            "    checkpoint save booted.chkpt\n"
+            "    checkpoint load booted.chkpt");
+    }
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+};
+
+/**
+ * Checkpoint file: CheckpointHeaderType, raw pages (chunks) starting from
+ * the page aligned offset, page map and the state as a config string.
+ * Pages filled with one 64-bits value are stored in the map only, zero
+ * pages are omitted, equal pages refer to the same chunk. Chunks are
+ * written in the order of the first reference, so that the consecutive
+ * pages of the storage can be mapped by one call.
+ */
+static const char CHECKPOINT_MAGIC[8] = {'R', 'V', 'C', 'H', 'K', 'P', 'T', 0};
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+struct CheckpointHeaderType {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_size;
+    uint64_t chunk_off;
+    uint64_t chunk_total;
+    uint64_t map_off;
+    uint64_t map_total;
+    uint64_t state_off;
+    uint64_t state_size;
+};
+
+enum ECheckpointPage {
+    CheckpointPage_Chunk,
+    CheckpointPage_Fill,
+};
+
+struct CheckpointPageType {
+    uint32_t storage;           // index in the 'storages' list of state
+    uint32_t kind;              // ECheckpointPage
+    uint64_t off;               // offset in storage
+    uint64_t value;             // chunk index or filling value
+};
+
+class CheckpointService : public IService {
+ public:
+    explicit CheckpointService(const char *name);
+    virtual ~CheckpointService();
+
+    /** IService interface */
+    virtual void postinitService() override;
+    virtual void predeleteService() override;
+
+    /** Common methods, return error description or 0 */
+    const char *save(const char *filename, AttributeType *res);
+    const char *load(const char *filename, AttributeType *res);
+    const char *take(AttributeType *res);
+    const char *rollback(AttributeType *res);
+
+ private:
+    bool isHalted();
+    void getStorages(AttributeType *list);
+    void saveStates(AttributeType *state);
+    void restoreStates(AttributeType *state);
+    ISnapshot *getSnapshot(const char *name);
+
+    int64_t findChunk(uint64_t hash, const uint8_t *page);
+    void addChunk(uint64_t hash, const uint8_t *page, uint64_t idx);
+    void addPage(uint32_t storage, uint32_t kind, uint64_t off,
+                 uint64_t value);
+    void freeTaken();
+
+ private:
+    AttributeType cmdexec_;
+
+    ICmdExecutor *icmdexec_;
+    CheckpointCmdType *pcmd_;
+
+    // Deduplication of the chunks on save
+    struct ChunkHashType {
+        uint64_t hash;
+        const uint8_t *page;    // page of the halted system
+        uint64_t idx;
+    } *chunkHash_;
+    uint64_t chunkHashSize_;
+    uint64_t chunkCnt_;
+
+    CheckpointPageType *map_;
+    uint64_t mapCnt_;
+    uint64_t mapSize_;
+
+    // In-process snapshot
+    AttributeType takenState_;
+    AttributeType takenStorages_;   // [[name, size, copy-on-write], ...]
+    struct TakenPageType {
+        ISnapshot *isnap;
+        uint64_t off;
+        uint8_t *data;
+    } *taken_;
+    uint64_t takenCnt_;
+    uint64_t takenSize_;
+};
+
+DECLARE_CLASS(CheckpointService)
+
+}  // namespace debugger
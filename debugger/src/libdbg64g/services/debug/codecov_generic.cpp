@@ -14,26 +14,100 @@
  *  limitations under the License.
  */
 
+#include <api_core.h>
 #include "codecov_generic.h"
+#include <stdio.h>
+#include <time.h>
+#include <algorithm>
 
 namespace debugger {
 
+static unsigned popcount64(uint64_t v) {
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return static_cast<unsigned>((v * 0x0101010101010101ull) >> 56);
+}
+
+/** Index of the least significant set bit, v != 0 */
+static unsigned ctz64(uint64_t v) {
+    return popcount64((v & (~v + 1)) - 1);
+}
+
+static void fprintf_xml(FILE *fp, const char *s) {
+    for (; *s; s++) {
+        switch (*s) {
+        case '<': fputs("&lt;", fp); break;
+        case '>': fputs("&gt;", fp); break;
+        case '&': fputs("&amp;", fp); break;
+        case '"': fputs("&quot;", fp); break;
+        default: fputc(*s, fp);
+        }
+    }
+}
+
 int CoverageCmdType::isValid(AttributeType *args) {
     if (!(*args)[0u].is_equal("coverage")) {
         return CMD_INVALID;
     }
-    return CMD_VALID;
+    if (args->size() == 1) {
+        return CMD_VALID;
+    }
+    if (!(*args)[1].is_string()) {
+        return CMD_WRONG_ARGS;
+    }
+    if (args->size() == 2) {
+        return CMD_VALID;
+    }
+    if (!(*args)[2].is_string()) {
+        return CMD_WRONG_ARGS;
+    }
+    if (args->size() == 3) {
+        return CMD_VALID;
+    }
+    if (args->size() == 4 && (*args)[3].is_string()) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
 }
 
 void CoverageCmdType::exec(AttributeType *args, AttributeType *res) {
     GenericCodeCoverage *p = static_cast<GenericCodeCoverage *>(cmdParent_);
-    if (args->size() == 2 && (*args)[1].is_string()) {
+    const char *err = 0;
+    if (args->size() == 1) {
+        res->make_floating(p->getCoverage());
+        return;
+    }
+
+    res->attr_free();
+    res->make_nil();
+    if (args->size() == 2) {
         if ((*args)[1].is_equal("detailed")) {
             p->getCoverageDetailed(res);
-            return;
+        } else if ((*args)[1].is_equal("clear")) {
+            p->clear();
+        } else {
+            generateError(res, "Wrong argument");
         }
+        return;
+    }
+
+    const char *file = (*args)[2].to_string();
+    const char *name = args->size() == 4 ? (*args)[3].to_string() : "";
+    if ((*args)[1].is_equal("save")) {
+        err = p->save(file);
+    } else if ((*args)[1].is_equal("merge")) {
+        err = p->merge(file);
+    } else if ((*args)[1].is_equal("lcov")) {
+        err = p->writeLcov(file, name);
+    } else if ((*args)[1].is_equal("cobertura")) {
+        err = p->writeCobertura(file, name);
+    } else {
+        err = "Wrong argument";
+    }
+    if (err) {
+        generateError(res, err);
     }
-    res->make_floating(p->getCoverage());
 }
 
 
@@ -41,9 +115,32 @@ GenericCodeCoverage::GenericCodeCoverage(const char *name) : IService(name) {
     registerInterface(static_cast<ICoverageTracker *>(this));
     registerAttribute("CmdExecutor", static_cast<IAttribute *>(&cmdexec_));
     registerAttribute("SourceCode", static_cast<IAttribute *>(&src_));
-    registerAttribute("Paged", static_cast<IAttribute *>(&paged_));
     registerAttribute("Regions", static_cast<IAttribute *>(&regions_));
+    iexec_ = 0;
+    isrc_ = 0;
+    pcmd_ = 0;
     track_sz_ = 0;
+    regions_.make_list(0);
+
+    RISCV_mutex_init(&mutexPages_);
+    memset(&emptyPage_, 0, sizeof(emptyPage_));
+    emptyPage_.pn = ~0ull;
+    lastPage_ = &emptyPage_;
+    pageHashSize_ = 1024;
+    pageHash_ = new CoveragePageType *[pageHashSize_];
+    memset(pageHash_, 0, pageHashSize_ * sizeof(CoveragePageType *));
+    pageSize_ = 256;
+    pages_ = new CoveragePageType *[pageSize_];
+    pageCnt_ = 0;
+}
+
+GenericCodeCoverage::~GenericCodeCoverage() {
+    for (unsigned i = 0; i < pageCnt_; i++) {
+        delete pages_[i];
+    }
+    delete [] pages_;
+    delete [] pageHash_;
+    RISCV_mutex_destroy(&mutexPages_);
 }
 
 void GenericCodeCoverage::postinitService() {
@@ -66,7 +163,7 @@ void GenericCodeCoverage::postinitService() {
     pcmd_ = new CoverageCmdType(static_cast<IService *>(this));
     iexec_->registerCommand(static_cast<ICommand *>(pcmd_));
 
-    // Compute Total regions size
+    // Compute Total regions size, functions are used if not specified
     if (!regions_.is_list()) {
         RISCV_error("Regions attribute of wrong format",
                     src_.to_string());
@@ -77,7 +174,6 @@ void GenericCodeCoverage::postinitService() {
         AttributeType &item = regions_[i];
         track_sz_ += item[1].to_uint64() - item[0u].to_uint64() + 1;
     }
-    memset(flash_, 0, sizeof(flash_));
 }
 
 void GenericCodeCoverage::predeleteService() {
@@ -86,137 +182,376 @@ void GenericCodeCoverage::predeleteService() {
     }
 }
 
-void GenericCodeCoverage::markAddress(uint64_t addr, uint8_t oplen) {
-    addr = paged2flat(addr);
-    if (addr < sizeof(flash_)) {
-        flash_[addr] = oplen;
+CoveragePageType *GenericCodeCoverage::findPage(uint64_t pn) {
+    unsigned h = static_cast<unsigned>(pn * 0x9E3779B97F4A7C15ull >> 32);
+    CoveragePageType *p;
+    while ((p = pageHash_[h & (pageHashSize_ - 1)]) != 0) {
+        if (p->pn == pn) {
+            return p;
+        }
+        h++;
     }
+    return 0;
 }
 
-uint64_t GenericCodeCoverage::paged2flat(uint64_t addr) {
-    if (!paged_.to_bool()) {
-        return addr;
+/** Slow path of markAddress() */
+CoveragePageType *GenericCodeCoverage::getPage(uint64_t pn) {
+    CoveragePageType *p;
+    RISCV_mutex_lock(&mutexPages_);
+    p = findPage(pn);
+    if (p == 0) {
+        if (2 * (pageCnt_ + 1) > pageHashSize_) {
+            delete [] pageHash_;
+            pageHashSize_ *= 2;
+            pageHash_ = new CoveragePageType *[pageHashSize_];
+            memset(pageHash_, 0,
+                   pageHashSize_ * sizeof(CoveragePageType *));
+            for (unsigned i = 0; i < pageCnt_; i++) {
+                unsigned h = static_cast<unsigned>(
+                    pages_[i]->pn * 0x9E3779B97F4A7C15ull >> 32);
+                while (pageHash_[h & (pageHashSize_ - 1)]) {
+                    h++;
+                }
+                pageHash_[h & (pageHashSize_ - 1)] = pages_[i];
+            }
+        }
+        if (pageCnt_ == pageSize_) {
+            CoveragePageType **t = new CoveragePageType *[2 * pageSize_];
+            memcpy(t, pages_, pageSize_ * sizeof(CoveragePageType *));
+            delete [] pages_;
+            pages_ = t;
+            pageSize_ *= 2;
+        }
+        p = new CoveragePageType;
+        memset(p, 0, sizeof(CoveragePageType));
+        p->pn = pn;
+        unsigned h = static_cast<unsigned>(pn * 0x9E3779B97F4A7C15ull >> 32);
+        while (pageHash_[h & (pageHashSize_ - 1)]) {
+            h++;
+        }
+        pageHash_[h & (pageHashSize_ - 1)] = p;
+        pages_[pageCnt_++] = p;
+    }
+    lastPage_ = p;
+    RISCV_mutex_unlock(&mutexPages_);
+    return p;
+}
+
+/** 64 bytes starting from the aligned address, called with locked mutex */
+uint64_t GenericCodeCoverage::getWord(uint64_t addr) {
+    uint64_t pn = addr >> COVERAGE_PAGE_BITS;
+    unsigned idx = static_cast<unsigned>(addr >> 6) & (COVERAGE_PAGE_WORDS - 1);
+    CoveragePageType *p = findPage(pn);
+    uint64_t ret = p ? p->bits[idx] : 0;
+    if (idx == 0 && (p = findPage(pn - 1)) != 0) {
+        ret |= p->bits[COVERAGE_PAGE_WORDS];
+    }
+    return ret;
+}
+
+/** Number of covered bytes in [start, end) */
+uint64_t GenericCodeCoverage::countCovered(uint64_t start, uint64_t end) {
+    uint64_t ret = 0;
+    uint64_t addr = start & ~0x3Full;
+    while (addr < end) {
+        uint64_t w = getWord(addr);
+        if (addr < start) {
+            w &= ~0ull << (start - addr);
+        }
+        if (end - addr < 64) {
+            w &= (1ull << (end - addr)) - 1;
+        }
+        ret += popcount64(w);
+        addr += 64;
+    }
+    return ret;
+}
+
+/** First address in [addr, end) with the marking different from 'marked' */
+uint64_t GenericCodeCoverage::nextChange(uint64_t addr, uint64_t end,
+                                         bool marked) {
+    while (addr < end) {
+        uint64_t w = getWord(addr & ~0x3Full);
+        if (marked) {
+            w = ~w;
+        }
+        w &= ~0ull << (addr & 0x3F);
+        if (w) {
+            addr = (addr & ~0x3Full) + ctz64(w);
+            break;
+        }
+        addr = (addr & ~0x3Full) + 64;
+    }
+    return addr < end ? addr : end;
+}
+
+/** @return number of symbols sorted by address */
+unsigned GenericCodeCoverage::getFunctions(bool code_only,
+                                           AttributeType *symbols,
+                                           FunctionType **funcs) {
+    unsigned cnt = 0;
+    isrc_->getSymbols(symbols);
+    *funcs = new FunctionType[symbols->size() + 1];
+    for (unsigned i = 0; i < symbols->size(); i++) {
+        AttributeType &symb = (*symbols)[i];
+        if (code_only && symb[Symbol_Type].to_uint64() != SYMBOL_TYPE_FUNCTION) {
+            continue;
+        }
+        (*funcs)[cnt].addr = symb[Symbol_Addr].to_uint64();
+        (*funcs)[cnt].size = symb[Symbol_Size].to_uint64();
+        if ((*funcs)[cnt].size == 0) {
+            (*funcs)[cnt].size = 1;
+        }
+        (*funcs)[cnt].name = i;
+        cnt++;
     }
-    return addr % sizeof(flash_);
+    std::sort(*funcs, *funcs + cnt,
+        [](const FunctionType &a, const FunctionType &b) {
+            return a.addr < b.addr;
+        });
+    return cnt;
 }
 
 double GenericCodeCoverage::getCoverage() {
+    AttributeType symbols;
+    FunctionType *funcs = 0;
     uint64_t used = 0;
-    uint64_t off = 0;
-    uint64_t inc_bytes;
-    double ret;
+    uint64_t total = track_sz_;
+    unsigned cnt = 0;
+
+    if (regions_.size() == 0 && isrc_) {
+        cnt = getFunctions(true, &symbols, &funcs);
+    }
 
+    RISCV_mutex_lock(&mutexPages_);
     for (unsigned i = 0; i < regions_.size(); i++) {
         AttributeType &item = regions_[i];
-        uint64_t sec_start = paged2flat(item[0u].to_uint32());
-        uint64_t sec_end = paged2flat(item[1].to_uint32());
-        uint64_t sec_sz = sec_end - sec_start + 1;
-        off = 0;
-        while (off < sec_sz) {
-            if (!flash_[sec_start + off]) {
-                off++;
-            } else {
-                inc_bytes = flash_[sec_start + off];
-                if ((sec_start + off + inc_bytes) > sec_end) {
-                    inc_bytes = 1 + sec_end - (sec_start + off);
-                }
-                used += inc_bytes;
-                off += inc_bytes;
-            }
-        }
+        used += countCovered(item[0u].to_uint64(), item[1].to_uint64() + 1);
     }
+    for (unsigned i = 0; i < cnt; i++) {
+        used += countCovered(funcs[i].addr, funcs[i].addr + funcs[i].size);
+        total += funcs[i].size;
+    }
+    RISCV_mutex_unlock(&mutexPages_);
+    delete [] funcs;
 
-    ret = 100.0*static_cast<double>(used)/track_sz_;
-    return ret;
+    if (total == 0) {
+        return 0;
+    }
+    return 100.0*static_cast<double>(used)/total;
 }
 
+/** [[marked, start, end, 'symbol+offset'], ...] with inclusive end */
 void GenericCodeCoverage::getCoverageDetailed(AttributeType *resp) {
-    resp->attr_free();
-    resp->make_list(0);
-    unsigned off;
-    uint8_t marked;
     AttributeType item;
-    AttributeType symbol;
-    bool split_section;
-    enum EStage {
-        SectionMarked,
-        SectionCleared,
-    } estage;
     char tstr[256];
+    const char *name;
+    uint64_t symboff;
+    resp->attr_free();
+    resp->make_list(0);
+    if (!isrc_) {
+        return;
+    }
     item.make_list(4);
 
+    RISCV_mutex_lock(&mutexPages_);
     for (unsigned i = 0; i < regions_.size(); i++) {
         AttributeType &region = regions_[i];
-        unsigned sec_start = region[0u].to_uint32();
-        unsigned sec_end = region[1].to_uint32();
-        unsigned sec_sz = sec_end - sec_start + 1;
-        unsigned sec_cnt = 0;
-        off = sec_start;
-        marked = flash_[paged2flat(sec_start)];
-
-        if (flash_[paged2flat(off)]) {
-            item[0u].make_boolean(true);
-            estage = SectionMarked;
-        } else {
-            item[0u].make_boolean(false);
-            estage = SectionCleared;
-        }
-        item[1].make_uint64(sec_start);        // start addess initial value
-        item[2].make_uint64(sec_start);        // end address initial value
-        isrc_->addressToSymbol(sec_start, &symbol);
-        RISCV_sprintf(tstr, sizeof(tstr), "%s+0x%x",
-                        symbol[0u].to_string(), symbol[1].to_uint32());
-        item[3].make_string(tstr);
-
-        while (sec_cnt < sec_sz) {
-            marked = flash_[paged2flat(off)];
-            split_section = false;
-
-            switch (estage) {
-            case SectionMarked:
-                if (!marked) {
-                    estage = SectionCleared;
-                    split_section = true;
-                }
-                break;
-            case SectionCleared:
-                if (marked) {
-                    estage = SectionMarked;
-                    split_section = true;
-                }
-                break;
-            default:;
-            }
+        uint64_t off = region[0u].to_uint64();
+        uint64_t end = region[1].to_uint64() + 1;
+        bool marked = countCovered(off, off + 1) != 0;
+        while (off < end) {
+            uint64_t next = nextChange(off, end, marked);
+            item[0u].make_boolean(marked);
+            item[1].make_uint64(off);
+            item[2].make_uint64(next - 1);
+            name = isrc_->addressToName(off, &symboff);
+            RISCV_sprintf(tstr, sizeof(tstr), "%s+0x%" RV_PRI64 "x",
+                          name ? name : "", symboff);
+            item[3].make_string(tstr);
+            resp->add_to_list(&item);
+            marked = !marked;
+            off = next;
+        }
+    }
+    RISCV_mutex_unlock(&mutexPages_);
+}
 
-            if (split_section) {
-                resp->add_to_list(&item);
-
-                // init attribute for the next sections
-                item[0u].make_boolean(marked ? true: false);
-                item[1].make_uint64(off);               // start address
-                item[2].make_uint64(off);               // end address initial value
-                isrc_->addressToSymbol(off, &symbol);
-                RISCV_sprintf(tstr, sizeof(tstr), "%s+0x%x",
-                              symbol[0u].to_string(), symbol[1].to_uint32());
-                item[3].make_string(tstr);
-            }
+void GenericCodeCoverage::clear() {
+    RISCV_mutex_lock(&mutexPages_);
+    for (unsigned i = 0; i < pageCnt_; i++) {
+        memset(pages_[i]->bits, 0, sizeof(pages_[i]->bits));
+    }
+    RISCV_mutex_unlock(&mutexPages_);
+}
 
-            if (marked) {
-                for (uint8_t n = 0; n < marked; n++) {
-                    if (sec_cnt < sec_sz) {
-                        item[2].make_uint64(off);   // end address update
-                    }
-                    off++;
-                    sec_cnt++;
-                }
-            } else {
-                item[2].make_uint64(off);           // end address update
-                off++;
-                sec_cnt++;
-            }
+const char *GenericCodeCoverage::save(const char *filename) {
+    CoverageHeaderType hdr;
+    const char *ret = 0;
+    FILE *fp = fopen(filename, "wb");
+    if (!fp) {
+        return "Can't open file";
+    }
+    RISCV_mutex_lock(&mutexPages_);
+    memcpy(hdr.magic, COVERAGE_MAGIC, sizeof(hdr.magic));
+    hdr.version = COVERAGE_VERSION;
+    hdr.page_bits = COVERAGE_PAGE_BITS;
+    hdr.page_total = pageCnt_;
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) {
+        ret = "Write error";
+    }
+    for (unsigned i = 0; i < pageCnt_ && !ret; i++) {
+        if (fwrite(pages_[i], sizeof(CoveragePageType), 1, fp) != 1) {
+            ret = "Write error";
+        }
+    }
+    RISCV_mutex_unlock(&mutexPages_);
+    fclose(fp);
+    return ret;
+}
+
+/** Files of the different runs are merged with OR */
+const char *GenericCodeCoverage::merge(const char *filename) {
+    CoverageHeaderType hdr;
+    CoveragePageType page;
+    CoveragePageType *p;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        return "Can't open file";
+    }
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1
+        || memcmp(hdr.magic, COVERAGE_MAGIC, sizeof(hdr.magic)) != 0
+        || hdr.version != COVERAGE_VERSION
+        || hdr.page_bits != COVERAGE_PAGE_BITS) {
+        fclose(fp);
+        return "Wrong file format";
+    }
+    for (uint64_t i = 0; i < hdr.page_total; i++) {
+        if (fread(&page, sizeof(page), 1, fp) != 1) {
+            fclose(fp);
+            return "Unexpected end of file";
+        }
+        p = getPage(page.pn);
+        for (int n = 0; n <= COVERAGE_PAGE_WORDS; n++) {
+            p->bits[n] |= page.bits[n];
+        }
+    }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * Source lines aren't available, so that each function is one line
+ * numbered in the address order.
+ */
+const char *GenericCodeCoverage::writeLcov(const char *filename,
+                                           const char *name) {
+    AttributeType symbols;
+    FunctionType *funcs;
+    unsigned cnt;
+    unsigned hit = 0;
+    uint64_t *covered;
+    FILE *fp;
+
+    if (!isrc_) {
+        return "Source code service not found";
+    }
+    if ((fp = fopen(filename, "wb")) == 0) {
+        return "Can't open file";
+    }
+    cnt = getFunctions(true, &symbols, &funcs);
+    covered = new uint64_t[cnt + 1];
+    RISCV_mutex_lock(&mutexPages_);
+    for (unsigned i = 0; i < cnt; i++) {
+        covered[i] = countCovered(funcs[i].addr, funcs[i].addr + funcs[i].size);
+        if (covered[i]) {
+            hit++;
         }
-        resp->add_to_list(&item);
     }
+    RISCV_mutex_unlock(&mutexPages_);
+
+    fprintf(fp, "TN:%s\n", name);
+    fprintf(fp, "SF:%s\n", name[0] ? name : getObjName());
+    for (unsigned i = 0; i < cnt; i++) {
+        fprintf(fp, "FN:%d,%s\n", i + 1,
+                symbols[funcs[i].name][Symbol_Name].to_string());
+    }
+    for (unsigned i = 0; i < cnt; i++) {
+        fprintf(fp, "FNDA:%d,%s\n", covered[i] ? 1 : 0,
+                symbols[funcs[i].name][Symbol_Name].to_string());
+    }
+    fprintf(fp, "FNF:%d\nFNH:%d\n", cnt, hit);
+    for (unsigned i = 0; i < cnt; i++) {
+        fprintf(fp, "DA:%d,%d\n", i + 1, covered[i] ? 1 : 0);
+    }
+    fprintf(fp, "LF:%d\nLH:%d\nend_of_record\n", cnt, hit);
+    fclose(fp);
+    delete [] covered;
+    delete [] funcs;
+    return 0;
+}
+
+/** Line rate of the function is the ratio of its covered bytes */
+const char *GenericCodeCoverage::writeCobertura(const char *filename,
+                                                const char *name) {
+    AttributeType symbols;
+    FunctionType *funcs;
+    unsigned cnt;
+    uint64_t *covered;
+    uint64_t used = 0;
+    uint64_t total = 0;
+    FILE *fp;
+
+    if (!isrc_) {
+        return "Source code service not found";
+    }
+    if ((fp = fopen(filename, "wb")) == 0) {
+        return "Can't open file";
+    }
+    if (name[0] == '\0') {
+        name = getObjName();
+    }
+    cnt = getFunctions(true, &symbols, &funcs);
+    covered = new uint64_t[cnt + 1];
+    RISCV_mutex_lock(&mutexPages_);
+    for (unsigned i = 0; i < cnt; i++) {
+        covered[i] = countCovered(funcs[i].addr, funcs[i].addr + funcs[i].size);
+        used += covered[i];
+        total += funcs[i].size;
+    }
+    RISCV_mutex_unlock(&mutexPages_);
+
+    double rate = total ? static_cast<double>(used) / total : 0;
+    fprintf(fp, "<?xml version=\"1.0\" ?>\n"
+        "<!DOCTYPE coverage SYSTEM "
+        "\"http://cobertura.sourceforge.net/xml/coverage-04.dtd\">\n");
+    fprintf(fp, "<coverage line-rate=\"%.4f\" branch-rate=\"0\" "
+        "lines-covered=\"%" RV_PRI64 "d\" lines-valid=\"%" RV_PRI64 "d\" "
+        "branches-covered=\"0\" branches-valid=\"0\" complexity=\"0\" "
+        "version=\"1\" timestamp=\"%" RV_PRI64 "d\">\n",
+        rate, used, total, static_cast<uint64_t>(time(0)));
+    fprintf(fp, "<sources><source>.</source></sources>\n<packages>\n");
+    fprintf(fp, "<package name=\"");
+    fprintf_xml(fp, name);
+    fprintf(fp, "\" line-rate=\"%.4f\" branch-rate=\"0\" complexity=\"0\">\n"
+                "<classes>\n", rate);
+    for (unsigned i = 0; i < cnt; i++) {
+        const char *fname = symbols[funcs[i].name][Symbol_Name].to_string();
+        double frate = static_cast<double>(covered[i]) / funcs[i].size;
+        fprintf(fp, "<class name=\"");
+        fprintf_xml(fp, fname);
+        fprintf(fp, "\" filename=\"");
+        fprintf_xml(fp, name);
+        fprintf(fp, "\" line-rate=\"%.4f\" branch-rate=\"0\" "
+                    "complexity=\"0\">\n<methods/>\n<lines>"
+                    "<line number=\"%d\" hits=\"%d\"/></lines>\n</class>\n",
+                    frate, i + 1, covered[i] ? 1 : 0);
+    }
+    fprintf(fp, "</classes>\n</package>\n</packages>\n</coverage>\n");
+    fclose(fp);
+    delete [] covered;
+    delete [] funcs;
+    return 0;
 }
 
 }  // namespace debugger
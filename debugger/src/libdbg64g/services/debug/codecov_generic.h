@@ -31,17 +31,23 @@ class CoverageCmdType : public ICommand {
         detailedDescr_.make_string(
             "Description:\n"
             "    This command returns brief or detailed information about\n"
-            "    code usage (coverage) in precentage.\n"
+            "    code usage (coverage) in precentage. Coverage of several\n"
+            "    runs can be saved into binary files and merged.\n"
             "Usage:\n"
             "    1. Read double value with the brief information in precentage:\n"
             "        coverage\n"
-            "    2. Read list with used/unused address ranges:\n"
-            "        coverage ranges\n"
-            "    3. Read list with detailed information and symbol names:\n"
+            "    2. Read list with detailed information and symbol names:\n"
             "        coverage detailed\n"
+            "    3. Save, merge with the current state or clear:\n"
+            "        coverage save|merge <file>\n"
+            "        coverage clear\n"
+            "    4. Export functions coverage:\n"
+            "        coverage lcov|cobertura <file> [name]\n"
             "Example:\n"
             "    coverage\n"
-            "    coverage detailed");
+            "    coverage detailed\n"
+            "    coverage merge run1.cov\n"
+            "    coverage lcov fw.info firmware.elf");
     }
 
     /** ICommand */
@@ -49,38 +55,100 @@ class CoverageCmdType : public ICommand {
     virtual void exec(AttributeType *args, AttributeType *res);
 };
 
+/**
+ * Coverage file: CoverageHeaderType and the array of CoveragePageType
+ * with one bit per covered byte.
+ */
+static const char COVERAGE_MAGIC[8] = {'R', 'V', 'C', 'O', 'V', 'M', 'A', 'P'};
+static const uint32_t COVERAGE_VERSION = 1;
+static const int COVERAGE_PAGE_BITS = 12;
+static const int COVERAGE_PAGE_WORDS = (1 << COVERAGE_PAGE_BITS) / 64;
+
+struct CoverageHeaderType {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_bits;
+    uint64_t page_total;
+};
+
+struct CoveragePageType {
+    uint64_t pn;                // address >> COVERAGE_PAGE_BITS
+    uint64_t bits[COVERAGE_PAGE_WORDS + 1];  // last is the next page spill
+};
 
 class GenericCodeCoverage : public IService,
                             public ICoverageTracker {
  public:
     explicit GenericCodeCoverage(const char *name);
- 
+    virtual ~GenericCodeCoverage();
+
     /** IService interface */
     virtual void postinitService();
     virtual void predeleteService();
 
-    /** ICoverageTracker */
-    virtual void markAddress(uint64_t addr, uint8_t oplen);
+    /**
+     * ICoverageTracker. Instruction bytes are set by one mask split into
+     * two words. The word after the last word of the page is merged into
+     * the next page on read, so that only the page change requires the
+     * lookup.
+     */
+    virtual void markAddress(uint64_t addr, uint8_t oplen) {
+        CoveragePageType *p = lastPage_;
+        if (p->pn != (addr >> COVERAGE_PAGE_BITS)) {
+            p = getPage(addr >> COVERAGE_PAGE_BITS);
+        }
+        uint64_t mask = (1ull << (oplen & 63)) - 1;
+        unsigned bit = static_cast<unsigned>(addr & 63);
+        uint64_t *w = &p->bits[(addr >> 6) & (COVERAGE_PAGE_WORDS - 1)];
+        w[0] |= mask << bit;
+        w[1] |= (mask >> 1) >> (63 - bit);
+    }
 
-    /** Common commands access methods */
+    /** Common commands access methods, return error description or 0 */
     virtual double getCoverage();
     virtual void getCoverageDetailed(AttributeType *resp);
+    const char *save(const char *filename);
+    const char *merge(const char *filename);
+    void clear();
+    const char *writeLcov(const char *filename, const char *name);
+    const char *writeCobertura(const char *filename, const char *name);
 
  protected:
-    uint64_t paged2flat(uint64_t addr);
+    /** Function symbols sorted by address */
+    struct FunctionType {
+        uint64_t addr;
+        uint64_t size;
+        unsigned name;          // index in the symbols list
+    };
+
+    CoveragePageType *getPage(uint64_t pn);
+    CoveragePageType *findPage(uint64_t pn);
+    uint64_t getWord(uint64_t addr);
+    uint64_t countCovered(uint64_t start, uint64_t end);
+    uint64_t nextChange(uint64_t addr, uint64_t end, bool marked);
+    unsigned getFunctions(bool code_only, AttributeType *symbols,
+                          FunctionType **funcs);
 
  protected:
     AttributeType cmdexec_;
     AttributeType src_;
     AttributeType regions_;
-    AttributeType paged_;
 
     ICmdExecutor *iexec_;
     ISourceCode *isrc_;
     CoverageCmdType *pcmd_;
 
     uint64_t track_sz_;
-    uint8_t flash_[128*1024];
+
+    // Pages are never freed while the service exists
+    mutex_def mutexPages_;
+    CoveragePageType emptyPage_;            // no address matches it
+    CoveragePageType * volatile lastPage_;
+    CoveragePageType **pageHash_;           // open addressing by pn
+    unsigned pageHashSize_;
+    CoveragePageType **pages_;              // allocation order
+    unsigned pageCnt_;
+    unsigned pageSize_;
 };
 
 DECLARE_CLASS(GenericCodeCoverage)
@@ -35,7 +35,8 @@ OpenOcdWrapper::OpenOcdWrapper(const char *name)
     cmdRead_(this, static_cast<IJtag *>(this)),
     cmdWrite_(this, static_cast<IJtag *>(this)),
     cmdExit_(this, static_cast<IJtag *>(this)),
-    cmdLog_(this, static_cast<IJtag *>(this)) {
+    cmdLog_(this, static_cast<IJtag *>(this)),
+    cmdLoadElf_(this, static_cast<IJtag *>(this)) {
     registerInterface(static_cast<IJtag *>(this));
     registerAttribute("CmdExecutor", &cmdexec_);
     registerAttribute("PollingMs", &pollingMs_);
@@ -76,6 +77,7 @@ void OpenOcdWrapper::postinitService() {
         icmdexec_->registerCommand(&cmdRead_);
         icmdexec_->registerCommand(&cmdWrite_);
         icmdexec_->registerCommand(&cmdExit_);
+        icmdexec_->registerCommand(&cmdLoadElf_);
     }
 
     // Run openocd as an external process using execv
@@ -105,6 +107,7 @@ void OpenOcdWrapper::predeleteService() {
         icmdexec_->unregisterCommand(&cmdRead_);
         icmdexec_->unregisterCommand(&cmdWrite_);
         icmdexec_->unregisterCommand(&cmdExit_);
+        icmdexec_->unregisterCommand(&cmdLoadElf_);
     }
 }
 
@@ -35,7 +35,7 @@
 #include "../exec/cmd/cmd_write.h"
 #include "../exec/cmd/cmd_exit.h"
 #include "../exec/cmd/cmd_log.h"
-//#include "cmd/cmd_loadelf.h"
+#include "../exec/cmd/cmd_loadelf.h"
 //#include "cmd/cmd_loadh86.h"
 //#include "cmd/cmd_loadsrec.h"
 //#include "cmd/cmd_memdump.h"
@@ -130,6 +130,7 @@ class OpenOcdWrapper : public TcpClient,
     CmdWrite cmdWrite_;
     CmdExit cmdExit_;
     CmdLog cmdLog_;
+    CmdLoadElf cmdLoadElf_;
 
     event_def config_done_;
     event_def eventJtagScanEnd_;
@@ -0,0 +1,558 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "profiler.h"
+#include <stdio.h>
+#include <string>
+#include <algorithm>
+
+namespace debugger {
+
+static uint64_t hash_u64(uint64_t v) {
+    v ^= v >> 33;
+    v *= 0xff51afd7ed558ccdull;
+    v ^= v >> 33;
+    return v;
+}
+
+/** Open addressing map of the 64-bits keys used to build reports */
+class ProfileIndexTable {
+ public:
+    ProfileIndexTable() : size_(0), cnt_(0), keys_(0), vals_(0) {
+        resize(1024);
+    }
+    ~ProfileIndexTable() {
+        delete [] keys_;
+        delete [] vals_;
+    }
+
+    /** @return value or -1 */
+    int get(uint64_t key) {
+        for (uint64_t h = hash_u64(key); ; h++) {
+            int v = vals_[h & (size_ - 1)];
+            if (v < 0 || keys_[h & (size_ - 1)] == key) {
+                return v;
+            }
+        }
+    }
+    void put(uint64_t key, int val) {
+        if (2 * (cnt_ + 1) > size_) {
+            resize(2 * size_);
+        }
+        insert(key, val);
+    }
+
+ private:
+    void insert(uint64_t key, int val) {
+        uint64_t h = hash_u64(key);
+        while (vals_[h & (size_ - 1)] >= 0
+            && keys_[h & (size_ - 1)] != key) {
+            h++;
+        }
+        if (vals_[h & (size_ - 1)] < 0) {
+            cnt_++;
+        }
+        keys_[h & (size_ - 1)] = key;
+        vals_[h & (size_ - 1)] = val;
+    }
+    void resize(unsigned sz) {
+        uint64_t *oldkeys = keys_;
+        int *oldvals = vals_;
+        unsigned oldsz = size_;
+        size_ = sz;
+        cnt_ = 0;
+        keys_ = new uint64_t[size_];
+        vals_ = new int[size_];
+        memset(vals_, 0xff, size_ * sizeof(int));
+        for (unsigned i = 0; i < oldsz; i++) {
+            if (oldvals[i] >= 0) {
+                insert(oldkeys[i], oldvals[i]);
+            }
+        }
+        delete [] oldkeys;
+        delete [] oldvals;
+    }
+
+ private:
+    unsigned size_;
+    unsigned cnt_;
+    uint64_t *keys_;
+    int *vals_;
+};
+
+struct SamplingProfiler::ReportType {
+    ProfileIndexTable addr2func;
+    ProfileIndexTable entry2func;
+    AttributeType names;
+    uint64_t *self;
+    uint64_t *total;
+    uint64_t *stamp;        // last stack sample counted in total
+    int cnt;
+    int size;
+
+    ReportType() : self(0), total(0), stamp(0), cnt(0), size(0) {
+        names.make_list(0);
+    }
+    ~ReportType() {
+        delete [] self;
+        delete [] total;
+        delete [] stamp;
+    }
+    int add(const char *name) {
+        if (cnt == size) {
+            int newsz = size ? 2 * size : 256;
+            uint64_t *t1 = new uint64_t[newsz];
+            uint64_t *t2 = new uint64_t[newsz];
+            uint64_t *t3 = new uint64_t[newsz];
+            memcpy(t1, self, size * sizeof(uint64_t));
+            memcpy(t2, total, size * sizeof(uint64_t));
+            memcpy(t3, stamp, size * sizeof(uint64_t));
+            delete [] self;
+            delete [] total;
+            delete [] stamp;
+            self = t1;
+            total = t2;
+            stamp = t3;
+            size = newsz;
+        }
+        AttributeType t1(name);
+        names.add_to_list(&t1);
+        self[cnt] = 0;
+        total[cnt] = 0;
+        stamp[cnt] = ~0ull;
+        return cnt++;
+    }
+};
+
+int ProfileCmdType::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 1
+        || (args->size() == 2 && (*args)[1].is_string())) {
+        return CMD_VALID;
+    }
+    if ((args->size() == 3 || args->size() == 4)
+        && (*args)[1].is_equal("folded") && (*args)[2].is_string()) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void ProfileCmdType::exec(AttributeType *args, AttributeType *res) {
+    SamplingProfiler *p = static_cast<SamplingProfiler *>(cmdParent_);
+    const char *cpuname = "";
+    int cpuidx;
+    res->attr_free();
+    res->make_nil();
+
+    if (args->size() == 2) {
+        if ((*args)[1].is_equal("start")) {
+            p->setEnable(true);
+            return;
+        } else if ((*args)[1].is_equal("stop")) {
+            p->setEnable(false);
+            return;
+        } else if ((*args)[1].is_equal("clear")) {
+            p->clear();
+            return;
+        }
+        cpuname = (*args)[1].to_string();
+    } else if (args->size() == 4) {
+        cpuname = (*args)[3].to_string();
+    }
+
+    cpuidx = p->getCpuIndex(cpuname);
+    if (cpuidx == -2) {
+        generateError(res, "CPU not found");
+        return;
+    }
+    if (args->size() < 3) {
+        p->getFlatReport(cpuidx, res);
+        return;
+    }
+    int cnt = p->writeFolded(cpuidx, (*args)[2].to_string());
+    if (cnt < 0) {
+        generateError(res, "Can't open file");
+        return;
+    }
+    res->make_int64(cnt);
+}
+
+
+SamplingProfiler::SamplingProfiler(const char *name) : IService(name) {
+    registerInterface(static_cast<IProfiler *>(this));
+    registerAttribute("CmdExecutor", &cmdexec_);
+    registerAttribute("SourceCode", &src_);
+    registerAttribute("Period", &periodAttr_);
+    registerAttribute("HistogramSize", &histogramSize_);
+    registerAttribute("StackSamplesSize", &stackSamplesSize_);
+    registerAttribute("Enable", &enable_);
+
+    periodAttr_.make_uint64(1000);
+    histogramSize_.make_uint64(16384);
+    stackSamplesSize_.make_uint64(4096);
+    enable_.make_boolean(true);
+
+    iexec_ = 0;
+    isrc_ = 0;
+    pcmd_ = 0;
+    period_ = 1;
+    enabled_ = false;
+    histMask_ = 0;
+    stackMask_ = 0;
+    framesSize_ = 0;
+    cpuTotal_ = 0;
+}
+
+SamplingProfiler::~SamplingProfiler() {
+    for (int i = 0; i < cpuTotal_; i++) {
+        delete [] cpus_[i].pcs;
+        delete [] cpus_[i].stacks;
+        delete [] cpus_[i].frames;
+    }
+}
+
+void SamplingProfiler::postinitService() {
+    iexec_ = static_cast<ICmdExecutor *>
+        (RISCV_get_service_iface(cmdexec_.to_string(), IFACE_CMD_EXECUTOR));
+    if (!iexec_) {
+        RISCV_error("Can't get ICmdExecutor interface %s",
+                    cmdexec_.to_string());
+        return;
+    }
+
+    isrc_ = static_cast<ISourceCode *>
+        (RISCV_get_service_iface(src_.to_string(), IFACE_SOURCE_CODE));
+    if (!isrc_) {
+        RISCV_error("Can't get ISourceCode interface %s",
+                    src_.to_string());
+        return;
+    }
+
+    pcmd_ = new ProfileCmdType(static_cast<IService *>(this));
+    iexec_->registerCommand(static_cast<ICommand *>(pcmd_));
+}
+
+void SamplingProfiler::predeleteService() {
+    if (iexec_ && pcmd_) {
+        iexec_->unregisterCommand(static_cast<ICommand *>(pcmd_));
+        delete pcmd_;
+    }
+}
+
+/** Called from the CPU postinit, so attributes are already assigned */
+int SamplingProfiler::registerCpu(const char *name) {
+    if (cpuTotal_ == CPU_MAX) {
+        RISCV_error("Can't register more than %d CPUs", CPU_MAX);
+        return -1;
+    }
+    if (cpuTotal_ == 0) {
+        uint32_t sz = 1;
+        while (sz < histogramSize_.to_uint32()) {
+            sz <<= 1;
+        }
+        histMask_ = sz - 1;
+        sz = 1;
+        while (sz < stackSamplesSize_.to_uint32()) {
+            sz <<= 1;
+        }
+        stackMask_ = sz - 1;
+        framesSize_ = 16 * sz;
+        period_ = periodAttr_.to_uint64();
+        if (period_ == 0) {
+            period_ = 1;
+        }
+        enabled_ = enable_.to_bool();
+    }
+
+    ProfiledCpuType *p = &cpus_[cpuTotal_];
+    p->name.make_string(name);
+    p->pcs = new PcSampleType[histMask_ + 1];
+    p->stacks = new StackSampleType[stackMask_ + 1];
+    p->frames = new uint64_t[framesSize_];
+    clearCpu(p);
+    return cpuTotal_++;
+}
+
+void SamplingProfiler::clearCpu(ProfiledCpuType *p) {
+    memset(p->pcs, 0, (histMask_ + 1) * sizeof(PcSampleType));
+    memset(p->stacks, 0, (stackMask_ + 1) * sizeof(StackSampleType));
+    p->framesUsed = 0;
+    p->samples = 0;
+    p->dropped = 0;
+    p->clearreq = false;
+}
+
+/** Tables are cleared by the CPU thread on the next sample */
+void SamplingProfiler::clear() {
+    for (int i = 0; i < cpuTotal_; i++) {
+        cpus_[i].clearreq = true;
+    }
+}
+
+void SamplingProfiler::sample(int cpuidx, uint64_t pc, const uint64_t *stack,
+                              unsigned depth, uint64_t weight) {
+    if (!enabled_ || cpuidx < 0) {
+        return;
+    }
+    ProfiledCpuType *p = &cpus_[cpuidx];
+    if (p->clearreq) {
+        clearCpu(p);
+    }
+    p->samples += weight;
+    if (!addPc(p, pc, weight) || !addStack(p, pc, stack, depth, weight)) {
+        p->dropped += weight;
+    }
+}
+
+bool SamplingProfiler::addPc(ProfiledCpuType *p, uint64_t pc,
+                             uint64_t weight) {
+    uint64_t h = hash_u64(pc);
+    for (int i = 0; i < PROBE_MAX; i++, h++) {
+        PcSampleType *e = &p->pcs[h & histMask_];
+        if (e->cnt == 0) {
+            e->pc = pc;
+            e->cnt = weight;
+            return true;
+        }
+        if (e->pc == pc) {
+            e->cnt += weight;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Only call sites are stored, callee is defined by the next site or PC */
+bool SamplingProfiler::addStack(ProfiledCpuType *p, uint64_t pc,
+                                const uint64_t *stack, unsigned depth,
+                                uint64_t weight) {
+    uint64_t hash = hash_u64(pc);
+    for (unsigned i = 0; i < depth; i++) {
+        hash = hash_u64(hash ^ stack[2*i]);
+    }
+
+    uint64_t h = hash;
+    for (int i = 0; i < PROBE_MAX; i++, h++) {
+        StackSampleType *e = &p->stacks[h & stackMask_];
+        if (e->cnt == 0) {
+            if (p->framesUsed + depth > framesSize_) {
+                return false;
+            }
+            for (unsigned n = 0; n < depth; n++) {
+                p->frames[p->framesUsed + n] = stack[2*n];
+            }
+            e->hash = hash;
+            e->pc = pc;
+            e->off = p->framesUsed;
+            e->depth = depth;
+            e->cnt = weight;
+            p->framesUsed += depth;
+            return true;
+        }
+        if (e->hash != hash || e->pc != pc || e->depth != depth) {
+            continue;
+        }
+        unsigned n = 0;
+        while (n < depth && p->frames[e->off + n] == stack[2*n]) {
+            n++;
+        }
+        if (n == depth) {
+            e->cnt += weight;
+            return true;
+        }
+    }
+    return false;
+}
+
+int SamplingProfiler::getCpuIndex(const char *name) {
+    if (name[0] == '\0') {
+        return -1;
+    }
+    for (int i = 0; i < cpuTotal_; i++) {
+        if (cpus_[i].name.is_equal(name)) {
+            return i;
+        }
+    }
+    return -2;
+}
+
+/** Address without symbol is shown as a separate function */
+int SamplingProfiler::functionIndex(ReportType *r, uint64_t addr) {
+    int ret = r->addr2func.get(addr);
+    if (ret >= 0) {
+        return ret;
+    }
+    char tstr[32];
+    uint64_t off;
+    uint64_t entry = addr;
+    const char *name = isrc_->addressToName(addr, &off);
+    if (name == 0 || name[0] == '\0') {
+        RISCV_sprintf(tstr, sizeof(tstr), "0x%" RV_PRI64 "x", addr);
+        name = tstr;
+    } else {
+        entry = addr - off;
+    }
+    ret = r->entry2func.get(entry);
+    if (ret < 0) {
+        ret = r->add(name);
+        r->entry2func.put(entry, ret);
+    }
+    r->addr2func.put(addr, ret);
+    return ret;
+}
+
+void SamplingProfiler::getFlatReport(int cpuidx, AttributeType *res) {
+    ReportType r;
+    uint64_t samples = 0;
+    uint64_t dropped = 0;
+    uint64_t sampleid = 0;
+    int idx;
+
+    for (int n = 0; n < cpuTotal_; n++) {
+        if (cpuidx >= 0 && n != cpuidx) {
+            continue;
+        }
+        ProfiledCpuType *p = &cpus_[n];
+        samples += p->samples;
+        dropped += p->dropped;
+        for (uint32_t i = 0; i <= histMask_; i++) {
+            uint64_t cnt = p->pcs[i].cnt;
+            if (cnt == 0 || !isrc_) {
+                continue;
+            }
+            idx = functionIndex(&r, p->pcs[i].pc);
+            r.self[idx] += cnt;
+        }
+        for (uint32_t i = 0; i <= stackMask_; i++) {
+            StackSampleType *e = &p->stacks[i];
+            uint64_t cnt = e->cnt;
+            if (cnt == 0 || !isrc_) {
+                continue;
+            }
+            // Recursive function is counted once per sample
+            sampleid++;
+            for (uint32_t k = 0; k <= e->depth; k++) {
+                idx = functionIndex(&r, k < e->depth ? p->frames[e->off + k]
+                                                     : e->pc);
+                if (r.stamp[idx] != sampleid) {
+                    r.stamp[idx] = sampleid;
+                    r.total[idx] += cnt;
+                }
+            }
+        }
+    }
+
+    int *order = new int[r.cnt + 1];
+    for (int i = 0; i < r.cnt; i++) {
+        order[i] = i;
+    }
+    std::sort(order, order + r.cnt, [&r](int a, int b) {
+        return r.self[a] > r.self[b]
+            || (r.self[a] == r.self[b] && r.total[a] > r.total[b]);
+    });
+
+    res->make_dict();
+    (*res)["samples"].make_uint64(samples);
+    (*res)["dropped"].make_uint64(dropped);
+    AttributeType &funcs = (*res)["functions"];
+    funcs.make_list(r.cnt);
+    for (int i = 0; i < r.cnt; i++) {
+        AttributeType &item = funcs[i];
+        item.make_list(3);
+        item[0u] = r.names[order[i]];
+        item[1].make_uint64(r.self[order[i]]);
+        item[2].make_uint64(r.total[order[i]]);
+    }
+    delete [] order;
+}
+
+/** Equal stacks of different PCs and CPUs are merged */
+int SamplingProfiler::writeFolded(int cpuidx, const char *filename) {
+    ReportType r;
+    ProfileIndexTable line2idx;
+    AttributeType lines;
+    uint64_t *counts = 0;
+    int countsSize = 0;
+    std::string line;
+    FILE *fp;
+
+    if (!isrc_) {
+        return -1;
+    }
+    lines.make_list(0);
+    fp = fopen(filename, "wb");
+    if (!fp) {
+        return -1;
+    }
+    for (int n = 0; n < cpuTotal_; n++) {
+        if (cpuidx >= 0 && n != cpuidx) {
+            continue;
+        }
+        ProfiledCpuType *p = &cpus_[n];
+        for (uint32_t i = 0; i <= stackMask_; i++) {
+            StackSampleType *e = &p->stacks[i];
+            uint64_t cnt = e->cnt;
+            if (cnt == 0) {
+                continue;
+            }
+            uint64_t hash = 0;
+            line.clear();
+            for (uint32_t k = 0; k <= e->depth; k++) {
+                int idx = functionIndex(&r, k < e->depth
+                                        ? p->frames[e->off + k] : e->pc);
+                hash = hash_u64(hash ^ static_cast<uint64_t>(idx));
+                if (k) {
+                    line += ';';
+                }
+                line += r.names[idx].to_string();
+            }
+
+            int lidx;
+            while ((lidx = line2idx.get(hash)) >= 0
+                && strcmp(lines[lidx].to_string(), line.c_str()) != 0) {
+                hash++;     // collision of different stacks
+            }
+            if (lidx < 0) {
+                lidx = static_cast<int>(lines.size());
+                AttributeType t1(line.c_str());
+                lines.add_to_list(&t1);
+                line2idx.put(hash, lidx);
+                if (lidx >= countsSize) {
+                    int newsz = countsSize ? 2 * countsSize : 256;
+                    uint64_t *t2 = new uint64_t[newsz];
+                    memcpy(t2, counts, countsSize * sizeof(uint64_t));
+                    delete [] counts;
+                    counts = t2;
+                    countsSize = newsz;
+                }
+                counts[lidx] = 0;
+            }
+            counts[lidx] += cnt;
+        }
+    }
+
+    for (unsigned i = 0; i < lines.size(); i++) {
+        fprintf(fp, "%s %" RV_PRI64 "d\n", lines[i].to_string(), counts[i]);
+    }
+    fclose(fp);
+    delete [] counts;
+    return static_cast<int>(lines.size());
+}
+
+}  // namespace debugger
@@ -0,0 +1,147 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/icmdexec.h"
+#include "coreservices/isrccode.h"
+#include "coreservices/iprofiler.h"
+
+namespace debugger {
+
+class ProfileCmdType : public ICommand {
+ public:
+    explicit ProfileCmdType(IService *parent) : ICommand(parent, "profile") {
+        briefDescr_.make_string("Sampling profiler reports.");
+        detailedDescr_.make_string(
+            "Description:\n"
+            "    CPU connected to the profiler saves PC and the stack trace\n"
+            "    buffer every 'Period' steps. Flat report contains number of\n"
+            "    samples in the function itself and in the function with\n"
+            "    its callees sorted by the first value. Folded stacks are\n"
+            "    written in the format of flamegraph tools.\n"
+            "Response:\n"
+            "    {'samples':n,'dropped':n,'functions':[['name',self,total],..]}\n"
+            "    Number of written stacks for 'folded'\n"
+            "Usage:\n"
+            "    profile [cpu_name]\n"
+            "    profile folded <file> [cpu_name]\n"
+            "    profile start|stop|clear\n"
+            "Example:\n"
+            "    profile\n"
+            "    profile folded dhry.folded core0");
+    }
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+};
+
+class SamplingProfiler : public IService,
+                         public IProfiler {
+ public:
+    explicit SamplingProfiler(const char *name);
+    virtual ~SamplingProfiler();
+
+    /** IService interface */
+    virtual void postinitService() override;
+    virtual void predeleteService() override;
+
+    /** IProfiler */
+    virtual int registerCpu(const char *name) override;
+    virtual uint64_t getSamplePeriod() override { return period_; }
+    virtual void sample(int cpuidx, uint64_t pc, const uint64_t *stack,
+                        unsigned depth, uint64_t weight) override;
+
+    /** Common methods */
+    void setEnable(bool v) { enabled_ = v; }
+    void clear();
+    /** @return CPU index, -1 for all CPUs or -2 if not found */
+    int getCpuIndex(const char *name);
+    void getFlatReport(int cpuidx, AttributeType *res);
+    /** @return number of written stacks or -1 if file can't be opened */
+    int writeFolded(int cpuidx, const char *filename);
+
+ private:
+    /** PC histogram entry, empty while cnt = 0 */
+    struct PcSampleType {
+        uint64_t pc;
+        volatile uint64_t cnt;
+    };
+
+    /** Unique pair of the call sites sequence and PC */
+    struct StackSampleType {
+        uint64_t hash;
+        uint64_t pc;
+        uint32_t off;           // first call site in frames pool
+        uint32_t depth;
+        volatile uint64_t cnt;
+    };
+
+    /**
+     * Tables are written by the CPU thread only, so that readers need no
+     * locks: the entry becomes visible with the non-zero counter after
+     * its other fields are written.
+     */
+    struct ProfiledCpuType {
+        AttributeType name;
+        PcSampleType *pcs;
+        StackSampleType *stacks;
+        uint64_t *frames;
+        uint32_t framesUsed;
+        volatile uint64_t samples;
+        volatile uint64_t dropped;
+        volatile bool clearreq;
+    };
+
+    /** Symbol table built for one report */
+    struct ReportType;
+
+    void clearCpu(ProfiledCpuType *p);
+    bool addPc(ProfiledCpuType *p, uint64_t pc, uint64_t weight);
+    bool addStack(ProfiledCpuType *p, uint64_t pc, const uint64_t *stack,
+                  unsigned depth, uint64_t weight);
+    int functionIndex(ReportType *r, uint64_t addr);
+
+ private:
+    static const int CPU_MAX = 32;
+    static const int PROBE_MAX = 64;
+
+    AttributeType cmdexec_;
+    AttributeType src_;
+    AttributeType periodAttr_;
+    AttributeType histogramSize_;
+    AttributeType stackSamplesSize_;
+    AttributeType enable_;
+
+    ICmdExecutor *iexec_;
+    ISourceCode *isrc_;
+    ProfileCmdType *pcmd_;
+
+    uint64_t period_;
+    volatile bool enabled_;
+    uint32_t histMask_;
+    uint32_t stackMask_;
+    uint32_t framesSize_;
+    ProfiledCpuType cpus_[CPU_MAX];
+    int cpuTotal_;
+};
+
+DECLARE_CLASS(SamplingProfiler)
+
+}  // namespace debugger
@@ -182,6 +182,7 @@ int ElfReaderService::loadSections() {
             loadsec[LoadSh_size].make_uint64(sh->get_size());
             loadsec[LoadSh_data].make_data(static_cast<unsigned>(sh->get_size()),
                                            &image_[sh->get_offset()]);
+            loadsec[LoadSh_nobits].make_boolean(false);
             loadSectionList_.add_to_list(&loadsec);
             total_bytes += sh->get_size();
         } else if (sh->get_type() == SHT_NOBITS
@@ -205,6 +206,7 @@ int ElfReaderService::loadSections() {
             loadsec[LoadSh_data].make_data(static_cast<unsigned>(sh->get_size()));
             memset(loadsec[LoadSh_data].data(), 
                         0, static_cast<size_t>(sh->get_size()));
+            loadsec[LoadSh_nobits].make_boolean(true);
             loadSectionList_.add_to_list(&loadsec);
             total_bytes += sh->get_size();
         } else if (sh->get_type() == SHT_SYMTAB || sh->get_type() == SHT_DYNSYM) {
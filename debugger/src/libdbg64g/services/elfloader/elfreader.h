@@ -58,6 +58,10 @@ public:
         return loadSectionList_[idx][LoadSh_data].data();
     }
 
+    virtual bool isSectionNoBits(unsigned idx) {
+        return loadSectionList_[idx][LoadSh_nobits].to_bool();
+    }
+
 private:
     int readElfHeader();
     int loadSections();
@@ -69,6 +73,7 @@ private:
         LoadSh_addr,
         LoadSh_size,
         LoadSh_data,
+        LoadSh_nobits,
         LoadSh_Total,
     };
 
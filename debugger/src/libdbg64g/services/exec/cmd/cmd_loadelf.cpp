@@ -17,6 +17,7 @@
 #include "iservice.h"
 #include "cmd_loadelf.h"
 #include "coreservices/ielfreader.h"
+#include "coreservices/icpufunctional.h"
 
 namespace debugger {
 
@@ -29,11 +30,21 @@ CmdLoadElf::CmdLoadElf(IService *parent, IJtag *ijtag)
         "    Load ELF-file to SOC target memory. Optional key 'nocode'\n"
         "    allows to read debug information from the elf-file without\n"
         "    target programming.\n"
+        "    Sections are copied via system bus of the simulated platform\n"
+        "    (backdoor) in parallel threads. Sections that aren't mapped\n"
+        "    on the bus and all sections with the key 'jtag' are written\n"
+        "    via debug interface as on real hardware.\n"
+        "Response:\n"
+        "    {'bytes':n,'sections':n,'jtag':n,'ms':n,'MBps':f}\n"
         "Usage:\n"
-        "    loadelf filename [nocode]\n"
+        "    loadelf filename [nocode|jtag]\n"
         "Example:\n"
         "    loadelf /home/riscv/image.elf\n"
-        "    loadelf /home/riscv/image.elf nocode\n");
+        "    loadelf /home/riscv/image.elf nocode\n"
+        "    loadelf /home/riscv/image.elf jtag\n");
+
+    jobcnt_ = 0;
+    chunkcnt_ = 0;
 }
 
 int CmdLoadElf::isValid(AttributeType *args) {
@@ -41,7 +52,8 @@ int CmdLoadElf::isValid(AttributeType *args) {
         return CMD_INVALID;
     }
     if (args->size() == 2 
-        || (args->size() == 3 && (*args)[2].is_equal("nocode"))) {
+        || (args->size() == 3 && (*args)[2].is_equal("nocode"))
+        || (args->size() == 3 && (*args)[2].is_equal("jtag"))) {
         return CMD_VALID;
     }
     return CMD_WRONG_ARGS;
@@ -51,9 +63,13 @@ void CmdLoadElf::exec(AttributeType *args, AttributeType *res) {
     res->attr_free();
     res->make_nil();
     bool program = true;
-    if (args->size() == 3 
-        && (*args)[2].is_string() && (*args)[2].is_equal("nocode")) {
-        program = false;
+    bool backdoor = true;
+    if (args->size() == 3 && (*args)[2].is_string()) {
+        if ((*args)[2].is_equal("nocode")) {
+            program = false;
+        } else if ((*args)[2].is_equal("jtag")) {
+            backdoor = false;
+        }
     }
 
     /**
@@ -80,17 +96,209 @@ void CmdLoadElf::exec(AttributeType *args, AttributeType *res) {
     dmcontrol.bits.ndmreset = 1;
     ijtag_->write_dmi(IJtag::DMI_DMCONTROL, dmcontrol.u32);
 
-    uint64_t sec_addr;
-    int sec_sz;
+    uint64_t t_start = RISCV_get_time_ms();
+    uint64_t bytes = 0;
+    uint64_t jtag_bytes = 0;
+    int errors = 0;
+    IMemoryOperation *ibus = 0;
+
+    if (backdoor) {
+        ibus = getSystemBus();
+    }
+    jobcnt_ = 0;
+    chunkcnt_ = 0;
     for (unsigned i = 0; i < elf->loadableSectionTotal(); i++) {
-        sec_addr = elf->sectionAddress(i);
-        sec_sz = static_cast<int>(elf->sectionSize(i));
-        ijtag_->write_memory(sec_addr, sec_sz, elf->sectionData(i));
+        uint64_t sec_addr = elf->sectionAddress(i);
+        uint64_t sec_sz = elf->sectionSize(i);
+        uint8_t *sec_data = elf->isSectionNoBits(i) ? 0 : elf->sectionData(i);
+        bytes += sec_sz;
+        RISCV_printf(NULL, 0, "    [%08" RV_PRI64 "x..%08" RV_PRI64 "x] "
+                     "%" RV_PRI64 "d B", sec_addr, sec_addr + sec_sz - 1,
+                     sec_sz);
+        if (ibus == 0) {
+            // Real hardware
+            if (ijtag_->write_memory(sec_addr, static_cast<int>(sec_sz),
+                                     elf->sectionData(i))) {
+                errors++;
+            }
+            jtag_bytes += sec_sz;
+            continue;
+        }
+        // Large section is split so that it is written by several jobs
+        for (uint64_t off = 0; off < sec_sz; off += CHUNK_MAX) {
+            uint64_t sz = sec_sz - off;
+            if (sz > CHUNK_MAX) {
+                sz = CHUNK_MAX;
+            }
+            addChunk(ibus, i, sec_addr + off, sz,
+                     sec_data ? &sec_data[off] : 0);
+        }
+    }
+
+    // Bus splits chunks at device boundaries, chunks run in parallel
+    for (int i = 0; i < jobcnt_; i++) {
+        jobs_[i].thread.func =
+            reinterpret_cast<lib_thread_func>(runLoadJob);
+        jobs_[i].thread.args = &jobs_[i];
+        RISCV_thread_create(&jobs_[i].thread);
+    }
+    for (int i = 0; i < jobcnt_; i++) {
+        RISCV_thread_join(jobs_[i].thread.Handle, 600000);
+    }
+    for (int i = 0; i < jobcnt_; i++) {
+        for (ChunkType *chunk = jobs_[i].first; chunk; chunk = chunk->next) {
+            if (!chunk->failed) {
+                continue;
+            }
+            // Memory without simulated model
+            uint64_t off = chunk->addr - elf->sectionAddress(chunk->secidx);
+            if (ijtag_->write_memory(chunk->addr,
+                                     static_cast<int>(chunk->size),
+                                     &elf->sectionData(chunk->secidx)[off])) {
+                errors++;
+            }
+            jtag_bytes += chunk->size;
+        }
     }
+    freeJobs();
 
-    //soft_reset = 0;
-    //tap_->write(addr, 8, reinterpret_cast<uint8_t *>(&soft_reset));
+    if (bytes != jtag_bytes) {
+        // Drop instructions decoded before the backdoor write
+        AttributeType lstCpu;
+        RISCV_get_services_with_iface(IFACE_CPU_FUNCTIONAL, &lstCpu);
+        for (unsigned i = 0; i < lstCpu.size(); i++) {
+            IService *icpuserv = static_cast<IService *>(lstCpu[i].to_iface());
+            ICpuFunctional *icpu = static_cast<ICpuFunctional *>(
+                        icpuserv->getInterface(IFACE_CPU_FUNCTIONAL));
+            icpu->flush(~0ull);
+        }
+    }
+
+    uint64_t ms = RISCV_get_time_ms() - t_start;
+    double mbps = 0;
+    if (ms) {
+        mbps = static_cast<double>(bytes) / 1000.0 / static_cast<double>(ms);
+    }
+    RISCV_printf(NULL, 0, "Loaded %" RV_PRI64 "d B (%" RV_PRI64 "d B via JTAG)"
+                 " in %" RV_PRI64 "d ms, %.1f MB/s",
+                 bytes, jtag_bytes, ms, mbps);
+    if (errors) {
+        generateError(res, "Can't write some sections");
+        return;
+    }
+    res->make_dict();
+    (*res)["bytes"].make_uint64(bytes);
+    (*res)["sections"].make_uint64(elf->loadableSectionTotal());
+    (*res)["jtag"].make_uint64(jtag_bytes);
+    (*res)["ms"].make_uint64(ms);
+    (*res)["MBps"].make_floating(mbps);
 }
 
+/** System bus of the simulated platform or 0 for real hardware */
+IMemoryOperation *CmdLoadElf::getSystemBus() {
+    AttributeType lstCpu;
+    RISCV_get_services_with_iface(IFACE_CPU_FUNCTIONAL, &lstCpu);
+    for (unsigned i = 0; i < lstCpu.size(); i++) {
+        IService *icpuserv = static_cast<IService *>(lstCpu[i].to_iface());
+        AttributeType *sysbus = static_cast<AttributeType *>(
+                        icpuserv->getAttribute("SysBus"));
+        if (sysbus == 0 || !sysbus->is_string()) {
+            continue;
+        }
+        IMemoryOperation *ibus = static_cast<IMemoryOperation *>(
+            RISCV_get_service_iface(sysbus->to_string(),
+                                    IFACE_MEMORY_OPERATION));
+        if (ibus) {
+            return ibus;
+        }
+    }
+    return 0;
+}
+
+void CmdLoadElf::addChunk(IMemoryOperation *ibus, unsigned secidx,
+                          uint64_t addr, uint64_t size, uint8_t *data) {
+    LoadJobType *job;
+    if (jobcnt_ < JOBS_MAX) {
+        job = &jobs_[jobcnt_++];
+        job->ibus = ibus;
+        job->first = 0;
+        job->last = 0;
+        job->bytes = 0;
+    } else {
+        job = &jobs_[chunkcnt_ % JOBS_MAX];
+    }
+    chunkcnt_++;
+    ChunkType *chunk = new ChunkType;
+    chunk->next = 0;
+    chunk->secidx = secidx;
+    chunk->addr = addr;
+    chunk->size = size;
+    chunk->data = data;
+    chunk->failed = false;
+    if (job->last) {
+        job->last->next = chunk;
+    } else {
+        job->first = chunk;
+    }
+    job->last = chunk;
+}
+
+void CmdLoadElf::freeJobs() {
+    for (int i = 0; i < jobcnt_; i++) {
+        ChunkType *chunk = jobs_[i].first;
+        while (chunk) {
+            ChunkType *next = chunk->next;
+            delete chunk;
+            chunk = next;
+        }
+    }
+    jobcnt_ = 0;
+    chunkcnt_ = 0;
+}
+
+thread_return_t CmdLoadElf::runLoadJob(void *arg) {
+    LoadJobType *job = reinterpret_cast<LoadJobType *>(arg);
+    static const int ZERO_BLOCK = 1 << 16;
+    uint8_t *zero = 0;
+    BulkTransactionType tr;
+    BulkBufferType buf;
+    tr.action = MemAction_Write;
+    tr.bufcnt = 1;
+    tr.buf = &buf;
+    tr.source_idx = 0;
+    for (ChunkType *chunk = job->first; chunk; chunk = chunk->next) {
+        uint64_t off = 0;
+        while (off < chunk->size) {
+            tr.addr = chunk->addr + off;
+            buf.size = chunk->size - off;
+            if (chunk->data) {
+                buf.ptr = &chunk->data[off];
+            } else {
+                if (zero == 0) {
+                    zero = new uint8_t[ZERO_BLOCK];
+                    memset(zero, 0, ZERO_BLOCK);
+                }
+                if (buf.size > ZERO_BLOCK) {
+                    buf.size = ZERO_BLOCK;
+                }
+                buf.ptr = zero;
+            }
+            if (job->ibus->bulk_transport(&tr) == TRANS_ERROR
+                || tr.response == MemResp_Error) {
+                chunk->failed = true;
+                break;
+            }
+            off += buf.size;
+        }
+        if (chunk->failed) {
+            continue;
+        }
+        job->bytes += chunk->size;
+    }
+    if (zero) {
+        delete [] zero;
+    }
+    return 0;
+}
 
 }  // namespace debugger
@@ -28,6 +28,39 @@ class CmdLoadElf : public ICommandRiscv {
     /** ICommand */
     virtual int isValid(AttributeType *args);
     virtual void exec(AttributeType *args, AttributeType *res);
+
+ protected:
+    /** Part of loadable section written via system bus */
+    struct ChunkType {
+        ChunkType *next;
+        unsigned secidx;
+        uint64_t addr;
+        uint64_t size;
+        uint8_t *data;          // 0 for not initialized data (zero-fill)
+        bool failed;            // not mapped on the bus, write via JTAG
+    };
+
+    /** Sections are distributed between jobs running in parallel */
+    struct LoadJobType {
+        IMemoryOperation *ibus;
+        ChunkType *first;
+        ChunkType *last;
+        LibThreadType thread;
+        uint64_t bytes;
+    };
+
+    IMemoryOperation *getSystemBus();
+    void addChunk(IMemoryOperation *ibus, unsigned secidx, uint64_t addr,
+                  uint64_t size, uint8_t *data);
+    void freeJobs();
+    static thread_return_t runLoadJob(void *arg);
+
+ protected:
+    static const int JOBS_MAX = 8;
+    static const uint64_t CHUNK_MAX = 1 << 20;     // bytes
+    LoadJobType jobs_[JOBS_MAX];
+    int jobcnt_;
+    int chunkcnt_;
 };
 
 }  // namespace debugger
@@ -48,5 +48,14 @@ ETransStatus MemoryLUT::b_transport(Axi4TransactionType *trans) {
     return itarget_->b_transport(trans);
 }
 
+ETransStatus MemoryLUT::bulk_transport(BulkTransactionType *trans) {
+    if (!itarget_) {
+        return TRANS_ERROR;
+    }
+    uint64_t off = trans->addr - getBaseAddress();
+    trans->addr = memOffset_.to_uint64() + off;
+    return itarget_->bulk_transport(trans);
+}
+
 }  // namespace debugger
 
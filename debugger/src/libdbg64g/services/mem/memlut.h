@@ -33,6 +33,7 @@ class MemoryLUT : public IService,
 
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
+    virtual ETransStatus bulk_transport(BulkTransactionType *trans);
 
  private:
     AttributeType memTarget_;
@@ -0,0 +1,1193 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "tcpsrv_gdb.h"
+#include <riscv-isa.h>
+#include "coreservices/icpuriscv.h"
+#include "coreservices/imemop.h"
+
+namespace debugger {
+
+/** RV64 general registers and pc in gdb numbering: x0..x31, pc */
+static const int GDB_REG_PC = 32;
+static const int GDB_REG_GPR_TOTAL = 33;
+static const int GDB_REG_FPR0 = 33;
+static const int GDB_REG_CSR0 = 65;
+
+static const char *const GDB_TARGET_XML =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\">"
+    "<architecture>riscv:rv64</architecture>"
+    "<feature name=\"org.gnu.gdb.riscv.cpu\">"
+    "<reg name=\"zero\" bitsize=\"64\" type=\"int\" regnum=\"0\"/>"
+    "<reg name=\"ra\" bitsize=\"64\" type=\"code_ptr\"/>"
+    "<reg name=\"sp\" bitsize=\"64\" type=\"data_ptr\"/>"
+    "<reg name=\"gp\" bitsize=\"64\" type=\"data_ptr\"/>"
+    "<reg name=\"tp\" bitsize=\"64\" type=\"data_ptr\"/>"
+    "<reg name=\"t0\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t1\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t2\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"fp\" bitsize=\"64\" type=\"data_ptr\"/>"
+    "<reg name=\"s1\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a0\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a1\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a2\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a3\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a4\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a5\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a6\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"a7\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s2\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s3\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s4\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s5\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s6\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s7\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s8\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s9\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s10\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"s11\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t3\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t4\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t5\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"t6\" bitsize=\"64\" type=\"int\"/>"
+    "<reg name=\"pc\" bitsize=\"64\" type=\"code_ptr\"/>"
+    "</feature>"
+    "</target>";
+
+static int hex2int(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static const char *parseHex(const char *s, uint64_t *val) {
+    int v;
+    *val = 0;
+    while ((v = hex2int(*s)) >= 0) {
+        *val = (*val << 4) | static_cast<uint64_t>(v);
+        s++;
+    }
+    return s;
+}
+
+/** Little-endian register value as gdb expects in 'g'/'p' packets */
+static int reg2hex(char *s, uint64_t val) {
+    for (int i = 0; i < 8; i++) {
+        RISCV_sprintf(&s[2*i], 3, "%02x",
+                      static_cast<unsigned>((val >> (8*i)) & 0xFF));
+    }
+    return 16;
+}
+
+static uint64_t hex2reg(const char *s) {
+    uint64_t ret = 0;
+    for (int i = 0; i < 8; i++) {
+        int hi = hex2int(s[2*i]);
+        int lo = hex2int(s[2*i + 1]);
+        if (hi < 0 || lo < 0) {
+            break;
+        }
+        ret |= static_cast<uint64_t>((hi << 4) | lo) << (8*i);
+    }
+    return ret;
+}
+
+TcpServerGdb::TcpServerGdb(const char *name) : TcpServer(name) {
+    registerAttribute("HartList", &hartList_);
+    registerAttribute("CmdExecutor", &cmdexec_);
+    hartcnt_ = 0;
+    icmdexec_ = 0;
+    memset(harts_, 0, sizeof(harts_));
+}
+
+void TcpServerGdb::postinitService() {
+    for (unsigned i = 0; i < hartList_.size(); i++) {
+        const char *hartname = hartList_[i].to_string();
+        if (hartcnt_ >= HARTS_MAX) {
+            RISCV_error("Too many harts, %s ignored", hartname);
+            continue;
+        }
+        HartType *p = &harts_[hartcnt_];
+        p->name = hartname;
+        p->idport = static_cast<IDPort *>(
+            RISCV_get_service_iface(hartname, IFACE_DPORT));
+        p->icpu = static_cast<ICpuFunctional *>(
+            RISCV_get_service_iface(hartname, IFACE_CPU_FUNCTIONAL));
+        if (!p->idport || !p->icpu) {
+            RISCV_error("Can't get IDPort/ICpuFunctional of %s", hartname);
+            continue;
+        }
+        hartcnt_++;
+    }
+
+    if (cmdexec_.size()) {
+        icmdexec_ = static_cast<ICmdExecutor *>(
+            RISCV_get_service_iface(cmdexec_.to_string(),
+                                    IFACE_CMD_EXECUTOR));
+    }
+    TcpServer::postinitService();
+}
+
+IThread *TcpServerGdb::createClientThread(const char *name, socket_def skt) {
+    ClientThread *thrd = new ClientThread(this,
+                                          name,
+                                          skt,
+                                          recvTimeout_.to_int());
+    thrd->run();
+    return thrd;
+}
+
+
+TcpServerGdb::ClientThread::ClientThread(TcpServerGdb *parent,
+                                         const char *name,
+                                         socket_def skt,
+                                         int recvTimeout)
+    : TcpServer::ClientThreadGeneric(parent, name, skt, recvTimeout) {
+    p_ = parent;
+    harts_ = parent->harts_;
+    hartcnt_ = parent->hartcnt_;
+    gidx_ = 0;
+    cidx_ = -1;
+    ackMode_ = true;
+    running_ = false;
+    lastStop_ = 0;
+    estate_ = Packet_Idle;
+    pktcnt_ = 0;
+    pktcrc_ = 0;
+    lastpktcnt_ = 0;
+    swbreakcnt_ = 0;
+    hwbreakcnt_ = 0;
+}
+
+/** All-stop mode: gdb expects halted target after connection */
+void TcpServerGdb::ClientThread::afterThreadStarted() {
+    haltHarts();
+    for (int i = 0; i < hartcnt_; i++) {
+        harts_[i].idport->dportReadReg(ICpuRiscV::CSR_dcsr, &harts_[i].dcsr);
+    }
+}
+
+void TcpServerGdb::ClientThread::beforeThreadClosing() {
+    removeAllBreaks();
+}
+
+/**
+ * Generic receive loop plus polling of the running harts so that the stop
+ * reply is sent without waiting for the next packet from gdb.
+ */
+void TcpServerGdb::ClientThread::busyLoop() {
+    int rxbytes;
+    afterThreadStarted();
+
+    while (isEnabled()) {
+        rxbytes = recv(hsock_, rxbuf_, sizeof(rxbuf_) - 1, 0);
+        if (rxbytes == 0) {
+            break;
+        } else if (rxbytes > 0) {
+            rxbuf_[rxbytes] = 0;
+            if (processRxBuffer(rxbuf_, rxbytes) < 0) {
+                sendData();
+                break;
+            }
+        }
+        if (running_) {
+            checkStopped();
+        }
+        if (sendData() < 0) {
+            break;
+        }
+    }
+    stop();
+
+    beforeThreadClosing();
+    closeSocket();
+}
+
+int TcpServerGdb::ClientThread::processRxBuffer(const char *cmdbuf,
+                                                int bufsz) {
+    int ret = 0;
+    int crc;
+    for (int i = 0; i < bufsz && ret == 0; i++) {
+        char c = cmdbuf[i];
+        switch (estate_) {
+        case Packet_Idle:
+            if (c == '$') {
+                estate_ = Packet_Data;
+                pktcnt_ = 0;
+                pktcrc_ = 0;
+            } else if (c == '\x03') {
+                // Interrupt request
+                if (running_) {
+                    haltHarts();
+                    running_ = false;
+                    sendStopReply(cidx_ < 0 ? gidx_ : cidx_, 2);
+                }
+            } else if (c == '-' && ackMode_ && lastpktcnt_) {
+                writeTxBuffer(lastpkt_, lastpktcnt_);
+            }
+            // '+' acknowledges the last response, nothing to do
+            break;
+        case Packet_Data:
+            if (c == '#') {
+                estate_ = Packet_Crc1;
+            } else if (pktcnt_ < PACKET_SIZE) {
+                pkt_[pktcnt_++] = c;
+                pktcrc_ += static_cast<uint8_t>(c);
+            } else {
+                RISCV_error("Packet size exceeds %d bytes", PACKET_SIZE);
+                estate_ = Packet_Idle;
+            }
+            break;
+        case Packet_Crc1:
+            crc = hex2int(c) << 4;
+            pkt_[pktcnt_] = static_cast<char>(crc);
+            estate_ = Packet_Crc2;
+            break;
+        default:
+            crc = static_cast<uint8_t>(pkt_[pktcnt_]) | hex2int(c);
+            estate_ = Packet_Idle;
+            if (ackMode_ && crc != pktcrc_) {
+                RISCV_info("Wrong checksum %02x != %02x", crc, pktcrc_);
+                writeTxBuffer("-", 1);
+                break;
+            }
+            if (ackMode_) {
+                writeTxBuffer("+", 1);
+            }
+            pkt_[pktcnt_] = '\0';
+            ret = handlePacket(pkt_, pktcnt_);
+        }
+    }
+    return ret;
+}
+
+int TcpServerGdb::ClientThread::handlePacket(char *data, int sz) {
+    if (running_ && data[0] != 'v') {
+        RISCV_info("Packet '%c' ignored while running", data[0]);
+        return 0;
+    }
+    RISCV_debug("<= %s", data);
+    switch (data[0]) {
+    case '?':
+        sendStopReply(lastStop_, 5);
+        break;
+    case 'c':
+    case 's':
+        // Legacy resume of the 'Hc' thread, 'c' resumes all harts
+        for (int i = 0; i < hartcnt_; i++) {
+            harts_[i].running = data[0] == 'c'
+                || i == (cidx_ < 0 ? gidx_ : cidx_);
+            harts_[i].stepping = harts_[i].running && data[0] == 's';
+        }
+        if (data[1]) {
+            uint64_t addr;
+            parseHex(&data[1], &addr);
+            harts_[cidx_ < 0 ? gidx_ : cidx_].icpu->setNPC(addr);
+        }
+        resumeHarts();
+        break;
+    case 'D':
+        removeAllBreaks();
+        for (int i = 0; i < hartcnt_; i++) {
+            harts_[i].running = true;
+            harts_[i].stepping = false;
+        }
+        resumeHarts();
+        running_ = false;
+        sendPacket("OK");
+        return -1;
+    case 'g':
+        handleReadRegisters();
+        break;
+    case 'G':
+        handleWriteRegisters(&data[1]);
+        break;
+    case 'H':
+        if (hartIndex(&data[2]) < -1) {
+            sendPacket("E01");
+        } else if (data[1] == 'g') {
+            gidx_ = hartIndex(&data[2]);
+            if (gidx_ < 0) {
+                gidx_ = 0;
+            }
+            sendPacket("OK");
+        } else {
+            cidx_ = hartIndex(&data[2]);
+            sendPacket("OK");
+        }
+        break;
+    case 'k':
+        removeAllBreaks();
+        return -1;
+    case 'm':
+        handleReadMemory(&data[1]);
+        break;
+    case 'M':
+        handleWriteMemory(&data[1], sz - 1, false);
+        break;
+    case 'X':
+        handleWriteMemory(&data[1], sz - 1, true);
+        break;
+    case 'p':
+        handleReadRegister(&data[1]);
+        break;
+    case 'P':
+        handleWriteRegister(&data[1]);
+        break;
+    case 'q':
+        handleQuery(data);
+        break;
+    case 'Q':
+        if (strcmp(data, "QStartNoAckMode") == 0) {
+            sendPacket("OK");
+            ackMode_ = false;
+        } else {
+            sendPacket("");
+        }
+        break;
+    case 'T':
+        sendPacket(hartIndex(&data[1]) >= 0 ? "OK" : "E01");
+        break;
+    case 'v':
+        if (strncmp(data, "vCont?", 6) == 0) {
+            sendPacket("vCont;c;C;s;S;t");
+        } else if (strncmp(data, "vCont;", 6) == 0) {
+            handleVCont(&data[6]);
+        } else if (strncmp(data, "vCtrlC", 6) == 0) {
+            haltHarts();
+            running_ = false;
+            sendPacket("OK");
+        } else {
+            sendPacket("");
+        }
+        break;
+    case 'z':
+    case 'Z':
+        handleBreakpoint(data);
+        break;
+    default:
+        sendPacket("");
+    }
+    return 0;
+}
+
+void TcpServerGdb::ClientThread::handleQuery(const char *data) {
+    char tstr[256];
+    int tsz;
+    if (strncmp(data, "qSupported", 10) == 0) {
+        RISCV_sprintf(tstr, sizeof(tstr),
+            "PacketSize=%x;QStartNoAckMode+;vContSupported+;"
+            "qXfer:features:read+;qXfer:memory-map:read+",
+            PACKET_SIZE);
+        sendPacket(tstr);
+    } else if (strncmp(data, "qXfer:", 6) == 0) {
+        handleXfer(&data[6]);
+    } else if (strcmp(data, "qAttached") == 0) {
+        sendPacket("1");
+    } else if (strcmp(data, "qC") == 0) {
+        RISCV_sprintf(tstr, sizeof(tstr), "QC%x", gidx_ + 1);
+        sendPacket(tstr);
+    } else if (strcmp(data, "qfThreadInfo") == 0) {
+        tsz = RISCV_sprintf(tstr, sizeof(tstr), "%s", "m");
+        for (int i = 0; i < hartcnt_ && tsz < 240; i++) {
+            tsz += RISCV_sprintf(&tstr[tsz], sizeof(tstr) - tsz,
+                                 i ? ",%x" : "%x", i + 1);
+        }
+        sendPacket(tstr);
+    } else if (strcmp(data, "qsThreadInfo") == 0) {
+        sendPacket("l");
+    } else if (strncmp(data, "qThreadExtraInfo,", 17) == 0) {
+        int idx = hartIndex(&data[17]);
+        if (idx < 0) {
+            sendPacket("E01");
+            return;
+        }
+        char info[64];
+        RISCV_sprintf(info, sizeof(info), "%s %s", harts_[idx].name,
+                      harts_[idx].idport->isHalted() ? "halted" : "running");
+        tsz = 0;
+        for (int i = 0; info[i] && tsz < 200; i++) {
+            tsz += RISCV_sprintf(&tstr[tsz], sizeof(tstr) - tsz, "%02x",
+                                 static_cast<uint8_t>(info[i]));
+        }
+        sendPacket(tstr);
+    } else if (strncmp(data, "qRcmd,", 6) == 0 && p_->icmdexec_) {
+        // 'monitor' command redirected into the debugger console
+        const char *hex = &data[6];
+        int i = 0;
+        while (hex[2*i] && hex[2*i + 1] && i < 255) {
+            tstr[i] = static_cast<char>(
+                (hex2int(hex[2*i]) << 4) | hex2int(hex[2*i + 1]));
+            i++;
+        }
+        tstr[i] = '\0';
+        AttributeType res;
+        p_->icmdexec_->exec(tstr, &res, false);
+        res.to_config();
+        tsz = 0;
+        for (unsigned n = 0; n < res.size() && tsz < 2*PACKET_SIZE - 4; n++) {
+            tsz += RISCV_sprintf(&resp_[tsz], sizeof(resp_) - tsz, "%02x",
+                                 static_cast<uint8_t>(res.to_string()[n]));
+        }
+        tsz += RISCV_sprintf(&resp_[tsz], sizeof(resp_) - tsz, "%02x", '\n');
+        sendPacket(resp_, tsz);
+    } else if (strncmp(data, "qSymbol:", 8) == 0) {
+        sendPacket("OK");
+    } else {
+        sendPacket("");
+    }
+}
+
+/**
+ * Memory map is built from the devices implementing IMemoryOperation.
+ * gdb rejects overlapped regions so that overlays are merged into one.
+ */
+void TcpServerGdb::ClientThread::handleXfer(const char *data) {
+    if (strncmp(data, "features:read:target.xml:", 25) == 0) {
+        sendXfer(GDB_TARGET_XML, static_cast<int>(strlen(GDB_TARGET_XML)),
+                 &data[25]);
+        return;
+    }
+    if (strncmp(data, "memory-map:read::", 17) != 0) {
+        sendPacket("");
+        return;
+    }
+
+    static const int REGIONS_MAX = 64;
+    uint64_t start[REGIONS_MAX];
+    uint64_t end[REGIONS_MAX];
+    int total = 0;
+    AttributeType memList;
+    RISCV_get_services_with_iface(IFACE_MEMORY_OPERATION, &memList);
+    for (unsigned i = 0; i < memList.size(); i++) {
+        IService *iserv = static_cast<IService *>(memList[i].to_iface());
+        IMemoryOperation *imem = static_cast<IMemoryOperation *>(
+                        iserv->getInterface(IFACE_MEMORY_OPERATION));
+        uint64_t b = imem->getBaseAddress();
+        uint64_t e = b + imem->getLength();
+        if (imem->getLength() == 0 || e < b) {
+            continue;
+        }
+        // Insertion with merging of overlapped and adjacent ranges
+        int n = 0;
+        while (n < total && end[n] < b) {
+            n++;
+        }
+        if (n < total && start[n] <= e) {
+            if (b < start[n]) {
+                start[n] = b;
+            }
+            if (e > end[n]) {
+                end[n] = e;
+            }
+            while (n + 1 < total && start[n + 1] <= end[n]) {
+                if (end[n + 1] > end[n]) {
+                    end[n] = end[n + 1];
+                }
+                for (int k = n + 1; k < total - 1; k++) {
+                    start[k] = start[k + 1];
+                    end[k] = end[k + 1];
+                }
+                total--;
+            }
+        } else if (total < REGIONS_MAX) {
+            for (int k = total; k > n; k--) {
+                start[k] = start[k - 1];
+                end[k] = end[k - 1];
+            }
+            start[n] = b;
+            end[n] = e;
+            total++;
+        }
+    }
+
+    char xml[REGIONS_MAX * 80 + 128];
+    int xmlsz = RISCV_sprintf(xml, sizeof(xml), "%s",
+        "<?xml version=\"1.0\"?>"
+        "<!DOCTYPE memory-map PUBLIC \"+//IDN gnu.org//DTD GDB Memory Map V1.0//EN\""
+        " \"http://sourceware.org/gdb/gdb-memory-map.dtd\">"
+        "<memory-map>");
+    for (int i = 0; i < total; i++) {
+        xmlsz += RISCV_sprintf(&xml[xmlsz], sizeof(xml) - xmlsz,
+            "<memory type=\"ram\" start=\"0x%" RV_PRI64 "x\" "
+            "length=\"0x%" RV_PRI64 "x\"/>",
+            start[i], end[i] - start[i]);
+    }
+    xmlsz += RISCV_sprintf(&xml[xmlsz], sizeof(xml) - xmlsz, "%s",
+                           "</memory-map>");
+    sendXfer(xml, xmlsz, &data[17]);
+}
+
+/** Reply on 'offset,length' request with binary escaped document part */
+void TcpServerGdb::ClientThread::sendXfer(const char *doc, int docsz,
+                                          const char *args) {
+    uint64_t off, len;
+    const char *s = parseHex(args, &off);
+    if (*s != ',') {
+        sendPacket("E01");
+        return;
+    }
+    parseHex(s + 1, &len);
+    if (off >= static_cast<uint64_t>(docsz)) {
+        sendPacket("l");
+        return;
+    }
+    if (len > PACKET_SIZE - 16) {
+        len = PACKET_SIZE - 16;
+    }
+    int tsz = 1;
+    uint64_t i;
+    resp_[0] = (off + len) >= static_cast<uint64_t>(docsz) ? 'l' : 'm';
+    for (i = off; i < off + len && i < static_cast<uint64_t>(docsz); i++) {
+        char c = doc[i];
+        if (c == '#' || c == '$' || c == '}' || c == '*') {
+            resp_[tsz++] = '}';
+            c ^= 0x20;
+        }
+        resp_[tsz++] = c;
+    }
+    sendPacket(resp_, tsz);
+}
+
+/**
+ * vCont;action[:thread-id]... The leftmost action matching a hart is
+ * applied. Harts without action stay halted.
+ */
+void TcpServerGdb::ClientThread::handleVCont(const char *data) {
+    bool assigned[HARTS_MAX] = {false};
+    for (int i = 0; i < hartcnt_; i++) {
+        harts_[i].running = false;
+        harts_[i].stepping = false;
+    }
+
+    const char *s = data;
+    while (*s) {
+        char action = *s++;
+        if (action == 'C' || action == 'S') {
+            uint64_t sig;
+            s = parseHex(s, &sig);        // signals aren't supported
+        }
+        int idx = -1;
+        if (*s == ':') {
+            idx = hartIndex(s + 1);
+            s++;
+            while (*s && *s != ';') {
+                s++;
+            }
+        }
+        for (int i = 0; i < hartcnt_; i++) {
+            if (assigned[i] || (idx >= 0 && idx != i)) {
+                continue;
+            }
+            assigned[i] = true;
+            if (action == 'c' || action == 'C') {
+                harts_[i].running = true;
+            } else if (action == 's' || action == 'S') {
+                harts_[i].running = true;
+                harts_[i].stepping = true;
+            }
+        }
+        if (*s == ';') {
+            s++;
+        }
+    }
+    resumeHarts();
+}
+
+void TcpServerGdb::ClientThread::handleBreakpoint(const char *data) {
+    uint64_t type, addr, kind;
+    const char *s = parseHex(&data[1], &type);
+    if (*s != ',') {
+        sendPacket("E01");
+        return;
+    }
+    s = parseHex(s + 1, &addr);
+    if (*s != ',') {
+        sendPacket("E01");
+        return;
+    }
+    parseHex(s + 1, &kind);
+
+    int err;
+    if (type == 0) {
+        if (data[0] == 'Z') {
+            err = insertSwBreak(addr, static_cast<int>(kind));
+        } else {
+            err = removeSwBreak(addr);
+        }
+    } else if (type <= 4) {
+        if (data[0] == 'Z') {
+            err = insertTrigger(static_cast<int>(type), addr, kind);
+        } else {
+            err = removeTrigger(static_cast<int>(type), addr, kind);
+        }
+    } else {
+        sendPacket("");
+        return;
+    }
+    sendPacket(err ? "E01" : "OK");
+}
+
+void TcpServerGdb::ClientThread::handleReadMemory(const char *data) {
+    uint64_t addr, len;
+    const char *s = parseHex(data, &addr);
+    if (*s != ',') {
+        sendPacket("E01");
+        return;
+    }
+    parseHex(s + 1, &len);
+    if (len > PACKET_SIZE / 2) {
+        len = PACKET_SIZE / 2;
+    }
+    uint8_t buf[PACKET_SIZE / 2];
+    int rdcnt = readMem(addr, buf, static_cast<int>(len));
+    if (rdcnt == 0 && len) {
+        sendPacket("E01");
+        return;
+    }
+    for (int i = 0; i < rdcnt; i++) {
+        RISCV_sprintf(&resp_[2*i], 3, "%02x", buf[i]);
+    }
+    sendPacket(resp_, 2*rdcnt);
+}
+
+/** 'M addr,len:hex' or 'X addr,len:binary' */
+void TcpServerGdb::ClientThread::handleWriteMemory(char *data, int sz,
+                                                   bool binary) {
+    uint64_t addr, len;
+    const char *s = parseHex(data, &addr);
+    if (*s != ',') {
+        sendPacket("E01");
+        return;
+    }
+    s = parseHex(s + 1, &len);
+    if (*s != ':' || len > PACKET_SIZE) {
+        sendPacket("E01");
+        return;
+    }
+    s++;
+
+    // Decode in place: result is never longer than the encoded data
+    uint8_t *buf = reinterpret_cast<uint8_t *>(data);
+    const char *end = &data[sz];
+    uint64_t cnt = 0;
+    while (s < end && cnt < len) {
+        if (binary) {
+            if (*s == '}' && s + 1 < end) {
+                buf[cnt++] = static_cast<uint8_t>(s[1] ^ 0x20);
+                s += 2;
+            } else {
+                buf[cnt++] = static_cast<uint8_t>(*s++);
+            }
+        } else if (s + 1 < end) {
+            buf[cnt++] = static_cast<uint8_t>(
+                (hex2int(s[0]) << 4) | hex2int(s[1]));
+            s += 2;
+        } else {
+            break;
+        }
+    }
+    if (cnt != len) {
+        sendPacket("E01");
+        return;
+    }
+    if (len == 0) {
+        sendPacket("OK");       // 'X' probing packet
+        return;
+    }
+    int wrcnt = writeMem(addr, buf, static_cast<int>(len));
+    sendPacket(wrcnt == static_cast<int>(len) ? "OK" : "E01");
+}
+
+void TcpServerGdb::ClientThread::handleReadRegisters() {
+    uint64_t val;
+    int tsz = 0;
+    for (int i = 0; i < GDB_REG_GPR_TOTAL; i++) {
+        if (!readReg(gidx_, i, &val)) {
+            val = 0;
+        }
+        tsz += reg2hex(&resp_[tsz], val);
+    }
+    sendPacket(resp_, tsz);
+}
+
+void TcpServerGdb::ClientThread::handleWriteRegisters(const char *data) {
+    int len = static_cast<int>(strlen(data));
+    for (int i = 0; i < GDB_REG_GPR_TOTAL && (i + 1) * 16 <= len; i++) {
+        writeReg(gidx_, i, hex2reg(&data[16 * i]));
+    }
+    sendPacket("OK");
+}
+
+void TcpServerGdb::ClientThread::handleReadRegister(const char *data) {
+    uint64_t regnum, val;
+    parseHex(data, &regnum);
+    if (!readReg(gidx_, static_cast<unsigned>(regnum), &val)) {
+        sendPacket("E01");
+        return;
+    }
+    char tstr[20];
+    sendPacket(tstr, reg2hex(tstr, val));
+}
+
+void TcpServerGdb::ClientThread::handleWriteRegister(const char *data) {
+    uint64_t regnum;
+    const char *s = parseHex(data, &regnum);
+    if (*s != '=') {
+        sendPacket("E01");
+        return;
+    }
+    if (!writeReg(gidx_, static_cast<unsigned>(regnum), hex2reg(s + 1))) {
+        sendPacket("E01");
+        return;
+    }
+    sendPacket("OK");
+}
+
+void TcpServerGdb::ClientThread::sendPacket(const char *data, int sz) {
+    uint8_t crc = 0;
+    int cnt = 0;
+    lastpkt_[cnt++] = '$';
+    for (int i = 0; i < sz && cnt < 2*PACKET_SIZE; i++) {
+        lastpkt_[cnt++] = data[i];
+        crc += static_cast<uint8_t>(data[i]);
+    }
+    cnt += RISCV_sprintf(&lastpkt_[cnt], 4, "#%02x", crc);
+    lastpktcnt_ = cnt;
+    writeTxBuffer(lastpkt_, lastpktcnt_);
+}
+
+/** T-reply with thread id and watchpoint address if any */
+void TcpServerGdb::ClientThread::sendStopReply(int idx, int signal) {
+    char tstr[128];
+    int tsz = RISCV_sprintf(tstr, sizeof(tstr), "T%02xthread:%x;",
+                            signal, idx + 1);
+    uint64_t dcsr;
+    if (signal == 5
+        && harts_[idx].idport->dportReadReg(ICpuRiscV::CSR_dcsr, &dcsr) == 0
+        && ((dcsr >> 6) & 0x7) == 2) {
+        // Trigger: find the watchpoint
+        for (int i = 0; i < hwbreakcnt_; i++) {
+            HwBreakType *p = &hwbreak_[i];
+            TriggerData1Type tdata1;
+            if (p->type < 2) {
+                continue;
+            }
+            harts_[idx].idport->dportWriteReg(ICpuRiscV::CSR_tselect,
+                                              p->trigidx);
+            harts_[idx].idport->dportReadReg(ICpuRiscV::CSR_tdata1,
+                                             &tdata1.val);
+            if (tdata1.mcontrol_bits.hit) {
+                static const char *const WATCH_NAME[5] = {
+                    "", "", "watch", "rwatch", "awatch"};
+                tsz += RISCV_sprintf(&tstr[tsz], sizeof(tstr) - tsz,
+                                     "%s:%" RV_PRI64 "x;",
+                                     WATCH_NAME[p->type], p->addr);
+                break;
+            }
+        }
+    }
+    for (int i = 0; i < hartcnt_; i++) {
+        clearTriggerHits(i);
+    }
+    lastStop_ = idx;
+    gidx_ = idx;
+    sendPacket(tstr, tsz);
+}
+
+/** @return 0..hartcnt_-1, -1 for all threads, -2 wrong thread-id */
+int TcpServerGdb::ClientThread::hartIndex(const char *tid) {
+    if (tid[0] == '-' && tid[1] == '1') {
+        return -1;
+    }
+    uint64_t id;
+    parseHex(tid, &id);
+    if (id == 0) {
+        return gidx_;           // any thread
+    }
+    if (id > static_cast<uint64_t>(hartcnt_)) {
+        return -2;
+    }
+    return static_cast<int>(id) - 1;
+}
+
+bool TcpServerGdb::ClientThread::readReg(int idx, unsigned regnum,
+                                         uint64_t *val) {
+    IDPort *idport = harts_[idx].idport;
+    if (regnum < GDB_REG_PC) {
+        return idport->dportReadReg(0x1000 + regnum, val) == 0;
+    } else if (regnum == GDB_REG_PC) {
+        *val = harts_[idx].icpu->getNPC();
+        return true;
+    } else if (regnum < GDB_REG_CSR0) {
+        return idport->dportReadReg(0x1000 + 32 + regnum - GDB_REG_FPR0,
+                                    val) == 0;
+    } else if (regnum < GDB_REG_CSR0 + 4096) {
+        return idport->dportReadReg(regnum - GDB_REG_CSR0, val) == 0;
+    }
+    return false;
+}
+
+bool TcpServerGdb::ClientThread::writeReg(int idx, unsigned regnum,
+                                          uint64_t val) {
+    IDPort *idport = harts_[idx].idport;
+    if (regnum == 0) {
+        return true;
+    } else if (regnum < GDB_REG_PC) {
+        return idport->dportWriteReg(0x1000 + regnum, val) == 0;
+    } else if (regnum == GDB_REG_PC) {
+        // Halted hart continues from npc
+        harts_[idx].icpu->setNPC(val);
+        idport->dportWriteReg(ICpuRiscV::CSR_dpc, val);
+        return true;
+    } else if (regnum < GDB_REG_CSR0) {
+        return idport->dportWriteReg(0x1000 + 32 + regnum - GDB_REG_FPR0,
+                                     val) == 0;
+    } else if (regnum < GDB_REG_CSR0 + 4096) {
+        return idport->dportWriteReg(regnum - GDB_REG_CSR0, val) == 0;
+    }
+    return false;
+}
+
+/**
+ * Naturally aligned accesses up to 8 bytes through the selected hart, so
+ * that virtual addresses are translated by its MMU.
+ * @return Number of bytes read before the first error.
+ */
+int TcpServerGdb::ClientThread::readMem(uint64_t addr, uint8_t *buf,
+                                        int len) {
+    IDPort *idport = harts_[gidx_].idport;
+    uint64_t payload;
+    int pos = 0;
+    int sz;
+    while (pos < len) {
+        sz = 8;
+        while (sz > len - pos || ((addr + pos) & (sz - 1))) {
+            sz >>= 1;
+        }
+        if (idport->dportReadMem(addr + pos, 1, sz, &payload) != 0) {
+            break;
+        }
+        memcpy(&buf[pos], &payload, sz);
+        pos += sz;
+    }
+    return pos;
+}
+
+int TcpServerGdb::ClientThread::writeMem(uint64_t addr, const uint8_t *buf,
+                                         int len) {
+    IDPort *idport = harts_[gidx_].idport;
+    uint64_t payload;
+    int pos = 0;
+    int sz;
+    while (pos < len) {
+        sz = 8;
+        while (sz > len - pos || ((addr + pos) & (sz - 1))) {
+            sz >>= 1;
+        }
+        payload = 0;
+        memcpy(&payload, &buf[pos], sz);
+        if (idport->dportWriteMem(addr + pos, 1, sz, payload) != 0) {
+            break;
+        }
+        pos += sz;
+    }
+    flushHarts(addr, pos);
+    return pos;
+}
+
+/** Other harts may have decoded instructions of the modified memory */
+void TcpServerGdb::ClientThread::flushHarts(uint64_t addr, int len) {
+    for (int i = 0; i < hartcnt_; i++) {
+        if (i == gidx_) {
+            continue;
+        }
+        if (len > 64) {
+            harts_[i].icpu->flush(~0ull);
+            continue;
+        }
+        for (int n = 0; n < len; n += 2) {
+            harts_[i].icpu->flush((addr & ~0x1ull) + n);
+        }
+    }
+}
+
+void TcpServerGdb::ClientThread::resumeHarts() {
+    csr_dcsr_type dcsr;
+    int stepidx = -1;
+    int stepcnt = 0;
+    int runcnt = 0;
+    for (int i = 0; i < hartcnt_; i++) {
+        HartType *p = &harts_[i];
+        if (!p->running) {
+            continue;
+        }
+        p->idport->dportReadReg(ICpuRiscV::CSR_dcsr, &dcsr.u64);
+        dcsr.bits.step = p->stepping ? 1 : 0;
+        p->idport->dportWriteReg(ICpuRiscV::CSR_dcsr, dcsr.u64);
+        if (p->stepping) {
+            stepidx = i;
+            stepcnt++;
+        }
+        runcnt++;
+    }
+    if (runcnt == 0) {
+        sendStopReply(gidx_, 5);
+        return;
+    }
+    for (int i = 0; i < hartcnt_; i++) {
+        if (harts_[i].running) {
+            harts_[i].idport->resumereq();
+        }
+    }
+    running_ = true;
+
+    // Single step is waited in place to avoid polling latency
+    if (stepcnt == 1 && runcnt == 1 && waitHalted(stepidx, 100)) {
+        checkStopped();
+    }
+}
+
+void TcpServerGdb::ClientThread::haltHarts() {
+    for (int i = 0; i < hartcnt_; i++) {
+        if (!harts_[i].idport->isHalted()) {
+            harts_[i].idport->haltreq();
+        }
+    }
+    for (int i = 0; i < hartcnt_; i++) {
+        waitHalted(i, 100);
+        harts_[i].running = false;
+    }
+}
+
+/** Resumed hart is halted again only after it acknowledged the resume */
+bool TcpServerGdb::ClientThread::waitHalted(int idx, int timeout_ms) {
+    IDPort *idport = harts_[idx].idport;
+    bool resumed = harts_[idx].running;
+    uint64_t t0 = RISCV_get_time_ms();
+    int spin = 0;
+    while (!idport->isHalted() || (resumed && !idport->isResumeAck())) {
+        if (++spin < 10000) {
+            continue;
+        }
+        if (RISCV_get_time_ms() - t0 > static_cast<uint64_t>(timeout_ms)) {
+            return false;
+        }
+        RISCV_sleep_ms(1);
+    }
+    return true;
+}
+
+/** The first halted hart stops all others (all-stop mode) */
+void TcpServerGdb::ClientThread::checkStopped() {
+    int stopidx = -1;
+    for (int i = 0; i < hartcnt_; i++) {
+        HartType *p = &harts_[i];
+        if (!p->running || !p->idport->isHalted()) {
+            continue;
+        }
+        if (p->idport->isResumeAck()) {
+            stopidx = i;
+            break;
+        }
+    }
+    if (stopidx < 0) {
+        return;
+    }
+
+    haltHarts();
+    csr_dcsr_type dcsr;
+    for (int i = 0; i < hartcnt_; i++) {
+        if (!harts_[i].stepping) {
+            continue;
+        }
+        harts_[i].stepping = false;
+        harts_[i].idport->dportReadReg(ICpuRiscV::CSR_dcsr, &dcsr.u64);
+        dcsr.bits.step = 0;
+        harts_[i].idport->dportWriteReg(ICpuRiscV::CSR_dcsr, dcsr.u64);
+    }
+    running_ = false;
+    sendStopReply(stopidx, 5);
+}
+
+void TcpServerGdb::ClientThread::clearTriggerHits(int idx) {
+    IDPort *idport = harts_[idx].idport;
+    TriggerData1Type tdata1;
+    for (int i = 0; i < hwbreakcnt_; i++) {
+        idport->dportWriteReg(ICpuRiscV::CSR_tselect, hwbreak_[i].trigidx);
+        idport->dportReadReg(ICpuRiscV::CSR_tdata1, &tdata1.val);
+        if (tdata1.mcontrol_bits.hit) {
+            tdata1.mcontrol_bits.hit = 0;
+            idport->dportWriteReg(ICpuRiscV::CSR_tdata1, tdata1.val);
+        }
+    }
+}
+
+/** kind 2 is c.ebreak, kind 4 is ebreak */
+int TcpServerGdb::ClientThread::insertSwBreak(uint64_t addr, int kind) {
+    for (int i = 0; i < swbreakcnt_; i++) {
+        if (swbreak_[i].addr == addr) {
+            return 0;
+        }
+    }
+    if (swbreakcnt_ >= BREAKS_MAX || (kind != 2 && kind != 4)) {
+        return -1;
+    }
+    SwBreakType *p = &swbreak_[swbreakcnt_];
+    uint32_t instr = kind == 2 ? 0x9002 : 0x00100073;
+    p->addr = addr;
+    p->kind = kind;
+    p->saved = 0;
+    if (readMem(addr, reinterpret_cast<uint8_t *>(&p->saved), kind) != kind
+        || writeMem(addr, reinterpret_cast<uint8_t *>(&instr), kind) != kind) {
+        return -1;
+    }
+    swbreakcnt_++;
+
+    csr_dcsr_type dcsr;
+    for (int i = 0; i < hartcnt_; i++) {
+        harts_[i].idport->dportReadReg(ICpuRiscV::CSR_dcsr, &dcsr.u64);
+        dcsr.bits.ebreakm = 1;
+        dcsr.bits.ebreaks = 1;
+        dcsr.bits.ebreaku = 1;
+        harts_[i].idport->dportWriteReg(ICpuRiscV::CSR_dcsr, dcsr.u64);
+    }
+    return 0;
+}
+
+int TcpServerGdb::ClientThread::removeSwBreak(uint64_t addr) {
+    for (int i = 0; i < swbreakcnt_; i++) {
+        SwBreakType *p = &swbreak_[i];
+        if (p->addr != addr) {
+            continue;
+        }
+        int err = writeMem(addr, reinterpret_cast<uint8_t *>(&p->saved),
+                           p->kind) != p->kind;
+        swbreak_[i] = swbreak_[--swbreakcnt_];
+        return err ? -1 : 0;
+    }
+    return 0;
+}
+
+/**
+ * Z1 uses execute trigger, Z2..Z4 use store/load triggers. The same
+ * trigger index is programmed in all harts.
+ */
+int TcpServerGdb::ClientThread::insertTrigger(int type, uint64_t addr,
+                                              uint64_t len) {
+    static const uint64_t SIZE_CODE[9] = {0, 1, 2, 0, 3, 0, 0, 0, 5};
+    if (hwbreakcnt_ >= BREAKS_MAX) {
+        return -1;
+    }
+    if (type > 1 && (len > 8 || SIZE_CODE[len] == 0)) {
+        return -1;              // gdb falls back to software watchpoint
+    }
+
+    IDPort *idport = harts_[0].idport;
+    uint64_t trigtotal;
+    idport->dportWriteReg(ICpuRiscV::CSR_tselect, ~0ull);
+    idport->dportReadReg(ICpuRiscV::CSR_tselect, &trigtotal);
+    int trigidx = -1;
+    for (uint64_t i = 0; i < trigtotal && trigidx < 0; i++) {
+        bool used = false;
+        for (int n = 0; n < hwbreakcnt_; n++) {
+            used |= hwbreak_[n].trigidx == static_cast<int>(i);
+        }
+        if (!used) {
+            trigidx = static_cast<int>(i);
+        }
+    }
+    if (trigidx < 0) {
+        return -1;
+    }
+
+    TriggerData1Type tdata1;
+    tdata1.val = 0;
+    tdata1.mcontrol_bits.type = 2;
+    tdata1.mcontrol_bits.dmode = 1;
+    tdata1.mcontrol_bits.action = 1;
+    tdata1.mcontrol_bits.m = 1;
+    tdata1.mcontrol_bits.s = 1;
+    tdata1.mcontrol_bits.u = 1;
+    if (type == 1) {
+        tdata1.mcontrol_bits.execute = 1;
+    } else {
+        tdata1.mcontrol_bits.store = type == 2 || type == 4;
+        tdata1.mcontrol_bits.load = type == 3 || type == 4;
+        tdata1.mcontrol_bits.sizelo = SIZE_CODE[len] & 0x3;
+        tdata1.mcontrol_bits.sizehi = SIZE_CODE[len] >> 2;
+    }
+    for (int i = 0; i < hartcnt_; i++) {
+        idport = harts_[i].idport;
+        idport->dportWriteReg(ICpuRiscV::CSR_tselect, trigidx);
+        idport->dportWriteReg(ICpuRiscV::CSR_tdata2, addr);
+        idport->dportWriteReg(ICpuRiscV::CSR_tdata1, tdata1.val);
+    }
+
+    HwBreakType *p = &hwbreak_[hwbreakcnt_++];
+    p->type = type;
+    p->addr = addr;
+    p->len = len;
+    p->trigidx = trigidx;
+    return 0;
+}
+
+int TcpServerGdb::ClientThread::removeTrigger(int type, uint64_t addr,
+                                              uint64_t len) {
+    for (int i = 0; i < hwbreakcnt_; i++) {
+        HwBreakType *p = &hwbreak_[i];
+        if (p->type != type || p->addr != addr) {
+            continue;
+        }
+        for (int n = 0; n < hartcnt_; n++) {
+            IDPort *idport = harts_[n].idport;
+            idport->dportWriteReg(ICpuRiscV::CSR_tselect, p->trigidx);
+            idport->dportWriteReg(ICpuRiscV::CSR_tdata1, 0);
+        }
+        hwbreak_[i] = hwbreak_[--hwbreakcnt_];
+        return 0;
+    }
+    return 0;
+}
+
+void TcpServerGdb::ClientThread::removeAllBreaks() {
+    while (swbreakcnt_) {
+        removeSwBreak(swbreak_[0].addr);
+    }
+    while (hwbreakcnt_) {
+        removeTrigger(hwbreak_[0].type, hwbreak_[0].addr, hwbreak_[0].len);
+    }
+
+    // ebreak instructions of the program trap again as before attach
+    csr_dcsr_type dcsr, saved;
+    for (int i = 0; i < hartcnt_; i++) {
+        saved.u64 = harts_[i].dcsr;
+        harts_[i].idport->dportReadReg(ICpuRiscV::CSR_dcsr, &dcsr.u64);
+        dcsr.bits.ebreakm = saved.bits.ebreakm;
+        dcsr.bits.ebreaks = saved.bits.ebreaks;
+        dcsr.bits.ebreaku = saved.bits.ebreaku;
+        harts_[i].idport->dportWriteReg(ICpuRiscV::CSR_dcsr, dcsr.u64);
+    }
+}
+
+}  // namespace debugger
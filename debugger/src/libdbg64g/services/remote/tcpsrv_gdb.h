@@ -0,0 +1,164 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <iclass.h>
+#include <iservice.h>
+#include "coreservices/ithread.h"
+#include "coreservices/idport.h"
+#include "coreservices/icpufunctional.h"
+#include "coreservices/icmdexec.h"
+#include "generic/tcpserver.h"
+
+namespace debugger {
+
+/**
+ * @brief GDB Remote Serial Protocol server.
+ * @details Connects gdb directly to the functional CPU models without
+ *          OpenOCD and JTAG/DMI layers. Every hart from 'HartList' is
+ *          reported as a separate thread (all-stop mode).
+ */
+class TcpServerGdb : public TcpServer {
+ public:
+    explicit TcpServerGdb(const char *name);
+
+    /** IService interface */
+    virtual void postinitService() override;
+
+ protected:
+    virtual IThread *createClientThread(const char *name, socket_def skt);
+
+ private:
+    static const int HARTS_MAX = 32;
+    static const int BREAKS_MAX = 64;
+    static const int PACKET_SIZE = 0x4000;
+
+    struct HartType {
+        const char *name;
+        IDPort *idport;
+        ICpuFunctional *icpu;
+        bool running;
+        bool stepping;
+        uint64_t dcsr;          // saved on attach, restored on detach
+    };
+
+    class ClientThread : public TcpServer::ClientThreadGeneric {
+     public:
+        explicit ClientThread(TcpServerGdb *parent,
+                              const char *name,
+                              socket_def skt,
+                              int recvTimeout);
+
+     protected:
+        /** IThread interface */
+        virtual void busyLoop() override;
+
+        /** TcpClient */
+        virtual void afterThreadStarted() override;
+        virtual void beforeThreadClosing() override;
+        virtual int processRxBuffer(const char *cmdbuf, int bufsz);
+
+     private:
+        int handlePacket(char *data, int sz);
+        void handleQuery(const char *data);
+        void handleXfer(const char *data);
+        void handleVCont(const char *data);
+        void handleBreakpoint(const char *data);
+        void handleReadMemory(const char *data);
+        void handleWriteMemory(char *data, int sz, bool binary);
+        void handleReadRegisters();
+        void handleWriteRegisters(const char *data);
+        void handleReadRegister(const char *data);
+        void handleWriteRegister(const char *data);
+
+        void sendPacket(const char *data, int sz);
+        void sendPacket(const char *data) {
+            sendPacket(data, static_cast<int>(strlen(data)));
+        }
+        void sendStopReply(int idx, int signal);
+        void sendXfer(const char *doc, int docsz, const char *args);
+
+        int hartIndex(const char *tid);
+        bool readReg(int idx, unsigned regnum, uint64_t *val);
+        bool writeReg(int idx, unsigned regnum, uint64_t val);
+        int readMem(uint64_t addr, uint8_t *buf, int len);
+        int writeMem(uint64_t addr, const uint8_t *buf, int len);
+        void flushHarts(uint64_t addr, int len);
+
+        void resumeHarts();
+        void haltHarts();
+        bool waitHalted(int idx, int timeout_ms);
+        void checkStopped();
+        void clearTriggerHits(int idx);
+
+        int insertSwBreak(uint64_t addr, int kind);
+        int removeSwBreak(uint64_t addr);
+        int insertTrigger(int type, uint64_t addr, uint64_t len);
+        int removeTrigger(int type, uint64_t addr, uint64_t len);
+        void removeAllBreaks();
+
+     private:
+        TcpServerGdb *p_;
+        HartType *harts_;
+        int hartcnt_;
+        int gidx_;                  // 'Hg' thread index
+        int cidx_;                  // 'Hc' thread index, -1 all
+        bool ackMode_;
+        bool running_;              // waiting for the stop event
+        int lastStop_;
+
+        enum EPacketState {
+            Packet_Idle,
+            Packet_Data,
+            Packet_Crc1,
+            Packet_Crc2
+        } estate_;
+        char pkt_[PACKET_SIZE + 16];
+        int pktcnt_;
+        uint8_t pktcrc_;
+        char lastpkt_[2*PACKET_SIZE + 16];
+        int lastpktcnt_;
+        char resp_[2*PACKET_SIZE + 16];
+
+        struct SwBreakType {
+            uint64_t addr;
+            int kind;
+            uint32_t saved;
+        } swbreak_[BREAKS_MAX];
+        int swbreakcnt_;
+
+        struct HwBreakType {
+            int type;               // Z1..Z4
+            uint64_t addr;
+            uint64_t len;
+            int trigidx;
+        } hwbreak_[BREAKS_MAX];
+        int hwbreakcnt_;
+    };
+
+ private:
+    AttributeType hartList_;
+    AttributeType cmdexec_;
+
+    HartType harts_[HARTS_MAX];
+    int hartcnt_;
+    ICmdExecutor *icmdexec_;
+};
+
+DECLARE_CLASS(TcpServerGdb)
+
+}  // namespace debugger
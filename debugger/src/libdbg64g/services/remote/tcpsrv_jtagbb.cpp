@@ -47,15 +47,85 @@ TcpServerJtagBitBang::ClientThread::ClientThread(TcpServerJtagBitBang *parent,
                                                 IJtagBitBang *ijtagbb)
     : TcpServer::ClientThreadGeneric(parent, name, skt, recvTimeout) {
     ijtagbb_ = ijtagbb;
+    tdocnt_ = 0;
 }
 
 TcpServerJtagBitBang::ClientThread::~ClientThread() {
 }
 
+void TcpServerJtagBitBang::ClientThread::putTDO(char v) {
+    if (tdocnt_ == static_cast<int>(sizeof(tdobuf_))) {
+        writeTxBuffer(tdobuf_, tdocnt_);
+        tdocnt_ = 0;
+    }
+    tdobuf_[tdocnt_++] = v;
+}
+
+/**
+ * @brief Recognize IR/DR shift sequence and execute it at once.
+ * @details OpenOCD sends every scan bit as '0'..'3' (TCK=0), optional 'R'
+ *          and the same pins with TCK=1. Bits with TMS=0 plus the last
+ *          bit with TMS=1 are collected while the TAP is in Shift-xR state.
+ * @return Number of consumed characters, 0 if nothing to batch.
+ */
+int TcpServerJtagBitBang::ClientThread::shiftScan(const char *cmdbuf,
+                                                  int bufsz) {
+    uint64_t tdi = 0;
+    uint64_t rdmask = 0;
+    int nbits = 0;
+    int pos = 0;
+    int bitpos;
+    char lo, tms = 0;
+
+    if (!ijtagbb_->isShiftState()) {
+        return 0;
+    }
+    while (nbits < 64 && tms == 0) {
+        bitpos = pos;
+        if (bitpos >= bufsz) {
+            break;
+        }
+        lo = cmdbuf[bitpos++];
+        if (lo < '0' || lo > '3') {
+            break;
+        }
+        if (bitpos < bufsz && cmdbuf[bitpos] == 'R') {
+            rdmask |= 1ull << nbits;
+            bitpos++;
+        }
+        if (bitpos >= bufsz || cmdbuf[bitpos] != lo + 4) {
+            // Incomplete bit or unexpected sequence: keep it for setPins()
+            rdmask &= ~(1ull << nbits);
+            break;
+        }
+        tms = (lo >> 1) & 0x1;
+        tdi |= static_cast<uint64_t>(lo & 0x1) << nbits;
+        nbits++;
+        pos = bitpos + 1;
+    }
+    if (nbits == 0) {
+        return 0;
+    }
+
+    uint64_t tdo = ijtagbb_->shiftScan(tdi, nbits, tms);
+    for (int i = 0; i < nbits; i++) {
+        if ((rdmask >> i) & 0x1) {
+            putTDO(((tdo >> i) & 0x1) ? '1' : '0');
+        }
+    }
+    return pos;
+}
+
 int TcpServerJtagBitBang::ClientThread::processRxBuffer(const char *cmdbuf, int bufsz) {
     int ret = 0;
+    int scanned;
 
     for (int i = 0; i < bufsz; i++) {
+        if (cmdbuf[i] >= '0' && cmdbuf[i] <= '3'
+            && (scanned = shiftScan(&cmdbuf[i], bufsz - i)) != 0) {
+            i += scanned - 1;
+            continue;
+        }
         switch (cmdbuf[i]) {
         case 'B':
             RISCV_debug("%s", "Blink on");
@@ -100,7 +170,7 @@ int TcpServerJtagBitBang::ClientThread::processRxBuffer(const char *cmdbuf, int
             ijtagbb_->setPins(1, 1, 1);
             break;
         case 'R':
-            writeTxBuffer(ijtagbb_->getTDO() ? "1" : "0", 1);
+            putTDO(ijtagbb_->getTDO() ? '1' : '0');
             break;
         case 'Q':
             ret = -1;
@@ -111,6 +181,10 @@ int TcpServerJtagBitBang::ClientThread::processRxBuffer(const char *cmdbuf, int
         }
     }
 
+    if (tdocnt_) {
+        writeTxBuffer(tdobuf_, tdocnt_);
+        tdocnt_ = 0;
+    }
     return ret;
 }
 
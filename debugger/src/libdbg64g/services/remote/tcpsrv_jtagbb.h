@@ -45,8 +45,13 @@ class TcpServerJtagBitBang : public TcpServer {
      protected:
         virtual int processRxBuffer(const char *cmdbuf, int bufsz);
 
+        int shiftScan(const char *cmdbuf, int bufsz);
+        void putTDO(char v);
+
      private:
         IJtagBitBang *ijtagbb_;
+        char tdobuf_[4096];     // coalesced 'R' responses
+        int tdocnt_;
     };
 
  private:
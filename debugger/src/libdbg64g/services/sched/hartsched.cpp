@@ -0,0 +1,303 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include <api_core.h>
+#include "hartsched.h"
+
+namespace debugger {
+
+/** Steps skipped in the sleep state aren't counted as executed */
+static uint64_t execute_hart(IQuantumExecutor *ihart, uint64_t steps,
+                             uint64_t *idle) {
+    uint64_t idle0 = ihart->getIdleSteps();
+    uint64_t ret = ihart->executeQuantum(steps);
+    *idle = ihart->getIdleSteps() - idle0;
+    return ret;
+}
+
+SchedCmdType::SchedCmdType(IService *parent, const char *name)
+    : ICommand(parent, name) {
+    briefDescr_.make_string("Multi-hart scheduler statistic.");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Print global time and number of instructions executed by\n"
+        "    all harts. Steps skipped by the sleeping harts (WFI) are\n"
+        "    counted separately, so that instructions per second don't\n"
+        "    include them.\n"
+        "Response:\n"
+        "    {'harts':n,'time':n,'instr':n,'idle':n}\n"
+        "Usage:\n"
+        "    sched0");
+}
+
+int SchedCmdType::isValid(AttributeType *args) {
+    if (!(*args)[0u].is_equal(cmdParent_->getObjName())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 1) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void SchedCmdType::exec(AttributeType *args, AttributeType *res) {
+    HartScheduler *p = static_cast<HartScheduler *>(cmdParent_);
+    res->make_dict();
+    (*res)["harts"].make_uint64(p->getHartTotal());
+    (*res)["time"].make_uint64(p->getStepCounter());
+    (*res)["instr"].make_uint64(p->getInstrTotal());
+    (*res)["idle"].make_uint64(p->getIdleTotal());
+}
+
+HartScheduler::HartWorker::HartWorker(IQuantumExecutor *ihart) {
+    AttributeType t1;
+    RISCV_generate_name(&t1);
+    RISCV_event_create(&eventStart_, t1.to_string());
+    RISCV_generate_name(&t1);
+    RISCV_event_create(&eventDone_, t1.to_string());
+    ihart_ = ihart;
+    steps_ = 0;
+    executed_ = 0;
+    idle_ = 0;
+    run();
+}
+
+HartScheduler::HartWorker::~HartWorker() {
+    close();
+    RISCV_event_close(&eventStart_);
+    RISCV_event_close(&eventDone_);
+}
+
+void HartScheduler::HartWorker::close() {
+    stop();
+    RISCV_event_set(&eventStart_);
+    join(5000);
+}
+
+void HartScheduler::HartWorker::start(uint64_t steps) {
+    steps_ = steps;
+    RISCV_event_set(&eventStart_);
+}
+
+uint64_t HartScheduler::HartWorker::wait(uint64_t *idle) {
+    RISCV_event_wait(&eventDone_);
+    RISCV_event_clear(&eventDone_);
+    *idle = idle_;
+    return executed_;
+}
+
+void HartScheduler::HartWorker::busyLoop() {
+    while (true) {
+        RISCV_event_wait(&eventStart_);
+        RISCV_event_clear(&eventStart_);
+        if (!isEnabled()) {
+            break;
+        }
+        executed_ = execute_hart(ihart_, steps_, &idle_);
+        RISCV_event_set(&eventDone_);
+    }
+}
+
+
+HartScheduler::HartScheduler(const char *name)
+    : IService(name), IHap(HAP_ConfigDone) {
+    registerInterface(static_cast<IThread *>(this));
+    registerInterface(static_cast<IClock *>(this));
+    registerInterface(static_cast<IHartScheduler *>(this));
+    registerInterface(static_cast<IHap *>(this));
+    registerAttribute("Quantum", &quantum_);
+    registerAttribute("Parallel", &parallel_);
+    registerAttribute("FreqHz", &freqHz_);
+    registerAttribute("CmdExecutor", &cmdexec_);
+
+    char tstr[256];
+    RISCV_sprintf(tstr, sizeof(tstr), "eventConfigDone_%s", name);
+    RISCV_event_create(&eventConfigDone_, tstr);
+    RISCV_register_hap(static_cast<IHap *>(this));
+
+    quantum_.make_uint64(10000);
+    parallel_.make_boolean(true);
+    freqHz_.make_uint64(1000000);
+    cmdexec_.make_string("");
+    icmdexec_ = 0;
+    pcmd_ = 0;
+    harts_.make_list(0);
+    workers_ = 0;
+    workersTotal_ = 0;
+    globalTime_ = 0;
+    instrCnt_ = 0;
+    idleCnt_ = 0;
+}
+
+HartScheduler::~HartScheduler() {
+    if (pcmd_) {
+        delete pcmd_;
+    }
+    RISCV_event_close(&eventConfigDone_);
+}
+
+void HartScheduler::postinitService() {
+    // Devices see the global time instead of the hart's step counter
+    RISCV_set_default_clock(static_cast<IClock *>(this));
+
+    if (cmdexec_.size()) {
+        icmdexec_ = static_cast<ICmdExecutor *>(
+            RISCV_get_service_iface(cmdexec_.to_string(),
+                                    IFACE_CMD_EXECUTOR));
+        if (!icmdexec_) {
+            RISCV_error("Can't get ICmdExecutor interface %s",
+                        cmdexec_.to_string());
+        } else {
+            pcmd_ = new SchedCmdType(static_cast<IService *>(this),
+                                     getObjName());
+            icmdexec_->registerCommand(pcmd_);
+        }
+    }
+
+    const AttributeType *glb = RISCV_get_global_settings();
+    if ((*glb)["SimEnable"].to_bool()) {
+        if (!run()) {
+            RISCV_error("Can't create thread.", NULL);
+            return;
+        }
+    }
+}
+
+void HartScheduler::predeleteService() {
+    if (icmdexec_) {
+        icmdexec_->unregisterCommand(pcmd_);
+    }
+}
+
+void HartScheduler::hapTriggered(EHapType type,
+                                 uint64_t param,
+                                 const char *descr) {
+    RISCV_unregister_hap(static_cast<IHap *>(this));
+    RISCV_event_set(&eventConfigDone_);
+}
+
+void HartScheduler::registerHart(IQuantumExecutor *ihart) {
+    AttributeType item(ihart);
+    harts_.add_to_list(&item);
+}
+
+void HartScheduler::registerStepCallback(IClockListener *cb, uint64_t t) {
+    queue_.put(t, cb);
+}
+
+bool HartScheduler::moveStepCallback(IClockListener *cb, uint64_t t) {
+    if (queue_.move(cb, t)) {
+        return true;
+    }
+    registerStepCallback(cb, t);
+    return false;
+}
+
+void HartScheduler::busyLoop() {
+    uint64_t quantum;
+    uint64_t executed;
+    RISCV_event_wait(&eventConfigDone_);
+
+    // The first hart is executed by the scheduler thread itself
+    if (parallel_.to_bool() && harts_.size() > 1) {
+        workersTotal_ = harts_.size() - 1;
+        workers_ = new HartWorker *[workersTotal_];
+        for (unsigned i = 0; i < workersTotal_; i++) {
+            workers_[i] = new HartWorker(static_cast<IQuantumExecutor *>(
+                                            harts_[i + 1].to_iface()));
+        }
+    }
+    RISCV_info("Scheduling %d harts, quantum %" RV_PRI64 "d steps%s",
+               harts_.size(), quantum_.to_uint64(),
+               workersTotal_ ? ", parallel" : "");
+
+    while (isEnabled()) {
+        quantum = quantum_.to_uint64();
+        if (workersTotal_) {
+            executed = executeParallel(quantum);
+        } else {
+            executed = executeSequential(quantum);
+        }
+        if (executed == 0) {
+            // All harts halted: wait for the debugger
+            RISCV_sleep_ms(1);
+            continue;
+        }
+        globalTime_ += quantum;
+        updateQueue();
+    }
+
+    for (unsigned i = 0; i < workersTotal_; i++) {
+        delete workers_[i];
+    }
+    if (workers_) {
+        delete [] workers_;
+    }
+    workers_ = 0;
+    workersTotal_ = 0;
+}
+
+/** @return maximal number of steps advanced by any hart */
+uint64_t HartScheduler::executeParallel(uint64_t steps) {
+    uint64_t ret;
+    uint64_t t1;
+    uint64_t idle;
+    for (unsigned i = 0; i < workersTotal_; i++) {
+        workers_[i]->start(steps);
+    }
+    ret = execute_hart(static_cast<IQuantumExecutor *>(
+                harts_[0u].to_iface()), steps, &idle);
+    instrCnt_ += ret - idle;
+    idleCnt_ += idle;
+    for (unsigned i = 0; i < workersTotal_; i++) {
+        t1 = workers_[i]->wait(&idle);
+        instrCnt_ += t1 - idle;
+        idleCnt_ += idle;
+        if (t1 > ret) {
+            ret = t1;
+        }
+    }
+    return ret;
+}
+
+uint64_t HartScheduler::executeSequential(uint64_t steps) {
+    uint64_t ret = 0;
+    uint64_t t1;
+    uint64_t idle;
+    for (unsigned i = 0; i < harts_.size(); i++) {
+        t1 = execute_hart(static_cast<IQuantumExecutor *>(
+                harts_[i].to_iface()), steps, &idle);
+        instrCnt_ += t1 - idle;
+        idleCnt_ += idle;
+        if (t1 > ret) {
+            ret = t1;
+        }
+    }
+    return ret;
+}
+
+/** Device callbacks run on the barrier while all harts are stopped */
+void HartScheduler::updateQueue() {
+    IFace *cb;
+    queue_.initProc();
+    queue_.pushPreQueued();
+
+    while ((cb = queue_.getNext(globalTime_)) != 0) {
+        static_cast<IClockListener *>(cb)->stepCallback(globalTime_);
+    }
+}
+
+}  // namespace debugger
@@ -0,0 +1,136 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#pragma once
+
+#include <iclass.h>
+#include <iservice.h>
+#include <ihap.h>
+#include <async_tqueue.h>
+#include "coreservices/ithread.h"
+#include "coreservices/iclock.h"
+#include "coreservices/ischeduler.h"
+#include "coreservices/icommand.h"
+#include "coreservices/icmdexec.h"
+
+namespace debugger {
+
+class SchedCmdType : public ICommand {
+ public:
+    SchedCmdType(IService *parent, const char *name);
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+};
+
+/**
+ * @brief Quantum-based scheduler of the multi-hart functional models.
+ * @details Every hart executes 'Quantum' instructions, then all harts meet
+ *          on the barrier and the global time advances by the quantum.
+ *          Devices clocked from the scheduler see the global time and
+ *          their callbacks run on the barrier while harts are stopped.
+ *          In 'Parallel' mode harts run in the separate host threads,
+ *          otherwise they are executed one by one in the scheduler thread,
+ *          so the simulation is reproducible.
+ */
+class HartScheduler : public IService,
+                      public IThread,
+                      public IClock,
+                      public IHartScheduler,
+                      public IHap {
+ public:
+    explicit HartScheduler(const char *name);
+    virtual ~HartScheduler();
+
+    /** IService interface */
+    virtual void postinitService() override;
+    virtual void predeleteService() override;
+
+    /** IClock */
+    virtual uint64_t getStepCounter() override { return globalTime_; }
+    virtual void registerStepCallback(IClockListener *cb,
+                                      uint64_t t) override;
+    virtual bool moveStepCallback(IClockListener *cb, uint64_t t) override;
+    virtual double getFreqHz() override {
+        return static_cast<double>(freqHz_.to_uint64());
+    }
+
+    /** IHartScheduler */
+    virtual void registerHart(IQuantumExecutor *ihart) override;
+
+    /** IHap */
+    virtual void hapTriggered(EHapType type, uint64_t param,
+                              const char *descr) override;
+
+    /** Common methods */
+    uint64_t getInstrTotal() { return instrCnt_; }
+    uint64_t getIdleTotal() { return idleCnt_; }
+    unsigned getHartTotal() { return harts_.size(); }
+
+ protected:
+    /** IThread interface */
+    virtual void busyLoop() override;
+
+ private:
+    uint64_t executeParallel(uint64_t steps);
+    uint64_t executeSequential(uint64_t steps);
+    void updateQueue();
+
+    /** Host thread of the hart in the parallel mode */
+    class HartWorker : public IThread {
+     public:
+        explicit HartWorker(IQuantumExecutor *ihart);
+        virtual ~HartWorker();
+
+        void start(uint64_t steps);
+        uint64_t wait(uint64_t *idle);
+        void close();
+
+     protected:
+        /** IThread interface */
+        virtual void busyLoop() override;
+
+     private:
+        IQuantumExecutor *ihart_;
+        event_def eventStart_;
+        event_def eventDone_;
+        uint64_t steps_;
+        uint64_t executed_;
+        uint64_t idle_;
+    };
+
+ private:
+    AttributeType quantum_;
+    AttributeType parallel_;
+    AttributeType freqHz_;
+    AttributeType cmdexec_;
+
+    ICmdExecutor *icmdexec_;
+    SchedCmdType *pcmd_;
+    AttributeType harts_;       // [IQuantumExecutor, ...]
+    HartWorker **workers_;
+    unsigned workersTotal_;
+    event_def eventConfigDone_;
+    ClockAsyncTQueueType queue_;
+    volatile uint64_t globalTime_;
+    uint64_t instrCnt_;         // executed by all harts
+    uint64_t idleCnt_;          // skipped by sleeping harts
+};
+
+DECLARE_CLASS(HartScheduler)
+
+}  // namespace debugger
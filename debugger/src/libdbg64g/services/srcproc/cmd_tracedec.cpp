@@ -0,0 +1,201 @@
+/*
+ *  Copyright 2023 Sergey Khabarov, sergeykhbr@gmail.com
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "cmd_tracedec.h"
+#include "generic/tracewriter.h"
+#include <riscv-isa.h>
+#include <stdio.h>
+
+namespace debugger {
+
+/** Buffered reader of the binary trace records */
+class TraceFileReader {
+ public:
+    explicit TraceFileReader(FILE *fp) : fp_(fp), pos_(0), cnt_(0) {}
+
+    bool eof() {
+        if (pos_ < cnt_) {
+            return false;
+        }
+        cnt_ = static_cast<int>(fread(buf_, 1, sizeof(buf_), fp_));
+        pos_ = 0;
+        return cnt_ == 0;
+    }
+    uint8_t getByte() {
+        return eof() ? 0 : buf_[pos_++];
+    }
+    uint64_t getVarint() {
+        uint64_t ret = 0;
+        uint8_t b;
+        int shift = 0;
+        do {
+            b = getByte();
+            ret |= static_cast<uint64_t>(b & 0x7F) << shift;
+            shift += 7;
+        } while ((b & 0x80) && shift < 64);
+        return ret;
+    }
+    int64_t getSigned() {
+        uint64_t v = getVarint();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+ private:
+    FILE *fp_;
+    uint8_t buf_[1 << 16];
+    int pos_;
+    int cnt_;
+};
+
+CmdTraceDecode::CmdTraceDecode(IService *parent) :
+    ICommand (parent, "tracedec") {
+
+    briefDescr_.make_string("Convert binary trace into text.");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Decode trace file generated with TraceFormat='binary' into\n"
+        "    the text format with disassembled instructions.\n"
+        "Response:\n"
+        "    Number of decoded instructions\n"
+        "Usage:\n"
+        "    tracedec <bin-file> <txt-file>\n"
+        "Example:\n"
+        "    tracedec trace.bin trace.txt\n");
+
+    isrc_ = static_cast<ISourceCode *>(
+                            parent->getInterface(IFACE_SOURCE_CODE));
+}
+
+int CmdTraceDecode::isValid(AttributeType *args) {
+    if (!cmdName_.is_equal((*args)[0u].to_string())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 3 && (*args)[1].is_string()
+        && (*args)[2].is_string()) {
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void CmdTraceDecode::exec(AttributeType *args, AttributeType *res) {
+    res->attr_free();
+    res->make_nil();
+
+    FILE *fin = fopen((*args)[1].to_string(), "rb");
+    if (!fin) {
+        generateError(res, "Can't open input file");
+        return;
+    }
+    TraceFileHeaderType hdr;
+    if (fread(&hdr, 1, sizeof(hdr), fin) != sizeof(hdr)
+        || memcmp(hdr.magic, TRACE_BIN_MAGIC, sizeof(hdr.magic)) != 0
+        || hdr.version != TRACE_BIN_VERSION) {
+        fclose(fin);
+        generateError(res, "Wrong trace file format");
+        return;
+    }
+    FILE *fout = fopen((*args)[2].to_string(), "wb");
+    if (!fout) {
+        fclose(fin);
+        generateError(res, "Can't open output file");
+        return;
+    }
+
+    TraceFileReader rd(fin);
+    uint64_t regs[TRACE_REGS_MAX] = {0};
+    uint64_t step = 0;
+    uint64_t npc = 0;
+    uint64_t memaddr = 0;
+    uint64_t total = 0;
+    uint64_t val;
+    uint8_t instr[4];
+    AttributeType instrbuf, asmlist;
+    char tstr[1024];
+    const char *mnemonic;
+    int regtotal = static_cast<int>(sizeof(RISCV_IREGS_NAMES)
+                                  / sizeof(RISCV_IREGS_NAMES[0]));
+
+    while (!rd.eof()) {
+        uint8_t tag = rd.getByte();
+        switch (tag & TRACE_TAG_TYPE_MASK) {
+        case TraceRecord_Instr: {
+            uint64_t pc = npc;
+            int oplen = (tag & TRACE_TAG_RVC) ? 2 : 4;
+            if (tag & TRACE_TAG_PC_JUMP) {
+                pc += static_cast<uint64_t>(rd.getSigned());
+            }
+            step += (tag & TRACE_TAG_STEP_JUMP) ? rd.getVarint() : 1;
+            for (int i = 0; i < oplen; i++) {
+                instr[i] = rd.getByte();
+            }
+            instrbuf.make_data(oplen, instr);
+            npc = pc + oplen;
+
+            mnemonic = "";
+            if (isrc_) {
+                isrc_->disasm(0, pc, &instrbuf, &asmlist);
+                for (unsigned i = 0; i < asmlist.size(); i++) {
+                    if (asmlist[i][ASM_list_type].to_int() == AsmList_disasm) {
+                        mnemonic = asmlist[i][ASM_mnemonic].to_string();
+                        break;
+                    }
+                }
+            }
+            RISCV_sprintf(tstr, sizeof(tstr),
+                "%9" RV_PRI64 "d: %08" RV_PRI64 "x: %s \r\n",
+                    step, pc, mnemonic);
+            total++;
+            break;
+        }
+        case TraceRecord_Reg: {
+            int idx = rd.getByte();
+            regs[idx] ^= rd.getVarint();
+            if (idx < regtotal) {
+                RISCV_sprintf(tstr, sizeof(tstr),
+                    "%20s %10s <= %016" RV_PRI64 "x\r\n",
+                        "", RISCV_IREGS_NAMES[idx], regs[idx]);
+            } else {
+                RISCV_sprintf(tstr, sizeof(tstr),
+                    "%20s %9s%d <= %016" RV_PRI64 "x\r\n",
+                        "", "r", idx, regs[idx]);
+            }
+            break;
+        }
+        case TraceRecord_Memop:
+            memaddr += static_cast<uint64_t>(rd.getSigned());
+            val = rd.getVarint();
+            RISCV_sprintf(tstr, sizeof(tstr),
+                "%20s [%08" RV_PRI64 "x] %s %016" RV_PRI64 "x\r\n",
+                    "", memaddr,
+                    (tag & TRACE_TAG_WRITE) ? "<=" : "=>", val);
+            break;
+        default:
+            RISCV_sprintf(tstr, sizeof(tstr),
+                "Wrong record tag %02x\r\n", tag);
+            fputs(tstr, fout);
+            fclose(fin);
+            fclose(fout);
+            generateError(res, "Trace file corrupted");
+            return;
+        }
+        fputs(tstr, fout);
+    }
+    fclose(fin);
+    fclose(fout);
+    res->make_uint64(total);
+}
+
+}  // namespace debugger
@@ -16,6 +16,7 @@
 
 #include "srcproc.h"
 #include <iostream>
+#include <algorithm>
 #include <riscv-isa.h>
 #include "coreservices/icpuriscv.h"
 
@@ -41,15 +42,29 @@ RiscvSourceService::RiscvSourceService(const char *name) : IService(name),
     registerAttribute("CmdExecutor", &cmdexec_);
 
     pcmdBr_ = new CmdBrRiscv(this);
+    pcmdTraceDec_ = new CmdTraceDecode(this);
 
 
     brList_.make_list(0);
     symbolListSortByName_.make_list(0);
-    symbolListSortByAddr_.make_list(0);
+    symbols_ = 0;
+    namePool_ = 0;
+    nameHash_ = 0;
+    rebuildSymbolIndex();
+
+    brHashSize_ = 16;
+    brHashUsed_ = 0;
+    brHash_ = new uint64_t[brHashSize_];
+    memset(brHash_, 0xff, brHashSize_ * sizeof(uint64_t));
 }
 
 RiscvSourceService::~RiscvSourceService() {
     delete pcmdBr_;
+    delete pcmdTraceDec_;
+    delete [] symbols_;
+    delete [] namePool_;
+    delete [] nameHash_;
+    delete [] brHash_;
 }
 
 void RiscvSourceService::postinitService() {
@@ -60,12 +75,14 @@ void RiscvSourceService::postinitService() {
                     cmdexec_.to_string());
     } else {
         icmdexec_->registerCommand(pcmdBr_);
+        icmdexec_->registerCommand(pcmdTraceDec_);
     }
 }
 
 void RiscvSourceService::predeleteService() {
     if (icmdexec_) {
         icmdexec_->unregisterCommand(pcmdBr_);
+        icmdexec_->unregisterCommand(pcmdTraceDec_);
     }
 }
 
@@ -79,122 +96,210 @@ void RiscvSourceService::hapTriggered(EHapType type,
     }
 }
 
-void RiscvSourceService::addFileSymbol(const char *name, uint64_t addr,
-                                       int sz) {
+void RiscvSourceService::addSymbol(const char *name, uint64_t addr, int sz,
+                                   uint64_t type) {
     AttributeType symb(Attr_List);
     symb.make_list(Symbol_Total);
     symb[Symbol_Name].make_string(name);
     symb[Symbol_Addr].make_uint64(addr);
     symb[Symbol_Size].make_int64(sz);
+    symb[Symbol_Type].make_uint64(type);
 
     symbolListSortByName_.add_to_list(&symb);
-    symbolListSortByName_.sort(Symbol_Name);
+    rebuildSymbolIndex();
+}
 
-    symbolListSortByAddr_.add_to_list(&symb);
-    symbolListSortByAddr_.sort(Symbol_Addr);
+void RiscvSourceService::addFileSymbol(const char *name, uint64_t addr,
+                                       int sz) {
+    addSymbol(name, addr, sz, SYMBOL_TYPE_FILE);
 }
 
 void RiscvSourceService::addFunctionSymbol(const char *name,
                                       uint64_t addr, int sz) {
-    addFileSymbol(name, addr, sz);
+    addSymbol(name, addr, sz, SYMBOL_TYPE_FUNCTION);
 }
 
 void RiscvSourceService::addDataSymbol(const char *name, uint64_t addr,
                                        int sz) {
-    addFileSymbol(name, addr, sz);
+    addSymbol(name, addr, sz, SYMBOL_TYPE_DATA);
 }
 
 void RiscvSourceService::clearSymbols() {
     symbolListSortByName_.make_list(0);
-    symbolListSortByAddr_.make_list(0);
+    rebuildSymbolIndex();
 }
 
 void RiscvSourceService::addSymbols(AttributeType *list) {
     for (unsigned i = 0; i < list->size(); i++) {
         AttributeType &item = (*list)[i];
         symbolListSortByName_.add_to_list(&item);
-        symbolListSortByAddr_.add_to_list(&item);
     }
-    symbolListSortByName_.sort(Symbol_Name);
-    symbolListSortByAddr_.sort(Symbol_Addr);
+    rebuildSymbolIndex();
 }
 
-void RiscvSourceService::addressToSymbol(uint64_t addr, AttributeType *info) {
-    uint64_t sadr, send;
-    int sz = static_cast<int>(symbolListSortByAddr_.size());
+static unsigned hash_addr(uint64_t addr) {
+    return static_cast<unsigned>((addr * 0x9E3779B97F4A7C15ull) >> 32);
+}
 
-    info->make_list(SymbInfo_Total);
-    (*info)[SymbInfo_Name].make_string("");
-    (*info)[SymbInfo_Address].make_uint64(0);
-    if (sz == 0) {
-        return;
+static unsigned hash_name(const char *name) {
+    unsigned h = 2166136261u;
+    while (*name) {
+        h = (h ^ static_cast<uint8_t>(*name++)) * 16777619u;
     }
-    sadr = symbolListSortByAddr_[0u][Symbol_Addr].to_uint64();
-    if (addr < sadr) {
-        return;
+    return h;
+}
+
+/**
+ * Build the flat table sorted by address, the names pool and the names
+ * hash from the symbols list, then sort the list itself by name.
+ */
+void RiscvSourceService::rebuildSymbolIndex() {
+    unsigned cnt = symbolListSortByName_.size();
+    unsigned poolsz = 0;
+    for (unsigned i = 0; i < cnt; i++) {
+        poolsz += static_cast<unsigned>(
+            strlen(symbolListSortByName_[i][Symbol_Name].to_string())) + 1;
+    }
+    delete [] symbols_;
+    delete [] namePool_;
+    delete [] nameHash_;
+    symbols_ = new SymbolIndexType[cnt + 1];
+    namePool_ = new char[poolsz + 1];
+    symbolCnt_ = cnt;
+
+    poolsz = 0;
+    for (unsigned i = 0; i < cnt; i++) {
+        AttributeType &item = symbolListSortByName_[i];
+        const char *name = item[Symbol_Name].to_string();
+        size_t len = strlen(name) + 1;
+        memcpy(&namePool_[poolsz], name, len);
+        symbols_[i].addr = item[Symbol_Addr].to_uint64();
+        symbols_[i].size = item[Symbol_Size].to_uint64();
+        symbols_[i].name = poolsz;
+        symbols_[i].type = item[Symbol_Type].to_uint32();
+        poolsz += static_cast<unsigned>(len);
     }
 
-    bool search = true;
-    int dist, pos = sz / 2;
-    dist = pos;
-    while (search) {
-        AttributeType &symb = symbolListSortByAddr_[pos];
-        sadr = symb[Symbol_Addr].to_uint64();
-        if (pos < static_cast<int>(symbolListSortByAddr_.size()) - 1) {
-            send = symbolListSortByAddr_[pos + 1][Symbol_Addr].to_uint64();
-        } else {
-            send = sadr + symb[Symbol_Size].to_uint64();
-        }
-        if (sadr <= addr && addr < send) {
-            (*info)[SymbInfo_Name] = symb[Symbol_Name];
-            (*info)[SymbInfo_Address].make_uint64(addr - sadr);
-            return;
-        }
-        
-        if (addr < sadr) {
-            if (dist == 0 || pos == 0) {
-                search = false;
-            } else if (dist == 1) {
-                dist = 0;
-                pos--;
-            } else {
-                int incr = dist / 2;
-                pos -= incr;
-                dist = (dist / 2) + (dist & 0x1);
-                if (pos < 0) {
-                    pos = 0;
-                }
-            }
-        } else {
-            if (dist == 0 || pos == (sz - 1)) {
-                search = false;
-            } else if (dist == 1) {
-                dist = 0;
-                pos++;
-            } else {
-                int incr = dist / 2;
-                pos += incr;
-                dist = (dist / 2) + (dist & 0x1);
-                if (pos >= sz) {
-                    pos = sz - 1;
-                }
-            }
+    // Names order for getSymbols()
+    const char *pool = namePool_;
+    std::stable_sort(symbols_, symbols_ + cnt,
+        [pool](const SymbolIndexType &a, const SymbolIndexType &b) {
+            return strcmp(&pool[a.name], &pool[b.name]) < 0;
+        });
+    AttributeType item;
+    item.make_list(Symbol_Total);
+    symbolListSortByName_.make_list(cnt);
+    for (unsigned i = 0; i < cnt; i++) {
+        item[Symbol_Name].make_string(&namePool_[symbols_[i].name]);
+        item[Symbol_Addr].make_uint64(symbols_[i].addr);
+        item[Symbol_Size].make_uint64(symbols_[i].size);
+        item[Symbol_Type].make_uint64(symbols_[i].type);
+        symbolListSortByName_[i] = item;
+    }
+
+    std::stable_sort(symbols_, symbols_ + cnt,
+        [](const SymbolIndexType &a, const SymbolIndexType &b) {
+            return a.addr < b.addr;
+        });
+
+    nameHashSize_ = 16;
+    while (nameHashSize_ < 2 * cnt) {
+        nameHashSize_ <<= 1;
+    }
+    nameHash_ = new unsigned[nameHashSize_];
+    memset(nameHash_, 0, nameHashSize_ * sizeof(unsigned));
+    for (unsigned i = 0; i < cnt; i++) {
+        unsigned h = hash_name(&namePool_[symbols_[i].name]);
+        while (nameHash_[h & (nameHashSize_ - 1)]) {
+            h++;
         }
+        nameHash_[h & (nameHashSize_ - 1)] = i + 1;
     }
 }
 
+/**
+ * Address belongs to the nearest symbol below it, the last symbol is
+ * limited by its size.
+ */
+const SymbolIndexType *RiscvSourceService::findSymbol(uint64_t addr) {
+    const SymbolIndexType *p = std::upper_bound(symbols_,
+        symbols_ + symbolCnt_, addr,
+        [](uint64_t a, const SymbolIndexType &b) {
+            return a < b.addr;
+        });
+    if (p == symbols_) {
+        return 0;
+    }
+    p--;
+    if (p == &symbols_[symbolCnt_ - 1] && addr >= p->addr + p->size) {
+        return 0;
+    }
+    return p;
+}
+
+const char *RiscvSourceService::addressToName(uint64_t addr,
+                                              uint64_t *offset) {
+    const SymbolIndexType *p = findSymbol(addr);
+    if (!p) {
+        *offset = 0;
+        return 0;
+    }
+    *offset = addr - p->addr;
+    return &namePool_[p->name];
+}
+
+void RiscvSourceService::addressToSymbol(uint64_t addr, AttributeType *info) {
+    uint64_t off;
+    const char *name = addressToName(addr, &off);
+    info->make_list(SymbInfo_Total);
+    (*info)[SymbInfo_Name].make_string(name ? name : "");
+    (*info)[SymbInfo_Address].make_uint64(off);
+}
+
 int RiscvSourceService::symbol2Address(const char *name, uint64_t *addr) {
-    for (unsigned i = 0; i < symbolListSortByName_.size(); i++) {
-        AttributeType &item = symbolListSortByName_[i];
-        if (item[Symbol_Name].is_equal(name)) {
-            *addr = item[Symbol_Addr].to_uint64();
+    unsigned h = hash_name(name);
+    unsigned idx;
+    while ((idx = nameHash_[h & (nameHashSize_ - 1)]) != 0) {
+        if (strcmp(&namePool_[symbols_[idx - 1].name], name) == 0) {
+            *addr = symbols_[idx - 1].addr;
             return 0;
         }
+        h++;
     }
     return -1;
 }
 
+void RiscvSourceService::insertBreakpoint(uint64_t addr) {
+    if (2 * (brHashUsed_ + 1) > brHashSize_) {
+        // Rebuild without removed entries
+        uint64_t *old = brHash_;
+        unsigned oldsz = brHashSize_;
+        brHashSize_ = 16;
+        while (brHashSize_ < 4 * (brList_.size() + 1)) {
+            brHashSize_ <<= 1;
+        }
+        brHash_ = new uint64_t[brHashSize_];
+        memset(brHash_, 0xff, brHashSize_ * sizeof(uint64_t));
+        brHashUsed_ = 0;
+        for (unsigned i = 0; i < oldsz; i++) {
+            if (old[i] != BR_EMPTY && old[i] != BR_REMOVED) {
+                insertBreakpoint(old[i]);
+            }
+        }
+        delete [] old;
+    }
+    unsigned h = hash_addr(addr);
+    while (brHash_[h & (brHashSize_ - 1)] != BR_EMPTY) {
+        h++;
+    }
+    brHash_[h & (brHashSize_ - 1)] = addr;
+    brHashUsed_++;
+}
+
 void RiscvSourceService::addBreakpoint(uint64_t addr, uint64_t flags) {
+    if (isBreakpoint(addr)) {
+        return;
+    }
     AttributeType item;
     item.make_list(BrkList_Total);
     item[BrkList_address].make_uint64(addr);
@@ -202,24 +307,20 @@ void RiscvSourceService::addBreakpoint(uint64_t addr, uint64_t flags) {
     //item[BrkList_instr].make_uint64(instr);
     //item[BrkList_opcode].make_uint64(opcode);
     //item[BrkList_oplen].make_int64(oplen);
-
-    bool not_found = true;
-    for (unsigned i = 0; i < brList_.size(); i++) {
-        AttributeType &br = brList_[i];
-        if (addr == br[BrkList_address].to_uint64()) {
-            not_found = false;
-        }
-    }
-    if (not_found) {
-        brList_.add_to_list(&item);
-    }
+    brList_.add_to_list(&item);
+    insertBreakpoint(addr);
 }
 
 int RiscvSourceService::removeBreakpoint(uint64_t addr) {
+    unsigned h = hash_addr(addr);
     for (unsigned i = 0; i < brList_.size(); i++) {
         AttributeType &br = brList_[i];
         if (addr == br[BrkList_address].to_uint64()) {
             brList_.remove_from_list(i);
+            while (brHash_[h & (brHashSize_ - 1)] != addr) {
+                h++;
+            }
+            brHash_[h & (brHashSize_ - 1)] = BR_REMOVED;
             return 0;
         }
     }
@@ -231,11 +332,13 @@ void RiscvSourceService::getBreakpointList(AttributeType *list) {
 }
 
 bool RiscvSourceService::isBreakpoint(uint64_t addr) {
-    for (unsigned i = 0; i < brList_.size(); i++) {
-        uint64_t bradr = brList_[i][BrkList_address].to_uint64();
-        if (addr == bradr) {
+    unsigned h = hash_addr(addr);
+    uint64_t v;
+    while ((v = brHash_[h & (brHashSize_ - 1)]) != BR_EMPTY) {
+        if (v == addr) {
             return true;
         }
+        h++;
     }
     return false;
 }
@@ -250,7 +353,7 @@ void RiscvSourceService::disasm(int mode,
     }
     uint8_t *data = idata->data();
 
-    AttributeType asm_item, symb_item, info;
+    AttributeType asm_item, symb_item;
     asm_item.make_list(ASM_Total);
     symb_item.make_list(3);
     asm_item[ASM_list_type].make_int64(AsmList_disasm);
@@ -258,15 +361,16 @@ void RiscvSourceService::disasm(int mode,
     uint64_t off = 0;
     Reg64Type code;
     int codesz;
+    const char *symbname;
+    uint64_t symboff;
 
     while (static_cast<unsigned>(off) < idata->size()) {
         code.val = *reinterpret_cast<uint32_t*>(&data[off]);
 
-        addressToSymbol(pc + off, &info);
-        if (info[SymbInfo_Name].size() != 0 && 
-            info[SymbInfo_Address].to_int() == 0) {
+        symbname = addressToName(pc + off, &symboff);
+        if (symbname && symbname[0] && symboff == 0) {
             symb_item[1].make_uint64(pc + off);
-            symb_item[2].make_string(info[SymbInfo_Name].to_string());
+            symb_item[2].make_string(symbname);
             asmlist->add_to_list(&symb_item);
         }
         asm_item[ASM_addrline].make_uint64(pc + off);
@@ -23,9 +23,17 @@
 #include "coreservices/isrccode.h"
 #include "coreservices/icmdexec.h"
 #include "cmd_br.h"
+#include "cmd_tracedec.h"
 
 namespace debugger {
 
+struct SymbolIndexType {
+    uint64_t addr;
+    uint64_t size;
+    uint32_t name;          // offset in the names pool
+    uint32_t type;          // ESymbolType
+};
+
 class RiscvSourceService : public IService,
                            public IHap,
                            public ISourceCode {
@@ -60,6 +68,8 @@ public:
 
     virtual void addressToSymbol(uint64_t addr, AttributeType *info);
 
+    virtual const char *addressToName(uint64_t addr, uint64_t *offset);
+
     virtual int symbol2Address(const char *name, uint64_t *addr);
 
     virtual void disasm(int mode,
@@ -75,16 +85,36 @@ public:
 
     virtual bool isBreakpoint(uint64_t addr);
 
+private:
+    void addSymbol(const char *name, uint64_t addr, int sz, uint64_t type);
+    void rebuildSymbolIndex();
+    const SymbolIndexType *findSymbol(uint64_t addr);
+    void insertBreakpoint(uint64_t addr);
+
 private:
     AttributeType cmdexec_;
 
     ICmdExecutor *icmdexec_;
 
     CmdBrRiscv *pcmdBr_;
+    CmdTraceDecode *pcmdTraceDec_;
 
     AttributeType brList_;
     AttributeType symbolListSortByName_;
-    AttributeType symbolListSortByAddr_;
+
+    // Symbols sorted by address with names in one pool
+    SymbolIndexType *symbols_;
+    unsigned symbolCnt_;
+    char *namePool_;
+    unsigned *nameHash_;            // open addressing, symbol index + 1
+    unsigned nameHashSize_;
+
+    // Open addressing set of the breakpoint addresses
+    static const uint64_t BR_EMPTY = ~0ull;
+    static const uint64_t BR_REMOVED = ~0ull - 1;
+    uint64_t *brHash_;
+    unsigned brHashSize_;
+    unsigned brHashUsed_;           // including removed
 };
 
 DECLARE_CLASS(RiscvSourceService)
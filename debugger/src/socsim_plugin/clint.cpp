@@ -18,6 +18,7 @@
 #include "clint.h"
 #include <riscv-isa.h>
 #include "coreservices/icpuriscv.h"
+#include "coreservices/icpufunctional.h"
 
 namespace debugger {
 
@@ -26,8 +27,11 @@ CLINT::CLINT(const char *name) : RegMemBankGeneric(name),
     mtimecmp(static_cast<IService *>(this), "mtimecmp", 0x004000),
     mtime(static_cast<IService *>(this), "mtime", 0x00bff8) {
     registerInterface(static_cast<IIrqController *>(this));
+    registerInterface(static_cast<IClockListener *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("Clock", &clock_);
     update_time_ = 0;
+    listeners_.make_list(0);
 }
 
 void CLINT::postinitService() {
@@ -45,6 +49,7 @@ void CLINT::postinitService() {
 void CLINT::setTimer(uint64_t v) {
     update_time_ = iclk_->getStepCounter();
     mtime.setValue(v);
+    scheduleTimer();
 }
 
 void CLINT::updateTimer() {
@@ -68,6 +73,7 @@ int CLINT::getPendingRequest(int ctxid) {
     uint32_t sw = (~ctxid) & 0x1;
     uint32_t tmr = ctxid & 0x1;
 
+    RISCV_mutex_lock(&mutexAccess_);
     if (sw) {
         ret = msip.getp()[hartid].bits.b0;
     } else if (tmr) {
@@ -76,10 +82,99 @@ int CLINT::getPendingRequest(int ctxid) {
             ret = 1;
         }
     }
+    RISCV_mutex_unlock(&mutexAccess_);
 
     return ret;
 }
 
+void CLINT::registerListener(int ctxid, IFace *icpu) {
+    AttributeType item;
+    item.make_list(2);
+    item[0u].make_int64(ctxid);
+    item[1].make_iface(icpu);
+    RISCV_mutex_lock(&mutexAccess_);
+    listeners_.add_to_list(&item);
+    RISCV_mutex_unlock(&mutexAccess_);
+}
+
+void CLINT::notifyListener(int ctxid) {
+    ICpuFunctional *icpu;
+    for (unsigned i = 0; i < listeners_.size(); i++) {
+        if (listeners_[i][0u].to_int() != ctxid) {
+            continue;
+        }
+        icpu = static_cast<ICpuFunctional *>(listeners_[i][1].to_iface());
+        icpu->notifyInterrupt();
+    }
+}
+
+/**
+ * @brief Register clock event at the nearest mtimecmp of the listening
+ *        harts, so that a sleeping hart could skip steps up to it.
+ */
+void CLINT::scheduleTimer() {
+    if (!iclk_) {
+        return;
+    }
+    uint64_t cur_time = iclk_->getStepCounter();
+    uint64_t t = mtime.getValue().val + (cur_time - update_time_);
+    uint64_t dt = ~0ull;
+    for (unsigned i = 0; i < listeners_.size(); i++) {
+        int ctxid = listeners_[i][0u].to_int();
+        if ((ctxid & 0x1) == 0) {
+            continue;
+        }
+        uint64_t cmp = mtimecmp.getp()[ctxid / 2].val;
+        if (cmp <= t) {
+            dt = 0;
+        } else if ((cmp - t) < dt) {
+            dt = cmp - t;
+        }
+    }
+    if (dt == ~0ull || dt > (~0ull - cur_time)) {
+        return;
+    }
+    iclk_->moveStepCallback(static_cast<IClockListener *>(this),
+                            cur_time + dt);
+}
+
+void CLINT::stepCallback(uint64_t t) {
+    RISCV_mutex_lock(&mutexAccess_);
+    updateTimer();
+    for (unsigned i = 0; i < listeners_.size(); i++) {
+        int ctxid = listeners_[i][0u].to_int();
+        if ((ctxid & 0x1) == 0) {
+            continue;
+        }
+        if (mtime.getValue().val >= mtimecmp.getp()[ctxid / 2].val) {
+            notifyListener(ctxid);
+        }
+    }
+    RISCV_mutex_unlock(&mutexAccess_);
+}
+
+/** Registers are saved by ports, timer callback is kept in CPU queue */
+void CLINT::saveState(AttributeType *state) {
+    state->make_dict();
+    (*state)["update_time"].make_uint64(update_time_);
+}
+
+void CLINT::restoreState(const AttributeType *state) {
+    update_time_ = (*state)["update_time"].to_uint64();
+}
+
+void CLINT::CLINT_MSIP_TYPE::write(int idx, uint32_t val) {
+    GenericReg32Bank::write(idx, val);
+    if (val & 0x1) {
+        static_cast<CLINT *>(parent_)->notifyListener(2*idx);
+    }
+}
+
+void CLINT::CLINT_MTIMECMP_TYPE::write(int idx, uint64_t val) {
+    GenericReg64Bank::write(idx, val);
+    static_cast<CLINT *>(parent_)->scheduleTimer();
+}
+
 uint64_t CLINT::CLINT_MTIME_TYPE::aboutToRead(uint64_t cur_val) {
     CLINT *p = static_cast<CLINT *>(parent_);
     p->updateTimer();
@@ -21,6 +21,7 @@
 #include "coreservices/imemop.h"
 #include "coreservices/iirq.h"
 #include "coreservices/iclock.h"
+#include "coreservices/isnapshot.h"
 #include "generic/mapreg.h"
 #include "generic/rmembank_gen1.h"
 
@@ -29,7 +30,9 @@ namespace debugger {
 static const int CLINT_HART_MAX = 4096;
 
 class CLINT : public RegMemBankGeneric,
-              public IIrqController {
+              public IIrqController,
+              public IClockListener,
+              public ISnapshot {
  public:
     explicit CLINT(const char *name);
 
@@ -39,10 +42,20 @@ class CLINT : public RegMemBankGeneric,
     /** IIrqController */
     virtual int requestInterrupt(IFace *isrc, int idx) { return 0; }
     virtual int getPendingRequest(int ctxid);
+    virtual void registerListener(int ctxid, IFace *icpu);
+
+    /** IClockListener */
+    virtual void stepCallback(uint64_t t);
+
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
 
  private:
     void setTimer(uint64_t v);
     void updateTimer();
+    void scheduleTimer();
+    void notifyListener(int ctxid);
 
  private:
 
@@ -50,6 +63,9 @@ class CLINT : public RegMemBankGeneric,
      public:
         CLINT_MSIP_TYPE(IService *parent, const char *name, uint64_t addr)
             : GenericReg32Bank(parent, name, addr, CLINT_HART_MAX) {}
+
+        using GenericReg32Bank::write;
+        virtual void write(int idx, uint32_t val) override;
     };
 
     class CLINT_MTIMECMP_TYPE : public GenericReg64Bank {
@@ -58,6 +74,9 @@ class CLINT : public RegMemBankGeneric,
             : GenericReg64Bank(parent, name, addr, CLINT_HART_MAX - 1) {
             // shouldn't be reset on reset signal
         }
+
+        using GenericReg64Bank::write;
+        virtual void write(int idx, uint64_t val) override;
     };
 
     class CLINT_MTIME_TYPE : public MappedReg64Type {
@@ -79,6 +98,7 @@ class CLINT : public RegMemBankGeneric,
     CLINT_MTIME_TYPE mtime;          // [00bff8] 1 register for all hart
 
     uint64_t update_time_;          // Last time when mtime was updated
+    AttributeType listeners_;       // [[ctxid, ICpuFunctional], ...]
 };
 
 DECLARE_CLASS(CLINT)
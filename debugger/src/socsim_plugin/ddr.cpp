@@ -16,76 +16,640 @@
 
 #include "api_core.h"
 #include "ddr.h"
+#if defined(_WIN32) || defined(__CYGWIN__)
+#else
+    #include <sys/mman.h>
+#endif
 
 namespace debugger {
 
+DdrCmdType::DdrCmdType(IService *parent, const char *name)
+    : ICommand(parent, name) {
+    briefDescr_.make_string("Sparse memory model statistic.");
+    detailedDescr_.make_string(
+        "Description:\n"
+        "    Print number of allocated pages and resident memory size.\n"
+        "    'bench' allocates zero pages over the first 'bytes' of the\n"
+        "    bank, the content isn't changed, and measures the average\n"
+        "    time of 8-bytes reads through b_transport: sequential, 256\n"
+        "    hot pages spread over the range and uniform random. The\n"
+        "    '*_host_ns' values are the same reads directly from the host\n"
+        "    pages, i.e. the memory system cost without the lookup.\n"
+        "    Run it with the halted simulation.\n"
+        "Response:\n"
+        "    {'pages':n,'tables':n,'resident':bytes,'mmap':bool,\n"
+        "     'copied':n,   copied on write pages of the snapshot\n"
+        "     'page':bytes}\n"
+        "    {'resident':bytes,'seq_ns':f,'seq_host_ns':f,'hot_ns':f,\n"
+        "     'hot_host_ns':f,'rand_ns':f,'rand_host_ns':f}\n"
+        "Usage:\n"
+        "    ddr0\n"
+        "    ddr0 bench <bytes> [reads]\n"
+        "Example:\n"
+        "    ddr1 bench 0x20000000\n"
+        "    ddr1 bench 0x20000000 0x100000");
+}
+
+int DdrCmdType::isValid(AttributeType *args) {
+    if (!(*args)[0u].is_equal(cmdParent_->getObjName())) {
+        return CMD_INVALID;
+    }
+    if (args->size() == 1) {
+        return CMD_VALID;
+    }
+    if ((args->size() == 3 || args->size() == 4)
+        && (*args)[1].is_equal("bench")) {
+        for (unsigned i = 2; i < args->size(); i++) {
+            if (!(*args)[i].is_integer()) {
+                return CMD_WRONG_ARGS;
+            }
+        }
+        return CMD_VALID;
+    }
+    return CMD_WRONG_ARGS;
+}
+
+void DdrCmdType::exec(AttributeType *args, AttributeType *res) {
+    DDR *p = static_cast<DDR *>(cmdParent_);
+    if (args->size() > 1) {
+        uint64_t reads = 1 << 21;
+        if (args->size() > 3) {
+            reads = (*args)[3].to_uint64();
+        }
+        p->lookupBench((*args)[2].to_uint64(), reads, res);
+        return;
+    }
+    res->make_dict();
+    (*res)["pages"].make_uint64(p->getPageTotal());
+    (*res)["tables"].make_uint64(p->getTableTotal());
+    (*res)["resident"].make_uint64(p->getResidentSize());
+    (*res)["mmap"].make_boolean(p->isMmapBacked());
+    (*res)["copied"].make_uint64(p->getCopiedTotal());
+    (*res)["page"].make_uint64(p->getPageSize());
+}
+
 DDR::DDR(const char *name) : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
-    mem_.bid = 0;
-    mem_.prv = 0;
-    mem_.nxt = 0;
-    memset(mem_.m, 0, sizeof(mem_.m));
+    registerInterface(static_cast<ISnapshot *>(this));
+    registerAttribute("MmapBacked", &mmapBacked_);
+    registerAttribute("CmdExecutor", &cmdexec_);
+    registerAttribute("PageSize", &pageSizeAttr_);
+
+    mmapBacked_.make_boolean(false);
+    pageSizeAttr_.make_uint64(1 << PAGE_BITS_MIN);
+    cmdexec_.make_string("");
+    icmdexec_ = 0;
+    pcmd_ = 0;
+
+    memset(&root_, 0, sizeof(root_));
+    pageBits_ = PAGE_BITS_MIN;
+    pageSize_ = 1ull << pageBits_;
+    offsetBits_ = pageBits_ + 3*TABLE_BITS;
+    memset(zeroPage_, 0, sizeof(zeroPage_));
+    mmap_ = 0;
+    mmapSize_ = 0;
+    page_total_ = 0;
+    table_total_ = 0;
+    lastTable_ = 0;
+    cow_ = 0;
+    cowCnt_ = 0;
+    cowSize_ = 0;
+    cowActive_ = false;
+    RISCV_mutex_init(&mutexAlloc_);
 }
 
 DDR::~DDR() {
-    MemBlockType *t = mem_.nxt;
-    MemBlockType *t2;
-    while (t) {
-        t2 = t->nxt;
-        delete t;
-        t = t2;
+    freePages();
+    freeCowPages();
+    if (cow_) {
+        delete [] cow_;
+    }
+#if defined(_WIN32) || defined(__CYGWIN__)
+#else
+    if (mmap_) {
+        munmap(mmap_, mmapSize_);
     }
+#endif
+    if (pcmd_) {
+        delete pcmd_;
+    }
+    RISCV_mutex_destroy(&mutexAlloc_);
 }
 
 void DDR::postinitService() {
+    // 4 KB up to 64 KB pages, leaf table covers 1024 pages
+    uint64_t pgsz = pageSizeAttr_.to_uint64();
+    int bits = PAGE_BITS_MIN;
+    while (bits < PAGE_BITS_MAX && (1ull << bits) < pgsz) {
+        bits++;
+    }
+    if ((1ull << bits) != pgsz) {
+        RISCV_error("PageSize %" RV_PRI64 "d isn't supported, use %d",
+                    pgsz, 1 << bits);
+    }
+    pageBits_ = bits;
+    pageSize_ = 1ull << pageBits_;
+    offsetBits_ = pageBits_ + 3*TABLE_BITS;
+
+    uint64_t len = getLength();
+    if (len > (1ull << offsetBits_)) {
+        RISCV_error("Length 0x%" RV_PRI64 "x exceeds %d bits",
+                    len, offsetBits_);
+    }
+
+    if (mmapBacked_.to_bool()) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+        RISCV_info("%s", "MmapBacked not supported, use heap pages");
+#else
+        // Reserve the whole bank, host allocates only touched pages
+        void *p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            RISCV_error("Can't mmap %" RV_PRI64 "d bytes", len);
+        } else {
+#ifdef MADV_HUGEPAGE
+            madvise(p, len, MADV_HUGEPAGE);
+#endif
+            mmap_ = static_cast<uint8_t *>(p);
+            mmapSize_ = len;
+        }
+#endif
+    }
+
+    if (cmdexec_.size()) {
+        icmdexec_ = static_cast<ICmdExecutor *>(
+            RISCV_get_service_iface(cmdexec_.to_string(),
+                                    IFACE_CMD_EXECUTOR));
+        if (!icmdexec_) {
+            RISCV_error("Can't get ICmdExecutor interface %s",
+                        cmdexec_.to_string());
+        } else {
+            pcmd_ = new DdrCmdType(static_cast<IService *>(this),
+                                   getObjName());
+            icmdexec_->registerCommand(pcmd_);
+        }
+    }
+}
+
+void DDR::predeleteService() {
+    if (icmdexec_) {
+        icmdexec_->unregisterCommand(pcmd_);
+    }
 }
 
 ETransStatus DDR::b_transport(Axi4TransactionType *trans) {
     uint64_t off = trans->addr - getBaseAddress();
-    uint8_t *data = getpMem(off);
+    uint32_t pos = 0;
+    uint32_t sz;
+    uint8_t *data;
+    bool full = ((1ul << trans->xsize) - 1) == trans->wstrb;
+
+    if ((off + trans->xsize) > (1ull << offsetBits_)) {
+        RISCV_error("Access out of range [%08" RV_PRI64 "x]", trans->addr);
+        trans->response = MemResp_Error;
+        return TRANS_ERROR;
+    }
     if (trans->action == MemAction_Read) {
-        memcpy(trans->rpayload.b8, data, trans->xsize);
-    } else {
-        memcpy(data, trans->wpayload.b8, trans->xsize);
+        trans->rpayload.b64[0] = 0;
     }
+    while (pos < trans->xsize) {
+        sz = static_cast<uint32_t>(pageSize_ - (off & (pageSize_ - 1)));
+        if (sz > trans->xsize - pos) {
+            sz = trans->xsize - pos;
+        }
+        if (trans->action == MemAction_Read) {
+            data = getpMem(off, false);
+            memcpy(&trans->rpayload.b8[pos], data, sz);
+        } else {
+            data = getpMem(off, true);
+            if (full) {
+                memcpy(data, &trans->wpayload.b8[pos], sz);
+            } else {
+                for (uint32_t i = 0; i < sz; i++) {
+                    if ((trans->wstrb >> (pos + i)) & 0x1) {
+                        data[i] = trans->wpayload.b8[pos + i];
+                    }
+                }
+            }
+        }
+        off += sz;
+        pos += sz;
+    }
+    trans->response = MemResp_Valid;
+    return TRANS_OK;
+}
+
+/**
+ * @brief Page-wise copy of the whole scatter list.
+ * @details Reading of not allocated pages doesn't allocate them.
+ */
+ETransStatus DDR::bulk_transport(BulkTransactionType *trans) {
+    uint64_t off = trans->addr - getBaseAddress();
+    uint64_t total = 0;
+    for (int i = 0; i < trans->bufcnt; i++) {
+        total += trans->buf[i].size;
+    }
+    if ((off + total) > (1ull << offsetBits_)) {
+        RISCV_error("Bulk access out of range [%08" RV_PRI64 "x]",
+                    trans->addr);
+        trans->response = MemResp_Error;
+        return TRANS_ERROR;
+    }
+
+    bool wr = trans->action == MemAction_Write;
+    uint64_t sz;
+    uint8_t *data;
+    for (int i = 0; i < trans->bufcnt; i++) {
+        uint8_t *ptr = trans->buf[i].ptr;
+        uint64_t left = trans->buf[i].size;
+        while (left) {
+            sz = pageSize_ - (off & (pageSize_ - 1));
+            if (sz > left) {
+                sz = left;
+            }
+            data = getpMem(off, wr);
+            if (wr) {
+                memcpy(data, ptr, sz);
+            } else {
+                memcpy(ptr, data, sz);
+            }
+            off += sz;
+            ptr += sz;
+            left -= sz;
+        }
+    }
+    trans->response = MemResp_Valid;
     return TRANS_OK;
 }
 
-uint8_t *DDR::getpMem(uint64_t addr) {
-    MemBlockType *b = &mem_;
-    uint64_t bid = addr >> 10;
+/**
+ * @brief Grant direct access to one page.
+ * @details Page is allocated here because the region is cached by
+ *          the requester and can't be switched from zero page later.
+ */
+bool DDR::get_direct_mem_ptr(uint64_t addr, DmiRegionType *dmi) {
+    uint64_t off = addr - getBaseAddress();
+    if (off >= getLength() || off >= (1ull << offsetBits_)) {
+        return false;
+    }
+    off &= ~(pageSize_ - 1);
+    void **pitem = getPageItem(off, true);
+    uintptr_t pg = reinterpret_cast<uintptr_t>(*pitem);
+    if (pg == 0) {
+        pg = fillPageItem(pitem, off, false);
+    }
+    dmi->addr = getBaseAddress() + off;
+    dmi->size = pageSize_;
+    dmi->ptr = reinterpret_cast<uint8_t *>(pg & ~PAGE_SHARED);
+    dmi->rd = true;
+    dmi->wr = (pg & PAGE_SHARED) == 0;  // write via bus to copy page
+    return true;
+}
+
+/**
+ * @brief Find page in the radix tree.
+ * @param[in] alloc Allocate page if not found, otherwise return pointer
+ *                  into zero page. Shared page is copied before writing.
+ * @details Lookup doesn't lock: tables and pages are published only after
+ *          initialization and aren't freed while the simulation runs.
+ *          The last hit leaf table is one pointer with its own tag, so
+ *          the concurrent callers can't see torn cache entry.
+ */
+uint8_t *DDR::getpMem(uint64_t off, bool alloc) {
+    uint32_t pgidx = static_cast<uint32_t>(off & (pageSize_ - 1));
+    PageTableType *t = lastTable_;
+    if (t == 0 || t->tag != (off >> (pageBits_ + TABLE_BITS))) {
+        if ((t = getLeafTable(off, alloc)) == 0) {
+            return &zeroPage_[pgidx];
+        }
+        lastTable_ = t;
+    }
+
+    void **pitem = &t->item[(off >> pageBits_) & (TABLE_SIZE - 1)];
+    uintptr_t pg = reinterpret_cast<uintptr_t>(*pitem);
+    if (pg == 0 && !alloc) {
+        return &zeroPage_[pgidx];
+    }
+    if (alloc && (pg == 0 || (pg & PAGE_SHARED))) {
+        pg = fillPageItem(pitem, off & ~(pageSize_ - 1), true);
+    }
+    return &reinterpret_cast<uint8_t *>(pg & ~PAGE_SHARED)[pgidx];
+}
+
+/** Leaf table covering the offset or 0 if it isn't allocated */
+DDR::PageTableType *DDR::getLeafTable(uint64_t off, bool alloc) {
+    PageTableType *t = &root_;
+    for (int lvl = 2; lvl >= 1; lvl--) {
+        void **pitem = &t->item[
+            (off >> (pageBits_ + lvl*TABLE_BITS)) & (TABLE_SIZE - 1)];
+        if (*pitem == 0) {
+            if (!alloc) {
+                return 0;
+            }
+            allocTable(pitem, off >> (pageBits_ + TABLE_BITS));
+        }
+        t = static_cast<PageTableType *>(*pitem);
+    }
+    return t;
+}
+
+/** Leaf item of the radix tree or 0 if the tables aren't allocated */
+void **DDR::getPageItem(uint64_t off, bool alloc) {
+    PageTableType *t = getLeafTable(off, alloc);
+    if (t == 0) {
+        return 0;
+    }
+    return &t->item[(off >> pageBits_) & (TABLE_SIZE - 1)];
+}
+
+void DDR::allocTable(void **pitem, uint64_t tag) {
+    RISCV_mutex_lock(&mutexAlloc_);
+    if (*pitem == 0) {      // other thread could allocate it meanwhile
+        PageTableType *t = new PageTableType;
+        memset(t, 0, sizeof(PageTableType));
+        t->tag = tag;
+        RISCV_memory_barrier();
+        *pitem = t;
+        table_total_++;
+    }
+    RISCV_mutex_unlock(&mutexAlloc_);
+}
+
+/**
+ * @brief Allocate page or copy shared page before writing.
+ * @return New tree item value.
+ */
+uintptr_t DDR::fillPageItem(void **pitem, uint64_t off, bool unshare) {
+    RISCV_mutex_lock(&mutexAlloc_);
+    uintptr_t pg = reinterpret_cast<uintptr_t>(*pitem);
+    if (pg == 0) {
+        pg = reinterpret_cast<uintptr_t>(allocPage(off));
+    } else if (unshare && (pg & PAGE_SHARED)) {
+        pg = reinterpret_cast<uintptr_t>(
+            unsharePage(off, reinterpret_cast<uint8_t *>(pg & ~PAGE_SHARED)));
+    }
+    RISCV_memory_barrier();
+    *pitem = reinterpret_cast<void *>(pg);
+    RISCV_mutex_unlock(&mutexAlloc_);
+    return pg;
+}
+
+uint8_t *DDR::allocPage(uint64_t off) {
     uint8_t *ret;
-    while (b->nxt && bid > b->bid) {
-        b = b->nxt;
-    }
-
-    if (b->bid < bid) {
-        MemBlockType *pnew = new MemBlockType;
-        pnew->bid = bid;
-        memset(pnew->m, 0, sizeof(pnew->m));
-        pnew->nxt = b->nxt;
-        pnew->prv = b;
-        b->nxt = pnew;
-        if (pnew->nxt) {
-            pnew->nxt->prv = pnew;
-        }
-        b = pnew;
-    } else if (b->bid == bid) {
-        // Do nothing
+    if (mmap_ && off < mmapSize_) {
+        ret = &mmap_[off];      // zero-filled by host on first touch
     } else {
-        MemBlockType *pnew = new MemBlockType;
-        pnew->bid = bid;
-        memset(pnew->m, 0, sizeof(pnew->m));
-        pnew->prv = b->prv;
-        pnew->nxt = b;
-        b->prv = pnew;
-        if (pnew->prv) {
-            pnew->prv->nxt = pnew;
-        }
-        b = pnew;
-    }
-    ret = &b->m[addr & 0x3FF];
+        ret = new uint8_t[pageSize_];
+        memset(ret, 0, pageSize_);
+    }
+    page_total_++;
+    if (cowActive_) {
+        addCowPage(off, 0);     // didn't exist on snapshot
+    }
     return ret;
 }
 
+/** Keep snapshot content, the live page stays on its place */
+uint8_t *DDR::unsharePage(uint64_t off, uint8_t *pg) {
+    uint8_t *copy = new uint8_t[pageSize_];
+    memcpy(copy, pg, pageSize_);
+    addCowPage(off, copy);
+    return pg;
+}
+
+void DDR::addCowPage(uint64_t off, uint8_t *copy) {
+    if (cowCnt_ == cowSize_) {
+        uint64_t sz = cowSize_ ? 2*cowSize_ : 1024;
+        CowPageType *t = new CowPageType[sz];
+        if (cow_) {
+            memcpy(t, cow_, cowCnt_*sizeof(CowPageType));
+            delete [] cow_;
+        }
+        cow_ = t;
+        cowSize_ = sz;
+    }
+    cow_[cowCnt_].off = off;
+    cow_[cowCnt_].copy = copy;
+    cowCnt_++;
+}
+
+void DDR::freeCowPages() {
+    for (uint64_t i = 0; i < cowCnt_; i++) {
+        if (cow_[i].copy) {
+            delete [] cow_[i].copy;
+        }
+    }
+    cowCnt_ = 0;
+    cowActive_ = false;
+}
+
+void DDR::freePages() {
+    PageTableType *t1, *t2;
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        if ((t1 = static_cast<PageTableType *>(root_.item[i])) == 0) {
+            continue;
+        }
+        for (int n = 0; n < TABLE_SIZE; n++) {
+            if ((t2 = static_cast<PageTableType *>(t1->item[n])) == 0) {
+                continue;
+            }
+            for (int k = 0; k < TABLE_SIZE; k++) {
+                uint8_t *pg = reinterpret_cast<uint8_t *>(
+                    reinterpret_cast<uintptr_t>(t2->item[k]) & ~PAGE_SHARED);
+                if (pg < mmap_ || pg >= &mmap_[mmapSize_]) {
+                    delete [] pg;
+                }
+            }
+            delete t2;
+        }
+        delete t1;
+    }
+    memset(&root_, 0, sizeof(root_));
+    page_total_ = 0;
+    table_total_ = 0;
+    lastTable_ = 0;
+}
+
+/** Page pointer for the checkpoint, doesn't unshare pages on reading */
+uint8_t *DDR::getStoragePage(uint64_t off, bool alloc) {
+    if (alloc) {
+        return getpMem(off, true);
+    }
+    void **pitem = getPageItem(off, false);
+    if (pitem == 0 || *pitem == 0) {
+        return 0;
+    }
+    return &reinterpret_cast<uint8_t *>(
+        reinterpret_cast<uintptr_t>(*pitem) & ~PAGE_SHARED)[
+            off & (pageSize_ - 1)];
+}
+
+void DDR::clearStorage() {
+    freeCowPages();
+    freePages();
+#if defined(_WIN32) || defined(__CYGWIN__)
+#else
+    if (mmap_) {
+        // Replace file mappings and touched pages with the fresh zero pages
+        void *p = mmap(mmap_, mmapSize_, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+                       -1, 0);
+        if (p == MAP_FAILED) {
+            RISCV_error("Can't remap %" RV_PRI64 "d bytes", mmapSize_);
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Map checkpoint file region over the reserved bank.
+ * @details Private mapping shares host pages with the file cache and
+ *          the other simulators restored from the same checkpoint.
+ */
+bool DDR::mapStorage(uint64_t off, uint64_t size, int fd, uint64_t fileoff) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    return false;
+#else
+    if (!mmap_ || (off + size) > mmapSize_) {
+        return false;
+    }
+    void *p = mmap(&mmap_[off], size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_FIXED, fd, static_cast<off_t>(fileoff));
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    for (uint64_t pg = off & ~(pageSize_ - 1); pg < off + size;
+         pg += pageSize_) {
+        void **pitem = getPageItem(pg, true);
+        if (*pitem == 0) {
+            *pitem = &mmap_[pg];
+            page_total_++;
+        }
+    }
+    return true;
+#endif
+}
+
+/** Mark all pages as shared, the previous snapshot is dropped */
+bool DDR::takeStorage() {
+    PageTableType *t1, *t2;
+    freeCowPages();
+    for (int i = 0; i < TABLE_SIZE; i++) {
+        if ((t1 = static_cast<PageTableType *>(root_.item[i])) == 0) {
+            continue;
+        }
+        for (int n = 0; n < TABLE_SIZE; n++) {
+            if ((t2 = static_cast<PageTableType *>(t1->item[n])) == 0) {
+                continue;
+            }
+            for (int k = 0; k < TABLE_SIZE; k++) {
+                if (t2->item[k]) {
+                    t2->item[k] = reinterpret_cast<void *>(
+                        reinterpret_cast<uintptr_t>(t2->item[k])
+                        | PAGE_SHARED);
+                }
+            }
+        }
+    }
+    cowActive_ = true;
+    return true;
+}
+
+/** Copy back modified pages, they stay writable for the next run */
+bool DDR::rollbackStorage() {
+    if (!cowActive_) {
+        return false;
+    }
+    for (uint64_t i = 0; i < cowCnt_; i++) {
+        uint8_t *pg = getStoragePage(cow_[i].off, false);
+        if (cow_[i].copy) {
+            memcpy(pg, cow_[i].copy, pageSize_);
+        } else {
+            memset(pg, 0, pageSize_);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Lookup cost versus the resident set size.
+ * @details The same offsets are read through b_transport and directly
+ *          from the host pages resolved beforehand, so the difference
+ *          of two is the lookup itself and the rest is host cache and
+ *          TLB misses of the touched data. Each read depends on the
+ *          previous one (masked by zero), so that both loops measure
+ *          latency like the CPU model does and not the overlapped misses.
+ */
+void DDR::lookupBench(uint64_t bytes, uint64_t reads, AttributeType *res) {
+    if (bytes > getLength()) {
+        bytes = getLength();
+    }
+    bytes &= ~(pageSize_ - 1);
+    res->make_dict();
+    if (bytes == 0 || reads == 0) {
+        return;
+    }
+    for (uint64_t off = 0; off < bytes; off += pageSize_) {
+        void **pitem = getPageItem(off, true);
+        if (*pitem == 0) {
+            fillPageItem(pitem, off, false);
+        }
+    }
+
+    static const char *const MODE_NAME[3] = {"seq", "hot", "rand"};
+    uint64_t *offs = new uint64_t[reads];
+    uint8_t **ptrs = new uint8_t *[reads];
+    uint64_t hotstep = bytes / 256 > pageSize_ ? bytes / 256 : pageSize_;
+    uint64_t rnd = 0x2545F4914F6CDD1Dull;
+    volatile uint64_t zero_v = 0;
+    uint64_t zero = zero_v;
+    uint64_t v = 0;
+    Axi4TransactionType tr;
+    memset(&tr, 0, sizeof(tr));
+    tr.action = MemAction_Read;
+    tr.xsize = 8;
+
+    (*res)["resident"].make_uint64(bytes);
+    for (int mode = 0; mode < 3; mode++) {
+        for (uint64_t i = 0; i < reads; i++) {
+            rnd ^= rnd << 13;
+            rnd ^= rnd >> 7;
+            rnd ^= rnd << 17;
+            if (mode == 0) {
+                offs[i] = (8 * i) % bytes;
+            } else if (mode == 1) {
+                // 256 hot 4 KB windows independent of the page size
+                offs[i] = ((rnd >> 32) & 0xff) * hotstep
+                        + (rnd & ((1 << PAGE_BITS_MIN) - 8));
+                offs[i] %= bytes;
+            } else {
+                offs[i] = (rnd % bytes) & ~0x7ull;
+            }
+            ptrs[i] = getpMem(offs[i], false);
+        }
+
+        uint64_t t1 = RISCV_get_time_ms();
+        for (uint64_t i = 0; i < reads; i++) {
+            tr.addr = getBaseAddress() + offs[i] + (v & zero);
+            b_transport(&tr);
+            v = tr.rpayload.b64[0];
+        }
+        uint64_t t2 = RISCV_get_time_ms();
+        for (uint64_t i = 0; i < reads; i++) {
+            v = *reinterpret_cast<uint64_t *>(ptrs[i] + (v & zero));
+        }
+        uint64_t t3 = RISCV_get_time_ms();
+
+        char name[32];
+        RISCV_sprintf(name, sizeof(name), "%s_ns", MODE_NAME[mode]);
+        (*res)[name].make_floating(1000000.0 * (t2 - t1) / reads);
+        RISCV_sprintf(name, sizeof(name), "%s_host_ns", MODE_NAME[mode]);
+        (*res)[name].make_floating(1000000.0 * (t3 - t2) / reads);
+    }
+    zero_v = v;
+    delete [] offs;
+    delete [] ptrs;
+}
+
 }  // namespace debugger
+
@@ -19,33 +19,120 @@
 #include "iclass.h"
 #include "iservice.h"
 #include "coreservices/imemop.h"
+#include "coreservices/icommand.h"
+#include "coreservices/icmdexec.h"
+#include "coreservices/isnapshot.h"
 
 namespace debugger {
 
-class DDR : public IService, 
-            public IMemoryOperation {
+class DdrCmdType : public ICommand {
+ public:
+    DdrCmdType(IService *parent, const char *name);
+
+    /** ICommand */
+    virtual int isValid(AttributeType *args);
+    virtual void exec(AttributeType *args, AttributeType *res);
+};
+
+/**
+ * Sparse memory model. Pages are allocated on the first write and found
+ * via 3-levels radix tree (4 KB pages and 42 bits of offset, or 64 KB
+ * pages and 46 bits), reading of not allocated page returns zeros.
+ *
+ * In-process snapshot marks all pages as shared (bit 0 of the tree item).
+ * The first write into the shared page saves its copy for the rollback,
+ * the page itself isn't moved so that granted DMI pointers stay valid.
+ *
+ * Lookup is lock-free, only the allocation of tables and pages is locked.
+ * Snapshot and storage methods are called with the halted simulation.
+ */
+class DDR : public IService,
+            public IMemoryOperation,
+            public ISnapshot {
  public:
     explicit DDR(const char *name);
     virtual ~DDR();
 
     /** IService interface */
     virtual void postinitService() override;
+    virtual void predeleteService() override;
 
     /** IMemoryOperation */
     virtual ETransStatus b_transport(Axi4TransactionType *trans);
+    virtual ETransStatus bulk_transport(BulkTransactionType *trans);
+    virtual bool get_direct_mem_ptr(uint64_t addr, DmiRegionType *dmi);
 
- private:
-    virtual uint8_t *getpMem(uint64_t addr);
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state) { state->make_nil(); }
+    virtual void restoreState(const AttributeType *state) {}
+    virtual uint64_t getStorageSize() { return getLength(); }
+    virtual uint8_t *getStoragePage(uint64_t off, bool alloc);
+    virtual void clearStorage();
+    virtual bool mapStorage(uint64_t off, uint64_t size,
+                            int fd, uint64_t fileoff);
+    virtual bool takeStorage();
+    virtual bool rollbackStorage();
+
+    /** Common methods */
+    uint64_t getResidentSize() { return page_total_ << pageBits_; }
+    uint64_t getPageTotal() { return page_total_; }
+    uint64_t getTableTotal() { return table_total_; }
+    uint64_t getCopiedTotal() { return cowCnt_; }
+    bool isMmapBacked() { return mmap_ != 0; }
+    uint64_t getPageSize() { return pageSize_; }
+    void lookupBench(uint64_t bytes, uint64_t reads, AttributeType *res);
 
  protected:
-    static const int BLOCK_SIZE = 1024*1024;
-
-    struct MemBlockType {
-        MemBlockType *nxt;
-        MemBlockType *prv;
-        uint64_t bid;
-        uint8_t m[BLOCK_SIZE];
-    } mem_;
+    static const int PAGE_BITS_MIN = SNAPSHOT_PAGE_BITS;
+    static const int PAGE_BITS_MAX = 16;
+    static const int TABLE_BITS = 10;
+    static const int TABLE_SIZE = 1 << TABLE_BITS;
+
+    struct PageTableType {
+        void *item[TABLE_SIZE];     // next level table or page
+        uint64_t tag;               // offset >> (pageBits_ + TABLE_BITS)
+    };
+
+    AttributeType mmapBacked_;
+    AttributeType pageSizeAttr_;
+    AttributeType cmdexec_;
+
+    ICmdExecutor *icmdexec_;
+    DdrCmdType *pcmd_;
+
+    PageTableType root_;
+    int pageBits_;
+    uint64_t pageSize_;
+    int offsetBits_;
+    uint8_t zeroPage_[1 << PAGE_BITS_MAX];
+    uint8_t *mmap_;                 // whole bank when mmap backed
+    uint64_t mmapSize_;
+    uint64_t page_total_;
+    uint64_t table_total_;
+
+    PageTableType * volatile lastTable_;    // last hit leaf table
+    mutex_def mutexAlloc_;          // allocation of tables, pages, copies
+
+    static const uintptr_t PAGE_SHARED = 1;
+    struct CowPageType {
+        uint64_t off;
+        uint8_t *copy;              // content on snapshot, 0 = zeros
+    } *cow_;
+    uint64_t cowCnt_;
+    uint64_t cowSize_;
+    bool cowActive_;
+
+ private:
+    uint8_t *getpMem(uint64_t off, bool alloc);
+    uint8_t *allocPage(uint64_t off);
+    PageTableType *getLeafTable(uint64_t off, bool alloc);
+    void **getPageItem(uint64_t off, bool alloc);
+    void allocTable(void **pitem, uint64_t tag);
+    uintptr_t fillPageItem(void **pitem, uint64_t off, bool unshare);
+    uint8_t *unsharePage(uint64_t off, uint8_t *pg);
+    void addCowPage(uint64_t off, uint8_t *copy);
+    void freeCowPages();
+    void freePages();
 };
 
 DECLARE_CLASS(DDR)
@@ -12,6 +12,8 @@ namespace debugger {
 
 GPTimers::GPTimers(const char *name)  : IService(name) {
     registerInterface(static_cast<IMemoryOperation *>(this));
+    registerInterface(static_cast<IClockListener *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("IrqControl", &irqctrl_);
     registerAttribute("ClkSource", &clksrc_);
 
@@ -38,6 +40,15 @@ void GPTimers::postinitService() {
     }
 }
 
+void GPTimers::saveState(AttributeType *state) {
+    state->make_dict();
+    (*state)["regs"].make_data(sizeof(regs_), &regs_);
+}
+
+void GPTimers::restoreState(const AttributeType *state) {
+    restoreData(state, "regs", &regs_, sizeof(regs_));
+}
+
 ETransStatus GPTimers::b_transport(Axi4TransactionType *trans) {
     uint64_t mask = (length_.to_uint64() - 1);
     uint64_t off = ((trans->addr - getBaseAddress()) & mask) / 4;
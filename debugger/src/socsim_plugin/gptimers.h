@@ -13,12 +13,14 @@
 #include "coreservices/imemop.h"
 #include "coreservices/iclock.h"
 #include "coreservices/iwire.h"
+#include "coreservices/isnapshot.h"
 
 namespace debugger {
 
 class GPTimers : public IService, 
                  public IMemoryOperation,
-                 public IClockListener {
+                 public IClockListener,
+                 public ISnapshot {
 public:
     GPTimers(const char *name);
     ~GPTimers();
@@ -32,6 +34,10 @@ public:
     /** IClockListener */
     virtual void stepCallback(uint64_t t);
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
 private:
     AttributeType irqctrl_;
     AttributeType clksrc_;
@@ -18,6 +18,7 @@
 #include "plic.h"
 #include <riscv-isa.h>
 #include "coreservices/icpuriscv.h"
+#include "coreservices/icpufunctional.h"
 
 namespace debugger {
 
@@ -25,10 +26,12 @@ PLIC::PLIC(const char *name) : RegMemBankGeneric(name),
     src_priority(static_cast<IService *>(this), "src_priority", 0x00, 1024),
     pending(static_cast<IService *>(this), "pending", 0x001000, 1024) {
     registerInterface(static_cast<IIrqController *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("ContextList", &contextList_);
 
     contextList_.make_list(0);
     pendingList_.make_list(0);
+    listeners_.make_list(0);
     ctx_enable = 0;
     ctx_priority_th = 0;
     ctx_claim = 0;
@@ -86,16 +89,59 @@ void PLIC::postinitService() {
 }
 
 int PLIC::requestInterrupt(IFace *isrc, int idx) {
+    RISCV_mutex_lock(&mutexAccess_);
     setPendingBit(idx);
+    notifyListeners();
+    RISCV_mutex_unlock(&mutexAccess_);
     return 0;
 }
 
+void PLIC::registerListener(int ctxid, IFace *icpu) {
+    RISCV_mutex_lock(&mutexAccess_);
+    for (unsigned i = 0; i < listeners_.size(); i++) {
+        if (listeners_[i][0u].to_int() == ctxid
+            && listeners_[i][1].to_iface() == icpu) {
+            RISCV_mutex_unlock(&mutexAccess_);
+            return;
+        }
+    }
+    AttributeType item;
+    item.make_list(2);
+    item[0u].make_int64(ctxid);
+    item[1].make_iface(icpu);
+    listeners_.add_to_list(&item);
+    RISCV_mutex_unlock(&mutexAccess_);
+}
+
+/** Register banks are saved by ports, only requests list is internal */
+void PLIC::saveState(AttributeType *state) {
+    state->make_dict();
+    (*state)["pending"] = pendingList_;
+}
+
+void PLIC::restoreState(const AttributeType *state) {
+    pendingList_.make_list(0);
+    if (state->has_key("pending")) {
+        pendingList_ = (*state)["pending"];
+    }
+    notifyListeners();
+}
+
+void PLIC::notifyListeners() {
+    ICpuFunctional *icpu;
+    for (unsigned i = 0; i < listeners_.size(); i++) {
+        icpu = static_cast<ICpuFunctional *>(listeners_[i][1].to_iface());
+        icpu->notifyInterrupt();
+    }
+}
+
 int PLIC::getPendingRequest(int ctxid) {
     uint32_t prio = 0;
     uint32_t irqidx = 0;
 
     // Select the highest priority request;
     uint32_t tidx;
+    RISCV_mutex_lock(&mutexAccess_);
     for (unsigned i = 0; i < pendingList_.size(); i++) {
         tidx = pendingList_[i].to_uint32();
         if (!isEnabled(tidx)) {
@@ -133,6 +179,7 @@ int PLIC::getPendingRequest(int ctxid) {
             }
         }
     }
+    RISCV_mutex_unlock(&mutexAccess_);
 
     return irqidx;
 }
@@ -200,6 +247,7 @@ void PLIC::clearPendingBit(int idx) {
 
 void PLIC::enableInterrupt(uint32_t ctxid, int idx) {
     RISCV_debug("Enable irq: context %d, irq=%d", ctxid, idx);
+    notifyListeners();
 }
 
 void PLIC::disableInterrupt(uint32_t ctxid, int idx) {
@@ -232,6 +280,16 @@ void PLIC::PLIC_ENABLE_TYPE::write(int idx, uint32_t val) {
     }
 }
 
+void PLIC::PLIC_SRC_PRIORITY_TYPE::write(int idx, uint32_t val) {
+    GenericReg32Bank::write(idx, val & 0x7);
+    static_cast<PLIC *>(parent_)->notifyListeners();
+}
+
+uint32_t PLIC::PLIC_CONTEXT_PRIOIRTY_TYPE::aboutToWrite(uint32_t nxt_val) {
+    static_cast<PLIC *>(parent_)->notifyListeners();
+    return nxt_val;
+}
+
 uint32_t PLIC::PLIC_CLAIM_COMPLETE_TYPE::aboutToRead(uint32_t prv_val) {
     PLIC *p = static_cast<PLIC *>(parent_);
     return p->claim(contextid_);
@@ -20,6 +20,7 @@
 #include <iservice.h>
 #include "coreservices/imemop.h"
 #include "coreservices/iirq.h"
+#include "coreservices/isnapshot.h"
 #include "generic/mapreg.h"
 #include "generic/rmembank_gen1.h"
 
@@ -28,7 +29,8 @@ namespace debugger {
 static const int PLIC_GLOBAL_IRQ_MAX = 1024;
 
 class PLIC : public RegMemBankGeneric,
-             public IIrqController {
+             public IIrqController,
+             public ISnapshot {
  public:
     explicit PLIC(const char *name);
     virtual ~PLIC();
@@ -39,6 +41,11 @@ class PLIC : public RegMemBankGeneric,
     /** IIrqController */
     virtual int requestInterrupt(IFace *isrc, int idx);
     virtual int getPendingRequest(int ctxid);
+    virtual void registerListener(int ctxid, IFace *icpu);
+
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
 
     /** Controller specific methods visible for ports */
     void enableInterrupt(uint32_t ctxid, int idx);
@@ -51,6 +58,7 @@ class PLIC : public RegMemBankGeneric,
  private:
     bool isEnabled(uint32_t irqidx);
     bool isUnmasked(uint32_t ctxid, uint32_t irqidx);
+    void notifyListeners();
 
  private:
 
@@ -70,9 +78,7 @@ class PLIC : public RegMemBankGeneric,
         PLIC_SRC_PRIORITY_TYPE(IService *parent, const char *name, uint64_t addr, int len)
             : GenericReg32Bank(parent, name, addr, len) {}
 
-        virtual void write(int idx, uint32_t val) override {
-            GenericReg32Bank::write(idx, val & 0x7);
-        }
+        virtual void write(int idx, uint32_t val) override;
     };
 
     class PLIC_CONTEXT_PRIOIRTY_TYPE : public MappedReg32Type {
@@ -83,6 +89,8 @@ class PLIC : public RegMemBankGeneric,
         }
 
         uint32_t getContextPrioiry() { return getValue().val & 0x7; }
+     protected:
+        virtual uint32_t aboutToWrite(uint32_t nxt_val) override;
      protected:
         unsigned contextid_;
     };
@@ -103,6 +111,7 @@ class PLIC : public RegMemBankGeneric,
 
     AttributeType contextList_;     // List of context names: [MCore0, MCore1, SCore1, MCore2, ...]
     AttributeType pendingList_;     // requested interrupt packed into attribute for better performance
+    AttributeType listeners_;       // [[ctxid, ICpuFunctional], ...]
 
     PLIC_SRC_PRIORITY_TYPE src_priority;            // [000000..000FFC] 0 doens't exists, 1..1023
     GenericReg32Bank pending;                       // [001000..00107C] 0..1023 1 bit per interrupt
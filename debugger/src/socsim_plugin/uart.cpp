@@ -32,6 +32,7 @@ UART::UART(const char *name) : RegMemBankGeneric(name),
     fwcpuid_(static_cast<IService *>(this), "fwcpuid", 0x1C) {
     registerInterface(static_cast<ISerial *>(this));
     registerInterface(static_cast<IClockListener *>(this));
+    registerInterface(static_cast<ISnapshot *>(this));
     registerAttribute("FifoSize", &fifoSize_);
     registerAttribute("IrqController", &irqctrl_);
     registerAttribute("IrqIdRx", &irqidrx_);
@@ -116,6 +117,7 @@ int UART::writeData(const char *buf, int sz) {
     if (rxfifo_ == 0) {
         return 0;
     }
+    RISCV_mutex_lock(&mutexAccess_);
     if (static_cast<uint32_t>(sz) > 
         (fifoSize_.to_uint32() - rx_total_)) {
         sz = (fifoSize_.to_uint32() - rx_total_);
@@ -133,6 +135,7 @@ int UART::writeData(const char *buf, int sz) {
         iirq_->requestInterrupt(static_cast<IService *>(this),
                               irqidrx_.to_int());
     }
+    RISCV_mutex_unlock(&mutexAccess_);
     return sz;
 }
 
@@ -168,6 +171,7 @@ void UART::closePort() {
 
 void UART::stepCallback(uint64_t t) {
     bool sent = false;
+    RISCV_mutex_lock(&mutexAccess_);
     if (tx_total_) {
         sent = true;
         tx_total_--;
@@ -181,6 +185,48 @@ void UART::stepCallback(uint64_t t) {
         iclk_->moveStepCallback(static_cast<IClockListener *>(this),
                                 t + getScaler());
     }
+    RISCV_mutex_unlock(&mutexAccess_);
+}
+
+/** Received bytes are saved in the reading order */
+void UART::saveState(AttributeType *state) {
+    const char *p = p_rx_rd_;
+    state->make_dict();
+    AttributeType &rx = (*state)["rx"];
+    rx.make_data(rx_total_);
+    for (uint32_t i = 0; i < rx_total_; i++) {
+        rx.data()[i] = static_cast<uint8_t>(*p);
+        if ((++p) >= (rxfifo_ + fifoSize_.to_int())) {
+            p = rxfifo_;
+        }
+    }
+    (*state)["tx"].make_data(sizeof(tx_fifo_), tx_fifo_);
+    (*state)["tx_wcnt"].make_uint64(tx_wcnt_);
+    (*state)["tx_total"].make_uint64(tx_total_);
+    (*state)["t_cb_cnt"].make_int64(t_cb_cnt_);
+}
+
+void UART::restoreState(const AttributeType *state) {
+    if (rxfifo_ == 0) {
+        return;
+    }
+    p_rx_wr_ = rxfifo_;
+    p_rx_rd_ = rxfifo_;
+    rx_total_ = 0;
+    if (state->has_key("rx") && (*state)["rx"].is_data()) {
+        const AttributeType &rx = (*state)["rx"];
+        uint32_t sz = rx.size();
+        if (sz > fifoSize_.to_uint32()) {
+            sz = fifoSize_.to_uint32();
+        }
+        memcpy(rxfifo_, rx.data(), sz);
+        rx_total_ = sz;
+        p_rx_wr_ = rxfifo_ + (sz % fifoSize_.to_uint32());
+    }
+    restoreData(state, "tx", tx_fifo_, sizeof(tx_fifo_));
+    tx_wcnt_ = (*state)["tx_wcnt"].to_uint32();
+    tx_total_ = (*state)["tx_total"].to_uint32();
+    t_cb_cnt_ = (*state)["t_cb_cnt"].to_int();
 }
 
 void UART::putByte(char v) {
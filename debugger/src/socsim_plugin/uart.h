@@ -23,6 +23,7 @@
 #include "coreservices/iirq.h"
 #include "coreservices/irawlistener.h"
 #include "coreservices/iclock.h"
+#include "coreservices/isnapshot.h"
 #include "coreservices/icommand.h"
 #include "coreservices/icmdexec.h"
 #include "generic/mapreg.h"
@@ -68,7 +69,8 @@ class UartCmdType : public ICommand {
 
 class UART : public RegMemBankGeneric,
              public ISerial,
-             public IClockListener {
+             public IClockListener,
+             public ISnapshot {
  public:
     explicit UART(const char *name);
     virtual ~UART();
@@ -88,6 +90,10 @@ class UART : public RegMemBankGeneric,
     /** IClockListener */
     virtual void stepCallback(uint64_t t);
 
+    /** ISnapshot */
+    virtual void saveState(AttributeType *state);
+    virtual void restoreState(const AttributeType *state);
+
     /** Common methods */
     uint32_t getScaler();
     int getFifoSize() { return fifoSize_.to_int(); }